@@ -13,6 +13,8 @@
 ** See the License for the specific language governing permissions and
 ** limitations under the License.
 */
+#include <amqpprox_backendhealthchecker.h>
+#include <amqpprox_backendoutlierdetector.h>
 #include <amqpprox_backendselectorstore.h>
 #include <amqpprox_backendstore.h>
 #include <amqpprox_bufferpool.h>
@@ -27,6 +29,7 @@
 #include <amqpprox_dataratelimitmanager.h>
 #include <amqpprox_logging.h>
 #include <amqpprox_loggingcontrolcommand.h>
+#include <amqpprox_metricsserver.h>
 #include <amqpprox_partitionpolicy.h>
 #include <amqpprox_partitionpolicystore.h>
 #include <amqpprox_resourcemapper.h>
@@ -38,6 +41,10 @@
 #include <amqpprox_vhoststate.h>
 
 // Backend selectors
+#include <amqpprox_hashbackendselector.h>
+#include <amqpprox_latencybackendselector.h>
+#include <amqpprox_leastconnectionsbackendselector.h>
+#include <amqpprox_poweroftwobackendselector.h>
 #include <amqpprox_robinbackendselector.h>
 
 // Partition policies
@@ -65,6 +72,8 @@
 #include <boost/program_options/value_semantic.hpp>
 #include <boost/program_options/variables_map.hpp>
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <thread>
@@ -94,6 +103,28 @@ int main(int argc, char *argv[])
     uint16_t    easyDestinationPort;
     std::string easyDestinationDNS;
     uint16_t    consoleVerbosity;
+    uint16_t    ioThreads;
+    bool        reusePort;
+    std::size_t maxInFlightBytes;
+    uint32_t    writeCoalesceMicros;
+    bool        splicePassthrough;
+    bool        countOnlyPassthrough;
+    bool        speculativeReads;
+    std::size_t bufferMemoryHighWatermark;
+    std::size_t bufferMemoryLowWatermark;
+    uint32_t    bufferReleaseIdleMs;
+    uint16_t    metricsPort;
+    uint32_t    healthCheckIntervalMs;
+    uint32_t    healthCheckTimeoutMs;
+    uint32_t    healthCheckUnhealthyThreshold;
+    uint32_t    healthCheckHealthyThreshold;
+    uint32_t    outlierDetectionIntervalMs;
+    uint32_t    outlierFailurePercent;
+    uint64_t    outlierMinimumConnections;
+    uint32_t    outlierBaseEjectionMs;
+    uint32_t    outlierMaxEjectionMs;
+    uint32_t    outlierMaxEjectedPercent;
+    std::string affinityClientProperty;
 
     // Set up the basic command line options to allow multiple instances to run
     // on a single box without colliding
@@ -120,7 +151,88 @@ int main(int argc, char *argv[])
         "consoleVerbosity,v",
         po::value<uint16_t>(&consoleVerbosity)->default_value(0),
         "Default console logging verbosity (0 = No output through to 5 = "
-        "Trace-level)");
+        "Trace-level)")(
+        "ioThreads",
+        po::value<uint16_t>(&ioThreads)->default_value(1),
+        "Number of threads servicing client and broker connections")(
+        "reusePort",
+        po::bool_switch(&reusePort),
+        "Open a SO_REUSEPORT acceptor per I/O thread on each listening port")(
+        "maxInFlightBytes",
+        po::value<std::size_t>(&maxInFlightBytes)->default_value(0),
+        "Bytes each direction of a connection may have in flight before "
+        "reading pauses (0 = read only once the previous write completes)")(
+        "writeCoalesceMicros",
+        po::value<uint32_t>(&writeCoalesceMicros)->default_value(0),
+        "Microseconds a small write may wait for more data to be written with "
+        "it (0 = write immediately)")(
+        "splicePassthrough",
+        po::bool_switch(&splicePassthrough),
+        "Move data between established plaintext connections with splice(), "
+        "counting bytes but not frames")(
+        "countOnlyPassthrough",
+        po::bool_switch(&countOnlyPassthrough),
+        "Pass data on established connections through without parsing "
+        "frames, counting bytes but not frames")(
+        "speculativeReads",
+        po::bool_switch(&speculativeReads),
+        "Read plaintext connections before waiting for readiness, saving "
+        "system calls on busy connections")(
+        "bufferMemoryHighWatermark",
+        po::value<std::size_t>(&bufferMemoryHighWatermark)->default_value(0),
+        "Bytes of buffer memory in use at which the connections holding the "
+        "most stop reading from clients (0 = unlimited)")(
+        "bufferMemoryLowWatermark",
+        po::value<std::size_t>(&bufferMemoryLowWatermark)->default_value(0),
+        "Bytes of buffer memory in use at which paused connections resume "
+        "reading (0 = 75% of the high watermark)")(
+        "bufferReleaseIdleMs",
+        po::value<uint32_t>(&bufferReleaseIdleMs)->default_value(30000u),
+        "Return buffer memory unused for this long to the OS (0 = never)")(
+        "metricsPort",
+        po::value<uint16_t>(&metricsPort)->default_value(0),
+        "Serve statistics in the OpenMetrics format over HTTP at /metrics on "
+        "this port (0 = disabled)")(
+        "healthCheckIntervalMs",
+        po::value<uint32_t>(&healthCheckIntervalMs)->default_value(0),
+        "Check each backend accepts AMQP connections this often, leaving out "
+        "unhealthy ones when selecting backends (0 = no checks)")(
+        "healthCheckTimeoutMs",
+        po::value<uint32_t>(&healthCheckTimeoutMs)->default_value(2000u),
+        "Time a backend health check may take before failing")(
+        "healthCheckUnhealthyThreshold",
+        po::value<uint32_t>(&healthCheckUnhealthyThreshold)->default_value(3),
+        "Health checks failed in a row marking a backend unhealthy")(
+        "healthCheckHealthyThreshold",
+        po::value<uint32_t>(&healthCheckHealthyThreshold)->default_value(2),
+        "Health checks passed in a row marking a backend healthy again")(
+        "outlierDetectionIntervalMs",
+        po::value<uint32_t>(&outlierDetectionIntervalMs)->default_value(0),
+        "Look for backends failing connections this often, ejecting them from "
+        "selection for a while (0 = no outlier detection)")(
+        "outlierFailurePercent",
+        po::value<uint32_t>(&outlierFailurePercent)->default_value(50),
+        "Percentage of a backend's connections over the last 10 intervals "
+        "that must fail, or be dropped once made, to eject it")(
+        "outlierMinimumConnections",
+        po::value<uint64_t>(&outlierMinimumConnections)->default_value(5),
+        "Connections to a backend over the last 10 intervals needed before "
+        "it may be ejected")(
+        "outlierBaseEjectionMs",
+        po::value<uint32_t>(&outlierBaseEjectionMs)->default_value(30000),
+        "Length of a backend's first ejection, doubling with each ejection "
+        "after")(
+        "outlierMaxEjectionMs",
+        po::value<uint32_t>(&outlierMaxEjectionMs)->default_value(300000),
+        "Longest a backend is ejected for")(
+        "outlierMaxEjectedPercent",
+        po::value<uint32_t>(&outlierMaxEjectedPercent)->default_value(50),
+        "Largest percentage of a farm's backends left out of selection for "
+        "being ejected")(
+        "affinityClientProperty",
+        po::value<std::string>(&affinityClientProperty),
+        "Client property whose value the consistent-hash selector places "
+        "connections by, along with their vhost");
 
     po::variables_map variablesMap;
 
@@ -159,6 +271,36 @@ int main(int argc, char *argv[])
         return 3;
     }
 
+    if (ioThreads == 0) {
+        std::cout << "At least one I/O thread is required\n";
+        return 4;
+    }
+
+    if (bufferMemoryLowWatermark > bufferMemoryHighWatermark) {
+        std::cout << "The buffer memory low watermark must not exceed the "
+                     "high watermark\n";
+        return 5;
+    }
+
+    if (healthCheckUnhealthyThreshold == 0 ||
+        healthCheckHealthyThreshold == 0) {
+        std::cout << "The health check thresholds must be at least 1\n";
+        return 7;
+    }
+
+    if (outlierFailurePercent == 0 || outlierFailurePercent > 100 ||
+        outlierMaxEjectedPercent > 100 ||
+        outlierBaseEjectionMs > outlierMaxEjectionMs) {
+        std::cout << "The outlier detection percentages must be at most 100, "
+                     "the failure percentage at least 1, and the base "
+                     "ejection time must not exceed the maximum\n";
+        return 8;
+    }
+
+    if (bufferMemoryLowWatermark == 0) {
+        bufferMemoryLowWatermark = bufferMemoryHighWatermark / 4 * 3;
+    }
+
     Logging::start(logDirectory);
 
     std::cout << "Starting amqpprox, logging to: '" << logDirectory
@@ -201,12 +343,32 @@ int main(int argc, char *argv[])
 
     Server server(
         &connectionSelector, &eventSource, &bufferPool, &dataRateLimitManager);
+
+    server.setReusePort(reusePort);
+    server.setInFlightWriteLimit(maxInFlightBytes);
+    server.setWriteCoalesceDelay(
+        std::chrono::microseconds(writeCoalesceMicros));
+    server.setSplicePassthrough(splicePassthrough);
+    server.setCountOnlyPassthrough(countOnlyPassthrough);
+    server.setSpeculativeReads(speculativeReads);
+    server.setAffinityClientProperty(affinityClientProperty);
+    server.setMemoryBudget(bufferMemoryHighWatermark,
+                           bufferMemoryLowWatermark);
+
+    for (uint16_t i = 1; i < ioThreads; ++i) {
+        server.addWorker();
+    }
+
     Control control(&server, &eventSource, controlSocket);
 
     // Set up the backend selector store
     using BackendSelectorPtr       = std::unique_ptr<BackendSelector>;
     BackendSelectorPtr selectors[] = {
-        BackendSelectorPtr(new RobinBackendSelector)};
+        BackendSelectorPtr(new RobinBackendSelector),
+        BackendSelectorPtr(new LeastConnectionsBackendSelector),
+        BackendSelectorPtr(new PowerOfTwoBackendSelector),
+        BackendSelectorPtr(new LatencyBackendSelector),
+        BackendSelectorPtr(new HashBackendSelector)};
 
     for (auto &&selector : selectors) {
         backendSelectorStore.addSelector(std::move(selector));
@@ -263,6 +425,22 @@ int main(int argc, char *argv[])
                                              std::placeholders::_1,
                                              std::placeholders::_2));
 
+    // Schedule returning idle buffer memory to the OS
+    if (bufferReleaseIdleMs != 0) {
+        control.scheduleRecurringEvent(
+            std::min(bufferReleaseIdleMs, 1000u),
+            "buffer-trim",
+            [&bufferPool, bufferReleaseIdleMs](Control *, Server *) {
+                std::size_t released = bufferPool.trim(
+                    std::chrono::milliseconds(bufferReleaseIdleMs));
+                if (released > 0) {
+                    LOG_DEBUG << "Released " << released
+                              << " bytes of idle buffer memory";
+                }
+                return true;
+            });
+    }
+
     // Schedule the self-CPU monitor
     control.scheduleRecurringEvent(CpuMonitor::intervalMs(),
                                    "cpu-monitor",
@@ -271,6 +449,59 @@ int main(int argc, char *argv[])
                                              std::placeholders::_1,
                                              std::placeholders::_2));
 
+    // Schedule the active backend health checks, which run on the control
+    // thread and report the health of every backend in the statistics
+    BackendHealthChecker healthChecker(control.ioContext(), &backendStore);
+    if (healthCheckIntervalMs != 0) {
+        healthChecker.setTimeout(
+            std::chrono::milliseconds(healthCheckTimeoutMs));
+        healthChecker.setThresholds(healthCheckUnhealthyThreshold,
+                                    healthCheckHealthyThreshold);
+        statCollector.setBackendStore(&backendStore);
+        control.scheduleRecurringEvent(
+            healthCheckIntervalMs,
+            "backend-health-check",
+            [&healthChecker](Control *, Server *) {
+                healthChecker.checkBackends();
+                return true;
+            });
+    }
+
+    // Schedule the passive outlier detection, which ejects backends failing
+    // the connections sessions make to them
+    BackendOutlierDetector outlierDetector(&backendStore);
+    if (outlierDetectionIntervalMs != 0) {
+        outlierDetector.setFailureThreshold(outlierFailurePercent,
+                                            outlierMinimumConnections);
+        outlierDetector.setEjectionTimes(
+            std::chrono::milliseconds(outlierBaseEjectionMs),
+            std::chrono::milliseconds(outlierMaxEjectionMs));
+        connectionSelector.setMaxEjectedPercent(outlierMaxEjectedPercent);
+        statCollector.setBackendStore(&backendStore);
+        control.scheduleRecurringEvent(
+            outlierDetectionIntervalMs,
+            "backend-outlier-detection",
+            [&outlierDetector](Control *, Server *) {
+                outlierDetector.detect(std::chrono::steady_clock::now());
+                return true;
+            });
+    }
+
+    // Serve the statistics from the control thread, where they are collected
+    std::unique_ptr<MetricsServer> metricsServer;
+    if (metricsPort != 0) {
+        metricsServer =
+            std::make_unique<MetricsServer>(control.ioContext(), &eventSource);
+
+        boost::system::error_code ec;
+        metricsServer->listen(metricsPort, ec);
+        if (ec) {
+            std::cout << "Failed to serve metrics on port " << metricsPort
+                      << ": " << ec.message() << "\n";
+            return 6;
+        }
+    }
+
     // Start the control thread separately
     std::thread controlThread([&]() { control.run(); });
 
@@ -37,6 +37,8 @@ Backend::Backend(const std::string &name,
 , d_proxyProtocolEnabled(proxyEnabled)
 , d_tlsEnabled(tlsEnabled)
 , d_dnsBasedEntry(dnsBasedEntry)
+, d_counters(std::make_shared<BackendCounters>())
+, d_health(std::make_shared<BackendHealth>())
 {
 }
 
@@ -49,6 +51,8 @@ Backend::Backend()
 , d_proxyProtocolEnabled(false)
 , d_tlsEnabled(false)
 , d_dnsBasedEntry(false)
+, d_counters(std::make_shared<BackendCounters>())
+, d_health(std::make_shared<BackendHealth>())
 {
 }
 
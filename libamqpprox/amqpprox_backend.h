@@ -16,7 +16,11 @@
 #ifndef BLOOMBERG_AMQPPROX_BACKEND
 #define BLOOMBERG_AMQPPROX_BACKEND
 
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendhealth.h>
+
 #include <iosfwd>
+#include <memory>
 #include <string>
 
 namespace Bloomberg {
@@ -26,14 +30,16 @@ namespace amqpprox {
  * \brief Represents an backend server
  */
 class Backend {
-    std::string d_name;
-    std::string d_datacenterTag;
-    std::string d_host;
-    std::string d_ip;
-    int         d_port;
-    bool        d_proxyProtocolEnabled;
-    bool        d_tlsEnabled;
-    bool        d_dnsBasedEntry;
+    std::string                      d_name;
+    std::string                      d_datacenterTag;
+    std::string                      d_host;
+    std::string                      d_ip;
+    int                              d_port;
+    bool                             d_proxyProtocolEnabled;
+    bool                             d_tlsEnabled;
+    bool                             d_dnsBasedEntry;
+    std::shared_ptr<BackendCounters> d_counters;
+    std::shared_ptr<BackendHealth>   d_health;
 
   public:
     Backend(const std::string &name,
@@ -55,6 +61,17 @@ class Backend {
     inline bool               proxyProtocolEnabled() const;
     inline bool               tlsEnabled() const;
     inline bool               dnsBasedEntry() const;
+
+    /**
+     * \return the live load counters, shared with copies of this backend
+     */
+    inline const std::shared_ptr<BackendCounters> &counters() const;
+
+    /**
+     * \return the health from active checks, shared with copies of this
+     * backend
+     */
+    inline const std::shared_ptr<BackendHealth> &health() const;
 };
 
 inline const std::string &Backend::host() const
@@ -97,6 +114,16 @@ inline bool Backend::dnsBasedEntry() const
     return d_dnsBasedEntry;
 }
 
+inline const std::shared_ptr<BackendCounters> &Backend::counters() const
+{
+    return d_counters;
+}
+
+inline const std::shared_ptr<BackendHealth> &Backend::health() const
+{
+    return d_health;
+}
+
 std::ostream &operator<<(std::ostream &os, const Backend &backend);
 
 bool operator==(const Backend &lhs, const Backend &rhs);
@@ -0,0 +1,127 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendcounters.h>
+
+#include <algorithm>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+int64_t wholeSeconds(BackendCounters::TimePoint now)
+{
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               now.time_since_epoch())
+        .count();
+}
+
+}
+
+BackendCounters::BackendCounters()
+: d_connections(0)
+, d_second(0)
+, d_secondBytes(0)
+, d_previousSecondBytes(0)
+, d_totalBytes(0)
+, d_latencies()
+, d_lastLatencySample(0)
+, d_succeeded(0)
+, d_failed(0)
+, d_snapped(0)
+{
+}
+
+void BackendCounters::addBytes(uint64_t bytes, TimePoint now)
+{
+    int64_t second  = wholeSeconds(now);
+    int64_t current = d_second.load(std::memory_order_relaxed);
+    if (second > current &&
+        d_second.compare_exchange_strong(current, second)) {
+        // Only the thread moving the window on carries the last second over.
+        // Bytes added by others meanwhile may land in either second, which
+        // is close enough for balancing load.
+        uint64_t last = d_secondBytes.exchange(0);
+        d_previousSecondBytes.store(second == current + 1 ? last : 0,
+                                    std::memory_order_relaxed);
+    }
+    d_secondBytes.fetch_add(bytes, std::memory_order_relaxed);
+    d_totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void BackendCounters::recordLatency(Phase                     phase,
+                                    std::chrono::microseconds sample,
+                                    TimePoint                 now)
+{
+    // Zero marks an unset average, so even instant samples count as 1us
+    int64_t micros = std::max<int64_t>(sample.count(), 1);
+
+    std::atomic<int64_t> &average =
+        d_latencies[static_cast<std::size_t>(phase)];
+    int64_t current = average.load(std::memory_order_relaxed);
+    int64_t updated;
+    do {
+        updated = current ? current + (micros - current) / 4 : micros;
+        updated = std::max<int64_t>(updated, 1);
+    } while (!average.compare_exchange_weak(
+        current, updated, std::memory_order_relaxed));
+
+    d_lastLatencySample.store(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            now.time_since_epoch())
+            .count(),
+        std::memory_order_relaxed);
+}
+
+uint64_t BackendCounters::bytesPerSecond(TimePoint now) const
+{
+    int64_t second  = wholeSeconds(now);
+    int64_t current = d_second.load(std::memory_order_relaxed);
+    if (second == current) {
+        return d_previousSecondBytes.load(std::memory_order_relaxed);
+    }
+    else if (second == current + 1) {
+        // Nothing has moved the window on yet, the second counting is over
+        return d_secondBytes.load(std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+std::chrono::microseconds BackendCounters::latency(Phase phase) const
+{
+    return std::chrono::microseconds(
+        d_latencies[static_cast<std::size_t>(phase)].load(
+            std::memory_order_relaxed));
+}
+
+std::chrono::microseconds BackendCounters::setupLatency() const
+{
+    std::chrono::microseconds total(0);
+    for (const auto &latency : d_latencies) {
+        total += std::chrono::microseconds(
+            latency.load(std::memory_order_relaxed));
+    }
+    return total;
+}
+
+BackendCounters::TimePoint BackendCounters::lastLatencySample() const
+{
+    return TimePoint(std::chrono::microseconds(
+        d_lastLatencySample.load(std::memory_order_relaxed)));
+}
+
+}
+}
@@ -0,0 +1,223 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_BACKENDCOUNTERS
+#define BLOOMBERG_AMQPPROX_BACKENDCOUNTERS
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Live load counters for a `Backend`, shared by every session
+ * connecting to it
+ *
+ * All operations are lock-free and safe to call concurrently from any
+ * thread. The byte rate is counted over whole seconds, so it lags the
+ * traffic by up to a second, which is ample for choosing between backends.
+ * Connection setup latencies are kept as exponentially weighted moving
+ * averages, each new sample counting for a quarter.
+ */
+class BackendCounters {
+  public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    /**
+     * \brief The timed steps of setting up a connection to the backend
+     */
+    enum class Phase {
+        CONNECT,        // TCP connect
+        TLS_HANDSHAKE,  // TLS handshake, for TLS backends only
+        BROKER_START,   // Protocol header sent until Connection.Start read
+        NUM_PHASES
+    };
+
+  private:
+    static constexpr std::size_t NUM_PHASES =
+        static_cast<std::size_t>(Phase::NUM_PHASES);
+
+    std::atomic<uint64_t> d_connections;
+    std::atomic<int64_t>  d_second;
+    std::atomic<uint64_t> d_secondBytes;
+    std::atomic<uint64_t> d_previousSecondBytes;
+    std::atomic<uint64_t> d_totalBytes;
+    std::atomic<int64_t>  d_latencies[NUM_PHASES];  // microseconds, 0 unset
+    std::atomic<int64_t>  d_lastLatencySample;  // since epoch, microseconds
+    std::atomic<uint64_t> d_succeeded;
+    std::atomic<uint64_t> d_failed;
+    std::atomic<uint64_t> d_snapped;
+
+  public:
+    // CREATORS
+    BackendCounters();
+
+    BackendCounters(const BackendCounters &) = delete;
+    BackendCounters &operator=(const BackendCounters &) = delete;
+
+    // MANIPULATORS
+    /**
+     * \brief Count a session starting to connect to the backend
+     */
+    inline void connectionOpened();
+
+    /**
+     * \brief Count a session counted by `connectionOpened` no longer being
+     * connected to the backend
+     */
+    inline void connectionClosed();
+
+    /**
+     * \brief Count bytes passed between a client and the backend
+     * \param bytes the number of bytes
+     * \param now the current time
+     */
+    void addBytes(uint64_t bytes, TimePoint now);
+
+    /**
+     * \brief Count a connection to the backend getting as far as the broker
+     * sending `Connection.Start`
+     */
+    inline void connectionSucceeded();
+
+    /**
+     * \brief Count a connection to the backend failing to be made, or being
+     * dropped by the backend before sending `Connection.Start`
+     */
+    inline void connectionFailed();
+
+    /**
+     * \brief Count a connection counted by `connectionSucceeded` being
+     * dropped by the backend afterwards
+     */
+    inline void connectionSnapped();
+
+    /**
+     * \brief Fold a latency sample into the moving average for its phase
+     * \param phase the step of connection setup that was timed
+     * \param sample how long it took
+     * \param now the current time
+     */
+    void recordLatency(Phase                     phase,
+                       std::chrono::microseconds sample,
+                       TimePoint                 now);
+
+    // ACCESSORS
+    /**
+     * \return the number of sessions connecting or connected to the backend
+     */
+    inline uint64_t connections() const;
+
+    /**
+     * \param now the current time
+     * \return the bytes passed through to the backend in the last whole
+     * second
+     */
+    uint64_t bytesPerSecond(TimePoint now) const;
+
+    /**
+     * \return the bytes passed through to the backend since it was created
+     */
+    inline uint64_t totalBytes() const;
+
+    /**
+     * \return the moving average latency of `phase`, or zero if it has
+     * never been sampled
+     */
+    std::chrono::microseconds latency(Phase phase) const;
+
+    /**
+     * \return the sum of the moving average latencies of all phases
+     */
+    std::chrono::microseconds setupLatency() const;
+
+    /**
+     * \return when a latency was last recorded, or the epoch if never
+     */
+    TimePoint lastLatencySample() const;
+
+    /**
+     * \return the number of connections counted by `connectionSucceeded`
+     */
+    inline uint64_t succeededConnections() const;
+
+    /**
+     * \return the number of connections counted by `connectionFailed`
+     */
+    inline uint64_t failedConnections() const;
+
+    /**
+     * \return the number of connections counted by `connectionSnapped`
+     */
+    inline uint64_t snappedConnections() const;
+};
+
+inline void BackendCounters::connectionOpened()
+{
+    d_connections.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BackendCounters::connectionClosed()
+{
+    d_connections.fetch_sub(1, std::memory_order_relaxed);
+}
+
+inline void BackendCounters::connectionSucceeded()
+{
+    d_succeeded.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BackendCounters::connectionFailed()
+{
+    d_failed.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline void BackendCounters::connectionSnapped()
+{
+    d_snapped.fetch_add(1, std::memory_order_relaxed);
+}
+
+inline uint64_t BackendCounters::connections() const
+{
+    return d_connections.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BackendCounters::totalBytes() const
+{
+    return d_totalBytes.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BackendCounters::succeededConnections() const
+{
+    return d_succeeded.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BackendCounters::failedConnections() const
+{
+    return d_failed.load(std::memory_order_relaxed);
+}
+
+inline uint64_t BackendCounters::snappedConnections() const
+{
+    return d_snapped.load(std::memory_order_relaxed);
+}
+
+}
+}
+
+#endif
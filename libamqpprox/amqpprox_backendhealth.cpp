@@ -0,0 +1,75 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendhealth.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+BackendHealth::BackendHealth()
+: d_healthy(true)
+, d_consecutivePasses(0)
+, d_consecutiveFailures(0)
+, d_ejectedUntil(0)
+{
+}
+
+bool BackendHealth::recordCheck(bool     passed,
+                                uint32_t unhealthyThreshold,
+                                uint32_t healthyThreshold)
+{
+    uint32_t streak;
+    if (passed) {
+        d_consecutiveFailures.store(0, std::memory_order_relaxed);
+        streak =
+            d_consecutivePasses.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+    else {
+        d_consecutivePasses.store(0, std::memory_order_relaxed);
+        streak =
+            d_consecutiveFailures.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    bool healthy = isHealthy();
+    if (healthy != passed &&
+        streak >= (passed ? healthyThreshold : unhealthyThreshold)) {
+        d_healthy.store(passed, std::memory_order_relaxed);
+        return true;
+    }
+
+    return false;
+}
+
+void BackendHealth::ejectUntil(TimePoint until)
+{
+    d_ejectedUntil.store(std::chrono::duration_cast<std::chrono::microseconds>(
+                             until.time_since_epoch())
+                             .count(),
+                         std::memory_order_relaxed);
+}
+
+bool BackendHealth::isEjected(TimePoint now) const
+{
+    return now < ejectedUntil();
+}
+
+BackendHealth::TimePoint BackendHealth::ejectedUntil() const
+{
+    return TimePoint(std::chrono::microseconds(
+        d_ejectedUntil.load(std::memory_order_relaxed)));
+}
+
+}
+}
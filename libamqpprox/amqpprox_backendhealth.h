@@ -0,0 +1,111 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_BACKENDHEALTH
+#define BLOOMBERG_AMQPPROX_BACKENDHEALTH
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Health of a `Backend` as judged by active checks and by the outlier
+ * detection of its connections, shared by every copy of the `Backend`
+ *
+ * A backend starts out healthy. It's marked unhealthy after a number of
+ * consecutive failed checks, and healthy again after a number of
+ * consecutive passed checks, so that one lost probe doesn't flap it in and
+ * out of selection. Separately it may be ejected until a point in time, after
+ * which it's readmitted without further action. Reading the state is
+ * lock-free and safe from any thread, checks for one backend must be
+ * recorded from one thread at a time.
+ */
+class BackendHealth {
+  public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+  private:
+    std::atomic<bool>     d_healthy;
+    std::atomic<uint32_t> d_consecutivePasses;
+    std::atomic<uint32_t> d_consecutiveFailures;
+    std::atomic<int64_t>  d_ejectedUntil;  // since epoch, microseconds
+
+  public:
+    // CREATORS
+    BackendHealth();
+
+    BackendHealth(const BackendHealth &) = delete;
+    BackendHealth &operator=(const BackendHealth &) = delete;
+
+    // MANIPULATORS
+    /**
+     * \brief Record the outcome of a health check
+     * \param passed whether the check passed
+     * \param unhealthyThreshold consecutive failed checks marking a healthy
+     * backend unhealthy
+     * \param healthyThreshold consecutive passed checks marking an unhealthy
+     * backend healthy
+     * \return true if this changed whether the backend is healthy
+     */
+    bool recordCheck(bool     passed,
+                     uint32_t unhealthyThreshold,
+                     uint32_t healthyThreshold);
+
+    /**
+     * \brief Eject the backend until the specified time, replacing any
+     * earlier ejection
+     */
+    void ejectUntil(TimePoint until);
+
+    // ACCESSORS
+    /**
+     * \return true unless the backend has been marked unhealthy
+     */
+    inline bool isHealthy() const;
+
+    /**
+     * \return the number of checks failed since the last one passed
+     */
+    inline uint32_t consecutiveFailures() const;
+
+    /**
+     * \return true if the backend is ejected at `now`
+     */
+    bool isEjected(TimePoint now) const;
+
+    /**
+     * \return when the latest ejection ends, or the epoch if the backend was
+     * never ejected
+     */
+    TimePoint ejectedUntil() const;
+};
+
+inline bool BackendHealth::isHealthy() const
+{
+    return d_healthy.load(std::memory_order_relaxed);
+}
+
+inline uint32_t BackendHealth::consecutiveFailures() const
+{
+    return d_consecutiveFailures.load(std::memory_order_relaxed);
+}
+
+}
+}
+
+#endif
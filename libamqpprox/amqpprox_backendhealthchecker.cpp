@@ -0,0 +1,259 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendhealthchecker.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendstore.h>
+#include <amqpprox_buffer.h>
+#include <amqpprox_constants.h>
+#include <amqpprox_frame.h>
+#include <amqpprox_logging.h>
+#include <amqpprox_methods_start.h>
+#include <amqpprox_proxyprotocolheaderv1.h>
+
+#include <boost/endian/arithmetic.hpp>
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <sstream>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+// A method frame's header, then the class and method of the method
+const std::size_t RESPONSE_SIZE = Frame::frameHeaderSize() + 4;
+
+const uint8_t METHOD_FRAME_TYPE = 1;
+
+/**
+ * \brief Checks one backend, calling back exactly once with the outcome
+ */
+class HealthCheck : public std::enable_shared_from_this<HealthCheck> {
+    using tcp        = boost::asio::ip::tcp;
+    using error_code = boost::system::error_code;
+    using Completion =
+        std::function<void(bool passed, const std::string &reason)>;
+
+    Backend                            d_backend;
+    tcp::resolver                      d_resolver;
+    tcp::socket                        d_socket;
+    boost::asio::steady_timer          d_timer;
+    std::string                        d_request;
+    std::array<uint8_t, RESPONSE_SIZE> d_response;
+    Completion                         d_completion;
+    bool                               d_finished;
+
+  public:
+    HealthCheck(boost::asio::io_context &ioContext,
+                const Backend           &backend,
+                Completion               completion)
+    : d_backend(backend)
+    , d_resolver(ioContext)
+    , d_socket(ioContext)
+    , d_timer(ioContext)
+    , d_request()
+    , d_response()
+    , d_completion(std::move(completion))
+    , d_finished(false)
+    {
+    }
+
+    void start(std::chrono::milliseconds timeout)
+    {
+        auto self(shared_from_this());
+        d_timer.expires_after(timeout);
+        d_timer.async_wait([this, self](const error_code &ec) {
+            if (!ec) {
+                finish(false, "timed out");
+            }
+        });
+
+        // Resolve as sessions do, so the check follows DNS changes
+        d_resolver.async_resolve(
+            d_backend.dnsBasedEntry() ? d_backend.host() : d_backend.ip(),
+            std::to_string(d_backend.port()),
+            [this, self](const error_code                &ec,
+                         const tcp::resolver::results_type &results) {
+                if (ec) {
+                    finish(false, "resolve failed: " + ec.message());
+                    return;
+                }
+                connect(results);
+            });
+    }
+
+  private:
+    void connect(const tcp::resolver::results_type &results)
+    {
+        auto self(shared_from_this());
+        boost::asio::async_connect(
+            d_socket,
+            results,
+            [this, self](const error_code &ec, const tcp::endpoint &) {
+                if (ec) {
+                    finish(false, "connect failed: " + ec.message());
+                    return;
+                }
+
+                if (d_backend.tlsEnabled()) {
+                    // Without a TLS session the broker can't be spoken to
+                    finish(true, "");
+                    return;
+                }
+
+                sendProtocolHeader();
+            });
+    }
+
+    void sendProtocolHeader()
+    {
+        if (d_backend.proxyProtocolEnabled()) {
+            std::ostringstream oss;
+            oss << ProxyProtocolHeaderV1();
+            d_request = oss.str();
+        }
+        d_request.append(Constants::protocolHeader(),
+                         Constants::protocolHeaderLength());
+
+        auto self(shared_from_this());
+        boost::asio::async_write(
+            d_socket,
+            boost::asio::buffer(d_request),
+            [this, self](const error_code &ec, std::size_t) {
+                if (ec) {
+                    finish(false, "write failed: " + ec.message());
+                    return;
+                }
+                readStart();
+            });
+    }
+
+    void readStart()
+    {
+        auto self(shared_from_this());
+        boost::asio::async_read(
+            d_socket,
+            boost::asio::buffer(d_response),
+            [this, self](const error_code &ec, std::size_t) {
+                if (ec) {
+                    finish(false, "read failed: " + ec.message());
+                    return;
+                }
+
+                Buffer response(d_response.data(), d_response.size());
+                auto   type    = response.copy<uint8_t>();
+                auto   channel = response.copy<boost::endian::big_uint16_t>();
+                response.skip(sizeof(boost::endian::big_uint32_t));
+                auto classType  = response.copy<boost::endian::big_uint16_t>();
+                auto methodType = response.copy<boost::endian::big_uint16_t>();
+
+                if (type != METHOD_FRAME_TYPE || channel != 0 ||
+                    classType != methods::Start::classType() ||
+                    methodType != methods::Start::methodType()) {
+                    finish(false, "no Connection.Start received");
+                    return;
+                }
+                finish(true, "");
+            });
+    }
+
+    void finish(bool passed, const std::string &reason)
+    {
+        if (d_finished) {
+            return;
+        }
+        d_finished = true;
+
+        // Closing aborts whichever step was outstanding
+        error_code ec;
+        d_timer.cancel();
+        d_resolver.cancel();
+        d_socket.close(ec);
+
+        d_completion(passed, reason);
+    }
+};
+
+}
+
+BackendHealthChecker::BackendHealthChecker(boost::asio::io_context &ioContext,
+                                           BackendStore *backendStore)
+: d_ioContext(ioContext)
+, d_backendStore_p(backendStore)
+, d_timeout(std::chrono::seconds(2))
+, d_unhealthyThreshold(3)
+, d_healthyThreshold(2)
+, d_checking()
+{
+}
+
+void BackendHealthChecker::setTimeout(std::chrono::milliseconds timeout)
+{
+    d_timeout = timeout;
+}
+
+void BackendHealthChecker::setThresholds(uint32_t unhealthyThreshold,
+                                         uint32_t healthyThreshold)
+{
+    d_unhealthyThreshold = unhealthyThreshold;
+    d_healthyThreshold   = healthyThreshold;
+}
+
+void BackendHealthChecker::checkBackends()
+{
+    for (const Backend &backend : d_backendStore_p->backends()) {
+        if (!d_checking.insert(backend.name()).second) {
+            continue;
+        }
+
+        std::shared_ptr<BackendHealth> health = backend.health();
+        std::string                    name   = backend.name();
+        auto completion = [this, health, name](bool               passed,
+                                               const std::string &reason) {
+            d_checking.erase(name);
+
+            bool changed = health->recordCheck(
+                passed, d_unhealthyThreshold, d_healthyThreshold);
+            if (changed && passed) {
+                LOG_INFO << "Backend " << name << " is healthy again";
+            }
+            else if (changed) {
+                LOG_WARN << "Backend " << name << " is unhealthy after "
+                         << health->consecutiveFailures()
+                         << " failed checks, last: " << reason;
+            }
+            else if (!passed) {
+                LOG_DEBUG << "Backend " << name
+                          << " failed health check: " << reason;
+            }
+        };
+
+        std::make_shared<HealthCheck>(d_ioContext, backend, completion)
+            ->start(d_timeout);
+    }
+}
+
+std::size_t BackendHealthChecker::checksInProgress() const
+{
+    return d_checking.size();
+}
+
+}
+}
@@ -0,0 +1,93 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_BACKENDHEALTHCHECKER
+#define BLOOMBERG_AMQPPROX_BACKENDHEALTHCHECKER
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_set>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class BackendStore;
+
+/**
+ * \brief Actively checks that each backend accepts AMQP connections,
+ * recording the outcome in its `BackendHealth`
+ *
+ * A check connects to the backend, sends the AMQP protocol header, preceded
+ * by a PROXY protocol header for backends expecting one, and passes if the
+ * backend replies with a Connection.Start method frame. TLS backends are
+ * only checked for accepting the TCP connection. Each check is abandoned as
+ * failed after a timeout, and a backend still being checked is skipped by
+ * the next round of checks.
+ *
+ * \note Thread Safety - Checks must be started on the thread running the
+ * `io_context`, which is the case for the control thread.
+ */
+class BackendHealthChecker {
+    boost::asio::io_context        &d_ioContext;
+    BackendStore                   *d_backendStore_p;  // HELD NOT OWNED
+    std::chrono::milliseconds       d_timeout;
+    uint32_t                        d_unhealthyThreshold;
+    uint32_t                        d_healthyThreshold;
+    std::unordered_set<std::string> d_checking;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct a checker of the backends in the `backendStore`,
+     * making connections on the `ioContext`
+     */
+    BackendHealthChecker(boost::asio::io_context &ioContext,
+                         BackendStore            *backendStore);
+
+    // MANIPULATORS
+    /**
+     * \brief Set how long a check may take before it fails, 2 seconds by
+     * default
+     */
+    void setTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     * \brief Set how many checks in a row must fail to mark a healthy backend
+     * unhealthy, 3 by default, and pass to mark an unhealthy one healthy, 2
+     * by default
+     */
+    void setThresholds(uint32_t unhealthyThreshold, uint32_t healthyThreshold);
+
+    /**
+     * \brief Start checking every backend in the store that isn't already
+     * being checked
+     */
+    void checkBackends();
+
+    // ACCESSORS
+    /**
+     * \return the number of backends being checked
+     */
+    std::size_t checksInProgress() const;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendoutlierdetector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendstore.h>
+#include <amqpprox_logging.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+BackendOutlierDetector::BackendOutlierDetector(BackendStore *backendStore)
+: d_backendStore_p(backendStore)
+, d_windowIntervals(10)
+, d_failurePercent(50)
+, d_minimumConnections(5)
+, d_baseEjection(std::chrono::seconds(30))
+, d_maxEjection(std::chrono::minutes(5))
+, d_backends()
+{
+}
+
+void BackendOutlierDetector::setWindow(std::size_t intervals)
+{
+    d_windowIntervals = intervals;
+}
+
+void BackendOutlierDetector::setFailureThreshold(uint32_t percent,
+                                                 uint64_t minimumConnections)
+{
+    d_failurePercent     = percent;
+    d_minimumConnections = minimumConnections;
+}
+
+void BackendOutlierDetector::setEjectionTimes(std::chrono::milliseconds base,
+                                              std::chrono::milliseconds max)
+{
+    d_baseEjection = base;
+    d_maxEjection  = max;
+}
+
+void BackendOutlierDetector::detect(TimePoint now)
+{
+    // Rebuilding the map drops the state of deleted backends, and comparing
+    // counters starts afresh for a backend replaced under the same name
+    std::unordered_map<std::string, BackendState> previous;
+    previous.swap(d_backends);
+
+    for (const Backend &backend : d_backendStore_p->backends()) {
+        const BackendCounters &counters = *backend.counters();
+        Outcomes total{counters.succeededConnections(),
+                       counters.failedConnections(),
+                       counters.snappedConnections()};
+
+        BackendState state{backend.counters(), total, {}, 0, false};
+        auto         it = previous.find(backend.name());
+        if (it != previous.end() &&
+            it->second.d_counters == backend.counters()) {
+            state = std::move(it->second);
+        }
+
+        Outcomes interval{total.d_succeeded - state.d_seen.d_succeeded,
+                          total.d_failed - state.d_seen.d_failed,
+                          total.d_snapped - state.d_seen.d_snapped};
+        state.d_seen = total;
+
+        BackendHealth &health = *backend.health();
+        if (health.isEjected(now)) {
+            d_backends.emplace(backend.name(), std::move(state));
+            continue;
+        }
+
+        if (state.d_ejected) {
+            LOG_INFO << "Backend " << backend.name()
+                     << " readmitted after ejection";
+            state.d_ejected = false;
+        }
+
+        if (state.d_ejections > 0 &&
+            now - health.ejectedUntil() >= d_maxEjection) {
+            state.d_ejections = 0;
+        }
+
+        state.d_window.push_back(interval);
+        while (state.d_window.size() > d_windowIntervals) {
+            state.d_window.pop_front();
+        }
+
+        Outcomes windowed{0, 0, 0};
+        for (const Outcomes &outcomes : state.d_window) {
+            windowed.d_succeeded += outcomes.d_succeeded;
+            windowed.d_failed += outcomes.d_failed;
+            windowed.d_snapped += outcomes.d_snapped;
+        }
+
+        // A session dropped by the backend was counted as succeeded when it
+        // connected, possibly before the window, so the drop is an outcome
+        // of its own
+        uint64_t failures = windowed.d_failed + windowed.d_snapped;
+        uint64_t outcomes = windowed.d_succeeded + failures;
+        if (outcomes != 0 && outcomes >= d_minimumConnections &&
+            failures * 100 >= outcomes * d_failurePercent) {
+            std::chrono::milliseconds ejection = d_baseEjection;
+            for (uint32_t i = 0;
+                 i < state.d_ejections && ejection < d_maxEjection;
+                 ++i) {
+                ejection *= 2;
+            }
+            ejection = std::min(ejection, d_maxEjection);
+
+            health.ejectUntil(now + ejection);
+            ++state.d_ejections;
+            state.d_ejected = true;
+            state.d_window.clear();
+
+            LOG_WARN << "Backend " << backend.name() << " ejected for "
+                     << ejection.count() << "ms after " << failures
+                     << " of " << outcomes << " connections failed or were"
+                     << " dropped";
+        }
+
+        d_backends.emplace(backend.name(), std::move(state));
+    }
+}
+
+}
+}
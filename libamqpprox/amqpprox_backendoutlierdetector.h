@@ -0,0 +1,117 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_BACKENDOUTLIERDETECTOR
+#define BLOOMBERG_AMQPPROX_BACKENDOUTLIERDETECTOR
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class BackendCounters;
+class BackendStore;
+
+/**
+ * \brief Ejects backends whose connections are failing, judged from the
+ * connection outcomes sessions count in each backend's `BackendCounters`
+ *
+ * Each call to `detect` closes an interval of the sliding window of outcomes
+ * kept for every backend. A backend is ejected, through its
+ * `BackendHealth`, once enough outcomes were counted for it within the
+ * window and a high enough share of them were failures. A connection the
+ * backend drops after it succeeded counts as a further, failed, outcome.
+ * Its first ejection lasts the base ejection time, which doubles with each
+ * ejection after, up to the maximum. A backend that has gone the maximum ejection time since it was
+ * readmitted starts again from the base.
+ *
+ * \note Thread Safety - `detect` must only be called from one thread at a
+ * time, for amqpprox the control thread.
+ */
+class BackendOutlierDetector {
+  public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+  private:
+    struct Outcomes {
+        uint64_t d_succeeded;
+        uint64_t d_failed;
+        uint64_t d_snapped;
+    };
+
+    struct BackendState {
+        std::shared_ptr<BackendCounters> d_counters;
+        Outcomes                         d_seen;  // at the last `detect`
+        std::deque<Outcomes>             d_window;
+        uint32_t                         d_ejections;
+        bool                             d_ejected;
+    };
+
+    BackendStore *d_backendStore_p;  // HELD NOT OWNED
+
+    std::size_t                                   d_windowIntervals;
+    uint32_t                                      d_failurePercent;
+    uint64_t                                      d_minimumConnections;
+    std::chrono::milliseconds                     d_baseEjection;
+    std::chrono::milliseconds                     d_maxEjection;
+    std::unordered_map<std::string, BackendState> d_backends;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct a detector of outliers among the backends in the
+     * `backendStore`
+     */
+    explicit BackendOutlierDetector(BackendStore *backendStore);
+
+    // MANIPULATORS
+    /**
+     * \brief Set how many calls to `detect` the window of outcomes spans, 10
+     * by default
+     */
+    void setWindow(std::size_t intervals);
+
+    /**
+     * \brief Set the percentage of outcomes in the window which must be
+     * failures to eject a backend, 50 by default, and the number of outcomes
+     * the window must hold first, 5 by default
+     */
+    void setFailureThreshold(uint32_t percent, uint64_t minimumConnections);
+
+    /**
+     * \brief Set how long the first ejection of a backend lasts, 30 seconds
+     * by default, and the cap on repeated ejections, 5 minutes by default
+     */
+    void setEjectionTimes(std::chrono::milliseconds base,
+                          std::chrono::milliseconds max);
+
+    /**
+     * \brief Close the current interval of outcomes for every backend in the
+     * store, ejecting those failing too often
+     * \param now the current time
+     */
+    void detect(TimePoint now);
+};
+
+}
+}
+
+#endif
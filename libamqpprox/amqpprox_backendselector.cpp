@@ -18,7 +18,14 @@
 namespace Bloomberg {
 namespace amqpprox {
 
-// Empty
+const Backend *
+BackendSelector::selectWithAffinity(BackendSet                  *backendSet,
+                                    const std::vector<uint64_t> &markers,
+                                    uint64_t                     retryCount,
+                                    std::string_view /* affinityKey */) const
+{
+    return select(backendSet, markers, retryCount);
+}
 
 }
 }
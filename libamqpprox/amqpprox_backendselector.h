@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace Bloomberg {
@@ -51,6 +52,25 @@ class BackendSelector {
                                   const std::vector<uint64_t> &markers,
                                   uint64_t retryCount) const = 0;
 
+    /**
+     * \brief Select a `Backend` instance as `select` does, for a session
+     * whose connections are best kept together with others sharing the
+     * specified `affinityKey`
+     * \param backendSet Backend set
+     * \param markers Markers
+     * \param retryCount Retry count
+     * \param affinityKey Key of the sessions to place together
+     * \return Backend
+     *
+     * Selectors which don't place sessions by key ignore it, which is what
+     * the default implementation does.
+     */
+    virtual const Backend *
+    selectWithAffinity(BackendSet                  *backendSet,
+                       const std::vector<uint64_t> &markers,
+                       uint64_t                     retryCount,
+                       std::string_view             affinityKey) const;
+
     // ACCESSORS
     /**
      * \brief Return the name of this `BackendSelector`. This name is used to
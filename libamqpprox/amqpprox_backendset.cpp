@@ -24,14 +24,14 @@ namespace amqpprox {
 // CREATORS
 BackendSet::BackendSet(std::vector<BackendSet::Partition> partitions)
 : d_partitions(std::move(partitions))
-, d_markers(d_partitions.size(), 0)
+, d_markers(d_partitions.size())
 {
 }
 
 // MANIPULATORS
 uint64_t BackendSet::markPartition(uint64_t partitionId)
 {
-    if (partitionId > d_markers.size()) {
+    if (partitionId >= d_markers.size()) {
         return 0;
     }
 
@@ -18,6 +18,7 @@
 
 #include <amqpprox_backend.h>
 
+#include <atomic>
 #include <vector>
 
 namespace Bloomberg {
@@ -40,8 +41,8 @@ class BackendSet {
 
   private:
     // DATA
-    std::vector<Partition> d_partitions;
-    std::vector<Marker>    d_markers;
+    std::vector<Partition>           d_partitions;
+    std::vector<std::atomic<Marker>> d_markers;
 
   public:
     // CREATORS
@@ -59,9 +60,10 @@ class BackendSet {
      * \param partitionId Partition ID
      * \return New value of the marker
      *
-     * This will move the partition's marker. The behaviour is undefined unless
-     * `partitionId` is within the range of the number of markers for this
-     * instance.
+     * This will move the partition's marker. If `partitionId` is not within
+     * the range of the number of markers for this instance, no marker is
+     * moved and 0 is returned. This is safe to call concurrently from several
+     * threads.
      */
     uint64_t markPartition(uint64_t partitionId);
 
@@ -73,10 +75,9 @@ class BackendSet {
     const std::vector<Partition> &partitions() const;
 
     /**
-     * \return Non-modifiable reference to the vector of markers stored in this
-     * `BackendSet` instance.
+     * \return Snapshot of the markers stored in this `BackendSet` instance.
      */
-    const std::vector<Marker> &markers() const;
+    std::vector<Marker> markers() const;
 };
 
 // ACCESSORS
@@ -85,9 +86,9 @@ inline const std::vector<BackendSet::Partition> &BackendSet::partitions() const
     return d_partitions;
 }
 
-inline const std::vector<BackendSet::Marker> &BackendSet::markers() const
+inline std::vector<BackendSet::Marker> BackendSet::markers() const
 {
-    return d_markers;
+    return std::vector<Marker>(d_markers.begin(), d_markers.end());
 }
 
 }
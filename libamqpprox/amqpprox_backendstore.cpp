@@ -15,6 +15,7 @@
 */
 #include <amqpprox_backendstore.h>
 
+#include <chrono>
 #include <iostream>
 
 namespace Bloomberg {
@@ -66,11 +67,30 @@ const Backend *BackendStore::lookup(const std::string &name) const
 
 void BackendStore::print(std::ostream &os) const
 {
+    auto                        now = std::chrono::steady_clock::now();
     std::lock_guard<std::mutex> lg(d_mutex);
     for (const auto &backend : d_backends) {
-        os << backend.second << std::endl;
+        os << backend.second;
+        if (!backend.second.health()->isHealthy()) {
+            os << " UNHEALTHY";
+        }
+        if (backend.second.health()->isEjected(now)) {
+            os << " EJECTED";
+        }
+        os << std::endl;
     }
 }
 
+std::vector<Backend> BackendStore::backends() const
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    std::vector<Backend>        backends;
+    backends.reserve(d_backends.size());
+    for (const auto &backend : d_backends) {
+        backends.push_back(backend.second);
+    }
+    return backends;
+}
+
 }
 }
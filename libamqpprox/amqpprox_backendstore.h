@@ -22,6 +22,7 @@
 #include <map>
 #include <mutex>
 #include <unordered_map>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -40,6 +41,12 @@ class BackendStore {
 
     const Backend *lookup(const std::string &name) const;
     void           print(std::ostream &os) const;
+
+    /**
+     * \return copies of every backend, which share their counters and
+     * health with the stored ones
+     */
+    std::vector<Backend> backends() const;
 };
 
 }
@@ -24,6 +24,7 @@ BufferHandle::BufferHandle(void *data, std::size_t size, BufferSource *source)
 : d_data(data)
 , d_size(size)
 , d_source(source)
+, d_heapBytes_p(nullptr)
 {
 }
 
@@ -31,6 +32,7 @@ BufferHandle::BufferHandle()
 : d_data(nullptr)
 , d_size(0)
 , d_source(nullptr)
+, d_heapBytes_p(nullptr)
 {
 }
 
@@ -47,11 +49,25 @@ void BufferHandle::assign(void *data, std::size_t size, BufferSource *source)
     d_source = source;
 }
 
+void BufferHandle::assignHeap(void                  *data,
+                              std::size_t            size,
+                              std::atomic<uint64_t> *heapBytes)
+{
+    release();
+    d_data        = data;
+    d_size        = size;
+    d_heapBytes_p = heapBytes;
+    if (d_heapBytes_p) {
+        d_heapBytes_p->fetch_add(size, std::memory_order_relaxed);
+    }
+}
+
 void BufferHandle::swap(BufferHandle &rhs)
 {
     std::swap(d_data, rhs.d_data);
     std::swap(d_size, rhs.d_size);
     std::swap(d_source, rhs.d_source);
+    std::swap(d_heapBytes_p, rhs.d_heapBytes_p);
 }
 
 void BufferHandle::release()
@@ -63,11 +79,15 @@ void BufferHandle::release()
         if (d_data) {
             delete[] static_cast<char *>(d_data);
         }
+        if (d_heapBytes_p) {
+            d_heapBytes_p->fetch_sub(d_size, std::memory_order_relaxed);
+        }
     }
 
-    d_data   = nullptr;
-    d_source = nullptr;
-    d_size   = 0;
+    d_data        = nullptr;
+    d_source      = nullptr;
+    d_heapBytes_p = nullptr;
+    d_size        = 0;
 }
 
 }
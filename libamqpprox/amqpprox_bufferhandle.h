@@ -16,6 +16,8 @@
 #ifndef BLOOMBERG_AMQPPROX_BUFFERHANDLE
 #define BLOOMBERG_AMQPPROX_BUFFERHANDLE
 
+#include <atomic>
+#include <cstdint>
 #include <iostream>
 #include <memory>
 
@@ -33,9 +35,10 @@ class BufferSource;
  * be switched at a later time with minimal changes.
  */
 class BufferHandle {
-    void         *d_data;
-    std::size_t   d_size;
-    BufferSource *d_source;
+    void                  *d_data;
+    std::size_t            d_size;
+    BufferSource          *d_source;
+    std::atomic<uint64_t> *d_heapBytes_p;  // HELD NOT OWNED
 
   public:
     // CREATORS
@@ -67,6 +70,15 @@ class BufferHandle {
      */
     void assign(void *data, std::size_t size, BufferSource *source);
 
+    /**
+     * \brief Set the heap allocated `data` and `size` of this handle,
+     * releasing any prior held data before. The `size` is added to
+     * `heapBytes` until the data is released.
+     */
+    void assignHeap(void                  *data,
+                    std::size_t            size,
+                    std::atomic<uint64_t> *heapBytes);
+
     /**
      * \brief Swap the contents of this handle with the provided `rhs`
      */
@@ -16,6 +16,7 @@
 #include <amqpprox_bufferpool.h>
 
 #include <algorithm>
+#include <climits>
 #include <tuple>
 
 namespace Bloomberg {
@@ -23,7 +24,9 @@ namespace amqpprox {
 
 BufferPool::BufferPool(const std::vector<std::size_t> &bucketsIn)
 : d_bufferSources()
+, d_sizeClassSources()
 , d_spillover(0)
+, d_spilloverBytes(0)
 {
     std::vector<std::size_t> buckets(bucketsIn);
     std::sort(begin(buckets), end(buckets));
@@ -32,22 +35,46 @@ BufferPool::BufferPool(const std::vector<std::size_t> &bucketsIn)
     for (const auto &b : buckets) {
         d_bufferSources.emplace_back(new BufferSource(b));
     }
+
+    // Each size class starts its search at the first source large enough for
+    // the smallest size in the class, every source before it is too small
+    // for any size in the class.
+    std::size_t source = 0;
+    for (std::size_t sc = 0; sc < NUM_SIZE_CLASSES; ++sc) {
+        while (source < buckets.size() && sizeClass(buckets[source]) < sc) {
+            ++source;
+        }
+        d_sizeClassSources[sc] = source;
+    }
 }
 
 void BufferPool::acquireBuffer(BufferHandle *handle, std::size_t sz)
 {
-    for (auto &source : d_bufferSources) {
+    // Only sizes in the same size class are checked, which is usually one
+    for (std::size_t i = d_sizeClassSources[sizeClass(sz)];
+         i < d_bufferSources.size();
+         ++i) {
+        auto &source = d_bufferSources[i];
         if (sz <= source->bufferSize()) {
             handle->assign(source->acquire(), sz, source.get());
             return;
         }
     }
 
-    handle->assign(new char[sz], sz, nullptr);
+    handle->assignHeap(new char[sz], sz, &d_spilloverBytes);
     d_spillover.fetch_add(1, std::memory_order_relaxed);
     return;
 }
 
+std::size_t BufferPool::trim(std::chrono::milliseconds idleTime)
+{
+    std::size_t released = 0;
+    for (const auto &source : d_bufferSources) {
+        released += source->trim(idleTime);
+    }
+    return released;
+}
+
 void BufferPool::getPoolStatistics(std::vector<BufferAllocationStat> *stats,
                                    uint64_t *spilloverCount)
 {
@@ -69,5 +96,34 @@ void BufferPool::getPoolStatistics(std::vector<BufferAllocationStat> *stats,
     *spilloverCount = d_spillover.load(std::memory_order_relaxed);
 }
 
+std::size_t BufferPool::bytesInUse() const
+{
+    std::size_t bytes = d_spilloverBytes.load(std::memory_order_relaxed);
+    for (const auto &source : d_bufferSources) {
+        bytes += source->outstanding() * source->bufferSize();
+    }
+    return bytes;
+}
+
+void BufferPool::getSlabStatistics(std::vector<SlabStat> *stats)
+{
+    for (const auto &source : d_bufferSources) {
+        uint64_t residentSlabs, releasedBytes;
+        source->slabStats(&residentSlabs, &releasedBytes);
+        stats->push_back(std::make_tuple(
+            source->bufferSize(), residentSlabs, releasedBytes));
+    }
+}
+
+std::size_t BufferPool::sizeClass(std::size_t sz)
+{
+    if (sz <= 1) {
+        return 0;
+    }
+
+    return sizeof(unsigned long long) * CHAR_BIT -
+           __builtin_clzll(static_cast<unsigned long long>(sz - 1));
+}
+
 }
 }
@@ -19,7 +19,9 @@
 #include <amqpprox_bufferhandle.h>
 #include <amqpprox_buffersource.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <cstring>
 #include <vector>
 
@@ -33,13 +35,19 @@ namespace amqpprox {
  * of `BufferSource` objects. The sizes the `BufferSource` objects provide is
  * parameterised at construction time.
  *
- * The pool is not threadsafe, apart from retrieving statistics on usage
- * through `getPoolStatistics`. The pool must have a lifetime that exceeds that
+ * The pool is threadsafe, buffers can be acquired from any thread and their
+ * handles released on any other, see `BufferSource`. The source for a size is
+ * found from its power of two size class, so the lookup does not depend on
+ * the number of buffer sizes. The pool must have a lifetime that exceeds that
  * of all of the buffer handles given out by the pool.
  */
 class BufferPool {
+    static constexpr std::size_t NUM_SIZE_CLASSES = 65;
+
     std::vector<std::unique_ptr<BufferSource>> d_bufferSources;
+    std::array<std::size_t, NUM_SIZE_CLASSES>  d_sizeClassSources;
     std::atomic<uint64_t>                      d_spillover;
+    std::atomic<uint64_t>                      d_spilloverBytes;
 
   public:
     // TYPES
@@ -49,6 +57,12 @@ class BufferPool {
      */
     using BufferAllocationStat = std::tuple<std::size_t, uint64_t, uint64_t>;
 
+    /**
+     * \brief The tuples are of the form: bufferSize, slabs held, bytes of
+     * slabs currently returned to the OS.
+     */
+    using SlabStat = std::tuple<std::size_t, uint64_t, uint64_t>;
+
     // CREATORS
     /**
      * \brief Construct the pool with the given range of buffer sizes
@@ -68,6 +82,13 @@ class BufferPool {
      */
     void acquireBuffer(BufferHandle *handle, std::size_t sz);
 
+    /**
+     * \brief Return the memory of buffer slabs unused for at least `idleTime`
+     * to the OS, see `BufferSource::trim`
+     * \return the number of bytes returned to the OS
+     */
+    std::size_t trim(std::chrono::milliseconds idleTime);
+
     // ACCESSORS
     /**
      * \brief Retrieve statistics on the current usage and highest usage for
@@ -75,6 +96,26 @@ class BufferPool {
      */
     void getPoolStatistics(std::vector<BufferAllocationStat> *stats,
                            uint64_t                          *spilloverCount);
+
+    /**
+     * \return the bytes currently handed out, which is the full buffer size
+     * for each buffer from a `BufferSource` plus the size of each heap
+     * allocation
+     */
+    std::size_t bytesInUse() const;
+
+    /**
+     * \brief Retrieve statistics on the slabs backing each buffer size in
+     * the pool.
+     */
+    void getSlabStatistics(std::vector<SlabStat> *stats);
+
+  private:
+    /**
+     * \return the size class of `sz`, which is the smallest `n` such that
+     * `sz <= 2^n`
+     */
+    static std::size_t sizeClass(std::size_t sz);
 };
 
 }
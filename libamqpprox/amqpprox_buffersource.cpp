@@ -16,14 +16,102 @@
 #include <amqpprox_buffersource.h>
 
 #include <algorithm>
+#include <new>
 
 namespace Bloomberg {
 namespace amqpprox {
 
-BufferSource::BufferSource(std::size_t bufferSize)
-: d_pool(bufferSize)
+namespace {
+
+std::mutex               s_threadSlotMutex;
+std::vector<std::size_t> s_freeThreadSlots;
+std::size_t              s_nextThreadSlot = 0;
+
+// Copy of `s_nextThreadSlot` readable without the mutex, which bounds the
+// thread caches that can have been used
+std::atomic<std::size_t> s_threadSlotsUsed(0);
+
+/**
+ * \brief Index of the running thread's cache in every `BufferSource`, which
+ * is returned for reuse by a later thread when the thread exits. Passing the
+ * index through the mutex hands the caches over safely.
+ */
+class ThreadSlot {
+    std::size_t d_slot;
+
+  public:
+    ThreadSlot()
+    {
+        std::lock_guard<std::mutex> lg(s_threadSlotMutex);
+        if (s_freeThreadSlots.empty()) {
+            d_slot = s_nextThreadSlot++;
+            s_threadSlotsUsed.store(s_nextThreadSlot,
+                                    std::memory_order_relaxed);
+        }
+        else {
+            auto it = std::min_element(s_freeThreadSlots.begin(),
+                                       s_freeThreadSlots.end());
+            d_slot  = *it;
+            s_freeThreadSlots.erase(it);
+        }
+    }
+
+    ~ThreadSlot()
+    {
+        std::lock_guard<std::mutex> lg(s_threadSlotMutex);
+        s_freeThreadSlots.push_back(d_slot);
+    }
+
+    std::size_t slot() const { return d_slot; }
+};
+
+std::size_t threadSlot()
+{
+    thread_local ThreadSlot slot;
+    return slot.slot();
+}
+
+class SpinGuard {
+    std::atomic_flag &d_flag;
+
+  public:
+    explicit SpinGuard(std::atomic_flag &flag)
+    : d_flag(flag)
+    {
+        while (d_flag.test_and_set(std::memory_order_acquire)) {
+        }
+    }
+
+    ~SpinGuard() { d_flag.clear(std::memory_order_release); }
+};
+
+void increment(std::atomic<uint64_t> *counter)
+{
+    // Only written by the owning thread, so no read-modify-write is needed
+    counter->store(counter->load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+}
+
+}
+
+BufferSource::ThreadCache::ThreadCache()
+: d_lock()
+, d_magazine()
 , d_allocationCount(0)
 , d_deallocationCount(0)
+, d_trimOperations(0)
+, d_idleSince()
+{
+    d_lock.clear();
+}
+
+BufferSource::BufferSource(std::size_t bufferSize)
+: d_arena(bufferSize)
+, d_depotMutex()
+, d_depot()
+, d_threadCaches(new ThreadCache[MAX_THREAD_CACHES])
+, d_uncachedAllocationCount(0)
+, d_uncachedDeallocationCount(0)
 , d_highWater(0)
 , d_allocatedBufferSize(bufferSize)
 {
@@ -31,31 +119,104 @@ BufferSource::BufferSource(std::size_t bufferSize)
 
 void BufferSource::release(void *data)
 {
-    d_deallocationCount.fetch_add(1, std::memory_order_relaxed);
-    d_pool.free(data);
+    ThreadCache *cache = threadCache();
+    if (!cache) {
+        d_uncachedDeallocationCount.fetch_add(1, std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lg(d_depotMutex);
+        d_arena.deallocate(data);
+        return;
+    }
+
+    increment(&cache->d_deallocationCount);
+
+    SpinGuard guard(cache->d_lock);
+    if (cache->d_magazine.size() >= MAGAZINE_SIZE) {
+        DepotMagazine full;
+        full.d_buffers.reserve(MAGAZINE_SIZE);
+        full.d_buffers.swap(cache->d_magazine);
+        full.d_releasedAt = SlabArena::Clock::now();
+
+        std::lock_guard<std::mutex> lg(d_depotMutex);
+        d_depot.push_back(std::move(full));
+    }
+
+    cache->d_magazine.push_back(data);
 }
 
 void *BufferSource::acquire()
 {
-    d_allocationCount.fetch_add(1, std::memory_order_relaxed);
-    uint64_t allocCount = d_allocationCount.load(std::memory_order_relaxed);
-    uint64_t deallocCount =
-        d_deallocationCount.load(std::memory_order_relaxed);
-
-    // This line is technically racy; however, the atomics are used only for
-    // statistics purposes and the writes necessarily have to only happen from
-    // the same thread because of the unprotected `d_pool` access.
-    d_highWater.store(std::max(d_highWater.load(std::memory_order_relaxed),
-                               allocCount - deallocCount),
-                      std::memory_order_relaxed);
-
-    auto buf = d_pool.malloc();
-    if (!buf) {
-        throw std::bad_alloc();
+    ThreadCache *cache = threadCache();
+
+    void *buf;
+    if (cache) {
+        SpinGuard guard(cache->d_lock);
+        if (!cache->d_magazine.empty()) {
+            buf = cache->d_magazine.back();
+            cache->d_magazine.pop_back();
+        }
+        else {
+            buf = acquireFromDepot(cache);
+        }
+
+        increment(&cache->d_allocationCount);
+    }
+    else {
+        buf = acquireFromDepot(nullptr);
+        d_uncachedAllocationCount.fetch_add(1, std::memory_order_relaxed);
     }
+
     return buf;
 }
 
+std::size_t BufferSource::trim(std::chrono::milliseconds idleTime)
+{
+    std::lock_guard<std::mutex> lg(d_depotMutex);
+
+    SlabArena::Clock::time_point now = SlabArena::Clock::now();
+
+    // The depot is used from the back, so its idle magazines are at the front
+    auto idle = std::find_if(d_depot.begin(),
+                             d_depot.end(),
+                             [&](const DepotMagazine &magazine) {
+                                 return now - magazine.d_releasedAt < idleTime;
+                             });
+    for (auto it = d_depot.begin(); it != idle; ++it) {
+        for (void *buf : it->d_buffers) {
+            d_arena.deallocate(buf, now);
+        }
+    }
+    d_depot.erase(d_depot.begin(), idle);
+
+    // A thread's magazine is idle once its counts stop changing. Threads busy
+    // with their magazine keep it until the next trim.
+    std::size_t caches = std::min(
+        s_threadSlotsUsed.load(std::memory_order_relaxed), MAX_THREAD_CACHES);
+    for (std::size_t i = 0; i < caches; ++i) {
+        ThreadCache &cache = d_threadCaches[i];
+        uint64_t     operations =
+            cache.d_allocationCount.load(std::memory_order_relaxed) +
+            cache.d_deallocationCount.load(std::memory_order_relaxed);
+        if (operations != cache.d_trimOperations) {
+            cache.d_trimOperations = operations;
+            cache.d_idleSince      = now;
+        }
+
+        if (now - cache.d_idleSince < idleTime ||
+            cache.d_lock.test_and_set(std::memory_order_acquire)) {
+            continue;
+        }
+
+        for (void *buf : cache.d_magazine) {
+            d_arena.deallocate(buf, now);
+        }
+        cache.d_magazine.clear();
+        cache.d_lock.clear(std::memory_order_release);
+    }
+
+    return d_arena.trim(idleTime, now);
+}
+
 std::size_t BufferSource::bufferSize() const
 {
     return d_allocatedBufferSize;
@@ -65,9 +226,96 @@ void BufferSource::allocationStats(uint64_t *allocationCount,
                                    uint64_t *deallocationCount,
                                    uint64_t *highwaterMark) const
 {
-    *allocationCount   = d_allocationCount.load(std::memory_order_relaxed);
-    *deallocationCount = d_deallocationCount.load(std::memory_order_relaxed);
-    *highwaterMark     = d_highWater.load(std::memory_order_relaxed);
+    countAllocations(allocationCount, deallocationCount);
+
+    // Buffers acquired from the magazines since the last depot acquire can
+    // only be seen here
+    *highwaterMark = std::max(d_highWater.load(std::memory_order_relaxed),
+                              *allocationCount - *deallocationCount);
+}
+
+uint64_t BufferSource::outstanding() const
+{
+    uint64_t allocations, deallocations;
+    countAllocations(&allocations, &deallocations);
+    return allocations - deallocations;
+}
+
+void BufferSource::slabStats(uint64_t *residentSlabs, uint64_t *releasedBytes)
+{
+    std::lock_guard<std::mutex> lg(d_depotMutex);
+    *residentSlabs = d_arena.residentSlabs();
+    *releasedBytes = d_arena.releasedBytes();
+}
+
+BufferSource::ThreadCache *BufferSource::threadCache()
+{
+    std::size_t slot = threadSlot();
+    return slot < MAX_THREAD_CACHES ? &d_threadCaches[slot] : nullptr;
+}
+
+void *BufferSource::acquireFromDepot(ThreadCache *cache)
+{
+    std::lock_guard<std::mutex> lg(d_depotMutex);
+
+    // The buffer being acquired isn't counted yet. Only written under the
+    // lock, so no compare-exchange is needed.
+    uint64_t allocations, deallocations;
+    countAllocations(&allocations, &deallocations);
+    uint64_t outstanding = allocations - deallocations + 1;
+    if (outstanding > d_highWater.load(std::memory_order_relaxed)) {
+        d_highWater.store(outstanding, std::memory_order_relaxed);
+    }
+
+    if (!d_depot.empty()) {
+        Magazine &magazine = d_depot.back().d_buffers;
+        void     *buf      = magazine.back();
+        magazine.pop_back();
+
+        if (cache) {
+            // The rest of the magazine moves to the thread's empty one
+            cache->d_magazine.swap(magazine);
+        }
+
+        if (magazine.empty()) {
+            d_depot.pop_back();
+        }
+
+        return buf;
+    }
+
+    void *buf = d_arena.allocate();
+    if (!buf) {
+        throw std::bad_alloc();
+    }
+    return buf;
+}
+
+void BufferSource::countAllocations(uint64_t *allocationCount,
+                                    uint64_t *deallocationCount) const
+{
+    // Deallocations are summed first, so a buffer acquired and released
+    // while summing is counted as neither or as still acquired. Relaxed loads
+    // of separate counters could still see a release before its acquire, so
+    // the allocations are never reported below the deallocations.
+    uint64_t deallocations =
+        d_uncachedDeallocationCount.load(std::memory_order_relaxed);
+    uint64_t allocations =
+        d_uncachedAllocationCount.load(std::memory_order_relaxed);
+
+    std::size_t caches = std::min(
+        s_threadSlotsUsed.load(std::memory_order_relaxed), MAX_THREAD_CACHES);
+    for (std::size_t i = 0; i < caches; ++i) {
+        deallocations += d_threadCaches[i].d_deallocationCount.load(
+            std::memory_order_relaxed);
+    }
+    for (std::size_t i = 0; i < caches; ++i) {
+        allocations +=
+            d_threadCaches[i].d_allocationCount.load(std::memory_order_relaxed);
+    }
+
+    *allocationCount   = std::max(allocations, deallocations);
+    *deallocationCount = deallocations;
 }
 
 }
@@ -16,9 +16,13 @@
 #ifndef BLOOMBERG_AMQPPROX_BUFFERSOURCE
 #define BLOOMBERG_AMQPPROX_BUFFERSOURCE
 
-#include <atomic>
+#include <amqpprox_slabarena.h>
 
-#include <boost/pool/pool.hpp>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -27,16 +31,73 @@ namespace amqpprox {
  * \brief Source of a pool of buffers of a particular size
  *
  * This class provides access to a pool of buffers of a fixed size,
- * parameterized in the constructor. This class is NOT thread safe in general,
- * it has one thread-safe method `allocationStats` for acquiring statistics and
- * the `bufferSize` method is also threadsafe.
+ * parameterized in the constructor. All methods are thread safe, and a buffer
+ * may be released on a different thread to the one which acquired it.
+ *
+ * Each thread keeps a magazine of free buffers which it acquires from and
+ * releases to under a spin lock of its own, which is uncontended except while
+ * `trim` is taking its buffers. When a thread's magazine is empty it takes a
+ * full one from a shared depot, and when it is full it gives it to the depot,
+ * so the depot lock is only taken once per `MAGAZINE_SIZE` operations. Only
+ * the depot allocates from the underlying `SlabArena`. The first
+ * `MAX_THREAD_CACHES` concurrently running threads get a magazine, any further
+ * threads use the depot directly.
+ *
+ * Memory is only handed back to the OS by `trim`, which returns the free
+ * buffers of depot and thread magazines unused for the idle time to the
+ * arena, and releases the slabs left idle. Caches still in use are left
+ * alone, so their threads aren't sent back to the depot by every trim.
+ *
+ * The outstanding buffer count is derived from the per-thread allocation
+ * counts, so the acquire and release paths share no counters. The high-water
+ * mark is updated whenever a buffer is acquired from the depot, which every
+ * newly allocated buffer is, and when the statistics are read.
  */
 class BufferSource {
-    boost::pool<>         d_pool;
-    std::atomic<uint64_t> d_allocationCount;
-    std::atomic<uint64_t> d_deallocationCount;
-    std::atomic<uint64_t> d_highWater;
-    std::size_t           d_allocatedBufferSize;
+  public:
+    // CONSTANTS
+    static constexpr std::size_t MAGAZINE_SIZE     = 32;
+    static constexpr std::size_t MAX_THREAD_CACHES = 64;
+
+  private:
+    using Magazine = std::vector<void *>;
+
+    /**
+     * \brief A full magazine given to the depot, and when it was given
+     */
+    struct DepotMagazine {
+        Magazine                     d_buffers;
+        SlabArena::Clock::time_point d_releasedAt;
+    };
+
+    /**
+     * \brief Free buffers and usage counts for a single thread. Only the
+     * owning thread writes to the counts, they are atomic so that they can be
+     * read for statistics. The magazine is guarded by `d_lock`, which `trim`
+     * only ever tries to take so that it can't deadlock with the owning
+     * thread taking the depot lock. The counts seen by the last `trim`, and
+     * since when they haven't changed, are only used by `trim` under the
+     * depot lock.
+     */
+    struct alignas(64) ThreadCache {
+        std::atomic_flag             d_lock;
+        Magazine                     d_magazine;
+        std::atomic<uint64_t>        d_allocationCount;
+        std::atomic<uint64_t>        d_deallocationCount;
+        uint64_t                     d_trimOperations;
+        SlabArena::Clock::time_point d_idleSince;
+
+        ThreadCache();
+    };
+
+    SlabArena                      d_arena;
+    std::mutex                     d_depotMutex;
+    std::vector<DepotMagazine>     d_depot;
+    std::unique_ptr<ThreadCache[]> d_threadCaches;
+    std::atomic<uint64_t>          d_uncachedAllocationCount;
+    std::atomic<uint64_t>          d_uncachedDeallocationCount;
+    std::atomic<uint64_t>          d_highWater;
+    std::size_t                    d_allocatedBufferSize;
 
   public:
     // CREATORS
@@ -56,16 +117,23 @@ class BufferSource {
      */
     void *acquire();
 
+    /**
+     * \brief Return the free buffers of the depot and thread magazines
+     * unused for at least `idleTime` to the arena, and the memory of arena
+     * slabs unused for at least `idleTime` to the OS
+     * \return the number of bytes returned to the OS
+     */
+    std::size_t trim(std::chrono::milliseconds idleTime);
+
     // ACCESSORS
     /**
-     * \return Size of the buffers managed by this component, this is a
-     * threadsafe method to call
+     * \return Size of the buffers managed by this component
      */
     std::size_t bufferSize() const;
 
     /**
-     * \brief Retrieve the current allocation statistics, this is a threadsafe
-     * method to call
+     * \brief Retrieve the current allocation statistics, merged across all
+     * threads
      * \param allocationCount Allocation count
      * \param deallocationCount Deallocation count
      * \param highwaterMark High-water mark
@@ -73,6 +141,38 @@ class BufferSource {
     void allocationStats(uint64_t *allocationCount,
                          uint64_t *deallocationCount,
                          uint64_t *highwaterMark) const;
+
+    /**
+     * \return the number of buffers currently acquired and not released
+     */
+    uint64_t outstanding() const;
+
+    /**
+     * \brief Retrieve the current statistics of the underlying arena
+     * \param residentSlabs the number of slabs held by the process
+     * \param releasedBytes the bytes of slabs currently returned to the OS
+     */
+    void slabStats(uint64_t *residentSlabs, uint64_t *releasedBytes);
+
+  private:
+    /**
+     * \return the calling thread's cache, or `nullptr` if it doesn't have one
+     */
+    ThreadCache *threadCache();
+
+    /**
+     * \brief Acquire a buffer from the depot, refilling the `cache`'s
+     * magazine from it if one is provided, and update the high-water mark
+     */
+    void *acquireFromDepot(ThreadCache *cache);
+
+    /**
+     * \brief Sum the allocation counts of all threads
+     * \param allocationCount Allocation count
+     * \param deallocationCount Deallocation count
+     */
+    void countAllocations(uint64_t *allocationCount,
+                          uint64_t *deallocationCount) const;
 };
 
 }
@@ -0,0 +1,42 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_changedsessions.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+ChangedSessions::ChangedSessions()
+: d_ids()
+, d_mutex()
+{
+}
+
+void ChangedSessions::add(uint64_t id)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_ids.push_back(id);
+}
+
+void ChangedSessions::take(std::vector<uint64_t> *ids)
+{
+    ids->clear();
+
+    std::lock_guard<std::mutex> lg(d_mutex);
+    ids->swap(d_ids);
+}
+
+}
+}
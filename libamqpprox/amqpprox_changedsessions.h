@@ -0,0 +1,63 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_CHANGEDSESSIONS
+#define BLOOMBERG_AMQPPROX_CHANGEDSESSIONS
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Collects the identifiers of sessions whose statistics have changed
+ *
+ * A `SessionState` given this list adds its identifier the first time its
+ * statistics change after it was last collected, so each interval's
+ * statistics only need to be gathered from the sessions named here rather
+ * than from every session.
+ *
+ * All methods are thread safe.
+ */
+class ChangedSessions {
+  private:
+    std::vector<uint64_t> d_ids;
+    std::mutex            d_mutex;
+
+  public:
+    // CREATORS
+    ChangedSessions();
+
+    // MANIPULATORS
+    /**
+     * \brief Add a changed session
+     * \param id the session's identifier
+     */
+    void add(uint64_t id);
+
+    /**
+     * \brief Take all the sessions added since the last call, leaving the
+     * list empty
+     * \param ids populated with the identifiers, replacing its contents
+     */
+    void take(std::vector<uint64_t> *ids);
+};
+
+}
+}
+
+#endif
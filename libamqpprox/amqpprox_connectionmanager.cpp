@@ -16,11 +16,16 @@
 #include <amqpprox_connectionmanager.h>
 
 #include <amqpprox_backend.h>
+#include <amqpprox_backendhealth.h>
 #include <amqpprox_backendselector.h>
 #include <amqpprox_backendset.h>
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 
 namespace Bloomberg {
@@ -28,18 +33,89 @@ namespace amqpprox {
 
 // CREATORS
 ConnectionManager::ConnectionManager(std::shared_ptr<BackendSet> backendSet,
-                                     BackendSelector *backendSelector)
+                                     BackendSelector *backendSelector,
+                                     uint32_t         maxEjectedPercent)
 : d_backendSet(std::move(backendSet))
 , d_markerSnapshot(d_backendSet->markers())
 , d_backendSelector_p(backendSelector)
+, d_affinityKey()
+, d_ejected()
+, d_selections()
+, d_selectorRetries(0)
+, d_deferred()
+, d_deferredUsed(0)
 {
+    auto        now   = std::chrono::steady_clock::now();
+    std::size_t total = 0;
+    for (const auto &partition : d_backendSet->partitions()) {
+        total += partition.size();
+        for (const Backend *backend : partition) {
+            if (backend->health()->isEjected(now)) {
+                d_ejected.push_back(backend);
+            }
+        }
+    }
+
+    std::size_t allowed = total * maxEjectedPercent / 100;
+    if (d_ejected.size() > allowed) {
+        std::sort(d_ejected.begin(),
+                  d_ejected.end(),
+                  [](const Backend *lhs, const Backend *rhs) {
+                      return lhs->health()->ejectedUntil() >
+                             rhs->health()->ejectedUntil();
+                  });
+        d_ejected.resize(allowed);
+    }
 }
 
+// MANIPULATORS
+void ConnectionManager::setAffinityKey(std::string affinityKey)
+{
+    d_affinityKey = std::move(affinityKey);
+}
+
+// ACCESSORS
 const Backend *ConnectionManager::getConnection(uint64_t retryCount) const
 {
     if (d_backendSelector_p) {
-        return d_backendSelector_p->select(
-            d_backendSet.get(), d_markerSnapshot, retryCount);
+        auto seen = [this](const Backend *backend) {
+            return std::find(d_selections.begin(),
+                             d_selections.end(),
+                             backend) != d_selections.end() ||
+                   std::find(d_deferred.begin(),
+                             d_deferred.end(),
+                             backend) != d_deferred.end();
+        };
+        auto deferred = [this](const Backend *backend) {
+            return !backend->health()->isHealthy() ||
+                   std::find(d_ejected.begin(), d_ejected.end(), backend) !=
+                       d_ejected.end();
+        };
+
+        while (d_selections.size() <= retryCount) {
+            const Backend *backend = nullptr;
+            do {
+                backend = d_backendSelector_p->selectWithAffinity(
+                    d_backendSet.get(),
+                    d_markerSnapshot,
+                    d_selectorRetries++,
+                    d_affinityKey);
+            } while (backend && seen(backend));
+
+            if (backend && deferred(backend)) {
+                d_deferred.push_back(backend);
+                continue;
+            }
+
+            if (!backend) {
+                if (d_deferredUsed == d_deferred.size()) {
+                    return nullptr;
+                }
+                backend = d_deferred[d_deferredUsed++];
+            }
+            d_selections.push_back(backend);
+        }
+        return d_selections[retryCount];
     }
     else {
         // The ConnectionManager must handle the special case where a vhost has
@@ -18,7 +18,9 @@
 
 #include <amqpprox_backendset.h>
 
+#include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 namespace Bloomberg {
@@ -51,19 +53,48 @@ class ConnectionManager {
     std::shared_ptr<BackendSet>     d_backendSet;
     std::vector<BackendSet::Marker> d_markerSnapshot;
     BackendSelector                *d_backendSelector_p;  // HELD NOT OWNED
+    std::string                     d_affinityKey;
+
+    // Backends ejected by outlier detection that stay ejected for this
+    // session, within the cap on the share of the set that may be ejected
+    std::vector<const Backend *> d_ejected;
+
+    // Candidates selected so far, indexed by retry count, and the retry count
+    // to pass the selector next
+    mutable std::vector<const Backend *> d_selections;
+    mutable uint64_t                     d_selectorRetries;
+
+    // Unhealthy or ejected backends the selector returned, held back until
+    // the others run out, and how many of them have been handed out since
+    mutable std::vector<const Backend *> d_deferred;
+    mutable std::size_t                  d_deferredUsed;
 
   public:
     // CREATORS
     /**
      * \brief Create a `ConnectionManager` instance backed by the specified
      * `backendSet` and `backendSelector`. The `Marker` value of the specified
-     * `backendSet` will be snapshotted at construction time.
+     * `backendSet` will be snapshotted at construction time, as will which
+     * of its backends are ejected. At most `maxEjectedPercent` percent of the
+     * backends in the set are treated as ejected, those with the longest
+     * ejections remaining first.
      *
      * \param backendSet Backend set
      * \param backendSelector Backend selector
+     * \param maxEjectedPercent Cap on the share of ejected backends
      */
     ConnectionManager(std::shared_ptr<BackendSet> backendSet,
-                      BackendSelector            *backendSelector);
+                      BackendSelector            *backendSelector,
+                      uint32_t                    maxEjectedPercent = 100);
+
+    // MANIPULATORS
+    /**
+     * \brief Set the key passed to the selector for placing this session
+     * together with others sharing it. This must be called before the first
+     * call to `getConnection`.
+     * \param affinityKey Affinity key
+     */
+    void setAffinityKey(std::string affinityKey);
 
     // ACCESSORS
     /**
@@ -84,6 +115,11 @@ class ConnectionManager {
      */
     BackendSelector *backendSelector() const;
 
+    /**
+     * \return the key passed to the selector with each selection
+     */
+    const std::string &affinityKey() const;
+
     /**
      * \brief Return a pointer to a `Backend` connection candidate, to which an
      * outgoing connection should be attempted.
@@ -96,6 +132,15 @@ class ConnectionManager {
      * the candidates will be returned is defined by the `BackendSelector` and
      * `Marker` snapshot. If there are no valid `Backend` instances to connect
      * to, this method will return `nullptr`.
+     *
+     * The candidate for each `retryCount` is selected once and remembered,
+     * so it's the same however often it's asked for, even from selectors
+     * choosing by live load. A candidate the selector returns again for a
+     * later retry is skipped. Backends failing their health checks or
+     * ejected by outlier detection are only returned once every other
+     * candidate has been, in the order the selector returned them, so a vhost
+     * stays reachable if they are all failing. This is not safe to call
+     * concurrently.
      */
     const Backend *getConnection(uint64_t retryCount) const;
 };
@@ -117,6 +162,11 @@ inline BackendSelector *ConnectionManager::backendSelector() const
     return d_backendSelector_p;
 }
 
+inline const std::string &ConnectionManager::affinityKey() const
+{
+    return d_affinityKey;
+}
+
 }
 }
 
@@ -40,6 +40,7 @@ ConnectionSelector::ConnectionSelector(
 , d_resourceMapper_p(resourceMapper)
 , d_defaultFarmName("")
 , d_connectionLimiterManager_p(connectionLimiterManager)
+, d_maxEjectedPercent(100)
 , d_mutex()
 {
 }
@@ -86,7 +87,9 @@ SessionState::ConnectionStatus ConnectionSelector::acquireConnection(
             const auto &farm = d_farmStore_p->getFarmByName(resourceName);
 
             connectionManager.reset(new ConnectionManager(
-                farm.backendSet(), farm.backendSelector()));
+                farm.backendSet(),
+                farm.backendSelector(),
+                d_maxEjectedPercent.load(std::memory_order_relaxed)));
         }
         catch (std::runtime_error &e) {
             LOG_WARN << "Unable to acquire backend from Farm: " << resourceName
@@ -130,5 +133,10 @@ void ConnectionSelector::unsetDefaultFarm()
     d_defaultFarmName = "";
 }
 
+void ConnectionSelector::setMaxEjectedPercent(uint32_t percent)
+{
+    d_maxEjectedPercent.store(percent, std::memory_order_relaxed);
+}
+
 }
 }
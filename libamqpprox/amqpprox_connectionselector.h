@@ -20,6 +20,8 @@
 
 #include <amqpprox_connectionlimitermanager.h>
 #include <amqpprox_sessionstate.h>
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <string>
@@ -43,6 +45,7 @@ class ConnectionSelector : public ConnectionSelectorInterface {
     ResourceMapper           *d_resourceMapper_p;
     std::string               d_defaultFarmName;
     ConnectionLimiterManager *d_connectionLimiterManager_p;
+    std::atomic<uint32_t>     d_maxEjectedPercent;
     mutable std::mutex        d_mutex;
 
   public:
@@ -81,6 +84,12 @@ class ConnectionSelector : public ConnectionSelectorInterface {
      * \brief Unset any default farm if a mapping is not found
      */
     void unsetDefaultFarm();
+
+    /**
+     * \brief Set the largest share of a farm's backends, in percent, that
+     * outlier detection may keep out of selection at once. Defaults to 100.
+     */
+    void setMaxEjectedPercent(uint32_t percent);
 };
 
 }
@@ -15,13 +15,38 @@
 */
 #include <amqpprox_connectionstats.h>
 
-#include <iostream>
-
 #include <algorithm>
+#include <cassert>
 
 namespace Bloomberg {
 namespace amqpprox {
 
+namespace {
+
+template <typename ENUM>
+ENUM indexOf(const std::vector<std::string> &names, const std::string &name)
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    assert(it != names.end());
+    return static_cast<ENUM>(it - names.begin());
+}
+
+template <typename ENUM>
+bool findIndex(ENUM                           *index,
+               const std::vector<std::string> &names,
+               const std::string              &name)
+{
+    auto it = std::find(names.begin(), names.end(), name);
+    if (it == names.end()) {
+        return false;
+    }
+
+    *index = static_cast<ENUM>(it - names.begin());
+    return true;
+}
+
+}
+
 const std::vector<std::string> ConnectionStats::s_sessionMetrics = {
     "packetsReceived",
     "packetsSent",
@@ -35,6 +60,7 @@ const std::vector<std::string> ConnectionStats::s_statsTypes = {
     "activeConnectionCount",
     "authDeniedConnectionCount",
     "limitedConnectionCount",
+    "countOnlyConnectionCount",
     "removedConnectionGraceful",
     "removedConnectionBrokerSnapped",
     "removedConnectionClientSnapped",
@@ -49,81 +75,169 @@ const std::vector<std::string> ConnectionStats::s_distributionMetrics = {
     "sendLatency",
     "receiveLatency"};
 
+const std::vector<std::pair<std::string, double>>
+    ConnectionStats::s_percentiles = {{"p50", 0.5},
+                                      {"p90", 0.9},
+                                      {"p99", 0.99},
+                                      {"p999", 0.999}};
+
 ConnectionStats::ConnectionStats()
-: d_statsMap()
-, d_distributionStatsMap()
+: d_values()
+, d_distributions()
+, d_histograms()
 {
-    for (auto &statName : statsTypes()) {
-        d_statsMap[statName] = 0;
-    }
-
-    for (auto &statName : distributionMetrics()) {
-        d_distributionStatsMap[statName] =
-            std::make_pair<uint64_t, uint64_t>(0, 0);
-    }
 }
 
 ConnectionStats::ConnectionStats(
     const std::map<std::string, uint64_t> &stats,
     const std::map<std::string, std::pair<uint64_t, uint64_t>>
         &distributionStats)
-: d_statsMap(stats)
-, d_distributionStatsMap(distributionStats)
+: d_values()
+, d_distributions()
+, d_histograms()
 {
+    for (const auto &stat : stats) {
+        statsValue(stat.first) = stat.second;
+    }
+
+    for (const auto &stat : distributionStats) {
+        d_distributions[static_cast<std::size_t>(indexOf<Distribution>(
+            s_distributionMetrics, stat.first))] = stat.second;
+    }
 }
 
 void ConnectionStats::swap(ConnectionStats &rhs)
 {
-    std::swap(d_statsMap, rhs.d_statsMap);
-    std::swap(d_distributionStatsMap, rhs.d_distributionStatsMap);
+    std::swap(d_values, rhs.d_values);
+    std::swap(d_distributions, rhs.d_distributions);
+    std::swap(d_histograms, rhs.d_histograms);
 }
 
 void ConnectionStats::addDistributionStats(const std::string &name,
                                            uint64_t           total,
                                            uint64_t           count)
 {
-    d_distributionStatsMap[name].first += total;
-    d_distributionStatsMap[name].second += count;
+    addDistributionStats(
+        indexOf<Distribution>(s_distributionMetrics, name), total, count);
+}
+
+void ConnectionStats::add(const ConnectionStats &other)
+{
+    for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+        d_values[i] += other.d_values[i];
+    }
+
+    for (std::size_t i = 0; i < NUM_DISTRIBUTIONS; ++i) {
+        d_distributions[i].first += other.d_distributions[i].first;
+        d_distributions[i].second += other.d_distributions[i].second;
+        d_histograms[i].add(other.d_histograms[i]);
+    }
+}
+
+void ConnectionStats::subtract(const ConnectionStats &other)
+{
+    for (std::size_t i = 0; i < NUM_METRICS; ++i) {
+        d_values[i] -= other.d_values[i];
+    }
+
+    for (std::size_t i = 0; i < NUM_DISTRIBUTIONS; ++i) {
+        d_distributions[i].first -= other.d_distributions[i].first;
+        d_distributions[i].second -= other.d_distributions[i].second;
+        d_histograms[i].subtract(other.d_histograms[i]);
+    }
+}
+
+void ConnectionStats::clearSessionMetrics()
+{
+    auto first = static_cast<std::size_t>(FIRST_SESSION_METRIC);
+    std::fill(d_values.begin() + first, d_values.end(), 0);
+    d_distributions.fill({0, 0});
+    for (auto &histogram : d_histograms) {
+        histogram.clear();
+    }
+}
+
+void ConnectionStats::subtractSessionMetrics(const ConnectionStats &previous)
+{
+    for (std::size_t i = static_cast<std::size_t>(FIRST_SESSION_METRIC);
+         i < NUM_METRICS;
+         ++i) {
+        d_values[i] -= previous.d_values[i];
+    }
+
+    for (std::size_t i = 0; i < NUM_DISTRIBUTIONS; ++i) {
+        d_distributions[i].first -= previous.d_distributions[i].first;
+        d_distributions[i].second -= previous.d_distributions[i].second;
+        d_histograms[i].subtract(previous.d_histograms[i]);
+    }
+}
+
+uint64_t &ConnectionStats::statsValue(const std::string &name)
+{
+    return statsValue(indexOf<Metric>(s_statsTypes, name));
+}
+
+const uint64_t &ConnectionStats::statsValue(const std::string &name) const
+{
+    return d_values[static_cast<std::size_t>(
+        indexOf<Metric>(s_statsTypes, name))];
 }
 
 uint64_t ConnectionStats::distributionCount(const std::string &name) const
 {
-    auto it = d_distributionStatsMap.find(name);
-    if (it == d_distributionStatsMap.end()) {
+    Distribution metric;
+    if (!findIndex(&metric, s_distributionMetrics, name)) {
         return 0;
     }
 
-    return it->second.second;
+    return distributionCount(metric);
 }
 
-double ConnectionStats::distributionValue(const std::string &name) const
+double ConnectionStats::distributionValue(Distribution metric) const
 {
-    auto it = d_distributionStatsMap.find(name);
-    if (it == d_distributionStatsMap.end()) {
+    const auto &distribution = distributionPair(metric);
+    if (distribution.second == 0) {
         return 0;
     }
 
-    if (it->second.second == 0) {
+    return distribution.first / distribution.second;
+}
+
+double ConnectionStats::distributionValue(const std::string &name) const
+{
+    Distribution metric;
+    if (!findIndex(&metric, s_distributionMetrics, name)) {
         return 0;
     }
 
-    return it->second.first / it->second.second;
+    return distributionValue(metric);
 }
 
 std::pair<uint64_t, uint64_t>
 ConnectionStats::distributionPair(const std::string &name) const
 {
-    const auto &it = d_distributionStatsMap.find(name);
-    if (it == d_distributionStatsMap.end()) {
+    Distribution metric;
+    if (!findIndex(&metric, s_distributionMetrics, name)) {
         return {0, 0};
     }
-    return it->second;
+
+    return distributionPair(metric);
+}
+
+const std::string &ConnectionStats::metricName(Metric metric)
+{
+    return s_statsTypes[static_cast<std::size_t>(metric)];
+}
+
+const std::string &ConnectionStats::distributionName(Distribution metric)
+{
+    return s_distributionMetrics[static_cast<std::size_t>(metric)];
 }
 
 bool ConnectionStats::operator==(const ConnectionStats &other) const
 {
-    return d_statsMap == other.d_statsMap &&
-           d_distributionStatsMap == other.d_distributionStatsMap;
+    return d_values == other.d_values &&
+           d_distributions == other.d_distributions;
 }
 
 bool ConnectionStats::operator!=(const ConnectionStats &other) const
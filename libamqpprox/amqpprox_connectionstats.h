@@ -16,12 +16,15 @@
 #ifndef BLOOMBERG_AMQPPROX_CONNECTIONSTATS
 #define BLOOMBERG_AMQPPROX_CONNECTIONSTATS
 
-#include <cassert>
+#include <amqpprox_latencyhistogram.h>
+
+#include <array>
+#include <cstddef>
 #include <cstdint>
 
-#include <algorithm>
 #include <map>
 #include <string>
+#include <utility>
 #include <vector>
 
 namespace Bloomberg {
@@ -33,16 +36,60 @@ namespace amqpprox {
  * This component is for storing a set of summary metrics collected from
  * multiple sessions, it has counts of each lifecycle state of a session and
  * totals for packets, frames and bytes sent and received.
+ *
+ * The metrics are a fixed set, so they are kept in flat arrays indexed by the
+ * `Metric` and `Distribution` enumerations rather than looked up by name.
+ * Their names, as published by the formatters, are available from
+ * `metricName` and `distributionName`, and the name based accessors remain
+ * for convenience away from the collection path.
+ *
+ * Each distribution also keeps a `LatencyHistogram` of its samples, from
+ * which the `percentiles` are published.
  */
 class ConnectionStats {
   public:
-    std::map<std::string, uint64_t> d_statsMap;
+    // TYPES
+    enum class Metric : std::size_t {
+        PAUSED_CONNECTION_COUNT,
+        ACTIVE_CONNECTION_COUNT,
+        AUTH_DENIED_CONNECTION_COUNT,
+        LIMITED_CONNECTION_COUNT,
+        COUNT_ONLY_CONNECTION_COUNT,
+        REMOVED_CONNECTION_GRACEFUL,
+        REMOVED_CONNECTION_BROKER_SNAPPED,
+        REMOVED_CONNECTION_CLIENT_SNAPPED,
+        PACKETS_RECEIVED,
+        PACKETS_SENT,
+        FRAMES_RECEIVED,
+        FRAMES_SENT,
+        BYTES_RECEIVED,
+        BYTES_SENT
+    };
+
+    enum class Distribution : std::size_t { SEND_LATENCY, RECEIVE_LATENCY };
+
+    static constexpr std::size_t NUM_METRICS = 14;
+    static constexpr std::size_t NUM_DISTRIBUTIONS = 2;
+
+    /**
+     * \brief The first of the metrics which are totals over the lifetime of
+     * each session, all of the metrics from here on are such totals. Those
+     * before it are counts of sessions in each lifecycle state.
+     */
+    static constexpr Metric FIRST_SESSION_METRIC = Metric::PACKETS_RECEIVED;
+
+  private:
+    std::array<uint64_t, NUM_METRICS> d_values;
     // store total and count for distribution metrics
-    std::map<std::string, std::pair<uint64_t, uint64_t>>
-                                          d_distributionStatsMap;
+    std::array<std::pair<uint64_t, uint64_t>, NUM_DISTRIBUTIONS>
+                                          d_distributions;
+    // and a histogram of their samples
+    std::array<LatencyHistogram, NUM_DISTRIBUTIONS>
+                                          d_histograms;
     static const std::vector<std::string> s_statsTypes;
     static const std::vector<std::string> s_sessionMetrics;
     static const std::vector<std::string> s_distributionMetrics;
+    static const std::vector<std::pair<std::string, double>> s_percentiles;
 
   public:
     // CREATORS
@@ -52,8 +99,8 @@ class ConnectionStats {
     ConnectionStats();
 
     /**
-     * \brief Construct with predetermined values.  Mostly useful for unit
-     * testing
+     * \brief Construct with predetermined values, any not named are zero.
+     * Mostly useful for unit testing
      * \param stats Stats
      * \param distributionStats Distribution stats
      */
@@ -70,39 +117,118 @@ class ConnectionStats {
     /**
      * \brief Add the value to the distribution stats
      */
+    inline void
+    addDistributionStats(Distribution metric, uint64_t total, uint64_t count);
+
+    /**
+     * \brief Add the value to the distribution stats named by name
+     */
     void addDistributionStats(const std::string &name,
                               uint64_t           total,
                               uint64_t           count);
 
-    // ACCESSORS
+    /**
+     * \brief Add the samples of the `histogram` to the distribution
+     */
+    inline void addHistogram(Distribution            metric,
+                             const LatencyHistogram &histogram);
+
+    /**
+     * \brief Add every counter, total and distribution of the `other` stats
+     * \param other the stats to add
+     */
+    void add(const ConnectionStats &other);
+
+    /**
+     * \brief Subtract every counter, total and distribution of the `other`
+     * stats
+     * \param other the stats to subtract
+     */
+    void subtract(const ConnectionStats &other);
+
+    /**
+     * \brief Zero the session totals and distributions, keeping the
+     * connection counts
+     */
+    void clearSessionMetrics();
+
+    /**
+     * \brief Subtract the session totals and distributions of the `previous`
+     * stats, leaving only what accumulated since they were taken
+     * \param previous the stats from the start of the interval
+     */
+    void subtractSessionMetrics(const ConnectionStats &previous);
+
+    /**
+     * \return Reference to the stats value for the metric
+     */
+    inline uint64_t &statsValue(Metric metric);
+
     /**
      * \return Reference to the stats value named by name
      */
-    inline uint64_t &statsValue(const std::string &name);
+    uint64_t &statsValue(const std::string &name);
+
+    // ACCESSORS
+    /**
+     * \return The stats value for the metric
+     */
+    inline uint64_t statsValue(Metric metric) const;
 
     /**
      * \return const reference to the stats value named by name
      */
-    inline const uint64_t &statsValue(const std::string &name) const;
+    const uint64_t &statsValue(const std::string &name) const;
+
+    /**
+     * \return Count for a distribution stat
+     */
+    inline uint64_t distributionCount(Distribution metric) const;
 
     /**
      * \return Count for a distribution stat
      */
     uint64_t distributionCount(const std::string &name) const;
 
+    /**
+     * \return Average value for a distribution stat
+     */
+    double distributionValue(Distribution metric) const;
+
     /**
      * \return Average value for a distribution stat
      */
     double distributionValue(const std::string &name) const;
 
     /**
-     * \return (count, total) pair for the distribution metric
+     * \return (total, count) pair for the distribution metric
+     */
+    inline const std::pair<uint64_t, uint64_t> &
+    distributionPair(Distribution metric) const;
+
+    /**
+     * \return (total, count) pair for the distribution metric
      */
     std::pair<uint64_t, uint64_t>
     distributionPair(const std::string &name) const;
 
     /**
-     * \return All available stats types
+     * \return Histogram of the samples of the distribution metric
+     */
+    inline const LatencyHistogram &histogram(Distribution metric) const;
+
+    /**
+     * \return The published name of the metric
+     */
+    static const std::string &metricName(Metric metric);
+
+    /**
+     * \return The published name of the distribution metric
+     */
+    static const std::string &distributionName(Distribution metric);
+
+    /**
+     * \return All available stats types, in `Metric` order
      */
     static const std::vector<std::string> &statsTypes()
     {
@@ -118,16 +244,26 @@ class ConnectionStats {
     }
 
     /**
-     * \return The metrics for which distributions are published
+     * \return The metrics for which distributions are published, in
+     * `Distribution` order
      */
     static const std::vector<std::string> &distributionMetrics()
     {
         return s_distributionMetrics;
     }
 
+    /**
+     * \return The percentiles published for each distribution, as pairs of
+     * their name and quantile
+     */
+    static const std::vector<std::pair<std::string, double>> &percentiles()
+    {
+        return s_percentiles;
+    }
+
     /**
      * \return Comparison for equality of all counter and total values for the
-     * stats object
+     * stats object, the histograms are not compared
      */
     bool operator==(const ConnectionStats &other) const;
 
@@ -138,19 +274,46 @@ class ConnectionStats {
     bool operator!=(const ConnectionStats &other) const;
 };
 
-inline uint64_t &ConnectionStats::statsValue(const std::string &name)
+inline void ConnectionStats::addDistributionStats(Distribution metric,
+                                                  uint64_t     total,
+                                                  uint64_t     count)
+{
+    auto &distribution = d_distributions[static_cast<std::size_t>(metric)];
+    distribution.first += total;
+    distribution.second += count;
+}
+
+inline void ConnectionStats::addHistogram(Distribution            metric,
+                                          const LatencyHistogram &histogram)
+{
+    d_histograms[static_cast<std::size_t>(metric)].add(histogram);
+}
+
+inline uint64_t &ConnectionStats::statsValue(Metric metric)
+{
+    return d_values[static_cast<std::size_t>(metric)];
+}
+
+inline uint64_t ConnectionStats::statsValue(Metric metric) const
+{
+    return d_values[static_cast<std::size_t>(metric)];
+}
+
+inline uint64_t ConnectionStats::distributionCount(Distribution metric) const
+{
+    return d_distributions[static_cast<std::size_t>(metric)].second;
+}
+
+inline const std::pair<uint64_t, uint64_t> &
+ConnectionStats::distributionPair(Distribution metric) const
 {
-    assert(std::find(s_statsTypes.begin(), s_statsTypes.end(), name) !=
-           s_statsTypes.end());
-    return d_statsMap[name];
+    return d_distributions[static_cast<std::size_t>(metric)];
 }
 
-inline const uint64_t &
-ConnectionStats::statsValue(const std::string &name) const
+inline const LatencyHistogram &
+ConnectionStats::histogram(Distribution metric) const
 {
-    assert(std::find(s_statsTypes.begin(), s_statsTypes.end(), name) !=
-           s_statsTypes.end());
-    return d_statsMap.find(name)->second;
+    return d_histograms[static_cast<std::size_t>(metric)];
 }
 
 }
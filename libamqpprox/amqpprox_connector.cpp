@@ -107,8 +107,6 @@ Connector::Connector(SessionState    *sessionState,
                      BufferPool      *bufferPool,
                      std::string_view localHostname)
 : d_state(State::AWAITING_PROTOCOL_HEADER)
-, d_synthesizedStart(ConnectorUtil::synthesizedStart())
-, d_synthesizedTune(ConnectorUtil::synthesizedTune())
 , d_sessionState_p(sessionState)
 , d_eventSource_p(eventSource)
 , d_bufferPool_p(bufferPool)
@@ -125,7 +123,9 @@ void Connector::receive(const Buffer &buffer)
     if (d_state == State::AWAITING_PROTOCOL_HEADER) {
         if (buffer.equalContents(protocolHeader) ||
             buffer.equalContents(legacyProtocolHeader)) {
-            sendResponse(d_synthesizedStart, true);
+            sendFrames(ConnectorUtil::synthesizedStartFrame(), true);
+            LOG_TRACE << "Connector sendResponse: "
+                      << ConnectorUtil::synthesizedStart();
             d_state = State::START_SENT;
         }
         else {
@@ -169,7 +169,9 @@ void Connector::receive(const Method &method, FlowType direction)
 
         LOG_TRACE << "StartOk: " << d_startOk;
 
-        sendResponse(d_synthesizedTune, true);
+        sendFrames(ConnectorUtil::synthesizedTuneFrame(), true);
+        LOG_TRACE << "Connector sendResponse: "
+                  << ConnectorUtil::synthesizedTune();
         d_state = State::TUNE_SENT;
     } break;
     case State::TUNE_SENT: {
@@ -385,7 +387,7 @@ void Connector::sendResponse(const T &response, bool sendToIngressSide)
             d_bufferPool_p->acquireBuffer(&expandedBuffer,
                                           newLength + existingResponseData);
             memcpy(expandedBuffer.data(),
-                   d_synthesizedReplyBuffer.data(),
+                   d_buffer.originalPtr(),
                    existingResponseData);
             d_synthesizedReplyBuffer.swap(expandedBuffer);
         }
@@ -413,6 +415,32 @@ void Connector::sendResponse(const T &response, bool sendToIngressSide)
     }
 }
 
+void Connector::sendFrames(const Buffer &frames, bool sendToIngressSide)
+{
+    std::size_t existingResponseData = d_buffer.size();
+    if (existingResponseData == 0) {
+        // Nothing to send along with them, so they're written from where
+        // they are without copying
+        d_buffer = frames;
+    }
+    else {
+        BufferHandle expandedBuffer;
+        d_bufferPool_p->acquireBuffer(&expandedBuffer,
+                                      existingResponseData + frames.size());
+        memcpy(expandedBuffer.data(),
+               d_buffer.originalPtr(),
+               existingResponseData);
+        memcpy(static_cast<char *>(expandedBuffer.data()) +
+                   existingResponseData,
+               frames.originalPtr(),
+               frames.size());
+        d_synthesizedReplyBuffer.swap(expandedBuffer);
+        d_buffer = Buffer(d_synthesizedReplyBuffer.data(),
+                          existingResponseData + frames.size());
+    }
+    d_sendToIngressSide = sendToIngressSide;
+}
+
 void Connector::synthesizeMessage(methods::Close  &replyMethod,
                                   bool             sendToIngressSide,
                                   uint64_t         code,
@@ -457,9 +485,9 @@ void Connector::synthesizeProxyProtocolHeader(
     d_buffer = tempBuffer.currentData();
 }
 
-const FieldTable Connector::getClientProperties() const
+FieldTableView Connector::getClientProperties() const
 {
-    return d_startOk.properties();
+    return d_startOk.receivedProperties();
 }
 
 const std::pair<const std::string, const std::string>
@@ -477,8 +505,8 @@ void Connector::setAuthMechanismCredentials(std::string_view authMechanism,
 
 void Connector::setAuthReasonAsClientProperties(std::string_view reason)
 {
-    d_startOk.properties().pushField("amqpprox_auth",
-                                     FieldValue('S', std::string(reason)));
+    d_startOk.pushClientProperty("amqpprox_auth",
+                                 FieldValue('S', std::string(reason)));
 }
 
 }
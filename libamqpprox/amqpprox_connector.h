@@ -19,6 +19,7 @@
 #include <amqpprox_buffer.h>
 #include <amqpprox_bufferhandle.h>
 #include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldtableview.h>
 #include <amqpprox_flowtype.h>
 #include <amqpprox_method.h>
 #include <amqpprox_methods_close.h>
@@ -78,10 +79,8 @@ class Connector {
 
   private:
     State                 d_state;
-    methods::Start        d_synthesizedStart;
     methods::Start        d_receivedStart;
     methods::StartOk      d_startOk;
-    methods::Tune         d_synthesizedTune;
     methods::Tune         d_receivedTune;
     methods::TuneOk       d_tuneOk;
     methods::Open         d_open;
@@ -102,6 +101,11 @@ class Connector {
     template <typename T>
     void sendResponse(const T &response, bool sendToIngressSide);
 
+    /**
+     * \brief Send already encoded frames, which must outlive the write
+     */
+    void sendFrames(const Buffer &frames, bool sendToIngressSide);
+
     inline void synthesizeMessage(methods::Close  &replyMethod,
                                   bool             sendToIngressSide,
                                   uint64_t         code,
@@ -203,9 +207,10 @@ class Connector {
      * \brief AMQP client sends client properties using START-OK connection
      * method. The method extracts properties information from that method
      * fields.
-     * \return client properties as a Fieldtable
+     * \return view of the client properties as received, valid until the
+     * next START-OK is received
      */
-    const FieldTable getClientProperties() const;
+    FieldTableView getClientProperties() const;
 
     /**
      * \brief AMQP client sends auth mechansim and credential information using
@@ -17,13 +17,44 @@
 #include <amqpprox_connectorutil.h>
 
 #include <amqpprox_constants.h>
+#include <amqpprox_frame.h>
+#include <amqpprox_method.h>
 
+#include <cassert>
 #include <sstream>
 #include <string_view>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
 
+namespace {
+
+template <typename T>
+std::vector<char> encodeFrame(const T &method)
+{
+    std::vector<char> payload(Frame::getMaxFrameSize());
+    Buffer            buffer(payload.data(), payload.size());
+    bool              encoded = Method::encode(buffer, method);
+    assert(encoded);
+    (void)encoded;
+
+    Frame f;
+    f.type    = 1;
+    f.channel = 0;
+    f.payload = buffer.originalPtr();
+    f.length  = buffer.offset();
+
+    std::vector<char> frame(f.length + Frame::frameOverhead());
+    std::size_t       written = 0;
+    encoded                   = Frame::encode(frame.data(), &written, f);
+    assert(encoded);
+    frame.resize(written);
+    return frame;
+}
+
+}
+
 methods::Tune ConnectorUtil::synthesizedTune()
 {
     return methods::Tune(Constants::channelMaximum(),
@@ -40,6 +71,20 @@ methods::Start ConnectorUtil::synthesizedStart()
                           {Constants::locale()});
 }
 
+Buffer ConnectorUtil::synthesizedStartFrame()
+{
+    // The start method only depends on constants, so it's encoded the first
+    // time it's needed and never changes
+    static const std::vector<char> frame = encodeFrame(synthesizedStart());
+    return Buffer(frame.data(), frame.size());
+}
+
+Buffer ConnectorUtil::synthesizedTuneFrame()
+{
+    static const std::vector<char> frame = encodeFrame(synthesizedTune());
+    return Buffer(frame.data(), frame.size());
+}
+
 FieldTable ConnectorUtil::generateServerProperties()
 {
     // TODO Enhancement: Some of this could be injected from config. At the
@@ -91,15 +136,15 @@ void ConnectorUtil::injectProxyClientIdent(methods::StartOk  *startOk,
     if (isIngressSecured) {
         remoteClient << " TLS";
     }
-    startOk->properties().pushField("amqpprox_client",
-                                    FieldValue('S', remoteClient.str()));
+    startOk->pushClientProperty("amqpprox_client",
+                                FieldValue('S', remoteClient.str()));
 
     // E.g. (:5672) hostname:37812
     std::stringstream proxyInfo;
     proxyInfo << "(:" << inboundListenPort << ") " << localHostname << ":"
               << outboundLocalPort;
-    startOk->properties().pushField("amqpprox_host",
-                                    FieldValue('S', proxyInfo.str()));
+    startOk->pushClientProperty("amqpprox_host",
+                                FieldValue('S', proxyInfo.str()));
 }
 
 }
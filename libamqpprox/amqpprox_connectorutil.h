@@ -17,6 +17,7 @@
 #ifndef BLOOMBERG_AMQPPROX_CONNECTORUTIL
 #define BLOOMBERG_AMQPPROX_CONNECTORUTIL
 
+#include <amqpprox_buffer.h>
 #include <amqpprox_fieldtable.h>
 #include <amqpprox_methods_start.h>
 #include <amqpprox_methods_startok.h>
@@ -56,6 +57,20 @@ class ConnectorUtil {
      */
     static methods::Tune synthesizedTune();
 
+    /**
+     * \brief The start method the proxy sends, encoded into a frame once and
+     * shared by every connection
+     * \return Immutable buffer holding the encoded frame
+     */
+    static Buffer synthesizedStartFrame();
+
+    /**
+     * \brief The tune method the proxy sends, encoded into a frame once and
+     * shared by every connection
+     * \return Immutable buffer holding the encoded frame
+     */
+    static Buffer synthesizedTuneFrame();
+
     /**
      * \brief Mutate the StartOk from the client to include proxy information.
      * \param startOk output parameter for method to mutate
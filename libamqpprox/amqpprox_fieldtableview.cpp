@@ -0,0 +1,138 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_fieldtableview.h>
+
+#include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldvalue.h>
+#include <amqpprox_types.h>
+
+#include <boost/endian/arithmetic.hpp>
+
+#include <iostream>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+/**
+ * \brief Read the name of the next field, without copying it
+ * \return false once there are no more fields
+ */
+bool nextFieldName(std::string_view *name, Buffer &buffer)
+{
+    if (buffer.available() < sizeof(boost::endian::big_uint8_t)) {
+        return false;
+    }
+
+    auto length = buffer.copy<boost::endian::big_uint8_t>();
+    if (length > buffer.available()) {
+        return false;
+    }
+
+    *name = std::string_view(static_cast<const char *>(buffer.ptr()), length);
+    buffer.skip(length);
+    return true;
+}
+
+}
+
+FieldTableView::FieldTableView()
+: d_fields()
+{
+}
+
+FieldTableView::FieldTableView(const Buffer &fields)
+: d_fields(fields.remaining())
+{
+}
+
+bool FieldTableView::findFieldValue(FieldValue      *value,
+                                    std::string_view name) const
+{
+    Buffer           buffer = d_fields;
+    std::string_view fieldName;
+    while (nextFieldName(&fieldName, buffer)) {
+        if (fieldName == name) {
+            return Types::decodeFieldValue(value, buffer);
+        }
+        if (!Types::skipFieldValue(buffer)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+bool FieldTableView::findFieldTable(FieldTableView  *table,
+                                    std::string_view name) const
+{
+    Buffer           buffer = d_fields;
+    std::string_view fieldName;
+    while (nextFieldName(&fieldName, buffer)) {
+        if (fieldName == name) {
+            if (buffer.available() < sizeof(char) ||
+                buffer.copy<char>() != 'F') {
+                return false;
+            }
+            return Types::decodeFieldTable(table, buffer);
+        }
+        if (!Types::skipFieldValue(buffer)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+std::size_t FieldTableView::numberFields() const
+{
+    Buffer           buffer = d_fields;
+    std::string_view fieldName;
+    std::size_t      count = 0;
+    while (nextFieldName(&fieldName, buffer) &&
+           Types::skipFieldValue(buffer)) {
+        ++count;
+    }
+    return count;
+}
+
+bool FieldTableView::materialize(FieldTable *table) const
+{
+    Buffer           buffer = d_fields;
+    std::string_view fieldName;
+    while (buffer.available() > 0) {
+        if (!nextFieldName(&fieldName, buffer)) {
+            return false;
+        }
+
+        FieldValue value('V', false);
+        if (!Types::decodeFieldValue(&value, buffer)) {
+            return false;
+        }
+
+        table->pushField(std::string(fieldName), value);
+    }
+    return true;
+}
+
+std::ostream &operator<<(std::ostream &os, const FieldTableView &table)
+{
+    FieldTable materialized;
+    table.materialize(&materialized);
+    return os << materialized;
+}
+
+}
+}
@@ -0,0 +1,99 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_FIELDTABLEVIEW
+#define BLOOMBERG_AMQPPROX_FIELDTABLEVIEW
+
+#include <amqpprox_buffer.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <string_view>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class FieldTable;
+class FieldValue;
+
+/**
+ * \brief Non-owning view of an encoded AMQP Field Table
+ *
+ * The view indexes directly into the encoded fields, decoding a value only
+ * when it is looked up, so read-only lookups don't allocate for every name
+ * and value in the table. The viewed data must outlive the view. Use
+ * `Types::decodeFieldTable` to obtain a validated view from a buffer, and
+ * `materialize` where an owning `FieldTable` is needed.
+ */
+class FieldTableView {
+    Buffer d_fields;
+
+  public:
+    // CREATORS
+    FieldTableView();
+
+    /**
+     * \brief Construct a view of already validated encoded fields
+     * \param fields the encoded fields, without the table's length prefix
+     */
+    explicit FieldTableView(const Buffer &fields);
+
+    // ACCESSORS
+    /**
+     * \brief find a field in the table by name and decode its value
+     * \param value - pointer to a value instance to be populated
+     * \param name - the name of the field to populate the value for
+     * \returns true if field with name found, false otherwise
+     */
+    bool findFieldValue(FieldValue *value, std::string_view name) const;
+
+    /**
+     * \brief find a nested field table by name without decoding it
+     * \param table - pointer to a view to be set to the nested table
+     * \param name - the name of the field holding the nested table
+     * \returns true if a field with name is found and is a field table,
+     * false otherwise
+     */
+    bool findFieldTable(FieldTableView *table, std::string_view name) const;
+
+    /**
+     * \returns the number of fields
+     */
+    std::size_t numberFields() const;
+
+    /**
+     * \brief Decode every field into an owning table
+     * \param table the table the fields are appended to
+     * \returns true in case of success, otherwise false
+     */
+    bool materialize(FieldTable *table) const;
+
+    /**
+     * \returns the encoded fields, without the table's length prefix
+     */
+    const Buffer &fields() const;
+};
+
+inline const Buffer &FieldTableView::fields() const
+{
+    return d_fields;
+}
+
+std::ostream &operator<<(std::ostream &os, const FieldTableView &table);
+
+}
+}
+
+#endif
@@ -18,9 +18,11 @@
 #include <amqpprox_constants.h>
 #include <amqpprox_logging.h>
 
+#include <cstring>
 #include <iostream>
 #include <stdexcept>
 
+#include <boost/endian/conversion.hpp>
 #include <boost/log/utility/manipulators/dump.hpp>
 
 namespace logging = boost::log;
@@ -84,6 +86,32 @@ bool Frame::decode(Frame       *frame,
     return true;
 }
 
+std::size_t
+Frame::scan(std::size_t *frameCount, const void *buf, std::size_t bufferLen)
+{
+    const uint8_t *buffer  = static_cast<const uint8_t *>(buf);
+    std::size_t    scanned = 0;
+    std::size_t    frames  = 0;
+
+    while (bufferLen - scanned >= frameOverhead()) {
+        uint32_t length;
+        memcpy(&length, buffer + scanned + 3, sizeof length);
+        boost::endian::big_to_native_inplace(length);
+
+        std::size_t frameSize = frameOverhead() + length;
+        if (frameSize > bufferLen - scanned ||
+            buffer[scanned + frameSize - 1] != Constants::frameEnd()) {
+            break;
+        }
+
+        scanned += frameSize;
+        ++frames;
+    }
+
+    *frameCount += frames;
+    return scanned;
+}
+
 bool Frame::encode(void *output, std::size_t *writtenSize, const Frame &frame)
 {
     if ((frame.length + frameOverhead()) > getMaxFrameSize()) {
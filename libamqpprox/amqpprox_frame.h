@@ -65,6 +65,26 @@ class Frame {
                        const void  *buffer,
                        std::size_t  bufferLen);
 
+    /**
+     * \brief Find the complete frames at the start of a buffer without
+     * decoding them, for when they only need to be counted and passed on
+     *
+     * Each frame's length is read straight from the buffer and its frame end
+     * octet checked, in a single pass. Scanning stops at the first frame which
+     * is incomplete or malformed, which `decode` then either waits for more
+     * bytes of or reports exactly as it would have without the scan.
+     *
+     * \param frameCount incremented by the number of frames found
+     *
+     * \param buffer pointer to the beginning of the byte stream to scan
+     *
+     * \param bufferLen the number of readable bytes contained in the buffer
+     *
+     * \returns the number of bytes of the frames found
+     */
+    static std::size_t
+    scan(std::size_t *frameCount, const void *buffer, std::size_t bufferLen);
+
     /**
      * \brief Encode a frame into a buffer per spec:
      * <type> <channel> <size> <payload> <end of frame byte>
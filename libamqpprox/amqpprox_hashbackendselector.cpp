@@ -0,0 +1,211 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_hashbackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+const std::string SELECTOR_NAME("consistent-hash");
+
+// Forget every cached table once this many are held, so those of departed
+// memberships don't build up
+const std::size_t MAX_CACHED_TABLES = 64;
+
+// A prime number of slots. Changing the size with the membership would move
+// nearly every key, so it's fixed, big enough to give up to 160 backends in a
+// partition close to equal shares.
+const std::size_t TABLE_SIZE = 16381;
+
+/**
+ * \brief FNV-1a, finalised to spread keys differing in their last bytes
+ */
+uint64_t hash(std::string_view data, uint64_t seed)
+{
+    uint64_t result = 14695981039346656037ull ^ seed;
+    for (char c : data) {
+        result ^= static_cast<uint8_t>(c);
+        result *= 1099511628211ull;
+    }
+
+    result ^= result >> 33;
+    result *= 0xff51afd7ed558ccdull;
+    result ^= result >> 33;
+    result *= 0xc4ceb9fe1a85ec53ull;
+    result ^= result >> 33;
+    return result;
+}
+
+/**
+ * \brief Fill a Maglev lookup table for `partition`. Each backend claims
+ * slots in turn, in the order of its own permutation of the table, until
+ * every slot is claimed.
+ */
+std::vector<uint32_t> buildTable(const BackendSet::Partition &partition)
+{
+    const std::size_t size = TABLE_SIZE;
+    std::vector<uint64_t> offsets, skips, next(partition.size(), 0);
+    for (const Backend *backend : partition) {
+        offsets.push_back(hash(backend->name(), 0) % size);
+        skips.push_back(hash(backend->name(), 1) % (size - 1) + 1);
+    }
+
+    std::vector<uint32_t> table(size, UINT32_MAX);
+    std::size_t           filled = 0;
+    while (filled < size) {
+        for (uint32_t i = 0; i < partition.size() && filled < size; ++i) {
+            uint64_t slot = (offsets[i] + next[i] * skips[i]) % size;
+            while (table[slot] != UINT32_MAX) {
+                ++next[i];
+                slot = (offsets[i] + next[i] * skips[i]) % size;
+            }
+            table[slot] = i;
+            ++next[i];
+            ++filled;
+        }
+    }
+
+    return table;
+}
+
+/**
+ * \return the index of each backend of the partition, in the order they
+ * first appear in `table` from the slot of `keyHash`
+ */
+std::vector<uint32_t> tableOrder(const std::vector<uint32_t> &table,
+                                 uint64_t                     keyHash,
+                                 std::size_t                  partitionSize)
+{
+    std::vector<uint32_t> order;
+    std::vector<bool>     seen(partitionSize, false);
+    std::size_t           start = keyHash % table.size();
+    for (std::size_t offset = 0;
+         offset < table.size() && order.size() < partitionSize;
+         ++offset) {
+        uint32_t index = table[(start + offset) % table.size()];
+        if (!seen[index]) {
+            seen[index] = true;
+            order.push_back(index);
+        }
+    }
+    return order;
+}
+
+}
+
+HashBackendSelector::HashBackendSelector()
+: d_mutex()
+, d_tables()
+, d_tablesBuilt(0)
+{
+}
+
+std::shared_ptr<const HashBackendSelector::Table>
+HashBackendSelector::table(const BackendSet::Partition &partition) const
+{
+    std::string names;
+    for (const Backend *backend : partition) {
+        names += backend->name();
+        names += '\n';
+    }
+
+    std::lock_guard<std::mutex> lg(d_mutex);
+    auto                        it = d_tables.find(names);
+    if (it != d_tables.end()) {
+        return it->second;
+    }
+
+    if (d_tables.size() >= MAX_CACHED_TABLES) {
+        d_tables.clear();
+    }
+
+    auto built = std::make_shared<const Table>(buildTable(partition));
+    d_tables.emplace(std::move(names), built);
+    ++d_tablesBuilt;
+    return built;
+}
+
+const Backend *
+HashBackendSelector::select(BackendSet                  *backendSet,
+                            const std::vector<uint64_t> &markers,
+                            uint64_t                     retryCount) const
+{
+    return selectWithAffinity(backendSet, markers, retryCount, "");
+}
+
+const Backend *HashBackendSelector::selectWithAffinity(
+    BackendSet                  *backendSet,
+    const std::vector<uint64_t> &markers,
+    uint64_t                     retryCount,
+    std::string_view             affinityKey) const
+{
+    uint64_t retry = retryCount;
+
+    for (uint64_t i = 0; i < markers.size(); ++i) {
+        const BackendSet::Partition &partition = backendSet->partitions()[i];
+        uint64_t                     partitionSize = partition.size();
+
+        // One attempt on the chosen backend, then one on each backend
+        uint64_t attempts = partitionSize ? partitionSize + 1 : 0;
+
+        if (retry >= attempts) {
+            retry -= attempts;
+            continue;
+        }
+
+        backendSet->markPartition(i);
+        std::vector<uint32_t> order = tableOrder(
+            *table(partition), hash(affinityKey, 0), partitionSize);
+        if (retry > 0) {
+            return partition[order[retry - 1]];
+        }
+
+        uint64_t sessions = 0;
+        for (const Backend *backend : partition) {
+            sessions += backend->counters()->connections();
+        }
+        uint64_t bound = partitionSize * 100;
+        uint64_t capacity =
+            ((sessions + 1) * LOAD_BOUND_PERCENT + bound - 1) / bound;
+
+        for (uint32_t index : order) {
+            if (partition[index]->counters()->connections() < capacity) {
+                return partition[index];
+            }
+        }
+        return partition[order[0]];
+    }
+
+    return nullptr;
+}
+
+const std::string &HashBackendSelector::selectorName() const
+{
+    return SELECTOR_NAME;
+}
+
+uint64_t HashBackendSelector::tablesBuilt() const
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    return d_tablesBuilt;
+}
+
+}
+}
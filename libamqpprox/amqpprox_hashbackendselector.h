@@ -0,0 +1,107 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_HASHBACKENDSELECTOR
+#define BLOOMBERG_AMQPPROX_HASHBACKENDSELECTOR
+
+#include <amqpprox_backendselector.h>
+#include <amqpprox_backendset.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class Backend;
+
+/**
+ * \brief Selects backends by consistent hashing of the session's affinity
+ * key with bounded loads, implements the BackendSelector interface
+ *
+ * Each partition's backends are laid out on a Maglev lookup table, so
+ * sessions with the same key go to the same backend, and adding or removing
+ * a backend moves few keys between the others. The first attempt on a
+ * partition goes to the first backend along the table from the key's slot
+ * with fewer than `LOAD_BOUND_PERCENT` percent of the average sessions per
+ * backend, counting the new one, so a busy key spills over to its next
+ * backend instead of overloading its own. Further attempts go to every
+ * backend of the partition in table order.
+ *
+ * Tables depend only on the names of a partition's backends, in order, so
+ * they are cached by those and only rebuilt when a farm's membership
+ * changes.
+ */
+class HashBackendSelector : public BackendSelector {
+  public:
+    static constexpr uint32_t LOAD_BOUND_PERCENT = 125;
+
+  private:
+    using Table = std::vector<uint32_t>;
+
+    mutable std::mutex d_mutex;
+    mutable std::unordered_map<std::string, std::shared_ptr<const Table>>
+                     d_tables;
+    mutable uint64_t d_tablesBuilt;
+
+    /**
+     * \return the lookup table of `partition`, building it if not cached
+     */
+    std::shared_ptr<const Table>
+    table(const BackendSet::Partition &partition) const;
+
+  public:
+    // CREATORS
+    HashBackendSelector();
+
+    virtual ~HashBackendSelector() override = default;
+
+    // ACCESSORS
+    /**
+     * \brief Select a `Backend` as `selectWithAffinity` does for an empty
+     * key, which places every session together
+     */
+    virtual const Backend *select(BackendSet                  *backendSet,
+                                  const std::vector<uint64_t> &markers,
+                                  uint64_t retryCount) const override;
+
+    virtual const Backend *
+    selectWithAffinity(BackendSet                  *backendSet,
+                       const std::vector<uint64_t> &markers,
+                       uint64_t                     retryCount,
+                       std::string_view affinityKey) const override;
+
+    /**
+     * \return the name of this `BackendSelector`. This name is used to attach
+     * this selector to a given `Farm`.
+     */
+    virtual const std::string &selectorName() const override;
+
+    /**
+     * \return the number of lookup tables built since construction
+     */
+    uint64_t tablesBuilt() const;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,187 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_heavyhitters.h>
+
+#include <algorithm>
+#include <functional>
+#include <limits>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+/**
+ * \return a second hash derived from the `hash`, which is odd so that the
+ * rows of a power of two width never share a counter for the same key
+ */
+uint64_t secondHash(uint64_t hash)
+{
+    // The splitmix64 finalizer
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash | 1;
+}
+
+std::size_t roundUpToPowerOfTwo(std::size_t value)
+{
+    std::size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}
+
+HeavyHitters::HeavyHitters(std::size_t capacity,
+                           std::size_t width,
+                           std::size_t depth)
+: d_capacity(capacity)
+, d_width(roundUpToPowerOfTwo(width))
+, d_depth(std::max<std::size_t>(depth, 1))
+, d_counters(d_width * d_depth, 0)
+, d_heap()
+, d_positions()
+{
+    d_heap.reserve(d_capacity);
+    d_positions.reserve(d_capacity);
+}
+
+uint64_t HeavyHitters::add(const std::string &key, uint64_t count)
+{
+    const uint64_t hash1 = std::hash<std::string>()(key);
+    const uint64_t hash2 = secondHash(hash1);
+
+    uint64_t current = std::numeric_limits<uint64_t>::max();
+    for (std::size_t row = 0; row < d_depth; ++row) {
+        current = std::min(current, d_counters[counter(row, hash1, hash2)]);
+    }
+
+    // Conservative update: counters already above the new estimate are over
+    // counting other keys, so are left as they are
+    const uint64_t estimate = current + count;
+    for (std::size_t row = 0; row < d_depth; ++row) {
+        uint64_t &value = d_counters[counter(row, hash1, hash2)];
+        value           = std::max(value, estimate);
+    }
+
+    if (d_capacity == 0) {
+        return estimate;
+    }
+
+    auto it = d_positions.find(key);
+    if (it != d_positions.end()) {
+        d_heap[it->second].d_estimate = estimate;
+        siftDown(it->second);
+    }
+    else if (d_heap.size() < d_capacity) {
+        d_positions.emplace(key, d_heap.size());
+        d_heap.push_back(Entry{key, estimate});
+        siftUp(d_heap.size() - 1);
+    }
+    else if (estimate > d_heap.front().d_estimate) {
+        d_positions.erase(d_heap.front().d_key);
+        d_positions.emplace(key, 0);
+        d_heap.front() = Entry{key, estimate};
+        siftDown(0);
+    }
+
+    return estimate;
+}
+
+void HeavyHitters::clear()
+{
+    std::fill(d_counters.begin(), d_counters.end(), 0);
+    d_heap.clear();
+    d_positions.clear();
+}
+
+uint64_t HeavyHitters::estimate(const std::string &key) const
+{
+    const uint64_t hash1 = std::hash<std::string>()(key);
+    const uint64_t hash2 = secondHash(hash1);
+
+    uint64_t result = std::numeric_limits<uint64_t>::max();
+    for (std::size_t row = 0; row < d_depth; ++row) {
+        result = std::min(result, d_counters[counter(row, hash1, hash2)]);
+    }
+    return result;
+}
+
+void HeavyHitters::top(std::vector<Entry> *entries) const
+{
+    *entries = d_heap;
+    std::sort(entries->begin(),
+              entries->end(),
+              [](const Entry &lhs, const Entry &rhs) {
+                  return lhs.d_estimate > rhs.d_estimate ||
+                         (lhs.d_estimate == rhs.d_estimate &&
+                          lhs.d_key < rhs.d_key);
+              });
+}
+
+std::size_t HeavyHitters::capacity() const
+{
+    return d_capacity;
+}
+
+void HeavyHitters::siftDown(std::size_t position)
+{
+    for (;;) {
+        std::size_t smallest = position;
+        for (std::size_t child = 2 * position + 1;
+             child <= 2 * position + 2 && child < d_heap.size();
+             ++child) {
+            if (d_heap[child].d_estimate < d_heap[smallest].d_estimate) {
+                smallest = child;
+            }
+        }
+
+        if (smallest == position) {
+            return;
+        }
+
+        swapEntries(position, smallest);
+        position = smallest;
+    }
+}
+
+void HeavyHitters::siftUp(std::size_t position)
+{
+    while (position > 0) {
+        std::size_t parent = (position - 1) / 2;
+        if (d_heap[parent].d_estimate <= d_heap[position].d_estimate) {
+            return;
+        }
+
+        swapEntries(position, parent);
+        position = parent;
+    }
+}
+
+void HeavyHitters::swapEntries(std::size_t lhs, std::size_t rhs)
+{
+    std::swap(d_heap[lhs], d_heap[rhs]);
+    d_positions[d_heap[lhs].d_key] = lhs;
+    d_positions[d_heap[rhs].d_key] = rhs;
+}
+
+}
+}
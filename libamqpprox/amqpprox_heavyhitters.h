@@ -0,0 +1,134 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_HEAVYHITTERS
+#define BLOOMBERG_AMQPPROX_HEAVYHITTERS
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Approximately tracks the keys with the highest totals, in bounded
+ * memory however many keys are counted
+ *
+ * Totals are kept in a count-min sketch: `depth` rows of `width` counters,
+ * each key adding to one counter per row chosen by hashing it. The estimate
+ * for a key is the smallest of its counters, which is never below its true
+ * total and exceeds it by at most a fraction of the total of all keys that
+ * shrinks with the width. Counters are updated conservatively, only raising
+ * those which are below the new estimate, which tightens the estimates.
+ *
+ * The `capacity` keys with the highest estimates are kept in a min-heap, so
+ * adding to a key costs the same whether or not it is one of them.
+ *
+ * \note Thread Safety - Calls must occur serially.
+ */
+class HeavyHitters {
+  public:
+    struct Entry {
+        std::string d_key;
+        uint64_t    d_estimate;
+    };
+
+  private:
+    std::size_t                                  d_capacity;
+    std::size_t                                  d_width;
+    std::size_t                                  d_depth;
+    std::vector<uint64_t>                        d_counters;
+    std::vector<Entry>                           d_heap;
+    std::unordered_map<std::string, std::size_t> d_positions;
+
+    /**
+     * \return the index of the counter in the `row` for a key with the
+     * hashes `hash1` and `hash2`
+     */
+    inline std::size_t
+    counter(std::size_t row, uint64_t hash1, uint64_t hash2) const;
+
+    /**
+     * \brief Restore the heap order below the entry at `position`, whose
+     * estimate may have grown
+     */
+    void siftDown(std::size_t position);
+
+    /**
+     * \brief Restore the heap order above the entry at `position`, which was
+     * just added
+     */
+    void siftUp(std::size_t position);
+
+    void swapEntries(std::size_t lhs, std::size_t rhs);
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct an empty tracker
+     * \param capacity the number of keys with the highest estimates to keep
+     * \param width the counters in each row of the sketch, rounded up to a
+     * power of two
+     * \param depth the rows of the sketch
+     */
+    explicit HeavyHitters(std::size_t capacity,
+                          std::size_t width = 1024,
+                          std::size_t depth = 4);
+
+    // MANIPULATORS
+    /**
+     * \brief Add `count` to the total of the `key`
+     * \return the new estimate of the key's total
+     */
+    uint64_t add(const std::string &key, uint64_t count);
+
+    /**
+     * \brief Forget every key's total
+     */
+    void clear();
+
+    // ACCESSORS
+    /**
+     * \return the estimate of the `key`'s total, which is zero only if
+     * nothing was added to it
+     */
+    uint64_t estimate(const std::string &key) const;
+
+    /**
+     * \brief Retrieve the keys with the highest estimates, highest first
+     * \param entries replaced with the keys and their estimates
+     */
+    void top(std::vector<Entry> *entries) const;
+
+    /**
+     * \return the number of keys with the highest estimates kept
+     */
+    std::size_t capacity() const;
+};
+
+inline std::size_t
+HeavyHitters::counter(std::size_t row, uint64_t hash1, uint64_t hash2) const
+{
+    // Double hashing derives each row's hash from the two
+    return row * d_width + ((hash1 + row * hash2) & (d_width - 1));
+}
+
+}
+}
+
+#endif
@@ -23,6 +23,27 @@ namespace amqpprox {
 
 namespace {
 
+using Metric       = ConnectionStats::Metric;
+using Distribution = ConnectionStats::Distribution;
+
+void humanLatency(std::ostream &os, const LatencyHistogram &histogram)
+{
+    const char *separator = "";
+    os << "latency ";
+    for (const auto &percentile : ConnectionStats::percentiles()) {
+        os << separator << percentile.first;
+        separator = "/";
+    }
+    os << ": ";
+
+    separator = "";
+    for (const auto &percentile : ConnectionStats::percentiles()) {
+        os << separator << histogram.percentile(percentile.second);
+        separator = "/";
+    }
+    os << " us";
+}
+
 void humanBytes(std::ostream &os, uint64_t bytes)
 {
     constexpr uint64_t kb = 1024;
@@ -51,28 +72,40 @@ void humanBytes(std::ostream &os, uint64_t bytes)
 
 void HumanStatFormatter::format(std::ostream &os, const ConnectionStats &stats)
 {
-    os << "Paused: " << stats.statsValue("pausedConnectionCount") << " "
-       << "Active: " << stats.statsValue("activeConnectionCount") << " "
-       << "Auth denied: " << stats.statsValue("authDeniedConnectionCount")
+    os << "Paused: " << stats.statsValue(Metric::PAUSED_CONNECTION_COUNT)
        << " "
-       << "Limited connections: " << stats.statsValue("limitedConnectionCount")
-       << " "
-       << "Removed(Clean): " << stats.statsValue("removedConnectionGraceful")
+       << "Active: " << stats.statsValue(Metric::ACTIVE_CONNECTION_COUNT)
        << " "
+       << "Auth denied: "
+       << stats.statsValue(Metric::AUTH_DENIED_CONNECTION_COUNT) << " "
+       << "Limited connections: "
+       << stats.statsValue(Metric::LIMITED_CONNECTION_COUNT) << " "
+       << "Count only: "
+       << stats.statsValue(Metric::COUNT_ONLY_CONNECTION_COUNT) << " "
+       << "Removed(Clean): "
+       << stats.statsValue(Metric::REMOVED_CONNECTION_GRACEFUL) << " "
        << "Removed(Broker): "
-       << stats.statsValue("removedConnectionBrokerSnapped") << " "
+       << stats.statsValue(Metric::REMOVED_CONNECTION_BROKER_SNAPPED) << " "
        << "Removed(Client): "
-       << stats.statsValue("removedConnectionClientSnapped") << " ";
+       << stats.statsValue(Metric::REMOVED_CONNECTION_CLIENT_SNAPPED) << " ";
 
     os << "IN: ";
-    humanBytes(os, stats.statsValue("bytesReceived"));
-    os << "/s " << stats.statsValue("packetsReceived") << " pkt/s "
-       << stats.statsValue("framesReceived") << " frames/s ";
+    humanBytes(os, stats.statsValue(Metric::BYTES_RECEIVED));
+    os << "/s " << stats.statsValue(Metric::PACKETS_RECEIVED) << " pkt/s "
+       << stats.statsValue(Metric::FRAMES_RECEIVED) << " frames/s ";
+    if (stats.distributionCount(Distribution::RECEIVE_LATENCY) > 0) {
+        humanLatency(os, stats.histogram(Distribution::RECEIVE_LATENCY));
+        os << " ";
+    }
 
     os << "OUT: ";
-    humanBytes(os, stats.statsValue("bytesSent"));
-    os << "/s " << stats.statsValue("packetsSent") << " pkt/s "
-       << stats.statsValue("framesSent") << " frames/s";
+    humanBytes(os, stats.statsValue(Metric::BYTES_SENT));
+    os << "/s " << stats.statsValue(Metric::PACKETS_SENT) << " pkt/s "
+       << stats.statsValue(Metric::FRAMES_SENT) << " frames/s";
+    if (stats.distributionCount(Distribution::SEND_LATENCY) > 0) {
+        os << " ";
+        humanLatency(os, stats.histogram(Distribution::SEND_LATENCY));
+    }
 }
 
 void HumanStatFormatter::format(std::ostream                 &os,
@@ -97,6 +130,19 @@ void HumanStatFormatter::format(std::ostream       &os,
     os << "BufferPool:\n";
     format(os, statSnapshot.pool(), statSnapshot.poolSpillover());
     os << "\n";
+    os << "Listeners:\n";
+    format(os, statSnapshot.listeners());
+    os << "Memory:\n";
+    format(os, statSnapshot.memory());
+    os << "\n";
+    if (!statSnapshot.backendHealth().empty()) {
+        os << "Backend health:\n";
+        format(os, statSnapshot.backendHealth());
+    }
+    os << "Top sources:\n";
+    format(os,
+           statSnapshot.topSourcesByBytes(),
+           statSnapshot.topSourcesByConnections());
     os << "Vhosts:\n";
     format(os, statSnapshot.vhosts());
     os << "Sources:\n";
@@ -120,7 +166,8 @@ void HumanStatFormatter::format(
     const std::vector<StatSnapshot::PoolStats> &poolStats,
     uint64_t                                    poolSpillover)
 {
-    os << "Spilt to heap: " << poolSpillover << ", Pools (Current/Peak): ";
+    os << "Spilt to heap: " << poolSpillover
+       << ", Pools (Current/Peak/Slabs): ";
 
     for (const auto &pool : poolStats) {
         if (&pool != &poolStats.front()) {
@@ -128,9 +175,73 @@ void HumanStatFormatter::format(
         }
 
         os << pool.d_bufferSize << "=" << pool.d_currentAllocation << "/"
-           << pool.d_highwaterMark;
+           << pool.d_highwaterMark << "/" << pool.d_slabs;
+    }
+
+    uint64_t released = 0;
+    for (const auto &pool : poolStats) {
+        released += pool.d_slabBytesReleased;
+    }
+    os << ", Released to OS: ";
+    humanBytes(os, released);
+}
+
+void HumanStatFormatter::format(
+    std::ostream                                   &os,
+    const std::vector<StatSnapshot::ListenerStats> &listenerStats)
+{
+    for (const auto &listener : listenerStats) {
+        os << "Port " << listener.d_port << " shard " << listener.d_shard
+           << ": " << listener.d_accepts << " accepts/interval\n";
     }
 }
 
+void HumanStatFormatter::format(std::ostream                    &os,
+                                const StatSnapshot::MemoryStats &memoryStats)
+{
+    os << "In use: ";
+    humanBytes(os, memoryStats.d_bytesInUse);
+    os << " High/Low: ";
+    humanBytes(os, memoryStats.d_highWatermark);
+    os << "/";
+    humanBytes(os, memoryStats.d_lowWatermark);
+    os << " Paused: " << memoryStats.d_pausedSessions
+       << " Pauses: " << memoryStats.d_pauses
+       << " Resumes: " << memoryStats.d_resumes;
+}
+
+void HumanStatFormatter::format(
+    std::ostream                                        &os,
+    const std::vector<StatSnapshot::BackendHealthStats> &backendHealth)
+{
+    for (const auto &health : backendHealth) {
+        os << health.d_backend << ": "
+           << (health.d_healthy ? "HEALTHY" : "UNHEALTHY") << " "
+           << health.d_consecutiveFailures << " failed checks"
+           << (health.d_ejected ? " EJECTED" : "") << "\n";
+    }
+}
+
+void HumanStatFormatter::format(
+    std::ostream                                    &os,
+    const std::vector<StatSnapshot::TopSourceStats> &byBytes,
+    const std::vector<StatSnapshot::TopSourceStats> &byConnections)
+{
+    auto formatList = [&os](const std::vector<StatSnapshot::TopSourceStats>
+                                &topSources) {
+        for (const auto &topSource : topSources) {
+            os << "  " << topSource.d_source << " -> " << topSource.d_vhost
+               << ": ";
+            humanBytes(os, topSource.d_bytes);
+            os << "/s " << topSource.d_connections << " conn/s\n";
+        }
+    };
+
+    os << "By bytes:\n";
+    formatList(byBytes);
+    os << "By connections:\n";
+    formatList(byConnections);
+}
+
 }
 }
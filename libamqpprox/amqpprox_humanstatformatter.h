@@ -91,6 +91,57 @@ class HumanStatFormatter : public StatFormatter {
     virtual void format(std::ostream                               &os,
                         const std::vector<StatSnapshot::PoolStats> &poolStats,
                         uint64_t poolSpillover) override;
+
+    /**
+     * \brief output the `StatSnapshot::ListenerStats` into the output stream
+     * in a human readable format.
+     *
+     * \param os the output stream
+     *
+     * \param listenerStats reference to the vector of ListenerStats
+     */
+    virtual void format(
+        std::ostream                                   &os,
+        const std::vector<StatSnapshot::ListenerStats> &listenerStats) override;
+
+    /**
+     * \brief output the `StatSnapshot::MemoryStats` into the output stream in
+     * a human readable format.
+     *
+     * \param os the output stream
+     *
+     * \param memoryStats reference to the MemoryStats
+     */
+    virtual void format(std::ostream                    &os,
+                        const StatSnapshot::MemoryStats &memoryStats) override;
+
+    /**
+     * \brief output the `StatSnapshot::BackendHealthStats` into the output
+     * stream in a human readable format.
+     *
+     * \param os the output stream
+     *
+     * \param backendHealth reference to the vector of BackendHealthStats
+     */
+    virtual void format(std::ostream &os,
+                        const std::vector<StatSnapshot::BackendHealthStats>
+                            &backendHealth) override;
+
+    /**
+     * \brief output the top sources by vhost into the output stream in
+     * a human readable format.
+     *
+     * \param os the output stream
+     *
+     * \param byBytes the top sources by bytes, highest first
+     *
+     * \param byConnections the top sources by new connections, highest first
+     */
+    virtual void format(
+        std::ostream                                    &os,
+        const std::vector<StatSnapshot::TopSourceStats> &byBytes,
+        const std::vector<StatSnapshot::TopSourceStats> &byConnections)
+        override;
 };
 
 }
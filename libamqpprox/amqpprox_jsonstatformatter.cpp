@@ -21,30 +21,61 @@
 namespace Bloomberg {
 namespace amqpprox {
 
+namespace {
+
+using Metric       = ConnectionStats::Metric;
+using Distribution = ConnectionStats::Distribution;
+
+void formatDistribution(std::ostream          &os,
+                        const ConnectionStats &stats,
+                        Distribution           metric)
+{
+    const LatencyHistogram &histogram = stats.histogram(metric);
+    os << "\"" << ConnectionStats::distributionName(metric) << "\": {"
+       << "\"count\": " << stats.distributionCount(metric);
+    for (const auto &percentile : ConnectionStats::percentiles()) {
+        os << ", \"" << percentile.first
+           << "\": " << histogram.percentile(percentile.second);
+    }
+    os << "}";
+}
+
+}
+
 void JsonStatFormatter::format(std::ostream &os, const ConnectionStats &stats)
 {
     os << "{"
        << "\"pausedConnectionCount\": "
-       << stats.statsValue("pausedConnectionCount") << ", "
+       << stats.statsValue(Metric::PAUSED_CONNECTION_COUNT) << ", "
        << "\"activeConnectionCount\": "
-       << stats.statsValue("activeConnectionCount") << ", "
+       << stats.statsValue(Metric::ACTIVE_CONNECTION_COUNT) << ", "
        << "\"authDeniedConnectionCount\": "
-       << stats.statsValue("authDeniedConnectionCount") << ", "
+       << stats.statsValue(Metric::AUTH_DENIED_CONNECTION_COUNT) << ", "
        << "\"limitedConnectionCount\": "
-       << stats.statsValue("limitedConnectionCount") << ", "
+       << stats.statsValue(Metric::LIMITED_CONNECTION_COUNT) << ", "
+       << "\"countOnlyConnectionCount\": "
+       << stats.statsValue(Metric::COUNT_ONLY_CONNECTION_COUNT) << ", "
        << "\"removedConnectionGraceful\": "
-       << stats.statsValue("removedConnectionGraceful") << ", "
+       << stats.statsValue(Metric::REMOVED_CONNECTION_GRACEFUL) << ", "
        << "\"removedConnectionBrokerSnapped\": "
-       << stats.statsValue("removedConnectionBrokerSnapped") << ", "
+       << stats.statsValue(Metric::REMOVED_CONNECTION_BROKER_SNAPPED) << ", "
        << "\"removedConnectionClientSnapped\": "
-       << stats.statsValue("removedConnectionClientSnapped") << ", "
-       << "\"packetsReceived\": " << stats.statsValue("packetsReceived")
+       << stats.statsValue(Metric::REMOVED_CONNECTION_CLIENT_SNAPPED) << ", "
+       << "\"packetsReceived\": " << stats.statsValue(Metric::PACKETS_RECEIVED)
+       << ", "
+       << "\"packetsSent\": " << stats.statsValue(Metric::PACKETS_SENT) << ", "
+       << "\"framesReceived\": " << stats.statsValue(Metric::FRAMES_RECEIVED)
        << ", "
-       << "\"packetsSent\": " << stats.statsValue("packetsSent") << ", "
-       << "\"framesReceived\": " << stats.statsValue("framesReceived") << ", "
-       << "\"framesSent\": " << stats.statsValue("framesSent") << ", "
-       << "\"bytesReceived\": " << stats.statsValue("bytesReceived") << ", "
-       << "\"bytesSent\": " << stats.statsValue("bytesSent") << "}";
+       << "\"framesSent\": " << stats.statsValue(Metric::FRAMES_SENT) << ", "
+       << "\"bytesReceived\": " << stats.statsValue(Metric::BYTES_RECEIVED)
+       << ", "
+       << "\"bytesSent\": " << stats.statsValue(Metric::BYTES_SENT);
+
+    for (std::size_t i = 0; i < ConnectionStats::NUM_DISTRIBUTIONS; ++i) {
+        os << ", ";
+        formatDistribution(os, stats, static_cast<Distribution>(i));
+    }
+    os << "}";
 }
 
 void JsonStatFormatter::format(std::ostream                 &os,
@@ -76,6 +107,16 @@ void JsonStatFormatter::format(std::ostream       &os,
     format(os, statSnapshot.process());
     os << ", \"bufferpool\": ";
     format(os, statSnapshot.pool(), statSnapshot.poolSpillover());
+    os << ", \"listeners\": ";
+    format(os, statSnapshot.listeners());
+    os << ", \"memory\": ";
+    format(os, statSnapshot.memory());
+    os << ", \"backendHealth\": ";
+    format(os, statSnapshot.backendHealth());
+    os << ", \"topSources\": ";
+    format(os,
+           statSnapshot.topSourcesByBytes(),
+           statSnapshot.topSourcesByConnections());
     os << ", \"vhosts\": ";
     format(os, statSnapshot.vhosts());
     os << ", \"sources\": ";
@@ -115,11 +156,103 @@ void JsonStatFormatter::format(
 
         os << "\"" << pool.d_bufferSize
            << "\": { \"current\": " << pool.d_currentAllocation
-           << ", \"highest\": " << pool.d_highwaterMark << "}";
+           << ", \"highest\": " << pool.d_highwaterMark
+           << ", \"slabs\": " << pool.d_slabs
+           << ", \"slab_bytes_released\": " << pool.d_slabBytesReleased
+           << "}";
     }
 
     os << "}}";
 }
 
+void JsonStatFormatter::format(
+    std::ostream                                   &os,
+    const std::vector<StatSnapshot::ListenerStats> &listenerStats)
+{
+    os << "{";
+
+    int previousPort = 0;
+    for (const auto &listener : listenerStats) {
+        if (listener.d_port != previousPort) {
+            if (previousPort != 0) {
+                os << "}, ";
+            }
+
+            os << "\"" << listener.d_port << "\": {";
+            previousPort = listener.d_port;
+        }
+        else {
+            os << ", ";
+        }
+
+        os << "\"" << listener.d_shard
+           << "\": {\"accepts\": " << listener.d_accepts << "}";
+    }
+
+    if (previousPort != 0) {
+        os << "}";
+    }
+    os << "}";
+}
+
+void JsonStatFormatter::format(std::ostream                    &os,
+                               const StatSnapshot::MemoryStats &memoryStats)
+{
+    os << "{"
+       << "\"bytes_in_use\": " << memoryStats.d_bytesInUse << ", "
+       << "\"high_watermark\": " << memoryStats.d_highWatermark << ", "
+       << "\"low_watermark\": " << memoryStats.d_lowWatermark << ", "
+       << "\"paused_sessions\": " << memoryStats.d_pausedSessions << ", "
+       << "\"pauses\": " << memoryStats.d_pauses << ", "
+       << "\"resumes\": " << memoryStats.d_resumes << "}";
+}
+
+void JsonStatFormatter::format(
+    std::ostream                                        &os,
+    const std::vector<StatSnapshot::BackendHealthStats> &backendHealth)
+{
+    os << "{";
+    for (const auto &health : backendHealth) {
+        if (&health != &backendHealth.front()) {
+            os << ", ";
+        }
+
+        os << "\"" << health.d_backend << "\": {\"healthy\": "
+           << (health.d_healthy ? "true" : "false")
+           << ", \"consecutive_failures\": " << health.d_consecutiveFailures
+           << ", \"ejected\": " << (health.d_ejected ? "true" : "false")
+           << "}";
+    }
+    os << "}";
+}
+
+void JsonStatFormatter::format(
+    std::ostream                                    &os,
+    const std::vector<StatSnapshot::TopSourceStats> &byBytes,
+    const std::vector<StatSnapshot::TopSourceStats> &byConnections)
+{
+    auto formatList = [&os](const std::vector<StatSnapshot::TopSourceStats>
+                                &topSources) {
+        os << "[";
+        for (const auto &topSource : topSources) {
+            if (&topSource != &topSources.front()) {
+                os << ", ";
+            }
+
+            os << "{\"vhost\": \"" << topSource.d_vhost << "\", "
+               << "\"source\": \"" << topSource.d_source << "\", "
+               << "\"bytes\": " << topSource.d_bytes << ", "
+               << "\"connections\": " << topSource.d_connections << "}";
+        }
+        os << "]";
+    };
+
+    os << "{\"bytes\": ";
+    formatList(byBytes);
+    os << ", \"connections\": ";
+    formatList(byConnections);
+    os << "}";
+}
+
 }
 }
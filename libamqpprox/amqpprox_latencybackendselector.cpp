@@ -0,0 +1,77 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_latencybackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+
+#include <cmath>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+const std::string SELECTOR_NAME("least-latency");
+
+}
+
+constexpr std::chrono::seconds LatencyBackendSelector::DECAY_HALF_LIFE;
+
+double
+LatencyBackendSelector::cost(const Backend                        &backend,
+                              std::chrono::steady_clock::time_point now)
+{
+    const BackendCounters &counters = *backend.counters();
+
+    std::chrono::duration<double> idle = now - counters.lastLatencySample();
+    double decay =
+        idle.count() > 0 ? std::exp2(-idle / DECAY_HALF_LIFE) : 1.0;
+
+    return static_cast<double>(counters.setupLatency().count()) * decay *
+           static_cast<double>(counters.connections() + 1);
+}
+
+std::size_t
+LatencyBackendSelector::choose(const BackendSet::Partition &partition,
+                               uint64_t                     marker) const
+{
+    auto        now      = std::chrono::steady_clock::now();
+    std::size_t size     = partition.size();
+    std::size_t start    = marker % size;
+    std::size_t best     = start;
+    double      bestCost = cost(*partition[start], now);
+
+    // Starting from the marker means equally fast backends take turns
+    for (std::size_t offset = 1; offset < size; ++offset) {
+        std::size_t candidate     = (start + offset) % size;
+        double      candidateCost = cost(*partition[candidate], now);
+        if (candidateCost < bestCost) {
+            best     = candidate;
+            bestCost = candidateCost;
+        }
+    }
+
+    return best;
+}
+
+const std::string &LatencyBackendSelector::selectorName() const
+{
+    return SELECTOR_NAME;
+}
+
+}
+}
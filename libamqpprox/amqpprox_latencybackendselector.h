@@ -0,0 +1,72 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_LATENCYBACKENDSELECTOR
+#define BLOOMBERG_AMQPPROX_LATENCYBACKENDSELECTOR
+
+#include <amqpprox_loadbackendselector.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class Backend;
+
+/**
+ * \brief Selects the backend in a partition that sets up connections the
+ * fastest first, implements the BackendSelector interface
+ *
+ * Each backend costs its moving average connect, TLS handshake and
+ * Connection.Start latency, multiplied by one more than the sessions on it
+ * so the fastest backend doesn't take every connection. The latency decays
+ * by half for every `DECAY_HALF_LIFE` without a new sample, so a backend
+ * passed over for being slow is tried again once its estimate is stale.
+ * Backends never sampled cost nothing, and are tried first.
+ */
+class LatencyBackendSelector : public LoadBackendSelector {
+  public:
+    static constexpr std::chrono::seconds DECAY_HALF_LIFE{10};
+
+  protected:
+    // ACCESSORS
+    virtual std::size_t choose(const BackendSet::Partition &partition,
+                               uint64_t marker) const override;
+
+  public:
+    // CREATORS
+    virtual ~LatencyBackendSelector() override = default;
+
+    // ACCESSORS
+    /**
+     * \return the name of this `BackendSelector`. This name is used to attach
+     * this selector to a given `Farm`.
+     */
+    virtual const std::string &selectorName() const override;
+
+    /**
+     * \return the cost of connecting to `backend` at `now`, lower is better
+     */
+    static double cost(const Backend                        &backend,
+                       std::chrono::steady_clock::time_point now);
+};
+
+}
+}
+
+#endif
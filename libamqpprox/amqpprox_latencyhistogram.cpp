@@ -0,0 +1,159 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_latencyhistogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+/**
+ * \return the position of the highest bit set in the non-zero `value`
+ */
+std::size_t highestBit(uint64_t value)
+{
+    return 63 - __builtin_clzll(value);
+}
+
+/**
+ * \return the number of counts up to and including the last non-zero one
+ */
+std::size_t usedSize(const std::vector<uint64_t> &counts)
+{
+    auto last = std::find_if(
+        counts.rbegin(), counts.rend(), [](uint64_t c) { return c != 0; });
+    return counts.rend() - last;
+}
+
+}
+
+constexpr std::size_t LatencyHistogram::SUB_BUCKET_BITS;
+constexpr std::size_t LatencyHistogram::SUB_BUCKETS;
+constexpr uint64_t    LatencyHistogram::MAX_VALUE;
+constexpr std::size_t LatencyHistogram::NUM_BUCKETS;
+
+LatencyHistogram::LatencyHistogram()
+: d_counts()
+{
+}
+
+void LatencyHistogram::addToBucket(std::size_t bucket, uint64_t count)
+{
+    if (bucket >= d_counts.size()) {
+        d_counts.resize(bucket + 1, 0);
+    }
+    d_counts[bucket] += count;
+}
+
+void LatencyHistogram::add(const LatencyHistogram &other)
+{
+    if (other.d_counts.size() > d_counts.size()) {
+        d_counts.resize(other.d_counts.size(), 0);
+    }
+
+    for (std::size_t i = 0; i < other.d_counts.size(); ++i) {
+        d_counts[i] += other.d_counts[i];
+    }
+}
+
+void LatencyHistogram::subtract(const LatencyHistogram &other)
+{
+    std::size_t size = std::min(d_counts.size(), other.d_counts.size());
+    for (std::size_t i = 0; i < size; ++i) {
+        d_counts[i] -= other.d_counts[i];
+    }
+    d_counts.resize(usedSize(d_counts));
+}
+
+void LatencyHistogram::clear()
+{
+    d_counts.clear();
+}
+
+uint64_t LatencyHistogram::count() const
+{
+    uint64_t total = 0;
+    for (uint64_t c : d_counts) {
+        total += c;
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::percentile(double quantile) const
+{
+    uint64_t total = count();
+    if (total == 0) {
+        return 0;
+    }
+
+    // The rank of the sample at the quantile, counting from one, allowing for
+    // the quantile not being exactly representable
+    uint64_t rank =
+        static_cast<uint64_t>(std::ceil(quantile * total - 1e-9));
+    rank          = std::max<uint64_t>(1, std::min(rank, total));
+
+    uint64_t seen = 0;
+    for (std::size_t i = 0; i < d_counts.size(); ++i) {
+        seen += d_counts[i];
+        if (seen >= rank) {
+            return bucketUpperBound(i);
+        }
+    }
+
+    return bucketUpperBound(d_counts.size() - 1);
+}
+
+std::size_t LatencyHistogram::bucketIndex(uint64_t value)
+{
+    if (value < SUB_BUCKETS) {
+        return value;
+    }
+
+    value             = std::min(value, MAX_VALUE);
+    std::size_t shift = highestBit(value) - SUB_BUCKET_BITS;
+    return (shift + 1) * SUB_BUCKETS + ((value >> shift) - SUB_BUCKETS);
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(std::size_t bucket)
+{
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+
+    std::size_t shift = bucket / SUB_BUCKETS - 1;
+    uint64_t    first = SUB_BUCKETS + bucket % SUB_BUCKETS;
+    return ((first + 1) << shift) - 1;
+}
+
+bool LatencyHistogram::operator==(const LatencyHistogram &other) const
+{
+    std::size_t size = usedSize(d_counts);
+    return size == usedSize(other.d_counts) &&
+           std::equal(d_counts.begin(),
+                      d_counts.begin() + size,
+                      other.d_counts.begin());
+}
+
+bool LatencyHistogram::operator!=(const LatencyHistogram &other) const
+{
+    return !(*this == other);
+}
+
+}
+}
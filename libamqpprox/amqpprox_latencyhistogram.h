@@ -0,0 +1,139 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_LATENCYHISTOGRAM
+#define BLOOMBERG_AMQPPROX_LATENCYHISTOGRAM
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Counts latency samples in log-linear buckets, for percentiles
+ *
+ * Values below `SUB_BUCKETS` each have their own bucket. Above that every
+ * power of two is split into `SUB_BUCKETS` equal buckets, so a bucket is never
+ * wider than 1/`SUB_BUCKETS` of the values it holds, and percentiles read
+ * back from the histogram are within that of the recorded values. Values
+ * above `MAX_VALUE` are counted in the last bucket.
+ *
+ * The counts are only kept up to the highest bucket used, so histograms of
+ * short latencies stay small. Histograms can be added and subtracted, which
+ * is how the histograms of sessions are merged into their aggregates.
+ *
+ * \note Thread Safety - Calls must occur serially.
+ */
+class LatencyHistogram {
+  public:
+    // CONSTANTS
+    static constexpr std::size_t SUB_BUCKET_BITS = 3;
+    static constexpr std::size_t SUB_BUCKETS     = 1 << SUB_BUCKET_BITS;
+    static constexpr uint64_t    MAX_VALUE       = 0xffffffff;
+    static constexpr std::size_t NUM_BUCKETS =
+        (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+  private:
+    std::vector<uint64_t> d_counts;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct an empty histogram
+     */
+    LatencyHistogram();
+
+    // MANIPULATORS
+    /**
+     * \brief Count `count` samples of `value`
+     */
+    inline void record(uint64_t value, uint64_t count = 1);
+
+    /**
+     * \brief Count `count` samples in the `bucket`, as returned by
+     * `bucketIndex`
+     */
+    void addToBucket(std::size_t bucket, uint64_t count);
+
+    /**
+     * \brief Add the samples of the `other` histogram to this one
+     */
+    void add(const LatencyHistogram &other);
+
+    /**
+     * \brief Remove the samples of the `other` histogram from this one, which
+     * must contain all of them
+     */
+    void subtract(const LatencyHistogram &other);
+
+    /**
+     * \brief Remove all samples
+     */
+    void clear();
+
+    // ACCESSORS
+    /**
+     * \return the number of samples counted
+     */
+    uint64_t count() const;
+
+    /**
+     * \return the highest value of the bucket holding the sample at the
+     * `quantile` (between 0 and 1) of those counted, or 0 if there are none
+     */
+    uint64_t percentile(double quantile) const;
+
+    /**
+     * \return the number of samples counted in the `bucket`
+     */
+    inline uint64_t bucketCount(std::size_t bucket) const;
+
+    /**
+     * \return the bucket counting samples of the `value`
+     */
+    static std::size_t bucketIndex(uint64_t value);
+
+    /**
+     * \return the highest value counted in the `bucket`
+     */
+    static uint64_t bucketUpperBound(std::size_t bucket);
+
+    /**
+     * \return whether both histograms count the same samples
+     */
+    bool operator==(const LatencyHistogram &other) const;
+
+    /**
+     * \return whether the histograms count different samples
+     */
+    bool operator!=(const LatencyHistogram &other) const;
+};
+
+inline void LatencyHistogram::record(uint64_t value, uint64_t count)
+{
+    addToBucket(bucketIndex(value), count);
+}
+
+inline uint64_t LatencyHistogram::bucketCount(std::size_t bucket) const
+{
+    return bucket < d_counts.size() ? d_counts[bucket] : 0;
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,57 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_leastconnectionsbackendselector.h>
+
+#include <amqpprox_backend.h>
+
+#include <chrono>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+const std::string SELECTOR_NAME("least-connections");
+
+}
+
+std::size_t
+LeastConnectionsBackendSelector::choose(const BackendSet::Partition &partition,
+                                        uint64_t marker) const
+{
+    auto        now   = std::chrono::steady_clock::now();
+    std::size_t size  = partition.size();
+    std::size_t start = marker % size;
+    std::size_t best  = start;
+
+    // Starting from the marker means equally loaded backends take turns
+    for (std::size_t offset = 1; offset < size; ++offset) {
+        std::size_t candidate = (start + offset) % size;
+        if (lessLoaded(*partition[candidate], *partition[best], now)) {
+            best = candidate;
+        }
+    }
+
+    return best;
+}
+
+const std::string &LeastConnectionsBackendSelector::selectorName() const
+{
+    return SELECTOR_NAME;
+}
+
+}
+}
@@ -0,0 +1,54 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_LEASTCONNECTIONSBACKENDSELECTOR
+#define BLOOMBERG_AMQPPROX_LEASTCONNECTIONSBACKENDSELECTOR
+
+#include <amqpprox_loadbackendselector.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Selects the backend in a partition with the fewest sessions
+ * connecting or connected to it first, breaking ties by the traffic in the
+ * last second and then round-robin, implements the BackendSelector interface
+ */
+class LeastConnectionsBackendSelector : public LoadBackendSelector {
+  protected:
+    // ACCESSORS
+    virtual std::size_t choose(const BackendSet::Partition &partition,
+                               uint64_t marker) const override;
+
+  public:
+    // CREATORS
+    virtual ~LeastConnectionsBackendSelector() override = default;
+
+    // ACCESSORS
+    /**
+     * \return the name of this `BackendSelector`. This name is used to attach
+     * this selector to a given `Farm`.
+     */
+    virtual const std::string &selectorName() const override;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_loadbackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+bool LoadBackendSelector::lessLoaded(const Backend                        &lhs,
+                                     const Backend                        &rhs,
+                                     std::chrono::steady_clock::time_point now)
+{
+    const BackendCounters &lhsCounters = *lhs.counters();
+    const BackendCounters &rhsCounters = *rhs.counters();
+    if (lhsCounters.connections() != rhsCounters.connections()) {
+        return lhsCounters.connections() < rhsCounters.connections();
+    }
+    return lhsCounters.bytesPerSecond(now) < rhsCounters.bytesPerSecond(now);
+}
+
+const Backend *
+LoadBackendSelector::select(BackendSet                  *backendSet,
+                            const std::vector<uint64_t> &markers,
+                            uint64_t                     retryCount) const
+{
+    uint64_t retry = retryCount;
+    uint64_t i     = 0;
+
+    for (const auto &marker : markers) {
+        const BackendSet::Partition &partition = backendSet->partitions()[i];
+        uint64_t                     partitionSize = partition.size();
+
+        // One attempt on the chosen backend, then one on each backend
+        uint64_t attempts = partitionSize ? partitionSize + 1 : 0;
+
+        if (retry >= attempts) {
+            retry -= attempts;
+        }
+        else {
+            backendSet->markPartition(i);
+            if (retry == 0) {
+                return partition[choose(partition, marker)];
+            }
+            return partition[(marker + retry - 1) % partitionSize];
+        }
+
+        ++i;
+    }
+
+    return nullptr;
+}
+
+}
+}
@@ -0,0 +1,78 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_LOADBACKENDSELECTOR
+#define BLOOMBERG_AMQPPROX_LOADBACKENDSELECTOR
+
+#include <amqpprox_backendselector.h>
+#include <amqpprox_backendset.h>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class Backend;
+
+/**
+ * \brief Base for selectors choosing the first backend attempted in a
+ * partition by the live load on each backend, implements the
+ * BackendSelector interface
+ *
+ * The first attempt on each partition goes to the backend chosen by
+ * `choose`, the following ones go to every backend of the partition in
+ * round-robin order. That order repeats the chosen backend once, which the
+ * `ConnectionManager` skips, so each backend is still attempted once. The
+ * load is read again on every call, so it's up to the `ConnectionManager`
+ * to ask for each retry count once.
+ */
+class LoadBackendSelector : public BackendSelector {
+  protected:
+    // ACCESSORS
+    /**
+     * \brief Choose the backend the first attempt on a partition goes to
+     * \param partition non-empty partition to choose from
+     * \param marker the partition's marker, to rotate the preference
+     * between equally loaded backends
+     * \return index of the chosen backend in `partition`
+     */
+    virtual std::size_t choose(const BackendSet::Partition &partition,
+                               uint64_t                     marker) const = 0;
+
+    /**
+     * \return true if the `lhs` backend has fewer connections, or as many
+     * connections and less traffic, than the `rhs` backend
+     */
+    static bool lessLoaded(const Backend                        &lhs,
+                           const Backend                        &rhs,
+                           std::chrono::steady_clock::time_point now);
+
+  public:
+    // CREATORS
+    virtual ~LoadBackendSelector() override = default;
+
+    // ACCESSORS
+    virtual const Backend *select(BackendSet                  *backendSet,
+                                  const std::vector<uint64_t> &markers,
+                                  uint64_t retryCount) const override;
+};
+
+}
+}
+
+#endif
@@ -483,6 +483,55 @@ class MaybeSecureSocketAdaptor
         }
     }
 
+    /**
+     * \return true if `read_some` may be attempted without first waiting for
+     * the socket to become readable, which requires it to be unencrypted,
+     * within its data rate limit, and if intercepted for the intercept to
+     * allow it
+     */
+    bool canReadSpeculatively()
+    {
+        if (BOOST_UNLIKELY(d_intercept.has_value()) &&
+            !d_intercept.value().get().canReadSpeculatively()) {
+            return false;
+        }
+
+        return !d_secured && d_dataRateLimit.remainingQuota() > 0;
+    }
+
+    /**
+     * \return the native handle of the socket if data can be spliced directly
+     * to and from it, which requires it to be neither encrypted nor
+     * intercepted, otherwise -1
+     */
+    int spliceHandle()
+    {
+        if (BOOST_UNLIKELY(d_intercept.has_value()) || d_secured) {
+            return -1;
+        }
+
+        return d_socket->next_layer().native_handle();
+    }
+
+    /**
+     * \brief Account for bytes read from the socket without `read_some`, such
+     * as by splicing, against the data rate limit and alarm
+     * \param amount the number of bytes read
+     */
+    void recordSplicedRead(std::size_t amount) { recordReadUsage(amount); }
+
+    /**
+     * \brief Invoke the handler once the socket can be written to without
+     * blocking
+     */
+    template <typename WaitHandler>
+    void async_wait_writable(WaitHandler &&handler)
+    {
+        d_socket->next_layer().async_wait(
+            boost::asio::ip::tcp::socket::wait_write,
+            std::forward<WaitHandler>(handler));
+    }
+
   private:
     bool isSecure()
     {
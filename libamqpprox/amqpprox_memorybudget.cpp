@@ -0,0 +1,181 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_memorybudget.h>
+
+#include <amqpprox_bufferpool.h>
+#include <amqpprox_logging.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+MemoryBudget::MemoryBudget(boost::asio::io_context &ioContext,
+                           BufferPool              *bufferPool,
+                           std::size_t              highWatermark,
+                           std::size_t              lowWatermark)
+: d_timer(ioContext)
+, d_bufferPool_p(bufferPool)
+, d_highWatermark(highWatermark)
+, d_lowWatermark(std::min(lowWatermark, highWatermark))
+, d_exceeded(false)
+, d_readers(0)
+, d_pauses(0)
+, d_resumes(0)
+, d_waitingMutex()
+, d_waiting()
+, d_sampling(false)
+{
+}
+
+MemoryBudget::~MemoryBudget()
+{
+    stop();
+}
+
+void MemoryBudget::addReader()
+{
+    d_readers.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MemoryBudget::removeReader()
+{
+    d_readers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MemoryBudget::startSampling()
+{
+    std::lock_guard<std::mutex> lg(d_waitingMutex);
+    if (!d_sampling) {
+        d_sampling = true;
+        scheduleSample();
+    }
+}
+
+void MemoryBudget::sample()
+{
+    std::vector<ResumeFunction> resumed;
+    {
+        std::lock_guard<std::mutex> lg(d_waitingMutex);
+        if (updateExceeded() || d_waiting.empty()) {
+            return;
+        }
+
+        resumed.swap(d_waiting);
+    }
+
+    LOG_DEBUG << "Resuming " << resumed.size() << " paused readers";
+    d_resumes.fetch_add(resumed.size(), std::memory_order_relaxed);
+    for (const auto &resume : resumed) {
+        resume();
+    }
+}
+
+bool MemoryBudget::shouldPause(std::size_t readerBytes) const
+{
+    if (!exceeded()) {
+        return false;
+    }
+
+    uint64_t readers = std::max<uint64_t>(
+        d_readers.load(std::memory_order_relaxed), 1);
+    return readerBytes >= d_lowWatermark / readers;
+}
+
+void MemoryBudget::waitForMemory(const ResumeFunction &resume)
+{
+    d_pauses.fetch_add(1, std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lg(d_waitingMutex);
+    d_waiting.push_back(resume);
+}
+
+void MemoryBudget::stop()
+{
+    std::lock_guard<std::mutex> lg(d_waitingMutex);
+    d_timer.cancel();
+    d_sampling = false;
+    d_waiting.clear();
+}
+
+std::size_t MemoryBudget::bytesInUse() const
+{
+    return d_bufferPool_p->bytesInUse();
+}
+
+bool MemoryBudget::exceeded() const
+{
+    return d_exceeded.load(std::memory_order_relaxed);
+}
+
+void MemoryBudget::statistics(uint64_t *pausedReaders,
+                              uint64_t *pauses,
+                              uint64_t *resumes)
+{
+    {
+        std::lock_guard<std::mutex> lg(d_waitingMutex);
+        *pausedReaders = d_waiting.size();
+    }
+
+    *pauses  = d_pauses.load(std::memory_order_relaxed);
+    *resumes = d_resumes.load(std::memory_order_relaxed);
+}
+
+bool MemoryBudget::updateExceeded()
+{
+    bool exceeded = d_exceeded.load(std::memory_order_relaxed);
+    if (!exceeded && d_highWatermark == 0) {
+        return false;
+    }
+
+    std::size_t inUse = bytesInUse();
+    if (!exceeded && inUse >= d_highWatermark) {
+        if (!d_exceeded.exchange(true, std::memory_order_relaxed)) {
+            LOG_INFO << "Buffer memory budget exceeded: " << inUse
+                     << " bytes in use, pausing the heaviest readers";
+        }
+        return true;
+    }
+    else if (exceeded && inUse <= d_lowWatermark) {
+        if (d_exceeded.exchange(false, std::memory_order_relaxed)) {
+            LOG_DEBUG << "Buffer memory drained to " << inUse << " bytes";
+        }
+        return false;
+    }
+
+    return exceeded;
+}
+
+void MemoryBudget::scheduleSample()
+{
+    d_timer.expires_after(std::chrono::milliseconds(SAMPLE_INTERVAL_MS));
+    d_timer.async_wait([this](const boost::system::error_code &ec) {
+        if (ec) {
+            return;
+        }
+
+        sample();
+
+        std::lock_guard<std::mutex> lg(d_waitingMutex);
+        if (d_sampling) {
+            scheduleSample();
+        }
+    });
+}
+
+}
+}
@@ -0,0 +1,190 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_MEMORYBUDGET
+#define BLOOMBERG_AMQPPROX_MEMORYBUDGET
+
+#include <boost/asio.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class BufferPool;
+
+/**
+ * \brief Bound the memory handed out by a `BufferPool` by pausing readers
+ *
+ * Once the bytes in use from the pool reach the high watermark the budget is
+ * exceeded, and stays so until they drain to the low watermark. The bytes in
+ * use are sampled every `SAMPLE_INTERVAL_MS` on the budget's io_context,
+ * since counting them reads counters written by every I/O thread, so readers
+ * only ever check a cached flag. While it is exceeded, readers ask
+ * `shouldPause` before each read, passing the bytes their reads hold on to.
+ * Those holding more than an equal share of the low watermark across all
+ * registered readers are the heaviest, and are told to pause. A paused reader
+ * registers a function with `waitForMemory`, which is invoked from the
+ * budget's io_context once a sample finds the low watermark reached.
+ *
+ * All methods are thread safe.
+ */
+class MemoryBudget {
+  public:
+    // TYPES
+    using ResumeFunction = std::function<void()>;
+
+    // CONSTANTS
+    static constexpr int SAMPLE_INTERVAL_MS = 10;
+
+  private:
+    boost::asio::steady_timer   d_timer;
+    BufferPool                 *d_bufferPool_p;  // HELD NOT OWNED
+    std::size_t                 d_highWatermark;
+    std::size_t                 d_lowWatermark;
+    std::atomic<bool>           d_exceeded;
+    std::atomic<uint64_t>       d_readers;
+    std::atomic<uint64_t>       d_pauses;
+    std::atomic<uint64_t>       d_resumes;
+    std::mutex                  d_waitingMutex;
+    std::vector<ResumeFunction> d_waiting;
+    bool                        d_sampling;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct a budget for the `bufferPool`
+     * \param ioContext the event loop used to periodically sample memory
+     * usage, and to resume paused readers
+     * \param bufferPool the pool whose usage is budgeted
+     * \param highWatermark bytes in use at which readers start to be paused
+     * \param lowWatermark bytes in use at which paused readers are resumed
+     */
+    MemoryBudget(boost::asio::io_context &ioContext,
+                 BufferPool              *bufferPool,
+                 std::size_t              highWatermark,
+                 std::size_t              lowWatermark);
+
+    ~MemoryBudget();
+
+    MemoryBudget(const MemoryBudget &) = delete;
+    MemoryBudget &operator=(const MemoryBudget &) = delete;
+
+    // MANIPULATORS
+    /**
+     * \brief Register a reader sharing the budget
+     */
+    void addReader();
+
+    /**
+     * \brief Unregister a reader previously registered with `addReader`
+     */
+    void removeReader();
+
+    /**
+     * \brief Start sampling memory usage every `SAMPLE_INTERVAL_MS`, until
+     * `stop` is called
+     */
+    void startSampling();
+
+    /**
+     * \brief Update whether the budget is exceeded from the bytes currently
+     * in use, resuming all paused readers if it no longer is
+     */
+    void sample();
+
+    /**
+     * \brief Check whether a reader holding on to `readerBytes` should pause
+     * reading, as of the last sample
+     * \return true if the budget is exceeded and the reader is one of the
+     * heaviest
+     */
+    bool shouldPause(std::size_t readerBytes) const;
+
+    /**
+     * \brief Register the `resume` function of a paused reader, to be
+     * invoked once a sample finds memory usage back to the low watermark
+     */
+    void waitForMemory(const ResumeFunction &resume);
+
+    /**
+     * \brief Stop sampling memory usage, discarding any paused readers
+     */
+    void stop();
+
+    // ACCESSORS
+    /**
+     * \return the bytes currently in use from the buffer pool
+     */
+    std::size_t bytesInUse() const;
+
+    /**
+     * \return whether, as of the last sample, the high watermark has been
+     * reached and memory has not yet drained to the low watermark
+     */
+    bool exceeded() const;
+
+    /**
+     * \brief Retrieve the current statistics of the budget
+     * \param pausedReaders the number of readers currently paused
+     * \param pauses the number of times a reader has been paused
+     * \param resumes the number of times a reader has been resumed
+     */
+    void statistics(uint64_t *pausedReaders,
+                    uint64_t *pauses,
+                    uint64_t *resumes);
+
+    /**
+     * \return the bytes in use at which readers start to be paused
+     */
+    std::size_t highWatermark() const;
+
+    /**
+     * \return the bytes in use at which paused readers are resumed
+     */
+    std::size_t lowWatermark() const;
+
+  private:
+    /**
+     * \brief Update whether the budget is exceeded from the current usage
+     * \return whether the budget is exceeded
+     */
+    bool updateExceeded();
+
+    /**
+     * \brief Take the next sample after `SAMPLE_INTERVAL_MS`
+     */
+    void scheduleSample();
+};
+
+inline std::size_t MemoryBudget::highWatermark() const
+{
+    return d_highWatermark;
+}
+
+inline std::size_t MemoryBudget::lowWatermark() const
+{
+    return d_lowWatermark;
+}
+
+}
+}
+
+#endif
@@ -46,8 +46,19 @@ bool Start::decode(Start *start, Buffer &buffer)
     start->d_versionMajor = buffer.copy<boost::endian::big_uint8_t>();
     start->d_versionMinor = buffer.copy<boost::endian::big_uint8_t>();
 
-    return Types::decodeFieldTable(&start->d_properties, buffer) &&
-           Types::decodeLongString(&start->d_mechanisms, buffer) &&
+    // The server properties are only copied, not decoded, as the proxy
+    // never looks them up
+    FieldTableView properties;
+    if (!Types::decodeFieldTable(&properties, buffer)) {
+        return false;
+    }
+
+    const char *fields = static_cast<const char *>(properties.fields().ptr());
+    start->d_receivedProperties.assign(
+        fields, fields + properties.fields().available());
+    start->d_properties.reset();
+
+    return Types::decodeLongString(&start->d_mechanisms, buffer) &&
            Types::decodeLongString(&start->d_locales, buffer);
 }
 
@@ -55,11 +66,23 @@ bool Start::encode(Buffer &buffer, const Start &start)
 {
     return buffer.writeIn<boost::endian::big_uint8_t>(start.versionMajor()) &&
            buffer.writeIn<boost::endian::big_uint8_t>(start.versionMinor()) &&
-           Types::encodeFieldTable(buffer, start.properties()) &&
+           Types::encodeFieldTable(
+               buffer, start.receivedProperties(), start.d_properties) &&
            Types::encodeLongString(buffer, start.mechanisms()) &&
            Types::encodeLongString(buffer, start.locales());
 }
 
+FieldTable Start::properties() const
+{
+    FieldTable properties;
+    receivedProperties().materialize(&properties);
+    for (std::size_t i = 0; i < d_properties.numberFields(); ++i) {
+        properties.pushField(d_properties.fieldName(i),
+                             d_properties.fieldIndex(i));
+    }
+    return properties;
+}
+
 std::ostream &operator<<(std::ostream &os, const Start &startMethod)
 {
     os << "Start = [version:" << (int)startMethod.versionMajor() << "."
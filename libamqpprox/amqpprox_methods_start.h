@@ -17,6 +17,7 @@
 #define BLOOMBERG_AMQPPROX_METHODS_START
 
 #include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldtableview.h>
 
 #include <boost/endian/arithmetic.hpp>
 #include <string>
@@ -35,6 +36,7 @@ namespace methods {
 class Start {
     boost::endian::big_uint8_t d_versionMajor;
     boost::endian::big_uint8_t d_versionMinor;
+    std::vector<char>          d_receivedProperties;
     FieldTable                 d_properties;
     std::string                d_mechanisms;
     std::string                d_locales;
@@ -48,7 +50,20 @@ class Start {
           const std::vector<std::string> &mechanisms,
           const std::vector<std::string> &locales);
 
-    const FieldTable &properties() const { return d_properties; }
+    /**
+     * \return the server properties as received, which are kept encoded
+     */
+    FieldTableView receivedProperties() const
+    {
+        return FieldTableView(
+            Buffer(d_receivedProperties.data(), d_receivedProperties.size()));
+    }
+
+    /**
+     * \return the server properties as received followed by those the
+     * method was constructed with, decoded into an owning table
+     */
+    FieldTable properties() const;
 
     const std::string &mechanisms() const { return d_mechanisms; }
 
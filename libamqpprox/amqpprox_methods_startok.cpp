@@ -15,6 +15,7 @@
 */
 #include <amqpprox_methods_startok.h>
 
+#include <amqpprox_buffer.h>
 #include <amqpprox_types.h>
 
 #include <iostream>
@@ -26,25 +27,56 @@ namespace methods {
 
 bool StartOk::decode(StartOk *startOk, Buffer &buffer)
 {
-    return Types::decodeFieldTable(&startOk->d_properties, buffer) &&
-           Types::decodeShortString(&startOk->d_mechanism, buffer) &&
+    // The client properties are only copied, not decoded: the proxy passes
+    // them on, only adding to them or looking up a few of them
+    FieldTableView properties;
+    if (!Types::decodeFieldTable(&properties, buffer)) {
+        return false;
+    }
+
+    const char *fields = static_cast<const char *>(properties.fields().ptr());
+    startOk->d_receivedProperties.assign(
+        fields, fields + properties.fields().available());
+    startOk->d_properties.reset();
+
+    return Types::decodeShortString(&startOk->d_mechanism, buffer) &&
            Types::decodeLongString(&startOk->d_response, buffer) &&
            Types::decodeShortString(&startOk->d_locale, buffer);
 }
 
 bool StartOk::encode(Buffer &buffer, const StartOk &startOk)
 {
-    return Types::encodeFieldTable(buffer, startOk.d_properties) &&
+    return Types::encodeFieldTable(buffer,
+                                   startOk.receivedProperties(),
+                                   startOk.d_properties) &&
            Types::encodeShortString(buffer, startOk.d_mechanism) &&
            Types::encodeLongString(buffer, startOk.d_response) &&
            Types::encodeShortString(buffer, startOk.d_locale);
 }
 
+FieldTable StartOk::properties() const
+{
+    FieldTable properties;
+    receivedProperties().materialize(&properties);
+    for (std::size_t i = 0; i < d_properties.numberFields(); ++i) {
+        properties.pushField(d_properties.fieldName(i),
+                             d_properties.fieldIndex(i));
+    }
+    return properties;
+}
+
 void StartOk::setClientProperties(const FieldTable &clientProperties)
 {
+    d_receivedProperties.clear();
     d_properties = clientProperties;
 }
 
+void StartOk::pushClientProperty(const std::string &name,
+                                 const FieldValue  &value)
+{
+    d_properties.pushField(name, value);
+}
+
 void StartOk::setAuthMechanism(std::string_view authMechanism)
 {
     d_mechanism = authMechanism;
@@ -17,11 +17,13 @@
 #define BLOOMBERG_AMQPPROX_METHODS_STARTOK
 
 #include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldtableview.h>
 
 #include <boost/endian/arithmetic.hpp>
 #include <iosfwd>
 #include <string>
 #include <string_view>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -34,15 +36,27 @@ namespace methods {
  * \brief Represents AMQP Connection START-OK method
  */
 class StartOk {
-    FieldTable  d_properties;
-    std::string d_mechanism;
-    std::string d_response;
-    std::string d_locale;
+    std::vector<char> d_receivedProperties;
+    FieldTable        d_properties;
+    std::string       d_mechanism;
+    std::string       d_response;
+    std::string       d_locale;
 
   public:
-    const FieldTable &properties() const { return d_properties; }
+    /**
+     * \return the client properties as received, which are kept encoded
+     */
+    FieldTableView receivedProperties() const
+    {
+        return FieldTableView(
+            Buffer(d_receivedProperties.data(), d_receivedProperties.size()));
+    }
 
-    FieldTable &properties() { return d_properties; }
+    /**
+     * \return the client properties as received followed by those pushed
+     * since, decoded into an owning table
+     */
+    FieldTable properties() const;
 
     const std::string &mechanism() const { return d_mechanism; }
 
@@ -70,6 +84,14 @@ class StartOk {
      */
     void setClientProperties(const FieldTable &clientProperties);
 
+    /**
+     * \brief Add a client property after those already present, without
+     * decoding the client properties as received
+     * \param name the name of the property
+     * \param value the value of the property
+     */
+    void pushClientProperty(const std::string &name, const FieldValue &value);
+
     /**
      * \brief Set specified AMQP authMechanism
      * \param authMechanism AMQP authentication mechanism
@@ -0,0 +1,328 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_metricsserver.h>
+
+#include <amqpprox_eventsource.h>
+#include <amqpprox_logging.h>
+#include <amqpprox_openmetricsrenderer.h>
+#include <amqpprox_statcollector.h>
+
+#include <chrono>
+#include <functional>
+#include <optional>
+#include <string>
+
+#include <boost/beast.hpp>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace beast = boost::beast;
+namespace http  = boost::beast::http;
+
+namespace {
+
+// Amount of text rendered into each chunk of a response
+const std::size_t CHUNK_SIZE = 64 * 1024;
+
+// Time allowed for each read or write before the connection is dropped
+const std::chrono::seconds TIMEOUT(30);
+
+/**
+ * \brief Serves the requests of one HTTP connection, one at a time
+ */
+class MetricsConnection
+: public std::enable_shared_from_this<MetricsConnection> {
+    using Serializer = http::response_serializer<http::empty_body>;
+
+    beast::tcp_stream                  d_stream;
+    beast::flat_buffer                 d_buffer;
+    http::request<http::string_body>   d_request;
+    http::response<http::empty_body>   d_response;
+    std::optional<Serializer>          d_serializer;
+    std::optional<OpenMetricsRenderer> d_renderer;
+    std::string                        d_body;
+    const MetricsServer               *d_server_p;  // HELD NOT OWNED
+
+  public:
+    MetricsConnection(boost::asio::ip::tcp::socket socket,
+                      const MetricsServer         *server)
+    : d_stream(std::move(socket))
+    , d_buffer()
+    , d_request()
+    , d_response()
+    , d_serializer()
+    , d_renderer()
+    , d_body()
+    , d_server_p(server)
+    {
+    }
+
+    void readRequest()
+    {
+        d_request = {};
+        d_stream.expires_after(TIMEOUT);
+        http::async_read(
+            d_stream,
+            d_buffer,
+            d_request,
+            beast::bind_front_handler(&MetricsConnection::onRead,
+                                      shared_from_this()));
+    }
+
+  private:
+    void onRead(beast::error_code ec, std::size_t)
+    {
+        if (ec == http::error::end_of_stream) {
+            close();
+            return;
+        }
+
+        if (ec) {
+            LOG_DEBUG << "Metrics request read failed: " << ec.message();
+            return;
+        }
+
+        beast::string_view target = d_request.target();
+        target                    = target.substr(0, target.find('?'));
+
+        if (target != "/metrics") {
+            sendError(http::status::not_found, "Not Found\n");
+        }
+        else if (d_request.method() != http::verb::get &&
+                 d_request.method() != http::verb::head) {
+            sendError(http::status::method_not_allowed,
+                      "Method Not Allowed\n");
+        }
+        else {
+            sendMetrics();
+        }
+    }
+
+    void sendError(http::status status, const char *reason)
+    {
+        auto response = std::make_shared<http::response<http::string_body>>(
+            status, d_request.version());
+        response->set(http::field::content_type, "text/plain");
+        if (status == http::status::method_not_allowed) {
+            response->set(http::field::allow, "GET, HEAD");
+        }
+        response->keep_alive(d_request.keep_alive());
+        response->body() = reason;
+        response->prepare_payload();
+
+        d_stream.expires_after(TIMEOUT);
+        http::async_write(
+            d_stream,
+            *response,
+            [self = shared_from_this(), response](beast::error_code ec,
+                                                  std::size_t) {
+                if (!ec) {
+                    self->finish(response->keep_alive());
+                }
+            });
+    }
+
+    void sendMetrics()
+    {
+        // HTTP/1.0 clients can't take chunks, so are sent the body as it is
+        // rendered and then closed
+        bool chunked = d_request.version() >= 11;
+
+        d_response = {};
+        d_response.result(http::status::ok);
+        d_response.version(d_request.version());
+        d_response.set(http::field::content_type,
+                       OpenMetricsRenderer::CONTENT_TYPE);
+        d_response.keep_alive(chunked && d_request.keep_alive());
+        d_response.chunked(chunked);
+
+        d_serializer.emplace(d_response);
+        d_stream.expires_after(TIMEOUT);
+        http::async_write_header(
+            d_stream,
+            *d_serializer,
+            beast::bind_front_handler(&MetricsConnection::onHeaderWritten,
+                                      shared_from_this()));
+    }
+
+    void onHeaderWritten(beast::error_code ec, std::size_t)
+    {
+        if (ec) {
+            LOG_DEBUG << "Metrics response write failed: " << ec.message();
+            return;
+        }
+
+        if (d_request.method() == http::verb::head) {
+            finish(d_response.keep_alive());
+            return;
+        }
+
+        d_renderer.emplace(d_server_p->snapshot());
+        writeBody();
+    }
+
+    void writeBody()
+    {
+        d_body.clear();
+        d_renderer->render(&d_body, CHUNK_SIZE);
+
+        d_stream.expires_after(TIMEOUT);
+        auto handler = beast::bind_front_handler(
+            &MetricsConnection::onBodyWritten, shared_from_this());
+        if (d_response.chunked()) {
+            boost::asio::async_write(
+                d_stream,
+                http::make_chunk(boost::asio::buffer(d_body)),
+                std::move(handler));
+        }
+        else {
+            boost::asio::async_write(
+                d_stream, boost::asio::buffer(d_body), std::move(handler));
+        }
+    }
+
+    void onBodyWritten(beast::error_code ec, std::size_t)
+    {
+        if (ec) {
+            LOG_DEBUG << "Metrics response write failed: " << ec.message();
+            return;
+        }
+
+        if (!d_renderer->finished()) {
+            writeBody();
+            return;
+        }
+
+        d_renderer.reset();
+        if (!d_response.chunked()) {
+            finish(false);
+            return;
+        }
+
+        d_stream.expires_after(TIMEOUT);
+        boost::asio::async_write(
+            d_stream,
+            http::make_chunk_last(),
+            [self = shared_from_this()](beast::error_code ec, std::size_t) {
+                if (!ec) {
+                    self->finish(self->d_response.keep_alive());
+                }
+            });
+    }
+
+    void finish(bool keepAlive)
+    {
+        d_serializer.reset();
+        if (keepAlive) {
+            readRequest();
+        }
+        else {
+            close();
+        }
+    }
+
+    void close()
+    {
+        beast::error_code ec;
+        d_stream.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_send,
+                                   ec);
+    }
+};
+
+}
+
+MetricsServer::MetricsServer(boost::asio::io_context &ioContext,
+                             EventSource             *eventSource)
+: d_ioContext(ioContext)
+, d_acceptor(ioContext)
+, d_snapshot(std::make_shared<StatSnapshot>())
+, d_statisticsAvailableSignal()
+{
+    d_statisticsAvailableSignal =
+        eventSource->statisticsAvailable().subscribe(std::bind(
+            &MetricsServer::storeSnapshot, this, std::placeholders::_1));
+}
+
+void MetricsServer::storeSnapshot(StatCollector *collector)
+{
+    // The collector is reset once the statistics have been emitted, so they
+    // have to be copied out now
+    auto snapshot = std::make_shared<StatSnapshot>();
+    collector->populateStats(snapshot.get());
+    d_snapshot = std::move(snapshot);
+}
+
+void MetricsServer::listen(int port, boost::system::error_code &ec)
+{
+    tcp::endpoint endpoint(tcp::v4(), port);
+
+    d_acceptor.open(endpoint.protocol(), ec);
+    if (!ec) {
+        d_acceptor.set_option(boost::asio::socket_base::reuse_address(true),
+                              ec);
+    }
+    if (!ec) {
+        d_acceptor.bind(endpoint, ec);
+    }
+    if (!ec) {
+        d_acceptor.listen(boost::asio::socket_base::max_connections, ec);
+    }
+
+    if (ec) {
+        boost::system::error_code ignored;
+        d_acceptor.close(ignored);
+        return;
+    }
+
+    LOG_INFO << "Serving metrics on port " << this->port();
+    accept();
+}
+
+void MetricsServer::accept()
+{
+    d_acceptor.async_accept(
+        d_ioContext,
+        [this](const boost::system::error_code &ec, tcp::socket socket) {
+            if (ec == boost::asio::error::operation_aborted) {
+                return;
+            }
+
+            if (ec) {
+                LOG_WARN << "Metrics accept failed: " << ec.message();
+            }
+            else {
+                std::make_shared<MetricsConnection>(std::move(socket), this)
+                    ->readRequest();
+            }
+
+            accept();
+        });
+}
+
+int MetricsServer::port() const
+{
+    boost::system::error_code ec;
+    return d_acceptor.is_open() ? d_acceptor.local_endpoint(ec).port() : 0;
+}
+
+std::shared_ptr<const StatSnapshot> MetricsServer::snapshot() const
+{
+    return d_snapshot;
+}
+
+}
+}
@@ -0,0 +1,90 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_METRICSSERVER
+#define BLOOMBERG_AMQPPROX_METRICSSERVER
+
+#include <amqpprox_eventsourcesignal.h>
+#include <amqpprox_statsnapshot.h>
+
+#include <memory>
+
+#include <boost/asio.hpp>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+class EventSource;
+class StatCollector;
+
+/**
+ * \brief Serves the latest statistics over HTTP in the OpenMetrics text
+ * format
+ *
+ * Each time statistics become available a snapshot of them is kept, and a
+ * `GET /metrics` request is answered by rendering that snapshot. HTTP/1.1
+ * responses are sent in chunks rendered as the previous one is written, so a
+ * snapshot with many series neither stalls the `io_context` nor has to be
+ * held in memory as text all at once.
+ *
+ * \note Thread Safety - The statistics must be emitted on the thread running
+ * the `io_context`, which is the case for the control thread.
+ */
+class MetricsServer {
+    using tcp = boost::asio::ip::tcp;
+
+    boost::asio::io_context            &d_ioContext;
+    tcp::acceptor                       d_acceptor;
+    std::shared_ptr<const StatSnapshot> d_snapshot;
+    EventSubscriptionHandle             d_statisticsAvailableSignal;
+
+    void storeSnapshot(StatCollector *collector);
+
+    void accept();
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct a server which isn't yet listening, taking snapshots
+     * of the statistics emitted by the `eventSource`
+     */
+    MetricsServer(boost::asio::io_context &ioContext,
+                  EventSource             *eventSource);
+
+    // MANIPULATORS
+    /**
+     * \brief Start accepting connections on the `port` of all interfaces
+     * \param port to listen on, or zero for one chosen by the OS
+     * \param ec set on failure to bind or listen
+     */
+    void listen(int port, boost::system::error_code &ec);
+
+    // ACCESSORS
+    /**
+     * \return the port being listened on, or zero if not listening
+     */
+    int port() const;
+
+    /**
+     * \return the latest snapshot of statistics, which is empty until
+     * statistics are first available
+     */
+    std::shared_ptr<const StatSnapshot> snapshot() const;
+};
+
+}
+}
+
+#endif
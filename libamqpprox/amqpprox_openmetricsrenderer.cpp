@@ -0,0 +1,419 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_openmetricsrenderer.h>
+
+#include <amqpprox_connectionstats.h>
+#include <amqpprox_latencyhistogram.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+using Distribution = ConnectionStats::Distribution;
+
+const std::size_t FIRST_HISTOGRAM_FAMILY = ConnectionStats::NUM_METRICS;
+const std::size_t OTHER_FAMILIES =
+    FIRST_HISTOGRAM_FAMILY + ConnectionStats::NUM_DISTRIBUTIONS;
+
+// The highest latency bucket boundary, beyond which is only +Inf
+const uint64_t MAX_LATENCY_BOUNDARY = (uint64_t(1) << 24) - 1;
+
+enum Axis { OVERALL, VHOSTS, BACKENDS, SOURCES, NUM_AXES };
+
+void appendFamily(std::string *buffer,
+                  const char  *name,
+                  const char  *type,
+                  const char  *help)
+{
+    buffer->append("# TYPE amqpprox_");
+    buffer->append(name);
+    buffer->push_back(' ');
+    buffer->append(type);
+    buffer->append("\n# HELP amqpprox_");
+    buffer->append(name);
+    buffer->push_back(' ');
+    buffer->append(help);
+    buffer->push_back('\n');
+}
+
+void appendSample(std::string       *buffer,
+                  const std::string &name,
+                  const char        *suffix,
+                  const std::string &labels,
+                  uint64_t           value)
+{
+    buffer->append("amqpprox_");
+    buffer->append(name);
+    buffer->append(suffix);
+    if (!labels.empty()) {
+        buffer->push_back('{');
+        buffer->append(labels);
+        buffer->push_back('}');
+    }
+    buffer->push_back(' ');
+    buffer->append(std::to_string(value));
+    buffer->push_back('\n');
+}
+
+void appendLabel(std::string       *labels,
+                 const char        *name,
+                 const std::string &value)
+{
+    if (!labels->empty()) {
+        labels->push_back(',');
+    }
+    labels->append(name);
+    labels->append("=\"");
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            labels->push_back('\\');
+            labels->push_back(c);
+        }
+        else if (c == '\n') {
+            labels->append("\\n");
+        }
+        else {
+            labels->push_back(c);
+        }
+    }
+    labels->push_back('"');
+}
+
+void appendLatencyHistogram(std::string           *buffer,
+                            const std::string     &name,
+                            const std::string     &labels,
+                            const ConnectionStats &stats,
+                            Distribution           metric)
+{
+    const LatencyHistogram &histogram = stats.histogram(metric);
+
+    // Cumulative counts at each power of two, which are bucket boundaries
+    std::string bucketLabels = labels;
+    uint64_t    cumulative   = 0;
+    for (std::size_t i = 0; i < LatencyHistogram::NUM_BUCKETS; ++i) {
+        cumulative += histogram.bucketCount(i);
+
+        uint64_t upper = LatencyHistogram::bucketUpperBound(i);
+        if (((upper + 1) & upper) == 0) {
+            bucketLabels.resize(labels.size());
+            appendLabel(&bucketLabels, "le", std::to_string(upper));
+            appendSample(buffer, name, "_bucket", bucketLabels, cumulative);
+        }
+
+        if (upper >= MAX_LATENCY_BOUNDARY) {
+            break;
+        }
+    }
+
+    uint64_t count = histogram.count();
+    bucketLabels.resize(labels.size());
+    appendLabel(&bucketLabels, "le", "+Inf");
+    appendSample(buffer, name, "_bucket", bucketLabels, count);
+    appendSample(buffer, name, "_count", labels, count);
+    appendSample(
+        buffer, name, "_sum", labels, stats.distributionPair(metric).first);
+}
+
+}
+
+const char *const OpenMetricsRenderer::CONTENT_TYPE =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
+OpenMetricsRenderer::OpenMetricsRenderer(
+    std::shared_ptr<const StatSnapshot> snapshot)
+: d_snapshot(std::move(snapshot))
+, d_family(0)
+, d_familyStarted(false)
+, d_axis(OVERALL)
+, d_it()
+, d_labels()
+{
+}
+
+bool OpenMetricsRenderer::render(std::string *buffer, std::size_t size)
+{
+    while (d_family < OTHER_FAMILIES && buffer->size() < size) {
+        if (!d_familyStarted) {
+            if (d_family < FIRST_HISTOGRAM_FAMILY) {
+                auto metric = static_cast<ConnectionStats::Metric>(d_family);
+                bool count =
+                    metric < ConnectionStats::FIRST_SESSION_METRIC;
+                appendFamily(buffer,
+                             ConnectionStats::metricName(metric).c_str(),
+                             "gauge",
+                             count ? "Connections currently in this state."
+                                   : "Total for the latest interval.");
+            }
+            else {
+                auto metric = static_cast<Distribution>(
+                    d_family - FIRST_HISTOGRAM_FAMILY);
+                appendFamily(buffer,
+                             ConnectionStats::distributionName(metric).c_str(),
+                             "histogram",
+                             "Microseconds from data being read to it being "
+                             "written, in the latest interval.");
+            }
+
+            d_axis          = OVERALL;
+            d_familyStarted = true;
+        }
+
+        const ConnectionStats *stats = nextSeries();
+        if (!stats) {
+            ++d_family;
+            d_familyStarted = false;
+        }
+        else if (d_family < FIRST_HISTOGRAM_FAMILY) {
+            auto metric = static_cast<ConnectionStats::Metric>(d_family);
+            appendSample(buffer,
+                         ConnectionStats::metricName(metric),
+                         "",
+                         d_labels,
+                         stats->statsValue(metric));
+        }
+        else {
+            auto metric =
+                static_cast<Distribution>(d_family - FIRST_HISTOGRAM_FAMILY);
+            appendLatencyHistogram(buffer,
+                                   ConnectionStats::distributionName(metric),
+                                   d_labels,
+                                   *stats,
+                                   metric);
+        }
+    }
+
+    if (d_family == OTHER_FAMILIES && buffer->size() < size) {
+        renderOtherFamilies(buffer);
+        buffer->append("# EOF\n");
+        ++d_family;
+    }
+
+    return finished();
+}
+
+const ConnectionStats *OpenMetricsRenderer::nextSeries()
+{
+    if (d_axis == OVERALL) {
+        d_labels.clear();
+        appendLabel(&d_labels, "rmqEndpointType", "overall");
+        d_axis = VHOSTS;
+        d_it   = d_snapshot->vhosts().begin();
+        return &d_snapshot->overall();
+    }
+
+    while (d_axis < NUM_AXES) {
+        const StatSnapshot::StatsMap &map =
+            d_axis == VHOSTS     ? d_snapshot->vhosts()
+            : d_axis == BACKENDS ? d_snapshot->backends()
+                                 : d_snapshot->sources();
+
+        if (d_it != map.end()) {
+            d_labels.clear();
+            if (d_axis == VHOSTS) {
+                appendLabel(&d_labels, "rmqEndpointType", "vhost");
+                appendLabel(&d_labels, "rmqVhostName", d_it->first);
+            }
+            else {
+                appendLabel(&d_labels,
+                            "rmqEndpointType",
+                            d_axis == BACKENDS ? "backends" : "sources");
+                appendLabel(&d_labels, "rmqEndpointHostname", d_it->first);
+            }
+            return &(d_it++)->second;
+        }
+
+        ++d_axis;
+        d_it = d_axis == BACKENDS  ? d_snapshot->backends().begin()
+               : d_axis == SOURCES ? d_snapshot->sources().begin()
+                                   : d_it;
+    }
+
+    return nullptr;
+}
+
+void OpenMetricsRenderer::renderOtherFamilies(std::string *buffer) const
+{
+    const std::string noLabels;
+    std::string       labels;
+
+    const auto &process = d_snapshot->process();
+    appendFamily(buffer, "cpu_percent_overall", "gauge", "CPU usage.");
+    appendSample(
+        buffer, "cpu_percent_overall", "", noLabels, process.d_overall);
+    appendFamily(buffer, "cpu_percent_user", "gauge", "User CPU usage.");
+    appendSample(buffer, "cpu_percent_user", "", noLabels, process.d_user);
+    appendFamily(buffer, "cpu_percent_system", "gauge", "System CPU usage.");
+    appendSample(buffer, "cpu_percent_system", "", noLabels, process.d_system);
+    appendFamily(buffer, "mem_rss_kb", "gauge", "Resident set size in KB.");
+    appendSample(buffer, "mem_rss_kb", "", noLabels, process.d_rssKB);
+
+    // The buffers in use are a histogram of their sizes
+    std::vector<StatSnapshot::PoolStats> pools = d_snapshot->pool();
+    std::sort(pools.begin(),
+              pools.end(),
+              [](const StatSnapshot::PoolStats &lhs,
+                 const StatSnapshot::PoolStats &rhs) {
+                  return lhs.d_bufferSize < rhs.d_bufferSize;
+              });
+
+    appendFamily(buffer,
+                 "pools",
+                 "gaugehistogram",
+                 "Buffers currently allocated from the pools, by size.");
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    for (const auto &pool : pools) {
+        count += pool.d_currentAllocation;
+        bytes += pool.d_currentAllocation * pool.d_bufferSize;
+        labels.clear();
+        appendLabel(&labels, "le", std::to_string(pool.d_bufferSize));
+        appendSample(buffer, "pools", "_bucket", labels, count);
+    }
+    labels.clear();
+    appendLabel(&labels, "le", "+Inf");
+    appendSample(buffer, "pools", "_bucket", labels, count);
+    appendSample(buffer, "pools", "_gcount", noLabels, count);
+    appendSample(buffer, "pools", "_gsum", noLabels, bytes);
+
+    struct PoolGauge {
+        const char *d_name;
+        const char *d_help;
+        uint64_t StatSnapshot::PoolStats::*d_value;
+    };
+    const PoolGauge poolGauges[] = {
+        {"pools_highest",
+         "Most buffers allocated from the pool at once.",
+         &StatSnapshot::PoolStats::d_highwaterMark},
+        {"pools_slabs",
+         "Slabs backing the pool.",
+         &StatSnapshot::PoolStats::d_slabs},
+        {"pools_slab_bytes_released",
+         "Bytes of idle slabs returned to the OS.",
+         &StatSnapshot::PoolStats::d_slabBytesReleased}};
+
+    for (const auto &gauge : poolGauges) {
+        appendFamily(buffer, gauge.d_name, "gauge", gauge.d_help);
+        for (const auto &pool : pools) {
+            labels.clear();
+            appendLabel(
+                &labels, "bufferSize", std::to_string(pool.d_bufferSize));
+            appendSample(
+                buffer, gauge.d_name, "", labels, pool.*gauge.d_value);
+        }
+    }
+
+    appendFamily(buffer,
+                 "spill_to_heap_count",
+                 "gauge",
+                 "Buffers allocated from the heap in the latest interval.");
+    appendSample(buffer,
+                 "spill_to_heap_count",
+                 "",
+                 noLabels,
+                 d_snapshot->poolSpillover());
+
+    appendFamily(buffer,
+                 "accepts",
+                 "gauge",
+                 "Connections accepted in the latest interval.");
+    for (const auto &listener : d_snapshot->listeners()) {
+        labels.clear();
+        appendLabel(&labels, "listenPort", std::to_string(listener.d_port));
+        appendLabel(&labels, "listenShard", std::to_string(listener.d_shard));
+        appendSample(buffer, "accepts", "", labels, listener.d_accepts);
+    }
+
+    const auto &memory = d_snapshot->memory();
+    if (memory.d_highWatermark != 0) {
+        appendFamily(buffer,
+                     "buffer_memory_bytes",
+                     "gauge",
+                     "Bytes of buffer memory in use.");
+        appendSample(
+            buffer, "buffer_memory_bytes", "", noLabels, memory.d_bytesInUse);
+        appendFamily(buffer,
+                     "buffer_memory_paused_sessions",
+                     "gauge",
+                     "Sessions paused from reading for lack of memory.");
+        appendSample(buffer,
+                     "buffer_memory_paused_sessions",
+                     "",
+                     noLabels,
+                     memory.d_pausedSessions);
+        appendFamily(buffer,
+                     "buffer_memory_pauses",
+                     "gauge",
+                     "Sessions paused in the latest interval.");
+        appendSample(
+            buffer, "buffer_memory_pauses", "", noLabels, memory.d_pauses);
+        appendFamily(buffer,
+                     "buffer_memory_resumes",
+                     "gauge",
+                     "Sessions resumed in the latest interval.");
+        appendSample(
+            buffer, "buffer_memory_resumes", "", noLabels, memory.d_resumes);
+    }
+
+    const auto &backendHealth = d_snapshot->backendHealth();
+    if (!backendHealth.empty()) {
+        appendFamily(buffer,
+                     "backend_healthy",
+                     "gauge",
+                     "Whether the backend is passing its health checks.");
+        for (const auto &health : backendHealth) {
+            labels.clear();
+            appendLabel(&labels, "backend", health.d_backend);
+            appendSample(
+                buffer, "backend_healthy", "", labels, health.d_healthy);
+        }
+        appendFamily(buffer,
+                     "backend_consecutive_failed_checks",
+                     "gauge",
+                     "Health checks failed in a row by the backend.");
+        for (const auto &health : backendHealth) {
+            labels.clear();
+            appendLabel(&labels, "backend", health.d_backend);
+            appendSample(buffer,
+                         "backend_consecutive_failed_checks",
+                         "",
+                         labels,
+                         health.d_consecutiveFailures);
+        }
+        appendFamily(buffer,
+                     "backend_ejected",
+                     "gauge",
+                     "Whether outlier detection has ejected the backend.");
+        for (const auto &health : backendHealth) {
+            labels.clear();
+            appendLabel(&labels, "backend", health.d_backend);
+            appendSample(
+                buffer, "backend_ejected", "", labels, health.d_ejected);
+        }
+    }
+}
+
+bool OpenMetricsRenderer::finished() const
+{
+    return d_family > OTHER_FAMILIES;
+}
+
+}
+}
@@ -0,0 +1,98 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_OPENMETRICSRENDERER
+#define BLOOMBERG_AMQPPROX_OPENMETRICSRENDERER
+
+#include <amqpprox_statsnapshot.h>
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Renders a `StatSnapshot` in the OpenMetrics text format a piece at a
+ * time
+ *
+ * The metrics are named as they are published to StatsD, prefixed with
+ * `amqpprox_`. Connection statistics are labelled with the type of endpoint
+ * (overall, vhost, backend or source) and its name, and are gauges since
+ * apart from the connection counts they are totals for the latest collection
+ * interval. The latency distributions are histograms in microseconds, and
+ * the buffers allocated from each pool are a gauge histogram by buffer size.
+ *
+ * Each call to `render` appends whole lines until the buffer reaches the
+ * requested size, so a large snapshot can be sent in chunks without
+ * rendering all of it at once.
+ *
+ * \note Thread Safety - Calls must occur serially.
+ */
+class OpenMetricsRenderer {
+  public:
+    // CONSTANTS
+    static const char *const CONTENT_TYPE;
+
+  private:
+    std::shared_ptr<const StatSnapshot>    d_snapshot;
+    std::size_t                            d_family;
+    bool                                   d_familyStarted;
+    std::size_t                            d_axis;
+    StatSnapshot::StatsMap::const_iterator d_it;
+    std::string                            d_labels;
+
+    /**
+     * \brief Find the next endpoint of the connection statistics families
+     * \return the stats of the endpoint, with `d_labels` set for it, or null
+     * once all endpoints have been rendered
+     */
+    const ConnectionStats *nextSeries();
+
+    /**
+     * \brief Append the families of the snapshot which aren't connection
+     * statistics, which are small enough to render in one go
+     */
+    void renderOtherFamilies(std::string *buffer) const;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct a renderer of the `snapshot`, starting from the
+     * beginning
+     */
+    explicit OpenMetricsRenderer(
+        std::shared_ptr<const StatSnapshot> snapshot);
+
+    // MANIPULATORS
+    /**
+     * \brief Append the next part of the snapshot to the `buffer`, stopping
+     * once it holds at least `size` bytes or everything has been rendered
+     * \return whether everything has been rendered
+     */
+    bool render(std::string *buffer, std::size_t size);
+
+    // ACCESSORS
+    /**
+     * \return whether everything has been rendered
+     */
+    bool finished() const;
+};
+
+}
+}
+
+#endif
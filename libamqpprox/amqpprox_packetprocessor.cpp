@@ -72,8 +72,22 @@ void PacketProcessor::process(FlowType direction, const Buffer &readBuffer)
         return;
     }
 
+    std::size_t frameCount = 0;
+
+    // Once open the frames are only counted, so the complete ones needn't be
+    // decoded. Any incomplete or malformed frame is left to `Frame::decode`.
+    // Count-only sessions pass everything through unparsed, so never hold
+    // back a partial frame.
+    if (d_connector.state() == Connector::State::OPEN) {
+        std::size_t passed =
+            d_state.getCountOnly()
+                ? remaining
+                : Frame::scan(&frameCount, nextFrame, remaining);
+        nextFrame = static_cast<const char *>(nextFrame) + passed;
+        remaining -= passed;
+    }
+
     Frame frame;
-    int   frameCount = 0;
     while (remaining >= Frame::frameOverhead()) {
         const void *currFrame = nextFrame;
         bool        decodable = Frame::decode(
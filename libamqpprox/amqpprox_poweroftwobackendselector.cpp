@@ -0,0 +1,63 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_poweroftwobackendselector.h>
+
+#include <amqpprox_backend.h>
+
+#include <chrono>
+#include <random>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+const std::string SELECTOR_NAME("power-of-two");
+
+}
+
+std::size_t
+PowerOfTwoBackendSelector::choose(const BackendSet::Partition &partition,
+                                  uint64_t) const
+{
+    std::size_t size = partition.size();
+    if (size == 1) {
+        return 0;
+    }
+
+    // Selection happens on the I/O threads, so each has its own generator
+    thread_local std::minstd_rand generator(std::random_device{}());
+
+    std::size_t first = std::uniform_int_distribution<std::size_t>(
+        0, size - 1)(generator);
+    std::size_t second = std::uniform_int_distribution<std::size_t>(
+        0, size - 2)(generator);
+    if (second >= first) {
+        ++second;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    return lessLoaded(*partition[second], *partition[first], now) ? second
+                                                                  : first;
+}
+
+const std::string &PowerOfTwoBackendSelector::selectorName() const
+{
+    return SELECTOR_NAME;
+}
+
+}
+}
@@ -0,0 +1,61 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_readsizeestimator.h>
+
+#include <algorithm>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+// Each read moves the average a quarter of the way to its size
+const std::size_t WEIGHT_SHIFT = 2;
+
+}
+
+ReadSizeEstimator::ReadSizeEstimator(std::size_t floor, std::size_t ceiling)
+: d_floor(floor)
+, d_ceiling(std::max(floor, ceiling))
+, d_average(floor)
+{
+}
+
+void ReadSizeEstimator::recordRead(std::size_t bytesRead,
+                                   std::size_t bufferSize)
+{
+    std::size_t sample = bytesRead >= bufferSize ? bytesRead * 2 : bytesRead;
+    sample             = std::min(sample, d_ceiling);
+
+    if (sample >= d_average) {
+        d_average += (sample - d_average) >> WEIGHT_SHIFT;
+    }
+    else {
+        d_average -= (d_average - sample) >> WEIGHT_SHIFT;
+    }
+}
+
+std::size_t ReadSizeEstimator::readSize() const
+{
+    std::size_t size = d_floor;
+    while (size < d_average && size < d_ceiling) {
+        size *= 2;
+    }
+    return std::min(size, d_ceiling);
+}
+
+}
+}
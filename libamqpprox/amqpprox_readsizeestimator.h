@@ -0,0 +1,83 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_READSIZEESTIMATOR
+#define BLOOMBERG_AMQPPROX_READSIZEESTIMATOR
+
+#include <cstddef>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Estimates how large the next read from a socket should be
+ *
+ * Keeps an exponentially weighted moving average of recent read sizes. A read
+ * that fills its whole buffer probably left data behind, so it counts as
+ * twice its size, which lets the estimate grow quickly under a burst and
+ * then decay back as reads come up short. The read size is the estimate
+ * rounded up to a power of two, matching the size classes of the
+ * `BufferPool`, and kept between a floor and a ceiling.
+ *
+ * \note Thread Safety - Calls must occur serially.
+ */
+class ReadSizeEstimator {
+  public:
+    // CONSTANTS
+    static constexpr std::size_t DEFAULT_FLOOR   = 4096;
+    static constexpr std::size_t DEFAULT_CEILING = 65536;
+
+  private:
+    std::size_t d_floor;
+    std::size_t d_ceiling;
+    std::size_t d_average;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct an estimator whose read sizes are at least `floor` and
+     * at most `ceiling` bytes, starting from `floor`
+     */
+    explicit ReadSizeEstimator(std::size_t floor   = DEFAULT_FLOOR,
+                               std::size_t ceiling = DEFAULT_CEILING);
+
+    // MANIPULATORS
+    /**
+     * \brief Record a read of `bytesRead` bytes into a buffer of `bufferSize`
+     * bytes
+     */
+    void recordRead(std::size_t bytesRead, std::size_t bufferSize);
+
+    // ACCESSORS
+    /**
+     * \return the size of buffer the next read should use
+     */
+    std::size_t readSize() const;
+
+    /**
+     * \return the moving average of recent read sizes
+     */
+    std::size_t average() const;
+};
+
+inline std::size_t ReadSizeEstimator::average() const
+{
+    return d_average;
+}
+
+}
+}
+
+#endif
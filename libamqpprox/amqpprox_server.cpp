@@ -22,14 +22,17 @@
 #include <amqpprox_hostnamemapper.h>
 #include <amqpprox_logging.h>
 #include <amqpprox_maybesecuresocketadaptor.h>
+#include <amqpprox_memorybudget.h>
 #include <amqpprox_session.h>
 #include <amqpprox_tlsutil.h>
 
 #include <boost/asio/ssl/context.hpp>
 #include <openssl/opensslv.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -59,6 +62,16 @@ void initTLS(boost::asio::ssl::context &context)
     TlsUtil::setupTlsLogging(context);
 }
 
+Server::Listener::Listener(boost::asio::io_context &ioContext,
+                           std::size_t              shard,
+                           bool                     pinnedToWorker)
+: d_acceptor(ioContext)
+, d_shard(shard)
+, d_pinnedToWorker(pinnedToWorker)
+, d_accepts(0)
+{
+}
+
 Server::Server(ConnectionSelectorInterface *selector,
                EventSource                 *eventSource,
                BufferPool                  *bufferPool,
@@ -67,9 +80,20 @@ Server::Server(ConnectionSelectorInterface *selector,
 , d_ingressTlsContext(boost::asio::ssl::context::tlsv12)
 , d_egressTlsContext(boost::asio::ssl::context::tlsv12)
 , d_timer(d_ioContext, boost::posix_time::time_duration(0, 0, 10, 0))
+, d_workers()
+, d_nextWorker(0)
+, d_memoryBudget()
 , d_sessions()
+, d_changedSessions()
 , d_deletingSessions()
 , d_listeningSockets()
+, d_reusePort(false)
+, d_inFlightWriteLimit(0)
+, d_writeCoalesceDelay(0)
+, d_splicePassthrough(false)
+, d_countOnlyPassthrough(false)
+, d_speculativeReads(false)
+, d_affinityClientProperty()
 , d_dnsResolver(d_ioContext)
 , d_connectionSelector_p(selector)
 , d_eventSource_p(eventSource)
@@ -83,6 +107,11 @@ Server::Server(ConnectionSelectorInterface *selector,
     d_dnsResolver.setCacheTimeout(1000);
     d_dnsResolver.startCleanupTimer();
 
+    Worker primary;
+    primary.d_ioContext_p   = &d_ioContext;
+    primary.d_dnsResolver_p = &d_dnsResolver;
+    d_workers.push_back(std::move(primary));
+
     initTLS(d_ingressTlsContext);
     initTLS(d_egressTlsContext);
 
@@ -94,14 +123,53 @@ Server::~Server()
     d_dnsResolver.stopCleanupTimer();
     closeListeners();
 
-    // Ensure the io_context is stopped fully
-    if (!d_ioContext.stopped()) {
-        d_ioContext.stop();
+    // Ensure the io_contexts are stopped fully
+    for (auto &worker : d_workers) {
+        if (worker.d_ownedDnsResolver) {
+            worker.d_ownedDnsResolver->stopCleanupTimer();
+        }
+
+        if (!worker.d_ioContext_p->stopped()) {
+            worker.d_ioContext_p->stop();
+        }
     }
 }
 
+void Server::addWorker()
+{
+    Worker worker;
+    worker.d_ownedIoContext   = std::make_unique<boost::asio::io_context>();
+    worker.d_ownedDnsResolver =
+        std::make_unique<DNSResolver>(*worker.d_ownedIoContext);
+    worker.d_ownedDnsResolver->setCacheTimeout(1000);
+    worker.d_ownedDnsResolver->startCleanupTimer();
+    worker.d_ioContext_p   = worker.d_ownedIoContext.get();
+    worker.d_dnsResolver_p = worker.d_ownedDnsResolver.get();
+
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_workers.push_back(std::move(worker));
+}
+
 int Server::run()
 {
+    std::vector<std::thread> threads;
+    for (std::size_t i = 1; i < d_workers.size(); ++i) {
+        boost::asio::io_context *ioContext = d_workers[i].d_ioContext_p;
+        threads.emplace_back([this, ioContext, i] {
+            // Workers have no timer of their own, so keep them alive while
+            // they have no sessions.
+            auto work = boost::asio::make_work_guard(*ioContext);
+            try {
+                ioContext->run();
+            }
+            catch (std::exception &e) {
+                LOG_FATAL << "Exception on worker " << i << ": " << e.what();
+                stop();
+            }
+        });
+    }
+
+    int rc = 0;
     try {
         d_ioContext.run();
     }
@@ -109,27 +177,95 @@ int Server::run()
         LOG_FATAL << "Exception: " << e.what();
         closeListeners();
 
-        return 1;
+        rc = 1;
     }
 
-    return 0;
+    stop();
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    return rc;
 }
 
 void Server::closeListeners()
 {
     for (auto &p : d_listeningSockets) {
-        p.second.close();
+        for (auto &listener : p.second) {
+            boost::system::error_code ec;
+            listener->d_acceptor.close(ec);
+        }
     }
 }
 
 void Server::stop()
 {
-    d_ioContext.stop();
+    for (auto &worker : d_workers) {
+        worker.d_ioContext_p->stop();
+    }
+}
+
+void Server::setReusePort(bool enabled)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_reusePort = enabled;
+}
+
+void Server::setInFlightWriteLimit(std::size_t bytes)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_inFlightWriteLimit = bytes;
+}
+
+void Server::setWriteCoalesceDelay(std::chrono::microseconds delay)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_writeCoalesceDelay = delay;
+}
+
+void Server::setSplicePassthrough(bool enabled)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_splicePassthrough = enabled;
+}
+
+void Server::setCountOnlyPassthrough(bool enabled)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_countOnlyPassthrough = enabled;
+}
+
+void Server::setSpeculativeReads(bool enabled)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_speculativeReads = enabled;
+}
+
+void Server::setAffinityClientProperty(const std::string &name)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_affinityClientProperty = name;
+}
+
+void Server::setMemoryBudget(std::size_t highWatermark,
+                             std::size_t lowWatermark)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    if (highWatermark == 0) {
+        d_memoryBudget.reset();
+        return;
+    }
+
+    d_memoryBudget = std::make_shared<MemoryBudget>(
+        d_ioContext, d_bufferPool_p, highWatermark, lowWatermark);
+    d_memoryBudget->startSampling();
 }
 
 void Server::startListening(int port, bool secure)
 {
     d_ioContext.dispatch([this, port, secure] {
+        std::size_t shards = 0;
+
         {
             std::lock_guard<std::mutex> lg(d_mutex);
             auto                        it = d_listeningSockets.find(port);
@@ -138,16 +274,44 @@ void Server::startListening(int port, bool secure)
                 return;
             }
 
-            boost::asio::ip::tcp::acceptor acceptor(d_ioContext);
-            tcp::endpoint                  local_endpoint(tcp::v4(), port);
-            acceptor.open(local_endpoint.protocol());
-            acceptor.set_option(boost::asio::socket_base::reuse_address(true));
-            acceptor.bind(local_endpoint);
-            acceptor.listen(boost::asio::socket_base::max_connections);
-            d_listeningSockets.emplace(port, std::move(acceptor));
+            bool reusePort = d_reusePort && d_workers.size() > 1;
+#ifndef SO_REUSEPORT
+            if (reusePort) {
+                LOG_WARN << "SO_REUSEPORT unsupported, listening on port "
+                         << port << " with a single acceptor";
+                reusePort = false;
+            }
+#endif
+
+            std::vector<ListenerPtr> listeners;
+            tcp::endpoint            local_endpoint(tcp::v4(), port);
+            shards = reusePort ? d_workers.size() : 1;
+            for (std::size_t shard = 0; shard < shards; ++shard) {
+                auto listener = std::make_shared<Listener>(
+                    *d_workers[shard].d_ioContext_p, shard, reusePort);
+
+                auto &acceptor = listener->d_acceptor;
+                acceptor.open(local_endpoint.protocol());
+                acceptor.set_option(
+                    boost::asio::socket_base::reuse_address(true));
+#ifdef SO_REUSEPORT
+                if (reusePort) {
+                    using ReusePortOption = boost::asio::detail::socket_option::
+                        boolean<SOL_SOCKET, SO_REUSEPORT>;
+                    acceptor.set_option(ReusePortOption(true));
+                }
+#endif
+                acceptor.bind(local_endpoint);
+                acceptor.listen(boost::asio::socket_base::max_connections);
+                listeners.push_back(std::move(listener));
+            }
+
+            d_listeningSockets.emplace(port, std::move(listeners));
         }
 
-        doAccept(port, secure);
+        for (std::size_t shard = 0; shard < shards; ++shard) {
+            doAccept(port, shard, secure);
+        }
     });
 }
 
@@ -157,13 +321,15 @@ void Server::stopListening(int port)
         std::lock_guard<std::mutex> lg(d_mutex);
         auto                        it = d_listeningSockets.find(port);
         if (it != d_listeningSockets.end()) {
-            boost::system::error_code ec;
-            it->second.close(ec);
-            d_listeningSockets.erase(it);
-            if (ec) {
-                LOG_WARN << "Closing listening socket failed: "
-                         << ec.message();
+            for (auto &listener : it->second) {
+                boost::system::error_code ec;
+                listener->d_acceptor.close(ec);
+                if (ec) {
+                    LOG_WARN << "Closing listening socket failed: "
+                             << ec.message();
+                }
             }
+            d_listeningSockets.erase(it);
         }
     });
 }
@@ -191,48 +357,87 @@ void Server::doTimer()
     // listening.
 }
 
-void Server::doAccept(int port, bool secure)
+const Server::Worker &Server::nextWorker()
+{
+    // Called with d_mutex held
+    return d_workers[d_nextWorker++ % d_workers.size()];
+}
+
+void Server::doAccept(int port, std::size_t shard, bool secure)
 {
     std::lock_guard<std::mutex> lg(d_mutex);
     auto                        it = d_listeningSockets.find(port);
-    if (it == d_listeningSockets.end()) {
+    if (it == d_listeningSockets.end() || shard >= it->second.size()) {
         return;
     }
 
+    std::shared_ptr<Listener> listener = it->second[shard];
+
+    // The socket is created on the worker's io_context so that all of the
+    // session's I/O is subsequently driven by that worker's thread. An
+    // acceptor of its own is only ever used by the worker it belongs to.
+    const Worker            &worker = listener->d_pinnedToWorker
+                                          ? d_workers[listener->d_shard]
+                                          : nextWorker();
+    boost::asio::io_context *ioContext   = worker.d_ioContext_p;
+    DNSResolver             *dnsResolver = worker.d_dnsResolver_p;
+
     std::shared_ptr<MaybeSecureSocketAdaptor<>> incomingSocket =
         std::make_shared<MaybeSecureSocketAdaptor<>>(
-            d_ioContext, d_ingressTlsContext, secure);
+            *ioContext, d_ingressTlsContext, secure);
 
-    it->second.async_accept(
+    listener->d_acceptor.async_accept(
         incomingSocket->socket(),
-        [this, port, secure, incomingSocket](error_code ec) {
+        [this,
+         listener,
+         port,
+         shard,
+         secure,
+         incomingSocket,
+         ioContext,
+         dnsResolver](error_code ec) {
             if (!ec) {
                 std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
                     std::make_shared<MaybeSecureSocketAdaptor<>>(
-                        d_ioContext, d_egressTlsContext, false);
-
-                auto session =
-                    std::make_shared<Session>(d_ioContext,
-                                              incomingSocket,
-                                              clientSocket,
-                                              d_connectionSelector_p,
-                                              d_eventSource_p,
-                                              d_bufferPool_p,
-                                              &d_dnsResolver,
-                                              d_hostnameMapper,
-                                              d_localHostname,
-                                              d_authIntercept,
-                                              secure,
-                                              d_limitManager);
+                        *ioContext, d_egressTlsContext, false);
 
+                ++listener->d_accepts;
+
+                std::shared_ptr<Session> session;
                 {
                     std::lock_guard<std::mutex> lg(d_mutex);
+                    session =
+                        std::make_shared<Session>(*ioContext,
+                                                  incomingSocket,
+                                                  clientSocket,
+                                                  d_connectionSelector_p,
+                                                  d_eventSource_p,
+                                                  d_bufferPool_p,
+                                                  dnsResolver,
+                                                  d_hostnameMapper,
+                                                  d_localHostname,
+                                                  d_authIntercept,
+                                                  secure,
+                                                  d_limitManager);
+                    session->setInFlightWriteLimit(d_inFlightWriteLimit);
+                    session->setWriteCoalesceDelay(d_writeCoalesceDelay);
+                    session->setSplicePassthrough(d_splicePassthrough);
+                    session->setSpeculativeReads(d_speculativeReads);
+                    session->setAffinityClientProperty(
+                        d_affinityClientProperty);
+                    session->state().setCountOnly(d_countOnlyPassthrough);
+                    session->setMemoryBudget(d_memoryBudget);
+                    // Under the lock, so it can't be looked up before it's
+                    // added
+                    session->state().setChangedSessions(&d_changedSessions);
                     d_sessions[session->state().id()] = session;
                 }
 
-                session->start();
-                d_eventSource_p->connectionReceived().emit(
-                    session->state().id());
+                boost::asio::dispatch(*ioContext, [this, session] {
+                    session->start();
+                    d_eventSource_p->connectionReceived().emit(
+                        session->state().id());
+                });
             }
             else {
                 LOG_ERROR << "Accept failed, reason: " << ec.message();
@@ -240,7 +445,7 @@ void Server::doAccept(int port, bool secure)
                 // accept again.
             }
 
-            doAccept(port, secure);
+            doAccept(port, shard, secure);
         });
 }
 
@@ -322,6 +527,31 @@ void Server::visitSessions(
     }
 }
 
+void Server::visitChangedSessions(
+    const std::function<void(const SessionPtr &)> &visitor)
+{
+    std::vector<uint64_t> ids;
+    d_changedSessions.take(&ids);
+
+    std::vector<SessionPtr> sessions;
+    sessions.reserve(ids.size());
+
+    {
+        std::lock_guard<std::mutex> lg(d_mutex);
+        for (uint64_t id : ids) {
+            auto it = d_sessions.find(id);
+            if (it != d_sessions.end()) {
+                sessions.push_back(it->second);
+            }
+        }
+    }
+
+    for (const auto &session : sessions) {
+        session->state().clearChanged();
+        visitor(session);
+    }
+}
+
 boost::asio::ssl::context &Server::ingressTlsContext()
 {
     return d_ingressTlsContext;
@@ -347,5 +577,34 @@ DNSResolver *Server::getDNSResolverPtr()
     return &d_dnsResolver;
 }
 
+std::size_t Server::workerCount() const
+{
+    return d_workers.size();
+}
+
+std::shared_ptr<MemoryBudget> Server::memoryBudget()
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    return d_memoryBudget;
+}
+
+void Server::getListenerStatistics(std::vector<ListenerStatistic> *stats)
+{
+    std::vector<ListenerStatistic> result;
+
+    {
+        std::lock_guard<std::mutex> lg(d_mutex);
+        for (const auto &p : d_listeningSockets) {
+            for (const auto &listener : p.second) {
+                result.emplace_back(
+                    p.first, listener->d_shard, listener->d_accepts.load());
+            }
+        }
+    }
+
+    std::sort(result.begin(), result.end());
+    stats->insert(stats->end(), result.begin(), result.end());
+}
+
 }  // namespace amqpprox
 }  // namespace Bloomberg
@@ -17,17 +17,23 @@
 #define BLOOMBERG_AMQPPROX_SERVER
 
 #include <amqpprox_authinterceptinterface.h>
+#include <amqpprox_changedsessions.h>
 #include <amqpprox_connectionselectorinterface.h>
 #include <amqpprox_dnsresolver.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/ssl/context.hpp>
 
+#include <atomic>
+#include <chrono>
 #include <iosfwd>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <tuple>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -36,24 +42,75 @@ class BufferPool;
 class Session;
 class EventSource;
 class HostnameMapper;
+class MemoryBudget;
 class DataRateLimitManager;
 
 /**
  * \brief Sockets are accept()'ed in this component. For each incoming
  * connection, it creates a Session object, and stores it in a threadsafe
  * collection. It is the primary thread, where event loop runs.
+ *
+ * Sessions are distributed over a number of workers. The first worker is the
+ * primary event loop, and further workers can be added with `addWorker`, each
+ * of which owns its own io_context and is run on a dedicated thread. A session
+ * is pinned to the worker it was accepted onto for its whole lifetime, so the
+ * `Session` is only ever touched from that worker's thread. The threadsafe
+ * `BufferPool` is shared by all workers.
  */
 class Server {
     using SessionPtr = std::shared_ptr<Session>;
 
+    /**
+     * \brief An event loop onto which sessions are placed. The primary worker
+     * refers to the server's own io_context and DNS resolver, additional
+     * workers own theirs.
+     */
+    struct Worker {
+        std::unique_ptr<boost::asio::io_context> d_ownedIoContext;
+        std::unique_ptr<DNSResolver>             d_ownedDnsResolver;
+        boost::asio::io_context                 *d_ioContext_p;
+        DNSResolver                             *d_dnsResolver_p;
+    };
+
+    /**
+     * \brief An acceptor for a listening port. When the server is listening
+     * with one acceptor per worker, the acceptor's io_context is that of the
+     * worker and all sessions it accepts are placed on that worker, otherwise
+     * the acceptor runs on the primary event loop and sessions are spread over
+     * all workers.
+     */
+    struct Listener {
+        boost::asio::ip::tcp::acceptor d_acceptor;
+        std::size_t                    d_shard;
+        bool                           d_pinnedToWorker;
+        std::atomic<uint64_t>          d_accepts;
+
+        Listener(boost::asio::io_context &ioContext,
+                 std::size_t              shard,
+                 bool                     pinnedToWorker);
+    };
+
+    using ListenerPtr = std::shared_ptr<Listener>;
+
     boost::asio::io_context                  d_ioContext;
     boost::asio::ssl::context                d_ingressTlsContext;
     boost::asio::ssl::context                d_egressTlsContext;
     boost::asio::deadline_timer              d_timer;
+    std::vector<Worker>                      d_workers;
+    std::size_t                              d_nextWorker;
+    std::shared_ptr<MemoryBudget>            d_memoryBudget;
     std::unordered_map<uint64_t, SessionPtr> d_sessions;
+    ChangedSessions                          d_changedSessions;
     std::unordered_set<SessionPtr>           d_deletingSessions;
-    std::unordered_map<int, boost::asio::ip::tcp::acceptor> d_listeningSockets;
-    DNSResolver                                             d_dnsResolver;
+    std::unordered_map<int, std::vector<ListenerPtr>> d_listeningSockets;
+    bool                                              d_reusePort;
+    std::size_t                                       d_inFlightWriteLimit;
+    std::chrono::microseconds                         d_writeCoalesceDelay;
+    bool                                              d_splicePassthrough;
+    bool                                              d_countOnlyPassthrough;
+    bool                                              d_speculativeReads;
+    std::string                                       d_affinityClientProperty;
+    DNSResolver                                       d_dnsResolver;
     ConnectionSelectorInterface    *d_connectionSelector_p;  // HELD NOT OWNED
     EventSource                    *d_eventSource_p;         // HELD NOT OWNED
     BufferPool                     *d_bufferPool_p;          // HELD NOT OWNED
@@ -64,6 +121,14 @@ class Server {
     DataRateLimitManager                   *d_limitManager;  // HELD NOT OWNED
 
   public:
+    // TYPES
+    /**
+     * \brief Listening port, shard index within that port and total number of
+     * connections accepted by that shard
+     */
+    using ListenerStatistic = std::tuple<int, std::size_t, uint64_t>;
+
+    // CREATORS
     Server(ConnectionSelectorInterface *selector,
            EventSource                 *eventSource,
            BufferPool                  *bufferPool,
@@ -73,15 +138,84 @@ class Server {
 
     // MANIPULATORS
     /**
-     * \brief Run the server event loop
+     * \brief Add a worker with its own io_context, run on its own thread, for
+     * new sessions to be placed onto. This must be called before `run`.
+     */
+    void addWorker();
+
+    /**
+     * \brief Run the server event loop, and the event loops of any additional
+     * workers on their own threads. Blocks until all of them have stopped.
      */
     int run();
 
     /**
-     * \brief Stop the server event loop
+     * \brief Stop the server event loop and those of all workers
      */
     void stop();
 
+    /**
+     * \brief Set whether ports subsequently listened on have one
+     * `SO_REUSEPORT` acceptor per worker, letting the kernel balance incoming
+     * connections over the workers, rather than a single acceptor on the
+     * primary event loop.
+     * \param enabled true to open an acceptor per worker
+     */
+    void setReusePort(bool enabled);
+
+    /**
+     * \brief Set the in-flight write limit applied to sessions accepted
+     * from now on, see `Session::setInFlightWriteLimit`
+     * \param bytes the in-flight byte limit for each direction of a session
+     */
+    void setInFlightWriteLimit(std::size_t bytes);
+
+    /**
+     * \brief Set how long sessions accepted from now on may hold back small
+     * writes, see `Session::setWriteCoalesceDelay`
+     * \param delay the longest time to hold back a small write
+     */
+    void setWriteCoalesceDelay(std::chrono::microseconds delay);
+
+    /**
+     * \brief Set whether sessions accepted from now on splice passthrough
+     * data, see `Session::setSplicePassthrough`
+     * \param enabled true to splice passthrough data on plaintext sessions
+     */
+    void setSplicePassthrough(bool enabled);
+
+    /**
+     * \brief Set whether sessions accepted from now on pass data through
+     * without parsing frames once open, see `SessionState::setCountOnly`
+     * \param enabled true to count passthrough bytes only
+     */
+    void setCountOnlyPassthrough(bool enabled);
+
+    /**
+     * \brief Set whether sessions accepted from now on attempt reads before
+     * waiting for readiness, see `Session::setSpeculativeReads`
+     * \param enabled true to attempt reads on plaintext sockets directly
+     */
+    void setSpeculativeReads(bool enabled);
+
+    /**
+     * \brief Set the client property that sessions accepted from now on
+     * include in their affinity key, see `Session::setAffinityClientProperty`
+     * \param name the client property, or empty for the vhost alone
+     */
+    void setAffinityClientProperty(const std::string &name);
+
+    /**
+     * \brief Bound the bytes in use from the buffer pool, pausing ingress
+     * reads of the heaviest sessions while over budget, see `MemoryBudget`.
+     * Only sessions started afterwards use the new budget, those already
+     * running keep sharing the one they were started with.
+     * \param highWatermark bytes in use at which sessions start to be paused,
+     * or 0 to remove the budget
+     * \param lowWatermark bytes in use at which paused sessions are resumed
+     */
+    void setMemoryBudget(std::size_t highWatermark, std::size_t lowWatermark);
+
     /**
      * \brief Start listening on the given port, no op if the server is already
      * listening on the specified port.
@@ -147,6 +281,15 @@ class Server {
      */
     void visitSessions(const std::function<void(const SessionPtr &)> &visitor);
 
+    /**
+     * \brief Visit the sessions whose statistics changed since they were
+     * last visited by this method, see `ChangedSessions`
+     * \param visitor callback function to be invoked with session shared
+     * pointer as an argument for each changed session
+     */
+    void visitChangedSessions(
+        const std::function<void(const SessionPtr &)> &visitor);
+
     /**
      * \brief Print all the connections information for all the sessions
      * \param os output stream object
@@ -178,8 +321,27 @@ class Server {
      */
     DNSResolver *getDNSResolverPtr();
 
+    /**
+     * \return the number of workers sessions are distributed over
+     */
+    std::size_t workerCount() const;
+
+    /**
+     * \return the budget bounding buffer memory, or `nullptr` if there is
+     * none
+     */
+    std::shared_ptr<MemoryBudget> memoryBudget();
+
+    /**
+     * \brief Retrieve the number of connections accepted by each acceptor,
+     * ordered by port and shard
+     * \param stats pointer to the vector the statistics are appended to
+     */
+    void getListenerStatistics(std::vector<ListenerStatistic> *stats);
+
   private:
-    void doAccept(int port, bool secure);
+    const Worker &nextWorker();
+    void          doAccept(int port, std::size_t shard, bool secure);
     void doTimer();
     void timer();
     void closeListeners();
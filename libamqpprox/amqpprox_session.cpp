@@ -31,6 +31,7 @@
 #include <amqpprox_flowtype.h>
 #include <amqpprox_frame.h>
 #include <amqpprox_logging.h>
+#include <amqpprox_memorybudget.h>
 #include <amqpprox_method.h>
 #include <amqpprox_packetprocessor.h>
 #include <amqpprox_proxyprotocolheaderv1.h>
@@ -43,11 +44,14 @@
 #include <boost/system/error_code.hpp>
 
 #include <algorithm>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
@@ -63,6 +67,70 @@ namespace amqpprox {
 //    to get the per connection adaption based on the heavyness of the
 //    connection being proxied.
 //
+// Passthrough pipelining:
+//
+// During the handshake each direction reads, then writes whatever the read
+// produced, and only reads again once that write has completed. Once the
+// connection is open, and an in-flight write limit is set, the buffer being
+// written is instead handed to that direction's write queue and the next read
+// is started straight away. Writes from the queue are issued one at a time,
+// in order, and reading is suspended while the queued bytes are at or above
+// the limit, resuming as writes complete.
+//
+// Write coalescing:
+//
+// While a queued write is in progress more buffers can be queued behind it,
+// and when it completes all of them, up to a limit, are gathered into a single
+// vectored write. Synthetic data from the `Connector`, such as a Close, is
+// queued behind any passthrough data for the same socket, so that it can
+// neither overtake nor be interleaved with it. With a coalesce delay set, a
+// small write to an idle socket is held back for up to that long, so that
+// data read shortly after can join it, much like Nagle's algorithm.
+//
+// Splice passthrough:
+//
+// When enabled, once the connection is open and neither socket is encrypted,
+// each direction stops reading into buffers and instead uses `splice` to move
+// data from its read socket into a pipe and from the pipe to its write
+// socket, so the payload never enters user space. Splicing only starts on a
+// frame boundary, with nothing buffered or queued for writing, and since the
+// data is no longer parsed only byte counts are kept from then on.
+//
+// Speculative reads:
+//
+// By default each read waits for the socket to become readable, asks how much
+// is available, and then reads into a buffer of at least that size. With
+// speculative reads enabled on a plaintext socket a buffer of the estimated
+// read size is taken and the read is attempted straight away, falling back to
+// the wait (and returning the buffer) only if nothing was there. A busy
+// connection then costs a single system call per read. The result is handled
+// from a posted handler, so that a steady stream of data cannot recurse.
+//
+// Read sizing:
+//
+// Data often arrives in several TCP segments, and by the time we read more of
+// it may be there than was reported available. Each direction keeps a moving
+// average of its read sizes, see `ReadSizeEstimator`, and reads use a buffer
+// of at least that size, so a busy connection reads up to a whole 64KB buffer
+// per system call while a quiet one keeps to small buffers.
+//
+// Memory budget:
+//
+// When a memory budget is set, ingress reads check it before waiting for more
+// data. The bytes this session holds on to for ingress, its last read buffer
+// and any queued writes, decide whether it is one of the heaviest sessions
+// that should stop reading while buffer memory is scarce. Stopping ingress
+// reads stops the client publishing through us, and egress is never paused so
+// that memory drains as the broker's replies and deliveries flow.
+//
+// Latency:
+//
+// Each direction notes the monotonic time of the first read not yet written
+// out. A queued write carries that time with it, and when a write completes
+// the time since is recorded with the `SessionState`, which keeps a histogram
+// of them. This is how long data dwells in the proxy, from the read that
+// first saw it to the write that completed it.
+//
 // Ingress/Egress direction:
 //
 // Ingress in this component means that data has originated at the client and
@@ -74,6 +142,10 @@ using namespace boost::system;
 
 namespace {
 
+const std::size_t SPLICE_CHUNK_SIZE  = 65536;
+const std::size_t MAX_GATHER_BUFFERS = 64;
+const std::size_t SMALL_WRITE_SIZE   = 4096;
+
 class ConnectionSummary {
     const SessionState &s;
 
@@ -150,6 +222,25 @@ Session::Session(boost::asio::io_context                         &ioContext,
 , d_connectionRateLimitedTimer(ioContext)
 , d_authIntercept(authIntercept)
 , d_limitManager(limitManager)
+, d_ingressWriteQueue()
+, d_egressWriteQueue()
+, d_inFlightWriteLimit(0)
+, d_writeCoalesceDelay(0)
+, d_ingressCoalesceTimer(ioContext)
+, d_egressCoalesceTimer(ioContext)
+, d_splicePassthrough(false)
+, d_speculativeReads(false)
+, d_ingressPipe()
+, d_egressPipe()
+, d_memoryBudget()
+, d_ingressReadBufferSize(0)
+, d_ingressReadSize()
+, d_egressReadSize()
+, d_backendCounters()
+, d_backendPhaseStartedAt()
+, d_backendOutcomeCounted(false)
+, d_backendSucceeded(false)
+, d_affinityClientProperty()
 {
     boost::system::error_code ec;
     d_serverSocket->setDefaultOptions(ec);
@@ -170,6 +261,10 @@ Session::Session(boost::asio::io_context                         &ioContext,
 
 Session::~Session()
 {
+    releaseBackend();
+    if (d_memoryBudget) {
+        d_memoryBudget->removeReader();
+    }
 }
 
 bool Session::finished()
@@ -197,7 +292,8 @@ void Session::start()
     auto self(shared_from_this());
     auto handshake_cb = [this, self](const error_code &ec) {
         if (ec) {
-            handleSessionError("ssl", FlowType::INGRESS, ec);
+            handleSessionError(
+                "ssl", FlowType::INGRESS, *d_serverSocket, ec);
             return;
         }
 
@@ -208,6 +304,45 @@ void Session::start()
                                     handshake_cb);
 }
 
+void Session::setInFlightWriteLimit(std::size_t bytes)
+{
+    d_inFlightWriteLimit = bytes;
+}
+
+void Session::setWriteCoalesceDelay(std::chrono::microseconds delay)
+{
+    d_writeCoalesceDelay = delay;
+}
+
+void Session::setSplicePassthrough(bool enabled)
+{
+    d_splicePassthrough = enabled;
+}
+
+void Session::setSpeculativeReads(bool enabled)
+{
+    d_speculativeReads = enabled;
+}
+
+void Session::setAffinityClientProperty(std::string name)
+{
+    d_affinityClientProperty = std::move(name);
+}
+
+void Session::setMemoryBudget(
+    const std::shared_ptr<MemoryBudget> &memoryBudget)
+{
+    if (d_memoryBudget) {
+        d_memoryBudget->removeReader();
+    }
+
+    d_memoryBudget = memoryBudget;
+
+    if (d_memoryBudget) {
+        d_memoryBudget->addReader();
+    }
+}
+
 void Session::attemptConnection(
     const std::shared_ptr<ConnectionManager> &connectionManager)
 {
@@ -233,6 +368,8 @@ void Session::attemptConnection(
         return;
     }
 
+    holdBackend(backend);
+
     using endpointType = boost::asio::ip::tcp::endpoint;
     auto self(shared_from_this());
     auto callback = [this, self, connectionManager](
@@ -322,6 +459,9 @@ void Session::attemptEndpointConnection(
     const std::shared_ptr<ConnectionManager> &connectionManager)
 {
     auto self(shared_from_this());
+    d_backendPhaseStartedAt = std::chrono::steady_clock::now();
+    d_backendOutcomeCounted = false;
+    d_backendSucceeded      = false;
     d_clientSocket->async_connect(
         endpoint, [this, self, connectionManager](error_code ec) {
             BOOST_LOG_SCOPED_THREAD_ATTR(
@@ -338,6 +478,8 @@ void Session::attemptEndpointConnection(
                 return;
             }
 
+            recordBackendLatency(BackendCounters::Phase::CONNECT);
+
             auto local_endpoint = d_clientSocket->local_endpoint(ec);
             if (ec) {
                 handleConnectionError("local_endpoint", ec, connectionManager);
@@ -372,7 +514,10 @@ void Session::attemptEndpointConnection(
                      << "connection for: " << d_sessionState;
 
             auto self(shared_from_this());
-            auto handshake_cb = [this, self, connectionManager](
+            auto handshake_cb = [this,
+                                 self,
+                                 connectionManager,
+                                 tls{currentBackend->tlsEnabled()}](
                                     const error_code &ec) {
                 BOOST_LOG_SCOPED_THREAD_ATTR(
                     "Vhost",
@@ -384,10 +529,19 @@ void Session::attemptEndpointConnection(
                         d_sessionState.id()));
 
                 if (ec) {
-                    handleSessionError("ssl", FlowType::INGRESS, ec);
+                    handleSessionError(
+                        "ssl", FlowType::EGRESS, *d_clientSocket, ec);
                     return;
                 }
 
+                if (tls) {
+                    recordBackendLatency(
+                        BackendCounters::Phase::TLS_HANDSHAKE);
+                }
+                else {
+                    d_backendPhaseStartedAt = std::chrono::steady_clock::now();
+                }
+
                 LOG_TRACE << "Post-handshake sending protocol header for:"
                           << d_sessionState;
 
@@ -412,7 +566,10 @@ void Session::attemptEndpointConnection(
                     [this, self, hscb{std::move(handshake_cb)}](error_code ec,
                                                                 std::size_t) {
                         if (ec) {
-                            handleSessionError("write", FlowType::INGRESS, ec);
+                            handleSessionError("write",
+                                               FlowType::EGRESS,
+                                               *d_clientSocket,
+                                               ec);
                             return;
                         }
 
@@ -509,6 +666,8 @@ void Session::establishConnection()
         return;
     }
 
+    connectionManager->setAffinityKey(affinityKey());
+
     auto authResponseCb = [this, self, connectionManager](
                               const authproto::AuthResponse
                                   &authResponseData) {
@@ -555,13 +714,38 @@ void Session::establishConnection()
     saslPtr->set_authmechanism(sasl.first);
     saslPtr->set_credentials(sasl.second);
 
-    // Authenticate connecting clients
-    d_authIntercept->authenticate(authRequestData, authResponseCb);
+    // Authenticate connecting clients. The intercept may respond from
+    // another thread's event loop, so hop back onto this session's before
+    // touching any of its state.
+    d_authIntercept->authenticate(
+        authRequestData,
+        [this, self, authResponseCb](
+            const authproto::AuthResponse &authResponseData) {
+            boost::asio::dispatch(d_ioContext,
+                                  [authResponseCb, authResponseData] {
+                                      authResponseCb(authResponseData);
+                                  });
+        });
+}
+
+std::string Session::affinityKey() const
+{
+    std::string key = d_sessionState.getVirtualHost();
+    if (!d_affinityClientProperty.empty()) {
+        FieldValue value('S', std::string());
+        if (d_connector.getClientProperties().findFieldValue(
+                &value, d_affinityClientProperty) &&
+            value.type() == 'S') {
+            key += '\0';
+            key += value.value<std::string>();
+        }
+    }
+    return key;
 }
 
 void Session::print(std::ostream &os)
 {
-    TimePoint now = std::chrono::high_resolution_clock::now();
+    TimePoint now = std::chrono::steady_clock::now();
     std::chrono::duration<double> ingressTime =
         now - timePoint(FlowType::INGRESS);
     std::chrono::duration<double> egressTime =
@@ -579,7 +763,13 @@ void Session::pause()
 
 void Session::unpause()
 {
-    if (d_sessionState.getPaused()) {
+    // Control commands call this from their own thread
+    auto self(shared_from_this());
+    d_ioContext.dispatch([this, self] {
+        if (!d_sessionState.getPaused()) {
+            return;
+        }
+
         if (d_sessionState.getReadyToConnectOnUnpause()) {
             BOOST_LOG_SCOPED_THREAD_ATTR(
                 "Vhost",
@@ -596,21 +786,20 @@ void Session::unpause()
             establishConnection();
         }
         else {
-            this->disconnect(true);
+            disconnect(true);
         }
-    }
+    });
 }
 
-void Session::disconnectUnauthClient(const FieldTable &clientProperties,
-                                     std::string_view  reason)
+void Session::disconnectUnauthClient(const FieldTableView &clientProperties,
+                                     std::string_view      reason)
 {
     d_sessionState.setAuthDeniedConnection(true);
-    std::shared_ptr<FieldTable> capabilitiesTable;
-    FieldValue                  fv('F', capabilitiesTable);
-    if (clientProperties.findFieldValue(&fv, Constants::capabilities()) &&
-        fv.type() == 'F') {
-        capabilitiesTable = fv.value<std::shared_ptr<FieldTable>>();
-        if (capabilitiesTable->findFieldValue(
+    FieldTableView capabilitiesTable;
+    FieldValue     fv('t', false);
+    if (clientProperties.findFieldTable(&capabilitiesTable,
+                                        Constants::capabilities())) {
+        if (capabilitiesTable.findFieldValue(
                 &fv, Constants::authenticationFailureClose()) &&
             fv.type() == 't') {
             bool authenticationFailureClose = fv.value<bool>();
@@ -653,8 +842,19 @@ void Session::disconnect(bool forcible)
         });
     }
     else {
-        d_connector.synthesizeClose(true);
-        sendSyntheticData();
+        auto self(shared_from_this());
+        d_ioContext.dispatch([this, self] {
+            if (d_egressPipe.isOpen()) {
+                // The Close can't be interleaved safely with spliced data,
+                // which doesn't respect frame boundaries
+                LOG_INFO << "Disconnecting spliced session forcibly";
+                disconnect(true);
+                return;
+            }
+
+            d_connector.synthesizeClose(true);
+            sendSyntheticData();
+        });
     }
 }
 
@@ -691,7 +891,8 @@ void Session::handleWriteData(FlowType                    direction,
                               Buffer                      data)
 {
     auto self(shared_from_this());
-    auto writeHandler = [this, self, direction](error_code ec, std::size_t) {
+    auto writeHandler = [this, self, direction, socket{&writeSocket}](
+                            error_code ec, std::size_t) {
         BOOST_LOG_SCOPED_THREAD_ATTR(
             "Vhost",
             boost::log::attributes::constant<std::string>(
@@ -707,22 +908,11 @@ void Session::handleWriteData(FlowType                    direction,
         }
 
         if (ec) {
-            handleSessionError("write", direction, ec);
+            handleSessionError("write", direction, *socket, ec);
             return;
         }
 
-        uint64_t latency =
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                TimePoint() - startedAt(direction))
-                .count();
-
-        if (direction == FlowType::INGRESS) {
-            d_sessionState.addIngressLatency(latency);
-        }
-        else {
-            d_sessionState.addEgressLatency(latency);
-        }
-        currentlyReading(direction) = false;
+        recordWriteLatency(direction);
 
         readData(direction);
     };
@@ -734,10 +924,183 @@ void Session::handleWriteData(FlowType                    direction,
                              writeHandler);
 }
 
+void Session::queueWriteData(FlowType direction,
+                             Buffer   data,
+                             bool     hasRemaining)
+{
+    auto &queue = writeQueue(direction);
+    queue.d_writes.emplace_back();
+
+    // The written data is left in the primary buffer, unless a partial frame
+    // was copied out of it into a new primary buffer.
+    auto &write = queue.d_writes.back();
+    write.d_handle.swap(hasRemaining ? bufferWriteDataHandle(direction)
+                                     : bufferHandle(direction));
+    write.d_data = data;
+    queue.d_bytes += data.size();
+
+    // The data's latency is recorded when its write completes, anything left
+    // over is still waiting on the rest of its frame from the same read
+    if (currentlyReading(direction)) {
+        write.d_readAt = startedAt(direction);
+        if (!hasRemaining) {
+            currentlyReading(direction) = false;
+        }
+    }
+
+    if (queue.d_inFlight == 0 && d_writeCoalesceDelay.count() > 0 &&
+        queue.d_bytes < SMALL_WRITE_SIZE) {
+        if (!queue.d_coalescing) {
+            queue.d_coalescing = true;
+
+            auto self(shared_from_this());
+            auto &timer = coalesceTimer(direction);
+            timer.expires_after(d_writeCoalesceDelay);
+            timer.async_wait([this, self, direction](error_code ec) {
+                auto &queue = writeQueue(direction);
+                if (ec || !queue.d_coalescing) {
+                    return;
+                }
+
+                queue.d_coalescing = false;
+                writeQueuedData(direction);
+            });
+        }
+    }
+    else {
+        if (queue.d_coalescing) {
+            queue.d_coalescing = false;
+            coalesceTimer(direction).cancel();
+        }
+
+        writeQueuedData(direction);
+    }
+
+    if (queue.d_bytes < d_inFlightWriteLimit) {
+        readData(direction);
+    }
+    else {
+        LOG_TRACE << "Suspending read with " << queue.d_bytes
+                  << " bytes in flight " << direction;
+        queue.d_readBlocked = true;
+    }
+}
+
+void Session::writeQueuedData(FlowType direction)
+{
+    auto &queue = writeQueue(direction);
+    if (queue.d_inFlight > 0 || queue.d_coalescing || queue.d_writes.empty()) {
+        return;
+    }
+
+    std::vector<boost::asio::const_buffer> buffers;
+    std::size_t                            bytes = 0;
+    for (const auto &write : queue.d_writes) {
+        if (buffers.size() == MAX_GATHER_BUFFERS) {
+            break;
+        }
+        buffers.emplace_back(write.d_data.ptr(), write.d_data.available());
+        bytes += write.d_data.available();
+    }
+    queue.d_inFlight = buffers.size();
+
+    auto self(shared_from_this());
+    auto writeHandler = [this, self, direction](error_code ec, std::size_t) {
+        BOOST_LOG_SCOPED_THREAD_ATTR(
+            "Vhost",
+            boost::log::attributes::constant<std::string>(
+                d_sessionState.getVirtualHost()));
+        BOOST_LOG_SCOPED_THREAD_ATTR(
+            "ConnID",
+            boost::log::attributes::constant<uint64_t>(d_sessionState.id()));
+
+        if (ec) {
+            handleSessionError(
+                "write", direction, writeSocket(direction), ec);
+            return;
+        }
+
+        auto                   &queue = writeQueue(direction);
+        std::optional<FlowType> readAfter;
+        TimePoint               now = std::chrono::steady_clock::now();
+        for (; queue.d_inFlight > 0; --queue.d_inFlight) {
+            auto &write = queue.d_writes.front();
+            queue.d_bytes -= write.d_data.size();
+            if (write.d_readAfter) {
+                readAfter = write.d_readAfter;
+            }
+            if (write.d_readAt) {
+                recordLatency(direction, *write.d_readAt, now);
+            }
+            queue.d_writes.pop_front();
+        }
+
+        writeQueuedData(direction);
+
+        if (queue.d_readBlocked && queue.d_bytes < d_inFlightWriteLimit) {
+            queue.d_readBlocked = false;
+            readData(direction);
+        }
+
+        if (readAfter) {
+            readData(*readAfter);
+        }
+    };
+
+    LOG_TRACE << "Write of " << bytes << " bytes from " << buffers.size()
+              << " buffers " << direction << " (queued)";
+    boost::asio::async_write(writeSocket(direction), buffers, writeHandler);
+}
+
+void Session::queueSyntheticData(FlowType      direction,
+                                 const Buffer &data,
+                                 FlowType      readAfter)
+{
+    auto &queue = writeQueue(direction);
+    queue.d_writes.emplace_back();
+
+    // The connector's buffer is reused for its next output, so take a copy
+    auto &write = queue.d_writes.back();
+    d_bufferPool_p->acquireBuffer(&write.d_handle, data.size());
+    std::memcpy(write.d_handle.data(), data.ptr(), data.size());
+    write.d_data      = Buffer(write.d_handle.data(), data.size());
+    write.d_readAfter = readAfter;
+    queue.d_bytes += data.size();
+
+    if (queue.d_coalescing) {
+        queue.d_coalescing = false;
+        coalesceTimer(direction).cancel();
+    }
+
+    writeQueuedData(direction);
+}
+
 void Session::readData(FlowType direction)
 {
-    auto &socket         = readSocket(direction);
-    timePoint(direction) = TimePoint();
+    if (canSplice(direction)) {
+        // Spliced data must follow any writes still queued from buffers
+        auto &queue = writeQueue(direction);
+        if (queue.d_writes.empty()) {
+            spliceData(direction);
+        }
+        else {
+            queue.d_readBlocked = true;
+        }
+        return;
+    }
+
+    if (direction == FlowType::INGRESS && d_memoryBudget &&
+        d_memoryBudget->shouldPause(d_ingressReadBufferSize +
+                                      writeQueue(direction).d_bytes)) {
+        waitForMemory();
+        return;
+    }
+
+    if (d_speculativeReads && speculativeRead(direction)) {
+        return;
+    }
+
+    auto &socket = readSocket(direction);
 
     auto self(shared_from_this());
     socket.async_read_some(
@@ -753,21 +1116,21 @@ void Session::readData(FlowType direction)
                     d_sessionState.id()));
 
             auto &socket         = readSocket(direction);
-            timePoint(direction) = TimePoint();
+            timePoint(direction) = std::chrono::steady_clock::now();
             if (!currentlyReading(direction)) {
-                startedAt(direction)        = TimePoint();
+                startedAt(direction)        = timePoint(direction);
                 currentlyReading(direction) = true;
             }
 
             if (ec) {
-                handleSessionError("read", direction, ec);
+                handleSessionError("read", direction, socket, ec);
                 return;
             }
 
             std::size_t available = socket.available(ec);
 
             if (ec) {
-                handleSessionError("socket-available", direction, ec);
+                handleSessionError("socket-available", direction, socket, ec);
                 return;
             }
 
@@ -790,7 +1153,10 @@ void Session::readData(FlowType direction)
             // If there's data in the buffer we shouldn't reallocate a new
             // one for this connection
             if (0 == watermark) {
-                d_bufferPool_p->acquireBuffer(&bufh, available);
+                d_bufferPool_p->acquireBuffer(
+                    &bufh,
+                    std::max(available,
+                             readSizeEstimator(direction).readSize()));
             }
 
             Buffer      readBuf    = readBuffer(direction);
@@ -798,6 +1164,7 @@ void Session::readData(FlowType direction)
                 boost::asio::buffer(readBuf.ptr(), readBuf.available()), ec);
 
             if (!ec) {
+                recordRead(direction, readAmount, readBuf.available());
                 watermark += readAmount;
                 if (direction == FlowType::EGRESS ||
                     !d_sessionState.getPaused()) {
@@ -813,16 +1180,290 @@ void Session::readData(FlowType direction)
                                  "discarded from "
                               << direction << " to close sockets";
                 }
-                handleSessionError("read_some", direction, ec);
+                handleSessionError("read_some", direction, socket, ec);
+                return;
+            }
+        });
+}
+
+bool Session::speculativeRead(FlowType direction)
+{
+    auto &socket = readSocket(direction);
+    if (!socket.canReadSpeculatively()) {
+        return false;
+    }
+
+    auto &bufh      = bufferHandle(direction);
+    auto &watermark = waterMark(direction);
+
+    if (0 == watermark) {
+        d_bufferPool_p->acquireBuffer(&bufh,
+                                      readSizeEstimator(direction).readSize());
+    }
+
+    error_code  ec;
+    Buffer      readBuf    = readBuffer(direction);
+    std::size_t readAmount = socket.read_some(
+        boost::asio::buffer(readBuf.ptr(), readBuf.available()), ec);
+
+    if (ec == boost::asio::error::would_block) {
+        // Don't hold on to a buffer while waiting for an idle connection
+        if (0 == watermark) {
+            bufh.release();
+        }
+        return false;
+    }
+
+    if (!ec) {
+        recordRead(direction, readAmount, readBuf.available());
+    }
+
+    timePoint(direction) = std::chrono::steady_clock::now();
+    if (!currentlyReading(direction)) {
+        startedAt(direction)        = timePoint(direction);
+        currentlyReading(direction) = true;
+    }
+
+    auto self(shared_from_this());
+    boost::asio::post(d_ioContext, [this, self, direction, readAmount, ec] {
+        BOOST_LOG_SCOPED_THREAD_ATTR(
+            "Vhost",
+            boost::log::attributes::constant<std::string>(
+                d_sessionState.getVirtualHost()));
+        BOOST_LOG_SCOPED_THREAD_ATTR(
+            "ConnID",
+            boost::log::attributes::constant<uint64_t>(d_sessionState.id()));
+
+        if (ec) {
+            handleSessionError(
+                "read_some", direction, readSocket(direction), ec);
+            return;
+        }
+
+        waterMark(direction) += readAmount;
+        if (direction == FlowType::EGRESS || !d_sessionState.getPaused()) {
+            handleData(direction);
+        }
+    });
+
+    return true;
+}
+
+void Session::waitForMemory()
+{
+    LOG_DEBUG << "Pausing ingress reads until buffer memory drains, holding "
+              << d_ingressReadBufferSize + d_ingressWriteQueue.d_bytes
+              << " bytes";
+
+    std::weak_ptr<Session> weakSelf = weak_from_this();
+    d_memoryBudget->waitForMemory([weakSelf] {
+        std::shared_ptr<Session> self = weakSelf.lock();
+        if (!self) {
+            return;
+        }
+
+        boost::asio::post(self->d_ioContext, [self] {
+            BOOST_LOG_SCOPED_THREAD_ATTR(
+                "Vhost",
+                boost::log::attributes::constant<std::string>(
+                    self->d_sessionState.getVirtualHost()));
+            BOOST_LOG_SCOPED_THREAD_ATTR(
+                "ConnID",
+                boost::log::attributes::constant<uint64_t>(
+                    self->d_sessionState.id()));
+
+            if (!self->finished()) {
+                LOG_DEBUG << "Resuming ingress reads";
+                self->readData(FlowType::INGRESS);
+            }
+        });
+    });
+}
+
+void Session::recordRead(FlowType    direction,
+                         std::size_t bytesRead,
+                         std::size_t bufferSize)
+{
+    readSizeEstimator(direction).recordRead(bytesRead, bufferSize);
+
+    if (direction == FlowType::INGRESS) {
+        d_sessionState.recordIngressRead(bytesRead);
+    }
+    else {
+        d_sessionState.recordEgressRead(bytesRead);
+    }
+}
+
+bool Session::canSplice(FlowType direction)
+{
+    if (!d_splicePassthrough ||
+        d_connector.state() != Connector::State::OPEN ||
+        waterMark(direction) != 0 || readSocket(direction).spliceHandle() < 0 ||
+        writeSocket(direction).spliceHandle() < 0) {
+        return false;
+    }
+
+    auto &pipe = splicePipe(direction);
+    if (!pipe.isOpen()) {
+        boost::system::error_code ec;
+        pipe.open(ec);
+        if (ec) {
+            LOG_WARN << "Failed to open splice pipe, continuing without: "
+                     << ec << " conn=" << ConnectionSummary(*this);
+            d_splicePassthrough = false;
+            return false;
+        }
+
+        LOG_DEBUG << "Splicing passthrough data " << direction;
+    }
+
+    return true;
+}
+
+void Session::spliceData(FlowType direction)
+{
+    auto &socket = readSocket(direction);
+
+    auto self(shared_from_this());
+    socket.async_read_some(
+        boost::asio::null_buffers(),
+        [this, self, direction](error_code ec, std::size_t) {
+            BOOST_LOG_SCOPED_THREAD_ATTR(
+                "Vhost",
+                boost::log::attributes::constant<std::string>(
+                    d_sessionState.getVirtualHost()));
+            BOOST_LOG_SCOPED_THREAD_ATTR(
+                "ConnID",
+                boost::log::attributes::constant<uint64_t>(
+                    d_sessionState.id()));
+
+            auto &socket         = readSocket(direction);
+            timePoint(direction) = std::chrono::steady_clock::now();
+            if (!currentlyReading(direction)) {
+                startedAt(direction)        = timePoint(direction);
+                currentlyReading(direction) = true;
+            }
+
+            if (ec) {
+                handleSessionError("read", direction, socket, ec);
                 return;
             }
+
+            if (direction == FlowType::INGRESS && d_sessionState.getPaused()) {
+                return;
+            }
+
+            std::size_t spliced = splicePipe(direction).fill(
+                socket.spliceHandle(), SPLICE_CHUNK_SIZE, ec);
+
+            if (ec == boost::asio::error::would_block) {
+                spliceData(direction);
+                return;
+            }
+            else if (ec) {
+                handleSessionError("splice", direction, socket, ec);
+                return;
+            }
+
+            socket.recordSplicedRead(spliced);
+            if (d_backendCounters) {
+                d_backendCounters->addBytes(spliced,
+                                            std::chrono::steady_clock::now());
+            }
+            if (direction == FlowType::INGRESS) {
+                d_sessionState.incrementIngressTotals(0, spliced);
+            }
+            else {
+                d_sessionState.incrementEgressTotals(0, spliced);
+            }
+
+            drainSplicePipe(direction);
         });
 }
 
+void Session::drainSplicePipe(FlowType direction)
+{
+    auto &pipe = splicePipe(direction);
+
+    boost::system::error_code ec;
+    pipe.drain(writeSocket(direction).spliceHandle(), ec);
+
+    if (ec == boost::asio::error::would_block) {
+        LOG_TRACE << "Waiting to splice " << pipe.pending() << " bytes "
+                  << direction;
+
+        auto self(shared_from_this());
+        writeSocket(direction).async_wait_writable(
+            [this, self, direction](error_code ec) {
+                BOOST_LOG_SCOPED_THREAD_ATTR(
+                    "Vhost",
+                    boost::log::attributes::constant<std::string>(
+                        d_sessionState.getVirtualHost()));
+                BOOST_LOG_SCOPED_THREAD_ATTR(
+                    "ConnID",
+                    boost::log::attributes::constant<uint64_t>(
+                        d_sessionState.id()));
+
+                if (ec) {
+                    handleSessionError(
+                        "write", direction, writeSocket(direction), ec);
+                    return;
+                }
+
+                drainSplicePipe(direction);
+            });
+        return;
+    }
+    else if (ec) {
+        handleSessionError("splice", direction, writeSocket(direction), ec);
+        return;
+    }
+
+    recordWriteLatency(direction);
+    readData(direction);
+}
+
+void Session::recordWriteLatency(FlowType direction)
+{
+    if (currentlyReading(direction)) {
+        recordLatency(direction,
+                      startedAt(direction),
+                      std::chrono::steady_clock::now());
+        currentlyReading(direction) = false;
+    }
+}
+
+void Session::recordLatency(FlowType  direction,
+                            TimePoint readAt,
+                            TimePoint writtenAt)
+{
+    uint64_t latency = std::chrono::duration_cast<std::chrono::microseconds>(
+                           writtenAt - readAt)
+                           .count();
+
+    if (direction == FlowType::INGRESS) {
+        d_sessionState.addIngressLatency(latency);
+    }
+    else {
+        d_sessionState.addEgressLatency(latency);
+    }
+}
+
 void Session::sendSyntheticData()
 {
     const Buffer outBuffer = d_connector.outBuffer();
-    if (outBuffer.size()) {
+    // Data for the ingress side is written by the egress direction's queue
+    FlowType queueDirection = d_connector.sendToIngressSide()
+                                  ? FlowType::EGRESS
+                                  : FlowType::INGRESS;
+    if (outBuffer.size() && !writeQueue(queueDirection).d_writes.empty()) {
+        queueSyntheticData(queueDirection,
+                           outBuffer,
+                           d_connector.sendToIngressSide() ? FlowType::INGRESS
+                                                           : FlowType::EGRESS);
+        d_connector.resetOutBuffer();
+    }
+    else if (outBuffer.size()) {
         auto &writeSocket = d_connector.sendToIngressSide() ? *d_serverSocket
                                                             : *d_clientSocket;
         handleWriteData(d_connector.sendToIngressSide() ? FlowType::INGRESS
@@ -838,11 +1479,23 @@ void Session::sendSyntheticData()
 
 void Session::handleData(FlowType direction)
 {
+    if (direction == FlowType::INGRESS) {
+        d_ingressReadBufferSize = bufferHandle(direction).size();
+    }
+
     try {
-        Buffer          readBuf = readBuffer(direction);
-        PacketProcessor processor(d_sessionState, d_connector);
+        Connector::State previousState = d_connector.state();
+        Buffer           readBuf       = readBuffer(direction);
+        PacketProcessor  processor(d_sessionState, d_connector);
         processor.process(direction, readBuf);
 
+        if (direction == FlowType::EGRESS &&
+            previousState == Connector::State::AWAITING_CONNECTION &&
+            d_connector.state() == Connector::State::STARTOK_SENT) {
+            recordBackendLatency(BackendCounters::Phase::BROKER_START);
+            countBackendOutcome(true);
+        }
+
         Buffer remaining = processor.remaining();
         copyRemaining(direction, remaining);
 
@@ -850,7 +1503,24 @@ void Session::handleData(FlowType direction)
         Buffer egressWrite  = processor.egressWrite();
 
         bool isOpen = d_connector.state() == Connector::State::OPEN;
-        if (ingressWrite.size()) {
+        if (isOpen && d_backendCounters) {
+            // Only what was passed through, not the partial frame carried
+            // over to the next read
+            d_backendCounters->addBytes(readBuf.offset() - remaining.size(),
+                                        std::chrono::steady_clock::now());
+        }
+        if (isOpen && d_inFlightWriteLimit > 0) {
+            // Passthrough only ever writes to the other side of `direction`
+            Buffer writeData =
+                direction == FlowType::INGRESS ? egressWrite : ingressWrite;
+            if (writeData.size()) {
+                queueWriteData(direction, writeData, remaining.size() > 0);
+            }
+            else {
+                readData(direction);
+            }
+        }
+        else if (ingressWrite.size()) {
             handleWriteData(isOpen ? FlowType::EGRESS : FlowType::INGRESS,
                             *d_serverSocket,
                             ingressWrite);
@@ -894,15 +1564,21 @@ void Session::handleData(FlowType direction)
     }
 }
 
-void Session::handleSessionError(const char               *action,
-                                 FlowType                  direction,
-                                 boost::system::error_code ec)
+void Session::handleSessionError(const char                       *action,
+                                 FlowType                          direction,
+                                 const MaybeSecureSocketAdaptor<> &socket,
+                                 boost::system::error_code         ec)
 {
+    // The direction says which way the data was flowing, not which end let
+    // it down: reading egress data and writing ingress data are both on the
+    // broker's socket.
+    const bool brokerSide = &socket == d_clientSocket.get();
+
     if (d_connector.state() == Connector::State::CLOSED) {
         d_sessionState.setDisconnected(
             SessionState::DisconnectType::DISCONNECTED_CLEANLY);
     }
-    else if (direction == FlowType::INGRESS &&
+    else if (!brokerSide &&
              d_connector.state() == Connector::State::CLIENT_CLOSE_SENT) {
         // The client might just close the socket or cancel read without
         // sending CloseOk back.
@@ -923,16 +1599,21 @@ void Session::handleSessionError(const char               *action,
     }
     else if (d_sessionState.getDisconnectType() ==
              SessionState::DisconnectType::NOT_DISCONNECTED) {
-        if (direction == FlowType::INGRESS) {
+        if (!brokerSide) {
             d_sessionState.setDisconnected(
                 SessionState::DisconnectType::DISCONNECTED_CLIENT);
         }
         else {
             d_sessionState.setDisconnected(
                 SessionState::DisconnectType::DISCONNECTED_SERVER);
+            if (ec != boost::asio::error::operation_aborted) {
+                countBackendDropped();
+            }
         }
     }
 
+    releaseBackend();
+
     if (ec != boost::asio::error::operation_aborted) {
         // TODO notify EventSource
 
@@ -974,11 +1655,15 @@ void Session::handleConnectionError(
              << "' error_code=" << TlsUtil::augmentTlsError(ec)
              << " conn=" << ConnectionSummary(*this);
 
+    countBackendOutcome(false);
+
     attemptResolvedConnection(connectionManager);
 }
 
 void Session::performDisconnectBoth()
 {
+    releaseBackend();
+
     auto self(shared_from_this());
     d_clientSocket->async_shutdown([this, self](error_code shutdownEc) {
         if (shutdownEc) {
@@ -1004,6 +1689,66 @@ void Session::performDisconnectBoth()
     });
 }
 
+void Session::holdBackend(const Backend *backend)
+{
+    if (d_backendCounters == backend->counters()) {
+        return;
+    }
+
+    releaseBackend();
+    d_backendCounters = backend->counters();
+    d_backendCounters->connectionOpened();
+}
+
+void Session::releaseBackend()
+{
+    if (d_backendCounters) {
+        d_backendCounters->connectionClosed();
+        d_backendCounters.reset();
+    }
+}
+
+void Session::countBackendOutcome(bool succeeded)
+{
+    // Once the broker has sent Connection.Start the connection has
+    // succeeded, the backend dropping it later is counted separately
+    if (!d_backendCounters || d_backendOutcomeCounted) {
+        return;
+    }
+
+    d_backendOutcomeCounted = true;
+    d_backendSucceeded      = succeeded;
+    if (succeeded) {
+        d_backendCounters->connectionSucceeded();
+    }
+    else {
+        d_backendCounters->connectionFailed();
+    }
+}
+
+void Session::countBackendDropped()
+{
+    if (d_backendCounters && d_backendSucceeded) {
+        d_backendCounters->connectionSnapped();
+    }
+    else {
+        countBackendOutcome(false);
+    }
+}
+
+void Session::recordBackendLatency(BackendCounters::Phase phase)
+{
+    TimePoint now = std::chrono::steady_clock::now();
+    if (d_backendCounters) {
+        d_backendCounters->recordLatency(
+            phase,
+            std::chrono::duration_cast<std::chrono::microseconds>(
+                now - d_backendPhaseStartedAt),
+            now);
+    }
+    d_backendPhaseStartedAt = now;
+}
+
 void Session::updateDataRateLimits()
 {
     // Called from the control socket thread
@@ -18,23 +18,29 @@
 
 #include <amqpprox_authinterceptinterface.h>
 #include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
 #include <amqpprox_buffer.h>
 #include <amqpprox_bufferhandle.h>
 #include <amqpprox_bufferpool.h>
 #include <amqpprox_connectionselectorinterface.h>
 #include <amqpprox_connector.h>
 #include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldtableview.h>
 #include <amqpprox_flowtype.h>
 #include <amqpprox_frame.h>
 #include <amqpprox_maybesecuresocketadaptor.h>
+#include <amqpprox_readsizeestimator.h>
 #include <amqpprox_sessionstate.h>
+#include <amqpprox_splicepipe.h>
 
 #include <boost/asio.hpp>
 #include <boost/asio/steady_timer.hpp>
 
 #include <chrono>
+#include <deque>
 #include <iosfwd>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -47,6 +53,7 @@ class ConnectionSelectorInterface;
 class EventSource;
 class DNSResolver;
 class DataRateLimitManager;
+class MemoryBudget;
 
 /**
  * \brief Binds the incoming and outgoing sockets into a channel through the
@@ -58,8 +65,41 @@ class DataRateLimitManager;
  */
 class Session : public std::enable_shared_from_this<Session> {
   private:
-    using TimePoint =
-        std::chrono::time_point<std::chrono::high_resolution_clock>;
+    using TimePoint = std::chrono::time_point<std::chrono::steady_clock>;
+
+    /**
+     * \brief A passthrough write that has been handed to the socket, or is
+     * queued behind one, together with ownership of the buffer it points into
+     */
+    struct InFlightWrite {
+        BufferHandle d_handle;
+        Buffer       d_data;
+        // The direction to read from once this write completes, for
+        // synthetic data queued behind passthrough data
+        std::optional<FlowType> d_readAfter;
+        // When the oldest of the data was read, for passthrough data
+        std::optional<TimePoint> d_readAt;
+    };
+
+    /**
+     * \brief The passthrough writes outstanding for one direction
+     */
+    struct WriteQueue {
+        std::deque<InFlightWrite> d_writes;
+        std::size_t               d_bytes;
+        std::size_t               d_inFlight;  // writes handed to the socket
+        bool                      d_readBlocked;
+        bool                      d_coalescing;  // held back for more data
+
+        WriteQueue()
+        : d_writes()
+        , d_bytes(0)
+        , d_inFlight(0)
+        , d_readBlocked(false)
+        , d_coalescing(false)
+        {
+        }
+    };
 
     boost::asio::io_context                  &d_ioContext;
     std::shared_ptr<MaybeSecureSocketAdaptor<>> d_serverSocket;
@@ -87,7 +127,27 @@ class Session : public std::enable_shared_from_this<Session> {
     uint32_t                                    d_resolvedEndpointsIndex;
     boost::asio::steady_timer                   d_connectionRateLimitedTimer;
     std::shared_ptr<AuthInterceptInterface>     d_authIntercept;
-    DataRateLimitManager *d_limitManager;  // HELD NOT OWNED
+    DataRateLimitManager            *d_limitManager;  // HELD NOT OWNED
+    WriteQueue                       d_ingressWriteQueue;
+    WriteQueue                       d_egressWriteQueue;
+    std::size_t                      d_inFlightWriteLimit;
+    std::chrono::microseconds        d_writeCoalesceDelay;
+    boost::asio::steady_timer        d_ingressCoalesceTimer;
+    boost::asio::steady_timer        d_egressCoalesceTimer;
+    bool                             d_splicePassthrough;
+    bool                             d_speculativeReads;
+    SplicePipe                       d_ingressPipe;
+    SplicePipe                       d_egressPipe;
+    std::shared_ptr<MemoryBudget>    d_memoryBudget;
+    std::size_t                      d_ingressReadBufferSize;
+    ReadSizeEstimator                d_ingressReadSize;
+    ReadSizeEstimator                d_egressReadSize;
+    std::shared_ptr<BackendCounters> d_backendCounters;
+    TimePoint                        d_backendPhaseStartedAt;
+    bool                             d_backendOutcomeCounted;
+    bool                             d_backendSucceeded;
+    std::string                      d_affinityClientProperty;
+
   public:
     // CREATORS
     Session(boost::asio::io_context                         &ioContext,
@@ -111,6 +171,66 @@ class Session : public std::enable_shared_from_this<Session> {
      */
     void start();
 
+    /**
+     * \brief Set the number of passthrough bytes each direction may have
+     * written to its socket but not yet completed before reading from that
+     * direction is suspended. Once the session is established this allows a
+     * direction to keep reading while earlier data is still being written. A
+     * limit of 0, the default, only reads again once the previous write has
+     * completed. This must be called before `start`.
+     * \param bytes the in-flight byte limit for each direction
+     */
+    void setInFlightWriteLimit(std::size_t bytes);
+
+    /**
+     * \brief Set how long a small passthrough write may be held back, when
+     * nothing else is being written in its direction, so that data read
+     * shortly after it can go out in the same write. Like Nagle's algorithm
+     * this trades latency for fewer, larger writes, and it only applies
+     * while an in-flight write limit is set. A delay of 0, the default,
+     * writes straight away. This must be called before `start`.
+     * \param delay the longest time to hold back a small write
+     */
+    void setWriteCoalesceDelay(std::chrono::microseconds delay);
+
+    /**
+     * \brief Set whether passthrough data is moved between plaintext sockets
+     * with `splice` once the session is established, instead of being read
+     * into a buffer and written back out. Spliced data is not parsed, so
+     * only bytes, not frames, are counted for it. This must be called
+     * before `start`.
+     * \param enabled whether to splice passthrough data
+     */
+    void setSplicePassthrough(bool enabled);
+
+    /**
+     * \brief Set whether reads on plaintext sockets are first attempted
+     * directly, only waiting for the socket to become readable if no data is
+     * available yet. This saves the readiness wait and the `available` query
+     * for busy connections, at the cost of a failed read for idle ones. This
+     * must be called before `start`.
+     * \param enabled whether to attempt reads before waiting for readiness
+     */
+    void setSpeculativeReads(bool enabled);
+
+    /**
+     * \brief Set the client property whose value, sent in `StartOk`, joins
+     * the vhost in the key the backend selector may place this session by,
+     * see `BackendSelector::selectWithAffinity`. Without it, or when the
+     * client doesn't send the property as a string, the key is the vhost
+     * alone. This must be called before `start`.
+     * \param name the client property, or empty for the vhost alone
+     */
+    void setAffinityClientProperty(std::string name);
+
+    /**
+     * \brief Set the budget that ingress reads are paused by while buffer
+     * memory is scarce and this session is one of the heaviest users of it,
+     * see `MemoryBudget`. This must be called before `start`.
+     * \param memoryBudget the budget, which the session shares ownership of
+     */
+    void setMemoryBudget(const std::shared_ptr<MemoryBudget> &memoryBudget);
+
     /**
      * \brief Print the session information
      * \param os output stream object
@@ -125,12 +245,14 @@ class Session : public std::enable_shared_from_this<Session> {
     /**
      * \brief Un-pause this session. This will disconnect the session if it was
      * connected to the broker when paused. If the session was paused during
-     * the handshake this may in future continue the handshake.
+     * the handshake this may in future continue the handshake. This may be
+     * called from any thread, the session is resumed on its own io_context.
      */
     void unpause();
 
     /**
-     * \brief Disconnect both sides of the session
+     * \brief Disconnect both sides of the session. This may be called from
+     * any thread, the disconnect is performed on the session's io_context.
      * \param forcible to specify forcefully disconnect
      */
     void disconnect(bool forcible);
@@ -145,8 +267,8 @@ class Session : public std::enable_shared_from_this<Session> {
      * 'authentication_failure_close' capability value
      * \param reason custom reason/message for unauthorized client
      */
-    void disconnectUnauthClient(const FieldTable &clientProperties,
-                                std::string_view  reason);
+    void disconnectUnauthClient(const FieldTableView &clientProperties,
+                                std::string_view      reason);
 
     /**
      * \brief Disconnect the session from the backend, but leave the client
@@ -215,6 +337,11 @@ class Session : public std::enable_shared_from_this<Session> {
      */
     void establishConnection();
 
+    /**
+     * \return the key the backend selector may place this session by
+     */
+    std::string affinityKey() const;
+
     /**
      * \brief Send data stored in connector's buffer and originated on the
      * proxy side
@@ -233,6 +360,64 @@ class Session : public std::enable_shared_from_this<Session> {
      */
     void readData(FlowType direction);
 
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return whether the next read for the `direction` can be spliced,
+     * opening its pipe if required
+     */
+    bool canSplice(FlowType direction);
+
+    /**
+     * \brief Account for a read of `bytesRead` bytes into a buffer with
+     * `bufferSize` bytes of space
+     */
+    void recordRead(FlowType direction,
+                    std::size_t bytesRead,
+                    std::size_t bufferSize);
+
+    /**
+     * \brief Stop reading ingress data until the memory budget has drained
+     */
+    void waitForMemory();
+
+    /**
+     * \brief Attempt to read from the `direction`'s socket without waiting
+     * for it to become readable, handling any result asynchronously
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return false if there was no data to read, in which case the caller
+     * should wait for some
+     */
+    bool speculativeRead(FlowType direction);
+
+    /**
+     * \brief Wait for data to read and splice it into the `direction`'s pipe
+     * \param direction specifies direction of the data flow (ingress/egress)
+     */
+    void spliceData(FlowType direction);
+
+    /**
+     * \brief Splice the `direction`'s pipe out to the outgoing socket, then
+     * re-read
+     * \param direction specifies direction of the data flow (ingress/egress)
+     */
+    void drainSplicePipe(FlowType direction);
+
+    /**
+     * \brief Record the latency of the read just written out and mark the
+     * `direction` as no longer reading a message
+     * \param direction specifies direction of the data flow (ingress/egress)
+     */
+    void recordWriteLatency(FlowType direction);
+
+    /**
+     * \brief Record the time data spent in the proxy
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \param readAt when the data was read
+     * \param writtenAt when the data finished being written
+     */
+    void
+    recordLatency(FlowType direction, TimePoint readAt, TimePoint writtenAt);
+
     /**
      * \brief Put the supplied data onto the outgoing socket, then re-read
      * \param direction specifies direction of the data flow (ingress/egress)
@@ -243,15 +428,50 @@ class Session : public std::enable_shared_from_this<Session> {
                          MaybeSecureSocketAdaptor<> &writeSocket,
                          Buffer                      data);
 
+    /**
+     * \brief Queue the passthrough data just read from the specified
+     * `direction`, taking ownership of the buffer holding it, and start
+     * writing it if no write is in progress. Reading continues while the
+     * direction's in-flight bytes are within the limit.
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \param data the frames to write to the other side
+     * \param hasRemaining whether a partial frame was moved into a new read
+     * buffer, leaving `data` in the secondary buffer
+     */
+    void queueWriteData(FlowType direction, Buffer data, bool hasRemaining);
+
+    /**
+     * \brief Write the queued data for the `direction`, gathering as many of
+     * the queued buffers as possible into a single write, unless a write is
+     * already in progress
+     * \param direction specifies direction of the data flow (ingress/egress)
+     */
+    void writeQueuedData(FlowType direction);
+
+    /**
+     * \brief Queue a copy of the `data` to be written behind the passthrough
+     * data already queued for the `direction`, reading from the `readAfter`
+     * direction once it has been written
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \param data to be written onto the outgoing socket
+     * \param readAfter the direction to read from after the write completes
+     */
+    void queueSyntheticData(FlowType      direction,
+                            const Buffer &data,
+                            FlowType      readAfter);
+
     /**
      * \brief Handle errors on an established connection
      * \param action specifies action information
      * \param direction specifies direction of the data flow (ingress/egress)
+     * \param socket the socket the failed operation was on, which decides
+     * whether the client or the broker is blamed
      * \param ec specifies error code
      */
-    void handleSessionError(const char               *action,
-                            FlowType                  direction,
-                            boost::system::error_code ec);
+    void handleSessionError(const char                       *action,
+                            FlowType                          direction,
+                            const MaybeSecureSocketAdaptor<> &socket,
+                            boost::system::error_code         ec);
 
     /**
      * \brief Handle errors while establishing a connection
@@ -269,6 +489,38 @@ class Session : public std::enable_shared_from_this<Session> {
      */
     void performDisconnectBoth();
 
+    /**
+     * \brief Count this session against the backend it's connecting to,
+     * instead of any it was counted against before
+     * \param backend the backend being connected to
+     */
+    void holdBackend(const Backend *backend);
+
+    /**
+     * \brief Stop counting this session against its backend, if any
+     */
+    void releaseBackend();
+
+    /**
+     * \brief Count the outcome of the current connection to the backend,
+     * unless it has already been counted
+     * \param succeeded whether the connection succeeded or failed
+     */
+    void countBackendOutcome(bool succeeded);
+
+    /**
+     * \brief Count the backend dropping the current connection, as a
+     * failure if it had not yet succeeded and as snapped if it had
+     */
+    void countBackendDropped();
+
+    /**
+     * \brief Record how long a step of setting up the connection to the
+     * backend took, and start timing the next step
+     * \param phase the step that has just completed
+     */
+    void recordBackendLatency(BackendCounters::Phase phase);
+
     /**
      * \brief Copy any remaining data from the incoming buffer to a new buffer
      * for the next read operation to append to.
@@ -283,6 +535,36 @@ class Session : public std::enable_shared_from_this<Session> {
      */
     inline MaybeSecureSocketAdaptor<> &readSocket(FlowType direction);
 
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return a mutable reference to the socket passthrough data is written to
+     */
+    inline MaybeSecureSocketAdaptor<> &writeSocket(FlowType direction);
+
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return a mutable reference to the queue of passthrough writes
+     */
+    inline WriteQueue &writeQueue(FlowType direction);
+
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return the timer holding back small writes for the `direction`
+     */
+    inline boost::asio::steady_timer &coalesceTimer(FlowType direction);
+
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return a mutable reference to the pipe spliced data passes through
+     */
+    inline SplicePipe &splicePipe(FlowType direction);
+
+    /**
+     * \param direction specifies direction of the data flow (ingress/egress)
+     * \return a mutable reference to the estimate of how much to read
+     */
+    inline ReadSizeEstimator &readSizeEstimator(FlowType direction);
+
     /**
      * \param direction specifies direction of the data flow (ingress/egress)
      * \return a buffer to used for reading into
@@ -336,6 +618,35 @@ inline MaybeSecureSocketAdaptor<> &Session::readSocket(FlowType direction)
                                             : *d_clientSocket;
 }
 
+inline MaybeSecureSocketAdaptor<> &Session::writeSocket(FlowType direction)
+{
+    return (direction == FlowType::INGRESS) ? *d_clientSocket
+                                            : *d_serverSocket;
+}
+
+inline Session::WriteQueue &Session::writeQueue(FlowType direction)
+{
+    return (direction == FlowType::INGRESS) ? d_ingressWriteQueue
+                                            : d_egressWriteQueue;
+}
+
+inline boost::asio::steady_timer &Session::coalesceTimer(FlowType direction)
+{
+    return (direction == FlowType::INGRESS) ? d_ingressCoalesceTimer
+                                            : d_egressCoalesceTimer;
+}
+
+inline SplicePipe &Session::splicePipe(FlowType direction)
+{
+    return (direction == FlowType::INGRESS) ? d_ingressPipe : d_egressPipe;
+}
+
+inline ReadSizeEstimator &Session::readSizeEstimator(FlowType direction)
+{
+    return (direction == FlowType::INGRESS) ? d_ingressReadSize
+                                            : d_egressReadSize;
+}
+
 inline void Session::copyRemaining(FlowType direction, const Buffer &remaining)
 {
     if (direction == FlowType::INGRESS) {
@@ -17,6 +17,7 @@
 
 #include <amqpprox_eventsource.h>
 #include <amqpprox_logging.h>
+#include <amqpprox_memorybudget.h>
 #include <amqpprox_server.h>
 #include <amqpprox_session.h>
 #include <amqpprox_statcollector.h>
@@ -37,8 +38,9 @@ bool SessionCleanup::cleanup(Control *control, Server *server)
 
     std::vector<std::shared_ptr<Session>> sessionsDeleted;
 
-    // Visit each of the sessions retrieving the statistics and setting any
-    // sessions that are disconnected to be deleted.
+    // Visit each of the sessions that changed since the last cleanup,
+    // retrieving their statistics and setting any sessions that are
+    // disconnected to be deleted. Sessions only disconnect by changing.
     auto visitor = [this, server, &sessionsDeleted](
                        const std::shared_ptr<Session> &session) {
         d_statCollector_p->collect(session->state());
@@ -49,7 +51,27 @@ bool SessionCleanup::cleanup(Control *control, Server *server)
         }
     };
 
-    server->visitSessions(visitor);
+    server->visitChangedSessions(visitor);
+
+    std::vector<Server::ListenerStatistic> listenerStats;
+    server->getListenerStatistics(&listenerStats);
+    for (const auto &listener : listenerStats) {
+        d_statCollector_p->collectListener(std::get<0>(listener),
+                                           std::get<1>(listener),
+                                           std::get<2>(listener));
+    }
+
+    std::shared_ptr<MemoryBudget> memoryBudget = server->memoryBudget();
+    if (memoryBudget) {
+        StatSnapshot::MemoryStats memoryStats;
+        memoryStats.d_bytesInUse    = memoryBudget->bytesInUse();
+        memoryStats.d_highWatermark = memoryBudget->highWatermark();
+        memoryStats.d_lowWatermark  = memoryBudget->lowWatermark();
+        memoryBudget->statistics(&memoryStats.d_pausedSessions,
+                                 &memoryStats.d_pauses,
+                                 &memoryStats.d_resumes);
+        d_statCollector_p->collectMemory(memoryStats);
+    }
 
     // Broadcast collected stats to all listeners
     d_eventSource_p->statisticsAvailable().emit(d_statCollector_p);
@@ -25,7 +25,7 @@
 namespace Bloomberg {
 namespace amqpprox {
 
-uint64_t SessionState::s_nextId = 1;
+std::atomic<uint64_t> SessionState::s_nextId(1);
 
 SessionState::SessionState(
     const std::shared_ptr<HostnameMapper> &hostnameMapper)
@@ -43,14 +43,23 @@ SessionState::SessionState(
 , d_ingressLatencyCount(0)
 , d_egressLatencyTotal(0)
 , d_egressLatencyCount(0)
+, d_ingressLatencyBuckets()
+, d_egressLatencyBuckets()
+, d_ingressReadCount(0)
+, d_egressReadCount(0)
+, d_ingressReadBytes(0)
+, d_egressReadBytes(0)
 , d_paused(false)
 , d_readyToConnectOnUnpause(false)
 , d_authDeniedConnection(false)
 , d_ingressSecured(false)
 , d_limitedConnection(false)
+, d_countOnly(false)
+, d_changed(false)
+, d_changedSessions_p(nullptr)
 , d_virtualHost()
 , d_disconnectedStatus(DisconnectType::NOT_DISCONNECTED)
-, d_id(s_nextId++)  // This isn't a race because this is only on one thread
+, d_id(s_nextId++)
 , d_lock()
 , d_hostnameMapper(hostnameMapper)
 {
@@ -64,9 +73,12 @@ void SessionState::setEgress(boost::asio::io_context       &ioContext,
         d_hostnameMapper->prime(ioContext, {local, remote});
     }
 
-    std::lock_guard<std::mutex> lg(d_lock);
-    d_egressLocalEndpoint  = local;
-    d_egressRemoteEndpoint = remote;
+    {
+        std::lock_guard<std::mutex> lg(d_lock);
+        d_egressLocalEndpoint  = local;
+        d_egressRemoteEndpoint = remote;
+    }
+    markChanged();
 }
 
 void SessionState::setIngress(boost::asio::io_context       &ioContext,
@@ -77,15 +89,33 @@ void SessionState::setIngress(boost::asio::io_context       &ioContext,
         d_hostnameMapper->prime(ioContext, {local, remote});
     }
 
-    std::lock_guard<std::mutex> lg(d_lock);
-    d_ingressLocalEndpoint  = local;
-    d_ingressRemoteEndpoint = remote;
+    {
+        std::lock_guard<std::mutex> lg(d_lock);
+        d_ingressLocalEndpoint  = local;
+        d_ingressRemoteEndpoint = remote;
+    }
+    markChanged();
+}
+
+void SessionState::setChangedSessions(ChangedSessions *changedSessions)
+{
+    d_changedSessions_p = changedSessions;
+    d_changed           = false;
+    markChanged();
+}
+
+void SessionState::clearChanged()
+{
+    d_changed = false;
 }
 
 void SessionState::setVirtualHost(const std::string &vhost)
 {
-    std::lock_guard<std::mutex> lg(d_lock);
-    d_virtualHost = vhost;
+    {
+        std::lock_guard<std::mutex> lg(d_lock);
+        d_virtualHost = vhost;
+    }
+    markChanged();
 }
 
 void SessionState::setHostnameMapper(
@@ -95,18 +125,22 @@ void SessionState::setHostnameMapper(
     if (!hostnameMapper) {
         return;
     }
-    std::lock_guard<std::mutex> lg(d_lock);
-    d_hostnameMapper = hostnameMapper;
-    d_hostnameMapper->prime(ioContext,
-                            {d_ingressLocalEndpoint,
-                             d_ingressRemoteEndpoint,
-                             d_egressLocalEndpoint,
-                             d_egressRemoteEndpoint});
+    {
+        std::lock_guard<std::mutex> lg(d_lock);
+        d_hostnameMapper = hostnameMapper;
+        d_hostnameMapper->prime(ioContext,
+                                {d_ingressLocalEndpoint,
+                                 d_ingressRemoteEndpoint,
+                                 d_egressLocalEndpoint,
+                                 d_egressRemoteEndpoint});
+    }
+    markChanged();
 }
 
 void SessionState::setPaused(bool paused)
 {
     d_paused = paused;
+    markChanged();
 }
 
 void SessionState::setReadyToConnectOnUnpause(bool paused)
@@ -114,9 +148,15 @@ void SessionState::setReadyToConnectOnUnpause(bool paused)
     d_readyToConnectOnUnpause = paused;
 }
 
+void SessionState::setCountOnly(bool countOnly)
+{
+    d_countOnly = countOnly;
+}
+
 void SessionState::setAuthDeniedConnection(bool authDenied)
 {
     d_authDeniedConnection = authDenied;
+    markChanged();
 }
 
 void SessionState::setIngressSecured(bool secured)
@@ -126,8 +166,11 @@ void SessionState::setIngressSecured(bool secured)
 
 void SessionState::setDisconnected(SessionState::DisconnectType disconnect)
 {
-    std::lock_guard<std::mutex> lg(d_lock);
-    d_disconnectedStatus = disconnect;
+    {
+        std::lock_guard<std::mutex> lg(d_lock);
+        d_disconnectedStatus = disconnect;
+    }
+    markChanged();
 }
 
 void SessionState::incrementIngressTotals(uint64_t frames, uint64_t bytes)
@@ -135,6 +178,7 @@ void SessionState::incrementIngressTotals(uint64_t frames, uint64_t bytes)
     d_ingressPacketTotal.fetch_add(1, std::memory_order_relaxed);
     d_ingressFrameTotal.fetch_add(frames, std::memory_order_relaxed);
     d_ingressBytesTotal.fetch_add(bytes, std::memory_order_relaxed);
+    markChanged();
 }
 
 void SessionState::incrementEgressTotals(uint64_t frames, uint64_t bytes)
@@ -142,23 +186,65 @@ void SessionState::incrementEgressTotals(uint64_t frames, uint64_t bytes)
     d_egressPacketTotal.fetch_add(1, std::memory_order_relaxed);
     d_egressFrameTotal.fetch_add(frames, std::memory_order_relaxed);
     d_egressBytesTotal.fetch_add(bytes, std::memory_order_relaxed);
+    markChanged();
 }
 
 void SessionState::addIngressLatency(uint64_t latency)
 {
     d_ingressLatencyTotal.fetch_add(latency, std::memory_order_relaxed);
     d_ingressLatencyCount.fetch_add(1, std::memory_order_relaxed);
+    countLatency(&d_ingressLatencyBuckets, latency);
+    markChanged();
 }
 
 void SessionState::addEgressLatency(uint64_t latency)
 {
     d_egressLatencyTotal.fetch_add(latency, std::memory_order_relaxed);
     d_egressLatencyCount.fetch_add(1, std::memory_order_relaxed);
+    countLatency(&d_egressLatencyBuckets, latency);
+    markChanged();
+}
+
+void SessionState::recordIngressRead(uint64_t bytes)
+{
+    d_ingressReadCount.fetch_add(1, std::memory_order_relaxed);
+    d_ingressReadBytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void SessionState::recordEgressRead(uint64_t bytes)
+{
+    d_egressReadCount.fetch_add(1, std::memory_order_relaxed);
+    d_egressReadBytes.fetch_add(bytes, std::memory_order_relaxed);
 }
 
 void SessionState::setLimitedConnection()
 {
     d_limitedConnection = true;
+    markChanged();
+}
+
+void SessionState::countLatency(LatencyBuckets *buckets, uint64_t latency)
+{
+    std::size_t bucket = LatencyHistogram::bucketIndex(latency);
+    buckets->d_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+
+    std::size_t used = buckets->d_used.load(std::memory_order_relaxed);
+    while (used <= bucket && !buckets->d_used.compare_exchange_weak(
+                                 used, bucket + 1, std::memory_order_release)) {
+    }
+}
+
+void SessionState::takeLatency(LatencyBuckets   *buckets,
+                               LatencyHistogram *histogram)
+{
+    std::size_t used = buckets->d_used.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < used; ++i) {
+        uint32_t count =
+            buckets->d_counts[i].exchange(0, std::memory_order_relaxed);
+        if (count > 0) {
+            histogram->addToBucket(i, count);
+        }
+    }
 }
 
 std::string
@@ -195,6 +281,36 @@ void SessionState::getTotals(uint64_t *ingressPackets,
     *egressLatencyCount = d_egressLatencyCount.load(std::memory_order_relaxed);
 }
 
+void SessionState::takeLatencyHistograms(LatencyHistogram *ingress,
+                                         LatencyHistogram *egress)
+{
+    takeLatency(&d_ingressLatencyBuckets, ingress);
+    takeLatency(&d_egressLatencyBuckets, egress);
+}
+
+void SessionState::getReadTotals(uint64_t *ingressReads,
+                                 uint64_t *ingressReadBytes,
+                                 uint64_t *egressReads,
+                                 uint64_t *egressReadBytes) const
+{
+    *ingressReads     = d_ingressReadCount.load(std::memory_order_relaxed);
+    *ingressReadBytes = d_ingressReadBytes.load(std::memory_order_relaxed);
+    *egressReads      = d_egressReadCount.load(std::memory_order_relaxed);
+    *egressReadBytes  = d_egressReadBytes.load(std::memory_order_relaxed);
+}
+
+namespace {
+
+void printReads(std::ostream &os, uint64_t reads, uint64_t bytes)
+{
+    if (reads > 0 && bytes > 0) {
+        os << " Avg. Read: " << bytes / reads << "B "
+           << (reads * 1024 * 1024 + bytes / 2) / bytes << " reads/MB ";
+    }
+}
+
+}
+
 std::ostream &operator<<(std::ostream &os, const SessionState &state)
 {
     uint64_t ingressPackets, ingressFrames, ingressBytes, ingressLatencyCount,
@@ -221,24 +337,38 @@ std::ostream &operator<<(std::ostream &os, const SessionState &state)
                : "D")
        << (state.getPaused() ? "P " : " ")
        << (state.getAuthDeniedConnection() ? "DENY " : " ")
+       << (state.getCountOnly() ? "COUNT " : "")
        << state.hostname(state.getIngress().second) << ":"
        << state.getIngress().second.port() << "->"
        << state.hostname(state.getIngress().first) << " --> "
        << state.hostname(state.getEgress().first) << ":"
        << state.getEgress().first.port() << "->"
        << state.hostname(state.getEgress().second) << ":"
-       << state.getEgress().second.port() << " IN: " << ingressBytes << "B "
-       << ingressFrames << " Frames in " << ingressPackets << " pkt. ";
+       << state.getEgress().second.port() << " IN: " << ingressBytes << "B ";
+    // The frame totals of count-only sessions stop once they're open
+    if (!state.getCountOnly()) {
+        os << ingressFrames << " Frames ";
+    }
+    os << "in " << ingressPackets << " pkt. ";
     if (ingressLatencyCount > 0) {
         os << " Avg. Latency: " << ingressLatencyTotal / ingressLatencyCount
-           << "ms ";
+           << "us ";
+    }
+
+    uint64_t ingressReads, ingressReadBytes, egressReads, egressReadBytes;
+    state.getReadTotals(
+        &ingressReads, &ingressReadBytes, &egressReads, &egressReadBytes);
+    printReads(os, ingressReads, ingressReadBytes);
+    os << " OUT: " << egressBytes << "B ";
+    if (!state.getCountOnly()) {
+        os << egressFrames << " Frames ";
     }
-    os << " OUT: " << egressBytes << "B " << egressFrames << " Frames in "
-       << egressPackets << " pkt. ";
+    os << "in " << egressPackets << " pkt. ";
     if (egressLatencyCount > 0) {
         os << " Avg. Latency: " << egressLatencyTotal / egressLatencyCount
-           << "ms ";
+           << "us ";
     }
+    printReads(os, egressReads, egressReadBytes);
 
     return os;
 }
@@ -16,8 +16,12 @@
 #ifndef BLOOMBERG_AMQPPROX_SESSIONSTATE
 #define BLOOMBERG_AMQPPROX_SESSIONSTATE
 
+#include <amqpprox_changedsessions.h>
+#include <amqpprox_latencyhistogram.h>
+
 #include <boost/asio.hpp>
 
+#include <array>
 #include <atomic>
 #include <iosfwd>
 #include <memory>
@@ -51,7 +55,16 @@ class SessionState {
     };
 
   private:
-    static uint64_t                 s_nextId;
+    // Latency samples counted since the histograms were last taken, and one
+    // past the highest bucket counted, so taking them only visits the buckets
+    // that can be in use
+    struct LatencyBuckets {
+        std::array<std::atomic<uint32_t>, LatencyHistogram::NUM_BUCKETS>
+                                 d_counts;
+        std::atomic<std::size_t> d_used;
+    };
+
+    static std::atomic<uint64_t>    s_nextId;
     boost::asio::ip::tcp::endpoint  d_ingressLocalEndpoint;
     boost::asio::ip::tcp::endpoint  d_ingressRemoteEndpoint;
     boost::asio::ip::tcp::endpoint  d_egressLocalEndpoint;
@@ -66,11 +79,20 @@ class SessionState {
     std::atomic<uint64_t>           d_egressLatencyCount;
     std::atomic<uint64_t>           d_ingressLatencyTotal;
     std::atomic<uint64_t>           d_egressLatencyTotal;
+    LatencyBuckets                  d_ingressLatencyBuckets;
+    LatencyBuckets                  d_egressLatencyBuckets;
+    std::atomic<uint64_t>           d_ingressReadCount;
+    std::atomic<uint64_t>           d_egressReadCount;
+    std::atomic<uint64_t>           d_ingressReadBytes;
+    std::atomic<uint64_t>           d_egressReadBytes;
     std::atomic<bool>               d_paused;
     std::atomic<bool>               d_readyToConnectOnUnpause;
     std::atomic<bool>               d_authDeniedConnection;
     std::atomic<bool>               d_ingressSecured;
     std::atomic<bool>               d_limitedConnection;
+    std::atomic<bool>               d_countOnly;
+    std::atomic<bool>               d_changed;
+    ChangedSessions                *d_changedSessions_p;  // HELD NOT OWNED
     std::string                     d_virtualHost;
     DisconnectType                  d_disconnectedStatus;
     uint64_t                        d_id;
@@ -107,6 +129,20 @@ class SessionState {
                     boost::asio::ip::tcp::endpoint local,
                     boost::asio::ip::tcp::endpoint remote);
 
+    /**
+     * \brief Set the list this session is added to when its statistics first
+     * change after being collected, see `ChangedSessions`. The session is
+     * added straight away so that it is collected at least once.
+     * \param changedSessions the list, which must outlive the session
+     */
+    void setChangedSessions(ChangedSessions *changedSessions);
+
+    /**
+     * \brief Clear the changed flag before collecting the statistics, so that
+     * any later change adds the session to the list again
+     */
+    void clearChanged();
+
     /**
      * \brief Set the virtual host
      * \param vhost virtual host
@@ -126,6 +162,14 @@ class SessionState {
      */
     void setReadyToConnectOnUnpause(bool paused);
 
+    /**
+     * \brief Set whether data is passed through without being parsed once
+     * the connection is open, so that only bytes are counted, not frames.
+     * This can't be undone once passthrough data has been counted only.
+     * \param countOnly flag to specify count-only passthrough
+     */
+    void setCountOnly(bool countOnly);
+
     /**
      * \brief Set the denied connection flag, because of auth failure
      * \param authDenied flag to specify denied connection because of auth
@@ -177,16 +221,28 @@ class SessionState {
 
     /**
      * \brief Add a latency value for ingress
-     * \param latency in milliseconds
+     * \param latency in microseconds
      */
     void addIngressLatency(uint64_t latency);
 
     /**
      * \brief Add a latency value for egress
-     * \param latency in milliseconds
+     * \param latency in microseconds
      */
     void addEgressLatency(uint64_t latency);
 
+    /**
+     * \brief Count a read of ingress data into a buffer
+     * \param bytes number of bytes read
+     */
+    void recordIngressRead(uint64_t bytes);
+
+    /**
+     * \brief Count a read of egress data into a buffer
+     * \param bytes number of bytes read
+     */
+    void recordEgressRead(uint64_t bytes);
+
     /**
      * \brief Get the hostname for the endpoint
      * \param endpoint ip address
@@ -219,6 +275,12 @@ class SessionState {
      */
     inline bool getReadyToConnectOnUnpause() const;
 
+    /**
+     * \return whether passthrough data is counted only, in which case the
+     * frame totals don't include it
+     */
+    inline bool getCountOnly() const;
+
     /**
      * \return the state of the connection, whether it is denied because of
      * auth failure
@@ -248,20 +310,61 @@ class SessionState {
     void getTotals(uint64_t *ingressPackets,
                    uint64_t *ingressFrames,
                    uint64_t *ingressBytes,
-                   uint64_t *ingressLatencyTotalMs,
+                   uint64_t *ingressLatencyTotalUs,
                    uint64_t *ingressLatencyCount,
                    uint64_t *egressPackets,
                    uint64_t *egressFrames,
                    uint64_t *egressBytes,
-                   uint64_t *egressLatencyTotalMs,
+                   uint64_t *egressLatencyTotalUs,
                    uint64_t *egressLatencyCount) const;
 
+    /**
+     * \brief Add the latency values added for ingress and egress since this
+     * was last called to the histograms, and stop counting them here
+     */
+    void takeLatencyHistograms(LatencyHistogram *ingress,
+                               LatencyHistogram *egress);
+
+    /**
+     * \brief Get the number of reads into buffers and the bytes they read,
+     * from which the average read size and reads per megabyte are derived
+     */
+    void getReadTotals(uint64_t *ingressReads,
+                       uint64_t *ingressReadBytes,
+                       uint64_t *egressReads,
+                       uint64_t *egressReadBytes) const;
+
     /**
      * \return whether session is disconnected and type of disconnection
      */
     inline DisconnectType getDisconnectType() const;
+
+  private:
+    /**
+     * \brief Add the session to the changed list unless it's already there
+     */
+    inline void markChanged();
+
+    /**
+     * \brief Count a latency sample of `latency` in the `buckets`
+     */
+    static void countLatency(LatencyBuckets *buckets, uint64_t latency);
+
+    /**
+     * \brief Move the samples counted in the `buckets` to the `histogram`
+     */
+    static void takeLatency(LatencyBuckets   *buckets,
+                            LatencyHistogram *histogram);
 };
 
+inline void SessionState::markChanged()
+{
+    if (d_changedSessions_p && !d_changed.load(std::memory_order_relaxed) &&
+        !d_changed.exchange(true)) {
+        d_changedSessions_p->add(d_id);
+    }
+}
+
 inline SessionState::EndpointPair SessionState::getEgress() const
 {
     std::lock_guard<std::mutex> lg(d_lock);
@@ -290,6 +393,11 @@ inline bool SessionState::getReadyToConnectOnUnpause() const
     return d_readyToConnectOnUnpause;
 }
 
+inline bool SessionState::getCountOnly() const
+{
+    return d_countOnly;
+}
+
 inline bool SessionState::getAuthDeniedConnection() const
 {
     return d_authDeniedConnection;
@@ -0,0 +1,196 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_slabarena.h>
+
+#include <algorithm>
+#include <cstdint>
+
+#include <sys/mman.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+std::size_t roundUp(std::size_t value, std::size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+char *mapAligned(std::size_t size)
+{
+    // Map twice the size so that a range aligned to the size can be cut out
+    // of it, unmapping the rest
+    std::size_t length = size * 2;
+    void       *mapped = ::mmap(nullptr,
+                          length,
+                          PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1,
+                          0);
+    if (mapped == MAP_FAILED) {
+        return nullptr;
+    }
+
+    char       *start   = static_cast<char *>(mapped);
+    std::size_t head    = roundUp(reinterpret_cast<uintptr_t>(start), size) -
+                       reinterpret_cast<uintptr_t>(start);
+    char       *aligned = start + head;
+    if (head > 0) {
+        ::munmap(start, head);
+    }
+    if (length - head - size > 0) {
+        ::munmap(aligned + size, length - head - size);
+    }
+
+#ifdef MADV_HUGEPAGE
+    ::madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+
+    return aligned;
+}
+
+}
+
+SlabArena::Slab::Slab(char *memory)
+: d_memory(memory)
+, d_freeList(nullptr)
+, d_carved(0)
+, d_inUse(0)
+, d_resident(true)
+, d_emptySince()
+{
+}
+
+SlabArena::SlabArena(std::size_t bufferSize)
+: d_bufferSize(bufferSize)
+, d_stride(roundUp(std::max<std::size_t>(bufferSize, sizeof(void *)),
+                   alignof(std::max_align_t)))
+, d_slabSize(SLAB_SIZE)
+, d_buffersPerSlab(0)
+, d_slabs()
+, d_available()
+, d_slabIndex()
+{
+    while (d_slabSize < d_stride) {
+        d_slabSize *= 2;
+    }
+
+    d_buffersPerSlab = d_slabSize / d_stride;
+}
+
+SlabArena::~SlabArena()
+{
+    for (const auto &slab : d_slabs) {
+        ::munmap(slab.d_memory, d_slabSize);
+    }
+}
+
+void *SlabArena::allocate()
+{
+    if (d_available.empty() && !addSlab()) {
+        return nullptr;
+    }
+
+    std::size_t index = *d_available.begin();
+    Slab       &slab  = d_slabs[index];
+
+    void *buf;
+    if (slab.d_freeList) {
+        buf             = slab.d_freeList;
+        slab.d_freeList = *static_cast<void **>(buf);
+    }
+    else {
+        buf = slab.d_memory + slab.d_carved * d_stride;
+        ++slab.d_carved;
+    }
+
+    slab.d_resident = true;
+    if (++slab.d_inUse == d_buffersPerSlab) {
+        d_available.erase(d_available.begin());
+    }
+
+    return buf;
+}
+
+void SlabArena::deallocate(void *data, Clock::time_point now)
+{
+    // Slabs are aligned to their size, so the slab is found from the address
+    char *base = reinterpret_cast<char *>(reinterpret_cast<uintptr_t>(data) &
+                                          ~(d_slabSize - 1));
+    std::size_t index = d_slabIndex.at(base);
+    Slab       &slab  = d_slabs[index];
+
+    if (slab.d_inUse == d_buffersPerSlab) {
+        d_available.insert(index);
+    }
+
+    *static_cast<void **>(data) = slab.d_freeList;
+    slab.d_freeList             = data;
+
+    if (--slab.d_inUse == 0) {
+        slab.d_emptySince = now;
+    }
+}
+
+std::size_t SlabArena::trim(Clock::duration idleTime, Clock::time_point now)
+{
+    std::size_t released = 0;
+    for (auto &slab : d_slabs) {
+        if (slab.d_inUse > 0 || !slab.d_resident ||
+            slab.d_emptySince + idleTime > now) {
+            continue;
+        }
+
+        // The pages read back as zero once touched again, so the free list
+        // kept inside them is discarded and buffers are carved afresh
+        ::madvise(slab.d_memory, d_slabSize, MADV_DONTNEED);
+        slab.d_freeList = nullptr;
+        slab.d_carved   = 0;
+        slab.d_resident = false;
+        released += d_slabSize;
+    }
+
+    return released;
+}
+
+std::size_t SlabArena::residentSlabs() const
+{
+    return std::count_if(d_slabs.begin(), d_slabs.end(), [](const Slab &slab) {
+        return slab.d_resident;
+    });
+}
+
+std::size_t SlabArena::releasedBytes() const
+{
+    return (d_slabs.size() - residentSlabs()) * d_slabSize;
+}
+
+bool SlabArena::addSlab()
+{
+    char *memory = mapAligned(d_slabSize);
+    if (!memory) {
+        return false;
+    }
+
+    d_slabIndex[memory] = d_slabs.size();
+    d_available.insert(d_slabs.size());
+    d_slabs.emplace_back(memory);
+    return true;
+}
+
+}
+}
@@ -0,0 +1,147 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_SLABARENA
+#define BLOOMBERG_AMQPPROX_SLABARENA
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <set>
+#include <unordered_map>
+#include <vector>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Arena of fixed size buffers carved out of large slabs
+ *
+ * Slabs are mapped directly from the OS, aligned to their size and, on Linux,
+ * advised to be backed by transparent hugepages to reduce TLB pressure.
+ * Buffers are carved from a slab only as they are first needed, so the untouched
+ * remainder of a slab costs no memory. Allocations come from the lowest
+ * numbered slab with free buffers, which packs buffers into the fewest slabs
+ * and lets the others empty out after a spike. `trim` hands the memory of
+ * slabs that have been empty for long enough back to the OS while keeping
+ * their address range mapped for reuse.
+ *
+ * This class is not thread safe.
+ */
+class SlabArena {
+  public:
+    // TYPES
+    using Clock = std::chrono::steady_clock;
+
+    // CONSTANTS
+    static constexpr std::size_t SLAB_SIZE = 2 * 1024 * 1024;
+
+  private:
+    struct Slab {
+        char             *d_memory;
+        void             *d_freeList;
+        std::size_t       d_carved;
+        std::size_t       d_inUse;
+        bool              d_resident;
+        Clock::time_point d_emptySince;
+
+        explicit Slab(char *memory);
+    };
+
+    std::size_t                             d_bufferSize;
+    std::size_t                             d_stride;
+    std::size_t                             d_slabSize;
+    std::size_t                             d_buffersPerSlab;
+    std::vector<Slab>                       d_slabs;
+    std::set<std::size_t>                   d_available;
+    std::unordered_map<char *, std::size_t> d_slabIndex;
+
+  public:
+    // CREATORS
+    /**
+     * \brief Construct an arena of buffers of `bufferSize` bytes. Slabs are
+     * `SLAB_SIZE`, or the next power of two that fits a buffer if larger.
+     */
+    explicit SlabArena(std::size_t bufferSize);
+
+    ~SlabArena();
+
+    SlabArena(const SlabArena &) = delete;
+    SlabArena &operator=(const SlabArena &) = delete;
+
+    // MANIPULATORS
+    /**
+     * \return a buffer of `bufferSize` bytes, or `nullptr` if a slab could
+     * not be mapped
+     */
+    void *allocate();
+
+    /**
+     * \brief Return the buffer `data`, previously given out by `allocate`
+     * \param now the time at which the buffer was returned
+     */
+    void deallocate(void *data, Clock::time_point now = Clock::now());
+
+    /**
+     * \brief Return the memory of slabs which have had no buffers in use
+     * since before `now - idleTime` to the OS
+     * \return the number of bytes returned
+     */
+    std::size_t trim(Clock::duration   idleTime,
+                     Clock::time_point now = Clock::now());
+
+    // ACCESSORS
+    /**
+     * \return the size of the buffers given out
+     */
+    std::size_t bufferSize() const;
+
+    /**
+     * \return the size of each slab
+     */
+    std::size_t slabSize() const;
+
+    /**
+     * \return the number of slabs whose memory is held by the process
+     */
+    std::size_t residentSlabs() const;
+
+    /**
+     * \return the number of bytes of slabs currently returned to the OS
+     */
+    std::size_t releasedBytes() const;
+
+  private:
+    /**
+     * \brief Map a new slab, adding it to the available slabs
+     * \return false if the slab could not be mapped
+     */
+    bool addSlab();
+};
+
+inline std::size_t SlabArena::bufferSize() const
+{
+    return d_bufferSize;
+}
+
+inline std::size_t SlabArena::slabSize() const
+{
+    return d_slabSize;
+}
+
+}
+}
+
+#endif
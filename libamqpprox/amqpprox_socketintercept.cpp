@@ -57,5 +57,10 @@ std::size_t SocketIntercept::available(boost::system::error_code &ec)
     return d_impl.available(ec);
 }
 
+bool SocketIntercept::canReadSpeculatively()
+{
+    return d_impl.canReadSpeculatively();
+}
+
 }
 }
@@ -120,6 +120,13 @@ class SocketIntercept {
      */
     std::size_t available(boost::system::error_code &ec);
 
+    /**
+     * \brief Return whether `read_some` may be called without first waiting
+     * for the socket to become readable
+     * \return true if reads may be attempted speculatively
+     */
+    bool canReadSpeculatively();
+
     /**
      * \brief Initiate a connection with the socket
      * \param peer_endpoint The endpoint to connect to
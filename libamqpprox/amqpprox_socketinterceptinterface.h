@@ -102,6 +102,17 @@ class SocketInterceptInterface {
      */
     virtual std::size_t available(boost::system::error_code &ec) = 0;
 
+    /**
+     * \brief Return whether `read_some` may be called without first waiting
+     * for the socket to become readable
+     *
+     * If so, `read_some` must set `would_block` when there is nothing to
+     * read, as a non-blocking socket does.
+     *
+     * \return true if reads may be attempted speculatively
+     */
+    virtual bool canReadSpeculatively() = 0;
+
     /**
      * \brief Initiate a connection with the socket
      * \param peer_endpoint The endpoint to connect to
@@ -0,0 +1,158 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#include <amqpprox_splicepipe.h>
+
+#include <boost/asio/error.hpp>
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+namespace {
+
+boost::system::error_code lastError()
+{
+    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+        return boost::asio::error::would_block;
+    }
+
+    return boost::system::error_code(errno, boost::system::system_category());
+}
+
+}
+
+SplicePipe::SplicePipe()
+: d_readFd(-1)
+, d_writeFd(-1)
+, d_pending(0)
+{
+}
+
+SplicePipe::~SplicePipe()
+{
+    close();
+}
+
+void SplicePipe::open(boost::system::error_code &ec)
+{
+    ec = boost::system::error_code();
+    if (isOpen()) {
+        return;
+    }
+
+#ifdef __linux__
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) != 0) {
+        ec = lastError();
+        return;
+    }
+
+    d_readFd  = fds[0];
+    d_writeFd = fds[1];
+    d_pending = 0;
+#else
+    ec = boost::asio::error::operation_not_supported;
+#endif
+}
+
+void SplicePipe::close()
+{
+    if (isOpen()) {
+        ::close(d_readFd);
+        ::close(d_writeFd);
+    }
+
+    d_readFd  = -1;
+    d_writeFd = -1;
+    d_pending = 0;
+}
+
+std::size_t
+SplicePipe::fill(int fd, std::size_t maxBytes, boost::system::error_code &ec)
+{
+    ec = boost::system::error_code();
+
+#ifdef __linux__
+    ssize_t moved = ::splice(fd,
+                             nullptr,
+                             d_writeFd,
+                             nullptr,
+                             maxBytes,
+                             SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (moved < 0) {
+        ec = lastError();
+        return 0;
+    }
+
+    if (moved == 0) {
+        ec = boost::asio::error::eof;
+        return 0;
+    }
+
+    d_pending += moved;
+    return moved;
+#else
+    (void)fd;
+    (void)maxBytes;
+    ec = boost::asio::error::operation_not_supported;
+    return 0;
+#endif
+}
+
+std::size_t SplicePipe::drain(int fd, boost::system::error_code &ec)
+{
+    ec = boost::system::error_code();
+
+#ifdef __linux__
+    std::size_t total = 0;
+    while (d_pending > 0) {
+        ssize_t moved = ::splice(d_readFd,
+                                 nullptr,
+                                 fd,
+                                 nullptr,
+                                 d_pending,
+                                 SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (moved < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            ec = lastError();
+            break;
+        }
+
+        d_pending -= moved;
+        total += moved;
+    }
+
+    return total;
+#else
+    (void)fd;
+    ec = boost::asio::error::operation_not_supported;
+    return 0;
+#endif
+}
+
+}
+}
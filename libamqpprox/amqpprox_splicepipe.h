@@ -0,0 +1,112 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#ifndef BLOOMBERG_AMQPPROX_SPLICEPIPE
+#define BLOOMBERG_AMQPPROX_SPLICEPIPE
+
+#include <boost/system/error_code.hpp>
+
+#include <cstddef>
+
+namespace Bloomberg {
+namespace amqpprox {
+
+/**
+ * \brief Moves bytes between two file descriptors through a kernel pipe
+ * using `splice`, without copying them into userspace.
+ *
+ * Data is moved in two steps: `fill` splices from a source socket into the
+ * pipe, and `drain` splices whatever the pipe holds into a destination
+ * socket. Both steps are non-blocking, so either may move fewer bytes than
+ * requested and report `would_block`, in which case the caller waits for
+ * readiness and tries again. The pipe is only available on Linux, elsewhere
+ * `open` fails with `operation_not_supported`.
+ */
+class SplicePipe {
+    int         d_readFd;
+    int         d_writeFd;
+    std::size_t d_pending;
+
+  public:
+    // CREATORS
+    SplicePipe();
+
+    ~SplicePipe();
+
+    SplicePipe(const SplicePipe &) = delete;
+    SplicePipe &operator=(const SplicePipe &) = delete;
+
+    // MANIPULATORS
+    /**
+     * \brief Create the underlying pipe, no-op if it is already open
+     * \param ec set if the pipe could not be created
+     */
+    void open(boost::system::error_code &ec);
+
+    /**
+     * \brief Close the underlying pipe, discarding any pending bytes
+     */
+    void close();
+
+    /**
+     * \brief Move up to `maxBytes` from the readable file descriptor `fd`
+     * into the pipe
+     * \param fd source file descriptor, typically a socket
+     * \param maxBytes the most bytes to move
+     * \param ec set to `would_block` if `fd` has no data or the pipe is
+     * full, to `eof` if `fd` has been shut down by the peer, or to the
+     * system error otherwise
+     * \return the number of bytes moved
+     */
+    std::size_t
+    fill(int fd, std::size_t maxBytes, boost::system::error_code &ec);
+
+    /**
+     * \brief Move the bytes held by the pipe into the writable file
+     * descriptor `fd`
+     * \param fd destination file descriptor, typically a socket
+     * \param ec set to `would_block` if `fd` cannot take all of the
+     * pending bytes, or to the system error otherwise
+     * \return the number of bytes moved
+     */
+    std::size_t drain(int fd, boost::system::error_code &ec);
+
+    // ACCESSORS
+    /**
+     * \return true if the pipe has been opened
+     */
+    bool isOpen() const;
+
+    /**
+     * \return the number of bytes held by the pipe which have not yet been
+     * drained
+     */
+    std::size_t pending() const;
+};
+
+inline bool SplicePipe::isOpen() const
+{
+    return d_readFd >= 0;
+}
+
+inline std::size_t SplicePipe::pending() const
+{
+    return d_pending;
+}
+
+}
+}
+
+#endif
@@ -15,21 +15,163 @@
 */
 #include <amqpprox_statcollector.h>
 
+#include <amqpprox_backendstore.h>
 #include <amqpprox_bufferpool.h>
 #include <amqpprox_cpumonitor.h>
 #include <amqpprox_sessionstate.h>
 
 #include <boost/lexical_cast.hpp>
 
+#include <algorithm>
+#include <chrono>
+
 namespace Bloomberg {
 namespace amqpprox {
 
+namespace {
+
+using Metric       = ConnectionStats::Metric;
+using Distribution = ConnectionStats::Distribution;
+
+/**
+ * \return what the session contributes to its aggregates: one for each
+ * lifecycle state it is in, and its totals since it started. Its latency
+ * histograms only hold the samples since it was last collected, so they are
+ * taken separately by `takeLatencies`.
+ */
+ConnectionStats sessionStats(const SessionState &session)
+{
+    using DiscoType = SessionState::DisconnectType;
+
+    uint64_t ingressPackets, ingressFrames, ingressBytes, ingressLatencyCount,
+        ingressLatencyTotal, egressPackets, egressFrames, egressBytes,
+        egressLatencyCount, egressLatencyTotal;
+
+    session.getTotals(&ingressPackets,
+                      &ingressFrames,
+                      &ingressBytes,
+                      &ingressLatencyTotal,
+                      &ingressLatencyCount,
+                      &egressPackets,
+                      &egressFrames,
+                      &egressBytes,
+                      &egressLatencyTotal,
+                      &egressLatencyCount);
+
+    ConnectionStats stats;
+    stats.statsValue(Metric::PACKETS_SENT)     = egressPackets;
+    stats.statsValue(Metric::PACKETS_RECEIVED) = ingressPackets;
+    stats.statsValue(Metric::BYTES_SENT)       = egressBytes;
+    stats.statsValue(Metric::BYTES_RECEIVED)   = ingressBytes;
+
+    // Count-only sessions stop counting frames once they're open, so they're
+    // counted separately and left out of the frame totals altogether
+    if (session.getCountOnly()) {
+        stats.statsValue(Metric::COUNT_ONLY_CONNECTION_COUNT) = 1;
+    }
+    else {
+        stats.statsValue(Metric::FRAMES_SENT)     = egressFrames;
+        stats.statsValue(Metric::FRAMES_RECEIVED) = ingressFrames;
+    }
+    stats.addDistributionStats(
+        Distribution::SEND_LATENCY, egressLatencyTotal, egressLatencyCount);
+    stats.addDistributionStats(Distribution::RECEIVE_LATENCY,
+                               ingressLatencyTotal,
+                               ingressLatencyCount);
+
+    auto discoStatus = session.getDisconnectType();
+    if (discoStatus == DiscoType::DISCONNECTED_CLIENT) {
+        stats.statsValue(Metric::REMOVED_CONNECTION_CLIENT_SNAPPED) = 1;
+    }
+    else if (discoStatus == DiscoType::DISCONNECTED_SERVER) {
+        stats.statsValue(Metric::REMOVED_CONNECTION_BROKER_SNAPPED) = 1;
+    }
+    else if (discoStatus == DiscoType::DISCONNECTED_CLEANLY ||
+             discoStatus == DiscoType::DISCONNECTED_PROXY) {
+        stats.statsValue(Metric::REMOVED_CONNECTION_GRACEFUL) = 1;
+    }
+    else {
+        stats.statsValue(Metric::ACTIVE_CONNECTION_COUNT) = 1;
+    }
+
+    // We count paused separately
+    if (session.getPaused()) {
+        stats.statsValue(Metric::PAUSED_CONNECTION_COUNT) = 1;
+    }
+
+    // Maintains total denied connections because of auth failure
+    if (session.getAuthDeniedConnection()) {
+        stats.statsValue(Metric::AUTH_DENIED_CONNECTION_COUNT) = 1;
+    }
+
+    // Maintains total limited connection count
+    if (session.getLimitedConnection()) {
+        stats.statsValue(Metric::LIMITED_CONNECTION_COUNT) = 1;
+    }
+
+    return stats;
+}
+
+/**
+ * \brief Move the latency samples the session recorded since it was last
+ * collected into the `stats`
+ */
+void takeLatencies(ConnectionStats *stats, SessionState &session)
+{
+    LatencyHistogram ingressLatency, egressLatency;
+    session.takeLatencyHistograms(&ingressLatency, &egressLatency);
+    stats->addHistogram(Distribution::SEND_LATENCY, egressLatency);
+    stats->addHistogram(Distribution::RECEIVE_LATENCY, ingressLatency);
+}
+
+/**
+ * \return only the connection counts of the `stats`, which unlike the totals
+ * stay with an aggregate for as long as the session is counted in it
+ */
+ConnectionStats connectionCounts(const ConnectionStats &stats)
+{
+    ConnectionStats counts;
+    for (std::size_t i = 0;
+         i < static_cast<std::size_t>(ConnectionStats::FIRST_SESSION_METRIC);
+         ++i) {
+        counts.statsValue(static_cast<Metric>(i)) =
+            stats.statsValue(static_cast<Metric>(i));
+    }
+    return counts;
+}
+
+// For backends we care about the broker's port to disambiguate the different
+// brokers running on a host.  Note that we are using '_' as the separator, as
+// ':' is not compatible with statsD.
+std::string backendName(const SessionState                   &session,
+                        const boost::asio::ip::tcp::endpoint &egress)
+{
+    return session.hostname(egress) + "_" +
+           boost::lexical_cast<std::string>(egress.port());
+}
+
+}
+
+StatCollector::TopSources::TopSources()
+: d_bytes(TOP_SOURCES)
+, d_connections(TOP_SOURCES)
+{
+}
+
 StatCollector::StatCollector()
 : d_current()
 , d_previous()
+, d_vhosts()
+, d_backends()
+, d_sources()
+, d_overall()
 , d_cpuMonitor_p(nullptr)
-, d_bufferPool_p(nullptr)
+, d_backendStore_p(nullptr)
+, d_bufferPools()
+, d_sessions()
+, d_topSources()
 , d_collectPerSourceStats(true)
+, d_collectTopSources(false)
 {
 }
 
@@ -38,6 +180,28 @@ void StatCollector::reset()
     d_previous.swap(d_current);
     StatSnapshot temp;
     d_current.swap(temp);
+
+    resetAxis(&d_vhosts);
+    resetAxis(&d_backends);
+    resetAxis(&d_sources);
+    d_overall.clearSessionMetrics();
+    d_topSources.clear();
+}
+
+void StatCollector::collectListener(int         port,
+                                    std::size_t shard,
+                                    uint64_t    acceptsTotal)
+{
+    StatSnapshot::ListenerStats stats;
+    stats.d_port    = port;
+    stats.d_shard   = shard;
+    stats.d_accepts = acceptsTotal;
+    d_current.listeners().push_back(stats);
+}
+
+void StatCollector::collectMemory(const StatSnapshot::MemoryStats &memoryStats)
+{
+    d_current.memory() = memoryStats;
 }
 
 void StatCollector::setCpuMonitor(CpuMonitor *monitor)
@@ -45,194 +209,141 @@ void StatCollector::setCpuMonitor(CpuMonitor *monitor)
     d_cpuMonitor_p = monitor;
 }
 
-void StatCollector::setBufferPool(BufferPool *pool)
+void StatCollector::setBackendStore(const BackendStore *store)
 {
-    d_bufferPool_p = pool;
+    d_backendStore_p = store;
 }
 
-void StatCollector::collect(const SessionState &session)
+void StatCollector::setBufferPool(BufferPool *pool)
 {
-    uint64_t ingressPackets, ingressFrames, ingressBytes, ingressLatencyCount,
-        ingressLatencyTotal, egressPackets, egressFrames, egressBytes,
-        egressLatencyCount, egressLatencyTotal;
+    d_bufferPools.clear();
+    addBufferPool(pool);
+}
 
-    session.getTotals(&ingressPackets,
-                      &ingressFrames,
-                      &ingressBytes,
-                      &ingressLatencyTotal,
-                      &ingressLatencyCount,
-                      &egressPackets,
-                      &egressFrames,
-                      &egressBytes,
-                      &egressLatencyTotal,
-                      &egressLatencyCount);
+void StatCollector::addBufferPool(BufferPool *pool)
+{
+    if (pool) {
+        d_bufferPools.push_back(pool);
+    }
+}
 
-    using DiscoType  = SessionState::DisconnectType;
-    auto discoStatus = session.getDisconnectType();
+void StatCollector::collect(SessionState &session)
+{
+    auto inserted = d_sessions.try_emplace(session.id());
+    auto &record  = inserted.first->second;
+    if (inserted.second) {
+        record.d_vhostId   = NO_AGGREGATE;
+        record.d_backendId = NO_AGGREGATE;
+        record.d_sourceId  = NO_AGGREGATE;
+    }
 
-    auto addStats = [&egressPackets,
-                     &ingressPackets,
-                     &egressFrames,
-                     &ingressFrames,
-                     &egressBytes,
-                     &ingressBytes,
-                     &egressLatencyTotal,
-                     &ingressLatencyTotal,
-                     &egressLatencyCount,
-                     &ingressLatencyCount,
-                     &session,
-                     &discoStatus](ConnectionStats &statsObject) {
-        statsObject.statsValue("packetsSent") += egressPackets;
-        statsObject.statsValue("packetsReceived") += ingressPackets;
-        statsObject.statsValue("framesSent") += egressFrames;
-        statsObject.statsValue("framesReceived") += ingressFrames;
-        statsObject.statsValue("bytesSent") += egressBytes;
-        statsObject.statsValue("bytesReceived") += ingressBytes;
-        statsObject.addDistributionStats(
-            "sendLatency", egressLatencyTotal, egressLatencyCount);
-        statsObject.addDistributionStats(
-            "receiveLatency", ingressLatencyTotal, ingressLatencyCount);
-
-        if (discoStatus == DiscoType::DISCONNECTED_CLIENT) {
-            statsObject.statsValue("removedConnectionClientSnapped") += 1;
-        }
-        else if (discoStatus == DiscoType::DISCONNECTED_SERVER) {
-            statsObject.statsValue("removedConnectionBrokerSnapped") += 1;
-        }
-        else if (discoStatus == DiscoType::DISCONNECTED_CLEANLY ||
-                 discoStatus == DiscoType::DISCONNECTED_PROXY) {
-            statsObject.statsValue("removedConnectionGraceful") += 1;
-        }
-        else {
-            statsObject.statsValue("activeConnectionCount") += 1;
-        }
+    ConnectionStats current = sessionStats(session);
+    ConnectionStats delta   = current;
+    delta.subtract(record.d_reported);
+    takeLatencies(&delta, session);
 
-        // We count paused separately
-        if (session.getPaused()) {
-            statsObject.statsValue("pausedConnectionCount") += 1;
-        }
+    // Only look up the aggregates again if what they're named from changed
+    const ConnectionStats counts = connectionCounts(record.d_reported);
 
-        // Maintains total denied connections because of auth failure
-        if (session.getAuthDeniedConnection()) {
-            statsObject.statsValue("authDeniedConnectionCount") += 1;
-        }
+    const std::string &vhost = session.getVirtualHost();
+    const bool         vhostChanged =
+        record.d_vhostId == NO_AGGREGATE || record.d_vhost != vhost;
+    if (vhostChanged) {
+        rebind(&d_vhosts, &record.d_vhostId, vhost, counts);
+        record.d_vhost = vhost;
+    }
 
-        // Maintains total limited connection count
-        if (session.getLimitedConnection()) {
-            statsObject.statsValue("limitedConnectionCount") += 1;
-        }
-    };
-
-    auto  vhost      = session.getVirtualHost();
-    auto &vhostStats = d_current.vhosts()[vhost];
-    addStats(vhostStats);
-
-    // For backends we care about the broker's port to disambiguate
-    // the different brokers running on a host.  Note that we are
-    // using '_' as the separator, as ':' is not compatible with
-    // statsD.
-    auto backend =
-        session.hostname(session.getEgress().second) + "_" +
-        boost::lexical_cast<std::string>(session.getEgress().second.port());
-    auto &backendStats = d_current.backends()[backend];
-    addStats(backendStats);
+    auto egress = session.getEgress().second;
+    if (record.d_backendId == NO_AGGREGATE || record.d_egress != egress) {
+        rebind(&d_backends,
+               &record.d_backendId,
+               backendName(session, egress),
+               counts);
+        record.d_egress = egress;
+    }
 
     if (d_collectPerSourceStats) {
         // For sources we only look at the machine, not the ephemeral port
-        auto source = session.hostname(session.getIngress().second);
+        auto ingress = session.getIngress().second;
+        if (record.d_sourceId == NO_AGGREGATE || record.d_ingress != ingress) {
+            rebind(&d_sources,
+                   &record.d_sourceId,
+                   session.hostname(ingress),
+                   counts);
+            record.d_ingress = ingress;
+        }
+    }
+    else if (record.d_sourceId != NO_AGGREGATE) {
+        unbind(&d_sources, &record.d_sourceId, counts);
+    }
 
-        auto &sourceStats = d_current.sources()[source];
-        addStats(sourceStats);
+    d_vhosts.d_aggregates[record.d_vhostId].d_stats.add(delta);
+    d_backends.d_aggregates[record.d_backendId].d_stats.add(delta);
+    if (record.d_sourceId != NO_AGGREGATE) {
+        d_sources.d_aggregates[record.d_sourceId].d_stats.add(delta);
+    }
+    d_overall.add(delta);
+
+    // Sessions are only tracked in the top sources once their vhost is known,
+    // counting as a connection when it is
+    if (d_collectTopSources && !vhost.empty()) {
+        auto &topSources = d_topSources[vhost];
+        if (vhostChanged || record.d_topSource.empty()) {
+            record.d_topSource =
+                session.hostname(session.getIngress().second);
+            topSources.d_connections.add(record.d_topSource, 1);
+        }
+
+        uint64_t bytes = delta.statsValue(Metric::BYTES_RECEIVED) +
+                         delta.statsValue(Metric::BYTES_SENT);
+        if (bytes > 0) {
+            topSources.d_bytes.add(record.d_topSource, bytes);
+        }
     }
 
-    addStats(d_current.overall());
+    record.d_reported = current;
 }
 
 void StatCollector::deletedSession(const SessionState &session)
 {
     // Implementation notes:
     //
-    // This method is required because the accumulated statistics are not kept
-    // per session in this component, and only accumulated across various axes.
-    // Each session object contains a counter of total bytes, packets and
-    // frames for each direction, because these are ever increasing totals,
-    // we latch the values and compare them in this class versus the last
-    // collected values. A-B-A type issues arise when the only session for one
-    // of the axes is deleted in one collection cycle, which must have its
-    // values counted, then it is reestablished in the subsequent cycle under a
-    // new session. This leaves a vhost/backend/source with a large count on
-    // the d_previous snapshot, and a small count on the d_current. These
-    // cannot be compared, so instead before resetting the accumulation
-    // interval, but after retrieving any statistics, we remove the
-    // accumulation totals for all the deleted sessions again in this method.
-
-    auto vhost = session.getVirtualHost();
-
-    // For backends we care about the broker's port to disambiguate
-    // the different brokers running on a host.  Note that we are
-    // using '_' as the separator, as ':' is not compatible with
-    // statsD.
-    auto backend =
-        session.hostname(session.getEgress().second) + "_" +
-        boost::lexical_cast<std::string>(session.getEgress().second.port());
-
-    // For sources we only look at the machine, not the ephemeral port
-    auto source = session.hostname(session.getIngress().second);
-
-    auto &vhostStats   = d_current.vhosts()[vhost];
-    auto &backendStats = d_current.backends()[backend];
-    auto &sourceStats  = d_current.sources()[source];
+    // The aggregates only keep the connection counts of the sessions counted
+    // in them between intervals, the totals are reset each interval. So once
+    // a session is deleted, after its statistics for the interval have been
+    // retrieved, only its connection counts need to be removed again.
+
+    auto it = d_sessions.find(session.id());
+    if (it == d_sessions.end()) {
+        return;
+    }
 
-    uint64_t ingressPackets, ingressFrames, ingressBytes, ingressLatencyCount,
-        ingressLatencyTotal, egressPackets, egressFrames, egressBytes,
-        egressLatencyCount, egressLatencyTotal;
+    auto                 &record = it->second;
+    const ConnectionStats counts = connectionCounts(record.d_reported);
 
-    session.getTotals(&ingressPackets,
-                      &ingressFrames,
-                      &ingressBytes,
-                      &ingressLatencyTotal,
-                      &ingressLatencyCount,
-                      &egressPackets,
-                      &egressFrames,
-                      &egressBytes,
-                      &egressLatencyTotal,
-                      &egressLatencyCount);
+    unbind(&d_vhosts, &record.d_vhostId, counts);
+    unbind(&d_backends, &record.d_backendId, counts);
+    if (record.d_sourceId != NO_AGGREGATE) {
+        unbind(&d_sources, &record.d_sourceId, counts);
+    }
+    d_overall.subtract(counts);
 
-    auto remStats = [&egressPackets,
-                     &ingressPackets,
-                     &egressFrames,
-                     &ingressFrames,
-                     &egressBytes,
-                     &ingressBytes,
-                     &egressLatencyTotal,
-                     &ingressLatencyTotal,
-                     &egressLatencyCount,
-                     &ingressLatencyCount](ConnectionStats &statsObject) {
-        statsObject.statsValue("packetsSent") -= egressPackets;
-        statsObject.statsValue("packetsReceived") -= ingressPackets;
-        statsObject.statsValue("framesSent") -= egressFrames;
-        statsObject.statsValue("framesReceived") -= ingressFrames;
-        statsObject.statsValue("bytesSent") -= egressBytes;
-        statsObject.statsValue("bytesReceived") -= ingressBytes;
-        statsObject.addDistributionStats(
-            "sendLatency", -egressLatencyTotal, -egressLatencyCount);
-        statsObject.addDistributionStats(
-            "receiveLatency", -ingressLatencyTotal, -ingressLatencyCount);
-    };
-
-    remStats(vhostStats);
-    remStats(backendStats);
-    remStats(sourceStats);
-    remStats(d_current.overall());
+    d_sessions.erase(it);
 }
 
 void StatCollector::populateStats(StatSnapshot *snap)
 {
-    populateMap(&snap->sources(), d_current.sources(), d_previous.sources());
-    populateMap(&snap->vhosts(), d_current.vhosts(), d_previous.vhosts());
-    populateMap(
-        &snap->backends(), d_current.backends(), d_previous.backends());
-    populateProgramStats(&snap->overall());
+    if (d_collectPerSourceStats) {
+        populateMap(&snap->sources(), d_sources);
+    }
+    populateMap(&snap->vhosts(), d_vhosts);
+    populateMap(&snap->backends(), d_backends);
+    snap->overall() = d_overall;
+
+    if (d_collectTopSources) {
+        populateTopSources(&snap->topSourcesByBytes(), true);
+        populateTopSources(&snap->topSourcesByConnections(), false);
+    }
 
     if (d_cpuMonitor_p && d_cpuMonitor_p->valid()) {
         auto &pstats     = snap->process();
@@ -244,75 +355,215 @@ void StatCollector::populateStats(StatSnapshot *snap)
             (std::get<0>(cpustats) + std::get<1>(cpustats)) * 100.0);
     }
 
-    if (d_bufferPool_p) {
+    for (const auto &current : d_current.listeners()) {
+        auto previous = std::find_if(
+            d_previous.listeners().begin(),
+            d_previous.listeners().end(),
+            [&current](const StatSnapshot::ListenerStats &candidate) {
+                return candidate.d_port == current.d_port &&
+                       candidate.d_shard == current.d_shard;
+            });
+
+        StatSnapshot::ListenerStats outputStats = current;
+        // A lower total means the port was closed and reopened since the
+        // previous interval, so everything was accepted in this one.
+        if (previous != d_previous.listeners().end() &&
+            previous->d_accepts <= current.d_accepts) {
+            outputStats.d_accepts -= previous->d_accepts;
+        }
+        snap->listeners().push_back(outputStats);
+    }
+
+    if (d_backendStore_p) {
+        auto now = std::chrono::steady_clock::now();
+        for (const Backend &backend : d_backendStore_p->backends()) {
+            const BackendHealth             &health = *backend.health();
+            StatSnapshot::BackendHealthStats healthStats;
+            healthStats.d_backend             = backend.name();
+            healthStats.d_healthy             = health.isHealthy();
+            healthStats.d_consecutiveFailures = health.consecutiveFailures();
+            healthStats.d_ejected             = health.isEjected(now);
+            snap->backendHealth().push_back(healthStats);
+        }
+        std::sort(snap->backendHealth().begin(),
+                  snap->backendHealth().end(),
+                  [](const StatSnapshot::BackendHealthStats &lhs,
+                     const StatSnapshot::BackendHealthStats &rhs) {
+                      return lhs.d_backend < rhs.d_backend;
+                  });
+    }
+
+    snap->memory() = d_current.memory();
+    // Lower totals mean the budget was replaced since the previous interval
+    if (d_previous.memory().d_pauses <= snap->memory().d_pauses &&
+        d_previous.memory().d_resumes <= snap->memory().d_resumes) {
+        snap->memory().d_pauses -= d_previous.memory().d_pauses;
+        snap->memory().d_resumes -= d_previous.memory().d_resumes;
+    }
+
+    for (BufferPool *bufferPool : d_bufferPools) {
         std::vector<BufferPool::BufferAllocationStat> poolstats;
         uint64_t                                      poolSpillover;
-        d_bufferPool_p->getPoolStatistics(&poolstats, &poolSpillover);
+        bufferPool->getPoolStatistics(&poolstats, &poolSpillover);
 
-        snap->poolSpillover() = poolSpillover;
+        snap->poolSpillover() += poolSpillover;
         for (const auto &ps : poolstats) {
-            StatSnapshot::PoolStats outputStats;
-            outputStats.d_bufferSize        = std::get<0>(ps);
-            outputStats.d_currentAllocation = std::get<1>(ps);
-            outputStats.d_highwaterMark     = std::get<2>(ps);
-            snap->pool().push_back(outputStats);
+            auto it = std::find_if(
+                snap->pool().begin(),
+                snap->pool().end(),
+                [&ps](const StatSnapshot::PoolStats &existing) {
+                    return existing.d_bufferSize == std::get<0>(ps);
+                });
+
+            if (it == snap->pool().end()) {
+                StatSnapshot::PoolStats outputStats;
+                outputStats.d_bufferSize        = std::get<0>(ps);
+                outputStats.d_currentAllocation = std::get<1>(ps);
+                outputStats.d_highwaterMark     = std::get<2>(ps);
+                snap->pool().push_back(outputStats);
+            }
+            else {
+                it->d_currentAllocation += std::get<1>(ps);
+                it->d_highwaterMark += std::get<2>(ps);
+            }
+        }
+
+        std::vector<BufferPool::SlabStat> slabstats;
+        bufferPool->getSlabStatistics(&slabstats);
+        for (const auto &ss : slabstats) {
+            auto it = std::find_if(
+                snap->pool().begin(),
+                snap->pool().end(),
+                [&ss](const StatSnapshot::PoolStats &existing) {
+                    return existing.d_bufferSize == std::get<0>(ss);
+                });
+
+            if (it != snap->pool().end()) {
+                it->d_slabs += std::get<1>(ss);
+                it->d_slabBytesReleased += std::get<2>(ss);
+            }
         }
     }
 }
 
-void StatCollector::populateProgramStats(ConnectionStats *programStats) const
+void StatCollector::rebind(Axis                  *axis,
+                           uint32_t              *id,
+                           const std::string     &name,
+                           const ConnectionStats &counts)
 {
-    ConnectionStats val;
-    val             = d_current.overall();
-    auto &prevStats = d_previous.overall();
-
-    for (auto &name : ConnectionStats::sessionMetrics()) {
-        val.statsValue(name) -= prevStats.statsValue(name);
+    if (*id != NO_AGGREGATE) {
+        unbind(axis, id, counts);
     }
 
-    for (auto &name : ConnectionStats::distributionMetrics()) {
-        const auto &prevDistribution = prevStats.distributionPair(name);
-        val.addDistributionStats(
-            name, -prevDistribution.first, -prevDistribution.second);
+    auto inserted = axis->d_ids.try_emplace(name, NO_AGGREGATE);
+    if (inserted.second) {
+        if (axis->d_free.empty()) {
+            inserted.first->second = axis->d_aggregates.size();
+            axis->d_aggregates.emplace_back();
+        }
+        else {
+            inserted.first->second = axis->d_free.back();
+            axis->d_free.pop_back();
+        }
+
+        auto &aggregate      = axis->d_aggregates[inserted.first->second];
+        aggregate.d_name     = name;
+        aggregate.d_stats    = ConnectionStats();
+        aggregate.d_sessions = 0;
+        aggregate.d_inUse    = true;
     }
 
-    *programStats = val;
+    *id             = inserted.first->second;
+    auto &aggregate = axis->d_aggregates[*id];
+    aggregate.d_stats.add(counts);
+    ++aggregate.d_sessions;
 }
 
-void StatCollector::populateMap(StatSnapshot::StatsMap       *map,
-                                const StatSnapshot::StatsMap &source,
-                                const StatSnapshot::StatsMap &previous) const
+void StatCollector::unbind(Axis                  *axis,
+                           uint32_t              *id,
+                           const ConnectionStats &counts)
 {
-    StatSnapshot::StatsMap output(source);
-    ConnectionStats        zeroStats;
-
-    for (auto &k : output) {
-        const ConnectionStats *prevValue = &zeroStats;
+    auto &aggregate = axis->d_aggregates[*id];
+    aggregate.d_stats.subtract(counts);
+    --aggregate.d_sessions;
+    *id = NO_AGGREGATE;
+}
 
-        auto it = previous.find(k.first);
-        if (it != previous.end()) {
-            prevValue = &it->second;
+void StatCollector::resetAxis(Axis *axis)
+{
+    for (uint32_t id = 0; id < axis->d_aggregates.size(); ++id) {
+        auto &aggregate = axis->d_aggregates[id];
+        if (!aggregate.d_inUse) {
+            continue;
         }
 
-        auto &val = k.second;
-        for (auto &name : ConnectionStats::sessionMetrics()) {
-            val.statsValue(name) -= prevValue->statsValue(name);
+        if (aggregate.d_sessions == 0) {
+            axis->d_ids.erase(aggregate.d_name);
+            axis->d_free.push_back(id);
+            aggregate.d_inUse = false;
+            aggregate.d_name.clear();
         }
+        else {
+            aggregate.d_stats.clearSessionMetrics();
+        }
+    }
+}
 
-        for (auto &name : ConnectionStats::distributionMetrics()) {
-            const auto &prevDistribution = prevValue->distributionPair(name);
-            val.addDistributionStats(
-                name, -prevDistribution.first, -prevDistribution.second);
+void StatCollector::populateMap(StatSnapshot::StatsMap *map, const Axis &axis)
+{
+    StatSnapshot::StatsMap output;
+    for (const auto &aggregate : axis.d_aggregates) {
+        if (aggregate.d_inUse) {
+            output.emplace(aggregate.d_name, aggregate.d_stats);
         }
     }
 
     map->swap(output);
 }
 
+void StatCollector::populateTopSources(
+    std::vector<StatSnapshot::TopSourceStats> *output,
+    bool                                       byBytes) const
+{
+    std::vector<const std::string *> vhosts;
+    vhosts.reserve(d_topSources.size());
+    for (const auto &topSources : d_topSources) {
+        vhosts.push_back(&topSources.first);
+    }
+    std::sort(vhosts.begin(),
+              vhosts.end(),
+              [](const std::string *lhs, const std::string *rhs) {
+                  return *lhs < *rhs;
+              });
+
+    output->clear();
+    std::vector<HeavyHitters::Entry> entries;
+    for (const std::string *vhost : vhosts) {
+        const auto &topSources = d_topSources.at(*vhost);
+        (byBytes ? topSources.d_bytes : topSources.d_connections)
+            .top(&entries);
+
+        for (const auto &entry : entries) {
+            StatSnapshot::TopSourceStats stats;
+            stats.d_vhost       = *vhost;
+            stats.d_source      = entry.d_key;
+            stats.d_bytes       = topSources.d_bytes.estimate(entry.d_key);
+            stats.d_connections = topSources.d_connections.estimate(
+                entry.d_key);
+            output->push_back(std::move(stats));
+        }
+    }
+}
+
 void StatCollector::collectPerSourceStats(bool enabled)
 {
     d_collectPerSourceStats = enabled;
 }
 
+void StatCollector::collectTopSources(bool enabled)
+{
+    d_collectTopSources = enabled;
+}
+
 }
 }
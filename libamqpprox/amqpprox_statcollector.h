@@ -17,16 +17,22 @@
 #define BLOOMBERG_AMQPPROX_STATCOLLECTOR
 
 #include <amqpprox_connectionstats.h>
+#include <amqpprox_heavyhitters.h>
 #include <amqpprox_statsnapshot.h>
 
+#include <boost/asio/ip/tcp.hpp>
+
 #include <atomic>
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <vector>
 
 namespace Bloomberg {
 namespace amqpprox {
 
+class BackendStore;
 class BufferPool;
 class CpuMonitor;
 class SessionState;
@@ -35,26 +41,103 @@ class SessionState;
  * \brief Collect statistics from Sessions for a time periodicity.
  *
  * This accumulates statistics along a number of axes such as vhost, backend
- * and source. It is designed to accumulate between those points until reset,
- * upon which time some previous values are latched and the returned values are
- * based upon the difference from the previous values with respect to each
- * axis.
+ * and source. Each vhost, backend and source has an aggregate which lives as
+ * long as sessions are counted in it, holding the number of those sessions in
+ * each lifecycle state and the totals accumulated by them during the current
+ * collection interval.
+ *
+ * Collecting a session adds whatever changed since it was last collected to
+ * the aggregates it was last counted in, so a session only needs to be
+ * collected again once it has changed, and each collection costs the same
+ * however long the session has existed. The aggregates a session is counted
+ * in are only looked up again when its vhost or endpoints change.
+ *
+ * As an alternative to the exact per-source statistics, which need an
+ * aggregate for every client host, the sources with the most bytes or new
+ * connections in each vhost can be tracked approximately at a constant cost
+ * per vhost, see `HeavyHitters`. Each vhost has its own trackers so that a
+ * busy vhost can't crowd the others out of the lists.
  *
  * The basic workflow for dealing with this class is:
- *  1. Call `collect` with each session you want accumulated
+ *  1. Call `collect` with each session that has changed, see
+ *     `ChangedSessions`
  *  2. Call populateStats to retrieve the current statistics
  *  3. For any sessions that are no longer going to be involved in the
  *     statistics collection we call `deletedSession`
  *  4. Call `reset` to start a new collection interval
  */
 class StatCollector {
+  public:
+    // CONSTANTS
+    /**
+     * \brief The number of sources reported for each vhost by each top
+     * sources list
+     */
+    static constexpr std::size_t TOP_SOURCES = 10;
+
   private:
-    StatSnapshot d_current;
-    StatSnapshot d_previous;
-    CpuMonitor  *d_cpuMonitor_p;  // HELD NOT OWNED
-    BufferPool  *d_bufferPool_p;  // HELD NOT OWNED
+    static constexpr uint32_t NO_AGGREGATE = UINT32_MAX;
+
+    /**
+     * \brief The statistics of one vhost, backend or source
+     */
+    struct Aggregate {
+        std::string     d_name;
+        ConnectionStats d_stats;
+        std::size_t     d_sessions;
+        bool            d_inUse;
+    };
+
+    /**
+     * \brief The aggregates of one axis, indexed by an interned id that is
+     * reused once its aggregate is no longer in use
+     */
+    struct Axis {
+        std::vector<Aggregate>                    d_aggregates;
+        std::unordered_map<std::string, uint32_t> d_ids;
+        std::vector<uint32_t>                     d_free;
+    };
+
+    /**
+     * \brief The sources of one vhost with the most bytes and connections
+     */
+    struct TopSources {
+        HeavyHitters d_bytes;
+        HeavyHitters d_connections;
+
+        TopSources();
+    };
+
+    /**
+     * \brief What was last collected from a session, what its aggregates
+     * were looked up from, and their ids. Only the counts and totals are
+     * kept, the latency samples are passed straight on to the aggregates.
+     */
+    struct SessionRecord {
+        std::string                    d_vhost;
+        boost::asio::ip::tcp::endpoint d_ingress;
+        boost::asio::ip::tcp::endpoint d_egress;
+        uint32_t                       d_vhostId;
+        uint32_t                       d_backendId;
+        uint32_t                       d_sourceId;
+        std::string                    d_topSource;
+        ConnectionStats                d_reported;
+    };
+
+    StatSnapshot              d_current;
+    StatSnapshot              d_previous;
+    Axis                      d_vhosts;
+    Axis                      d_backends;
+    Axis                      d_sources;
+    ConnectionStats           d_overall;
+    CpuMonitor               *d_cpuMonitor_p;    // HELD NOT OWNED
+    const BackendStore       *d_backendStore_p;  // HELD NOT OWNED
+    std::vector<BufferPool *> d_bufferPools;     // HELD NOT OWNED
+    std::unordered_map<uint64_t, SessionRecord> d_sessions;
+    std::unordered_map<std::string, TopSources> d_topSources;  // by vhost
 
     std::atomic<bool> d_collectPerSourceStats;
+    std::atomic<bool> d_collectTopSources;
 
   public:
     // CREATORS
@@ -68,19 +151,42 @@ class StatCollector {
     void reset();
 
     /**
-     * \brief Collect and accumulate statistics from the given `session`
+     * \brief Collect and accumulate the statistics of the given `session`
+     * that changed since it was last collected
      * \param session `SessionState` object, contains a counter of total bytes,
-     * packets and frames for each direction
+     * packets and frames for each direction. The latencies it counted since
+     * it was last collected are taken from it.
      */
-    void collect(const SessionState &session);
+    void collect(SessionState &session);
 
     /**
-     * \brief Delete the accumulated metrics for deleted specified session
+     * \brief Stop counting the specified session, which will not be collected
+     * again, in its aggregates
      * \param session `SessionState` object, whose accumulated metrics will be
      * removed from maintined collection
      */
     void deletedSession(const SessionState &session);
 
+    /**
+     * \brief Collect the total number of connections accepted so far by a
+     * listening socket. The number accepted during the collection interval is
+     * derived from the difference to the previous interval's total.
+     * \param port the listening port
+     * \param shard the index of the acceptor within the port
+     * \param acceptsTotal number of connections accepted since the acceptor
+     * was opened
+     */
+    void collectListener(int port, std::size_t shard, uint64_t acceptsTotal);
+
+    /**
+     * \brief Collect the state of the buffer memory budget. The number of
+     * pauses and resumes during the collection interval are derived from the
+     * difference to the previous interval's totals.
+     * \param memoryStats the budget's current usage, watermarks and number of
+     * paused sessions, with the total pauses and resumes so far
+     */
+    void collectMemory(const StatSnapshot::MemoryStats &memoryStats);
+
     /**
      * \brief Set the CPU monitor to extract CPU usage statistics from
      * \param monitor pointer to `CpuMonitor`
@@ -88,16 +194,37 @@ class StatCollector {
     void setCpuMonitor(CpuMonitor *monitor);
 
     /**
-     * \brief Set the buffer pool to extract statistics from
+     * \brief Set the store of backends to report the health of, which is
+     * only worth doing when they are actively checked
+     * \param store pointer to `BackendStore`, or null to report none
+     */
+    void setBackendStore(const BackendStore *store);
+
+    /**
+     * \brief Set the buffer pool to extract statistics from, replacing any
+     * previously set or added pools
      * \param pool pointer to `BuffrePool`
      */
     void setBufferPool(BufferPool *pool);
 
+    /**
+     * \brief Add a further buffer pool to extract statistics from. The
+     * statistics of all pools are summed per buffer size.
+     * \param pool pointer to `BufferPool`
+     */
+    void addBufferPool(BufferPool *pool);
+
     /**
      * \brief Enable/Disable per-source statistics
      */
     void collectPerSourceStats(bool enabled);
 
+    /**
+     * \brief Enable/Disable tracking the top sources by vhost, which is
+     * disabled by default
+     */
+    void collectTopSources(bool enabled);
+
     // ACCESSORS
     /**
      * \brief Retrieve the statistics as a `snapshot` that have been
@@ -107,11 +234,41 @@ class StatCollector {
     void populateStats(StatSnapshot *snapshot);
 
   private:
-    void populateProgramStats(ConnectionStats *programStats) const;
+    /**
+     * \brief Move a session's connection counts to the aggregate for `name`
+     * \param axis the axis of the aggregates
+     * \param id the session's aggregate id, or `NO_AGGREGATE`, updated
+     * \param name the name of the aggregate the session is now counted in
+     * \param counts the session's connection counts
+     */
+    void rebind(Axis                  *axis,
+                uint32_t              *id,
+                const std::string     &name,
+                const ConnectionStats &counts);
+
+    /**
+     * \brief Stop counting a session in an aggregate
+     * \param axis the axis of the aggregate
+     * \param id the aggregate's id, set to `NO_AGGREGATE`
+     * \param counts the session's connection counts
+     */
+    void unbind(Axis *axis, uint32_t *id, const ConnectionStats &counts);
+
+    /**
+     * \brief Start a new collection interval for each aggregate, releasing
+     * those no session is counted in any more
+     */
+    static void resetAxis(Axis *axis);
+
+    /**
+     * \brief Retrieve the top sources of each vhost, in vhost order, with
+     * the estimates of both their bytes and connections
+     * \param byBytes whether to rank by bytes rather than connections
+     */
+    void populateTopSources(std::vector<StatSnapshot::TopSourceStats> *output,
+                            bool byBytes) const;
 
-    void populateMap(StatSnapshot::StatsMap       *map,
-                     const StatSnapshot::StatsMap &source,
-                     const StatSnapshot::StatsMap &previous) const;
+    static void populateMap(StatSnapshot::StatsMap *map, const Axis &axis);
 };
 
 }
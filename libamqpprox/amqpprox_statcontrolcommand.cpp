@@ -23,6 +23,8 @@
 #include <amqpprox_statsdpublisher.h>
 #include <amqpprox_statsnapshot.h>
 
+#include <algorithm>
+#include <cctype>
 #include <sstream>
 
 #include <boost/algorithm/string.hpp>
@@ -73,6 +75,20 @@ void formatOutput(std::ostream       &oss,
         formatter.format(
             oss, statSnapshot.pool(), statSnapshot.poolSpillover());
     }
+    else if (filterType == "LISTENERS") {
+        formatter.format(oss, statSnapshot.listeners());
+    }
+    else if (filterType == "MEMORY") {
+        formatter.format(oss, statSnapshot.memory());
+    }
+    else if (filterType == "BACKEND-HEALTH") {
+        formatter.format(oss, statSnapshot.backendHealth());
+    }
+    else if (filterType == "TOP-SOURCES") {
+        formatter.format(oss,
+                         statSnapshot.topSourcesByBytes(),
+                         statSnapshot.topSourcesByConnections());
+    }
     else if (mapForFilter(&map, filterType, statSnapshot)) {
         auto it = map.find(filterValue);
         if (it != std::end(map)) {
@@ -174,13 +190,16 @@ std::string StatControlCommand::commandVerb() const
 
 std::string StatControlCommand::helpText() const
 {
-    return "(STOP SEND | SEND <host> <port> | (LISTEN (json|human) "
+    return "(STOP SEND | SEND <host> <port> [<max datagram bytes>] | "
+           "(LISTEN (json|human) "
            "(overall|vhost=foo|backend=bar|source=baz|all|all-except-per-"
-           "source|process|bufferpool))"
+           "source|process|bufferpool|listeners|memory|backend-health|"
+           "top-sources))"
            " - "
            "Output statistics\n"
-           "STAT (DISABLE|ENABLE) per-source - Enable/Disable internal "
-           "collection of per-source statistics. Applies to all "
+           "STAT (DISABLE|ENABLE) (per-source|top-sources) - Enable/Disable "
+           "internal collection of per-source statistics, or approximate "
+           "tracking of the top sources by vhost. Applies to all "
            "send/listeners";
 }
 
@@ -199,6 +218,7 @@ void StatControlCommand::handleCommand(const std::string   &command,
     std::string outputType;
     std::string outputHost;
     int         outputPort;
+    std::size_t maxDatagramSize = StatsDPublisher::DEFAULT_MAX_DATAGRAM_SIZE;
     if (subcommand == "LISTEN") {
         if (iss >> outputType) {
             boost::to_upper(outputType);
@@ -222,6 +242,22 @@ void StatControlCommand::handleCommand(const std::string   &command,
             outputFunctor("No output port specified.\n", true);
             return;
         }
+
+        // Optionally followed by the datagram size, otherwise a filter
+        auto        position = iss.tellg();
+        std::string sizeTerm;
+        if (iss >> sizeTerm && !sizeTerm.empty() &&
+            std::all_of(sizeTerm.begin(), sizeTerm.end(), ::isdigit)) {
+            maxDatagramSize = std::stoul(sizeTerm);
+            if (maxDatagramSize == 0) {
+                outputFunctor("Datagram size must be positive.\n", true);
+                return;
+            }
+        }
+        else {
+            iss.clear();
+            iss.seekg(position);
+        }
     }
     else if (subcommand == "STOP") {
         std::string type;
@@ -253,6 +289,11 @@ void StatControlCommand::handleCommand(const std::string   &command,
             outputFunctor(subcommand + " per-source applied.\n", true);
             return;
         }
+        else if (type == "TOP-SOURCES") {
+            d_statCollector_p->collectTopSources(subcommand == "ENABLE");
+            outputFunctor(subcommand + " top-sources applied.\n", true);
+            return;
+        }
         else {
             outputFunctor(
                 "Only LISTEN, SEND, STOP, ENABLE, and DISABLE subcommands are "
@@ -280,6 +321,10 @@ void StatControlCommand::handleCommand(const std::string   &command,
         if (uppercasedFilterTerm == "ALL" ||
             uppercasedFilterTerm == "OVERALL" ||
             uppercasedFilterTerm == "BUFFERPOOL" ||
+            uppercasedFilterTerm == "LISTENERS" ||
+            uppercasedFilterTerm == "MEMORY" ||
+            uppercasedFilterTerm == "BACKEND-HEALTH" ||
+            uppercasedFilterTerm == "TOP-SOURCES" ||
             uppercasedFilterTerm == "PROCESS") {
             filterType = uppercasedFilterTerm;
         }
@@ -324,8 +369,10 @@ void StatControlCommand::handleCommand(const std::string   &command,
         }
 
         std::shared_ptr<StatsDPublisher> publisher =
-            std::make_shared<StatsDPublisher>(
-                &controlHandle->ioContext(), outputHost, outputPort);
+            std::make_shared<StatsDPublisher>(&controlHandle->ioContext(),
+                                              outputHost,
+                                              outputPort,
+                                              maxDatagramSize);
         StatFunctor sf = [publisher](const StatSnapshot &statSnapshot) {
             publisher->publish(statSnapshot);
             return true;
@@ -82,6 +82,49 @@ class StatFormatter {
     virtual void format(std::ostream                               &os,
                         const std::vector<StatSnapshot::PoolStats> &poolStats,
                         uint64_t poolSpillover) = 0;
+
+    /**
+     * \brief output the `StatSnapshot::ListenerStats` into the output stream
+     * in the implemented format.
+     * \param os the output stream
+     * \param listenerStats const reference to the vector of
+     * `StatSnapshot::ListenerStats`
+     */
+    virtual void
+    format(std::ostream                                   &os,
+           const std::vector<StatSnapshot::ListenerStats> &listenerStats) = 0;
+
+    /**
+     * \brief output the `StatSnapshot::MemoryStats` into the output stream in
+     * the implemented format.
+     * \param os the output stream
+     * \param memoryStats const reference to the `StatSnapshot::MemoryStats`
+     */
+    virtual void format(std::ostream                    &os,
+                        const StatSnapshot::MemoryStats &memoryStats) = 0;
+
+    /**
+     * \brief output the `StatSnapshot::BackendHealthStats` into the output
+     * stream in the implemented format.
+     * \param os the output stream
+     * \param backendHealth const reference to the vector of
+     * `StatSnapshot::BackendHealthStats`
+     */
+    virtual void format(std::ostream &os,
+                        const std::vector<StatSnapshot::BackendHealthStats>
+                            &backendHealth) = 0;
+
+    /**
+     * \brief output the top sources by vhost into the output stream in
+     * the implemented format.
+     * \param os the output stream
+     * \param byBytes the top sources by bytes, highest first
+     * \param byConnections the top sources by new connections, highest first
+     */
+    virtual void
+    format(std::ostream                                    &os,
+           const std::vector<StatSnapshot::TopSourceStats> &byBytes,
+           const std::vector<StatSnapshot::TopSourceStats> &byConnections) = 0;
 };
 
 }
@@ -18,6 +18,9 @@
 #include <amqpprox_connectionstats.h>
 #include <amqpprox_logging.h>
 
+#include <array>
+#include <memory>
+
 namespace Bloomberg {
 namespace amqpprox {
 
@@ -25,101 +28,205 @@ namespace {
 
 enum class MetricType { GAUGE, COUNTER, DISTRIBUTION };
 
+const std::string NO_TAGS;
+
+/**
+ * \brief Format the metric into the `buffer`, replacing what was there
+ * \return the `buffer`
+ */
 template <typename T>
-std::string
-formatMetric(MetricType                                              type,
-             const std::string                                      &name,
-             T                                                       value,
-             const std::vector<std::pair<std::string, std::string>> &tags)
+const std::string &formatMetric(std::string       *buffer,
+                                MetricType         type,
+                                const std::string &name,
+                                T                  value,
+                                const std::string &tags)
 {
-    std::string metric = "amqpprox.";
-    metric += name;
-    for (const auto &tag : tags) {
-        metric += ",";
-        metric += tag.first;
-        metric += "=";
-        metric += tag.second;
-    }
-    metric += ":";
-    metric += std::to_string(value);
-    metric += "|";
+    buffer->assign("amqpprox.");
+    buffer->append(name);
+    buffer->append(tags);
+    buffer->push_back(':');
+    buffer->append(std::to_string(value));
+    buffer->push_back('|');
     if (type == MetricType::GAUGE) {
-        metric += "g";
+        buffer->push_back('g');
     }
     else if (type == MetricType::COUNTER) {
-        metric += "c";
+        buffer->push_back('c');
     }
     else if (type == MetricType::DISTRIBUTION) {
-        metric += "d";
+        buffer->push_back('d');
     }
 
-    return metric;
+    return *buffer;
+}
+
+/**
+ * \return the metric names of the published percentiles of the `metric`, in
+ * the order of `ConnectionStats::percentiles`
+ */
+const std::vector<std::string> &
+percentileNames(ConnectionStats::Distribution metric)
+{
+    using Names = std::array<std::vector<std::string>,
+                             ConnectionStats::NUM_DISTRIBUTIONS>;
+    static const Names names = [] {
+        Names result;
+        for (std::size_t i = 0; i < ConnectionStats::NUM_DISTRIBUTIONS; ++i) {
+            const std::string &name = ConnectionStats::distributionName(
+                static_cast<ConnectionStats::Distribution>(i));
+            for (const auto &percentile : ConnectionStats::percentiles()) {
+                result[i].push_back(name + "_" + percentile.first);
+            }
+        }
+        return result;
+    }();
+
+    return names[static_cast<std::size_t>(metric)];
+}
+
+std::string
+formatTags(const std::vector<std::pair<std::string, std::string>> &tags)
+{
+    std::string result;
+    for (const auto &tag : tags) {
+        result += ",";
+        result += tag.first;
+        result += "=";
+        result += tag.second;
+    }
+    return result;
 }
 
 }
 
+constexpr std::size_t StatsDPublisher::DEFAULT_MAX_DATAGRAM_SIZE;
+
 StatsDPublisher::StatsDPublisher(boost::asio::io_context *ioContext,
                                  const std::string       &host,
-                                 int                      port)
+                                 int                      port,
+                                 std::size_t              maxDatagramSize)
 : d_socket(*ioContext,
            boost::asio::ip::udp::endpoint(boost::asio::ip::udp::v4(), 0))
+, d_maxDatagramSize(maxDatagramSize)
+, d_datagram()
+, d_metric()
+, d_vhostTags()
+, d_sourceTags()
+, d_backendTags()
+, d_generation(0)
 {
     boost::asio::ip::udp::resolver        resolver(*ioContext);
     boost::asio::ip::udp::resolver::query query(
         boost::asio::ip::udp::v4(), host, std::to_string(port));
     d_statsdEndpoint = *resolver.resolve(query);
+
+    d_datagram.reserve(d_maxDatagramSize);
 }
 
 void StatsDPublisher::sendMetric(const std::string &metric)
 {
-    auto writeHandler = [metric](const boost::system::error_code &ec,
-                                 std::size_t bytesTransferred) {
+    if (!d_datagram.empty() &&
+        d_datagram.size() + 1 + metric.size() > d_maxDatagramSize) {
+        flush();
+    }
+
+    if (!d_datagram.empty()) {
+        d_datagram.push_back('\n');
+    }
+    d_datagram.append(metric);
+}
+
+void StatsDPublisher::flush()
+{
+    if (d_datagram.empty()) {
+        return;
+    }
+
+    // The datagram must outlive the send, the next one starts afresh
+    auto datagram = std::make_shared<std::string>();
+    datagram->reserve(d_maxDatagramSize);
+    datagram->swap(d_datagram);
+
+    auto writeHandler = [datagram](const boost::system::error_code &ec,
+                                   std::size_t) {
         if (ec) {
-            LOG_WARN << "Failed to send metric: " << metric
+            LOG_WARN << "Failed to send metrics: " << *datagram
                      << "error code: " << ec;
         }
     };
     d_socket.async_send_to(
-        boost::asio::buffer(metric), d_statsdEndpoint, writeHandler);
+        boost::asio::buffer(*datagram), d_statsdEndpoint, writeHandler);
 }
 
 void StatsDPublisher::publish(const ConnectionStats &stats,
                               const TagVector       &tags)
 {
-    static const std::vector<std::string> gaugeMetrics = {
-        "pausedConnectionCount",
-        "activeConnectionCount",
-        "authDeniedConnectionCount",
-        "limitedConnectionCount"};
-    for (auto &name : ConnectionStats::statsTypes()) {
-        MetricType type = MetricType::COUNTER;
+    publishStats(stats, formatTags(tags));
+}
+
+void StatsDPublisher::publishStats(const ConnectionStats &stats,
+                                   const std::string     &tags)
+{
+    using Metric       = ConnectionStats::Metric;
+    using Distribution = ConnectionStats::Distribution;
+
+    for (std::size_t i = 0; i < ConnectionStats::NUM_METRICS; ++i) {
+        Metric     metric = static_cast<Metric>(i);
+        MetricType type   = MetricType::COUNTER;
 
-        if (std::find(gaugeMetrics.begin(), gaugeMetrics.end(), name) !=
-            gaugeMetrics.end()) {
+        // The connection counts up to the count-only ones are gauges
+        if (metric <= Metric::COUNT_ONLY_CONNECTION_COUNT) {
             type = MetricType::GAUGE;
         }
-        sendMetric(formatMetric(type, name, stats.statsValue(name), tags));
+        sendMetric(formatMetric(&d_metric,
+                                type,
+                                ConnectionStats::metricName(metric),
+                                stats.statsValue(metric),
+                                tags));
     }
 
     MetricType type = MetricType::DISTRIBUTION;
-    for (auto &name : ConnectionStats::distributionMetrics()) {
-        if (stats.distributionCount(name) > 0) {
-            sendMetric(
-                formatMetric(type, name, stats.distributionValue(name), tags));
+    for (std::size_t i = 0; i < ConnectionStats::NUM_DISTRIBUTIONS; ++i) {
+        Distribution metric = static_cast<Distribution>(i);
+        if (stats.distributionCount(metric) == 0) {
+            continue;
+        }
+
+        const std::string &name = ConnectionStats::distributionName(metric);
+        sendMetric(formatMetric(
+            &d_metric, type, name, stats.distributionValue(metric), tags));
+
+        // The percentiles are of the interval's samples, so are gauges
+        const LatencyHistogram         &histogram = stats.histogram(metric);
+        const std::vector<std::string> &names     = percentileNames(metric);
+        const auto &percentiles = ConnectionStats::percentiles();
+        for (std::size_t i = 0; i < percentiles.size(); ++i) {
+            uint64_t value = histogram.percentile(percentiles[i].second);
+            sendMetric(formatMetric(
+                &d_metric, MetricType::GAUGE, names[i], value, tags));
         }
     }
 }
 
 void StatsDPublisher::publish(const StatSnapshot::ProcessStats &stats)
 {
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "cpu_percent_overall",
+                            stats.d_overall,
+                            NO_TAGS));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "cpu_percent_user",
+                            stats.d_user,
+                            NO_TAGS));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "cpu_percent_system",
+                            stats.d_system,
+                            NO_TAGS));
     sendMetric(formatMetric(
-        MetricType::COUNTER, "cpu_percent_overall", stats.d_overall, {}));
-    sendMetric(formatMetric(
-        MetricType::COUNTER, "cpu_percent_user", stats.d_user, {}));
-    sendMetric(formatMetric(
-        MetricType::COUNTER, "cpu_percent_system", stats.d_system, {}));
-    sendMetric(
-        formatMetric(MetricType::COUNTER, "mem_rss_kb", stats.d_rssKB, {}));
+        &d_metric, MetricType::COUNTER, "mem_rss_kb", stats.d_rssKB, NO_TAGS));
 }
 
 void StatsDPublisher::publishVhost(const StatSnapshot::StatsMap &stats)
@@ -128,8 +235,12 @@ void StatsDPublisher::publishVhost(const StatSnapshot::StatsMap &stats)
         if (vhost.first == "") {
             continue;
         }
-        publish(vhost.second,
-                {{"rmqEndpointType", "vhost"}, {"rmqVhostName", vhost.first}});
+        publishStats(vhost.second,
+                     cachedTags(&d_vhostTags,
+                                vhost.first,
+                                "rmqEndpointType",
+                                "rmqVhostName",
+                                "vhost"));
     }
 }
 
@@ -137,19 +248,95 @@ void StatsDPublisher::publish(
     const std::vector<StatSnapshot::PoolStats> &poolStats,
     uint64_t                                    poolSpillover)
 {
-    sendMetric(formatMetric(
-        MetricType::COUNTER, "spill_to_heap_count", poolSpillover, {}));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "spill_to_heap_count",
+                            poolSpillover,
+                            NO_TAGS));
     for (const auto &pool : poolStats) {
-        sendMetric(formatMetric(MetricType::COUNTER,
-                                "pools_" + std::to_string(pool.d_bufferSize) +
-                                    "_current",
+        const std::string prefix =
+            "pools_" + std::to_string(pool.d_bufferSize);
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::COUNTER,
+                                prefix + "_current",
                                 pool.d_currentAllocation,
-                                {}));
-        sendMetric(formatMetric(MetricType::COUNTER,
-                                "pools_" + std::to_string(pool.d_bufferSize) +
-                                    "_highest",
+                                NO_TAGS));
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::COUNTER,
+                                prefix + "_highest",
                                 pool.d_highwaterMark,
-                                {}));
+                                NO_TAGS));
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::GAUGE,
+                                prefix + "_slabs",
+                                pool.d_slabs,
+                                NO_TAGS));
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::GAUGE,
+                                prefix + "_slab_bytes_released",
+                                pool.d_slabBytesReleased,
+                                NO_TAGS));
+    }
+}
+
+void StatsDPublisher::publish(
+    const std::vector<StatSnapshot::ListenerStats> &listenerStats)
+{
+    for (const auto &listener : listenerStats) {
+        sendMetric(formatMetric(
+            &d_metric,
+            MetricType::COUNTER,
+            "accepts",
+            listener.d_accepts,
+            formatTags({{"listenPort", std::to_string(listener.d_port)},
+                        {"listenShard", std::to_string(listener.d_shard)}})));
+    }
+}
+
+void StatsDPublisher::publish(const StatSnapshot::MemoryStats &memoryStats)
+{
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::GAUGE,
+                            "buffer_memory_bytes",
+                            memoryStats.d_bytesInUse,
+                            NO_TAGS));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::GAUGE,
+                            "buffer_memory_paused_sessions",
+                            memoryStats.d_pausedSessions,
+                            NO_TAGS));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "buffer_memory_pauses",
+                            memoryStats.d_pauses,
+                            NO_TAGS));
+    sendMetric(formatMetric(&d_metric,
+                            MetricType::COUNTER,
+                            "buffer_memory_resumes",
+                            memoryStats.d_resumes,
+                            NO_TAGS));
+}
+
+void StatsDPublisher::publish(
+    const std::vector<StatSnapshot::BackendHealthStats> &backendHealth)
+{
+    for (const auto &health : backendHealth) {
+        std::string tags = formatTags({{"backend", health.d_backend}});
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::GAUGE,
+                                "backend_healthy",
+                                health.d_healthy ? 1 : 0,
+                                tags));
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::GAUGE,
+                                "backend_consecutive_failed_checks",
+                                health.d_consecutiveFailures,
+                                tags));
+        sendMetric(formatMetric(&d_metric,
+                                MetricType::GAUGE,
+                                "backend_ejected",
+                                health.d_ejected ? 1 : 0,
+                                tags));
     }
 }
 
@@ -157,21 +344,69 @@ void StatsDPublisher::publishHostnameMetrics(
     const StatSnapshot::StatsMap &stats,
     const std::string            &type)
 {
+    TagCache *cache = type == "backends" ? &d_backendTags : &d_sourceTags;
     for (const auto &stat : stats) {
-        publish(
-            stat.second,
-            {{"rmqEndpointType", type}, {"rmqEndpointHostname", stat.first}});
+        publishStats(stat.second,
+                     cachedTags(cache,
+                                stat.first,
+                                "rmqEndpointType",
+                                "rmqEndpointHostname",
+                                type));
     }
 }
 
 void StatsDPublisher::publish(const StatSnapshot &statSnapshot)
 {
+    ++d_generation;
+
     publish(statSnapshot.overall(), {{"rmqEndpointType", "overall"}});
     publish(statSnapshot.process());
     publishVhost(statSnapshot.vhosts());
     publish(statSnapshot.pool(), statSnapshot.poolSpillover());
+    publish(statSnapshot.listeners());
+    if (statSnapshot.memory().d_highWatermark != 0) {
+        publish(statSnapshot.memory());
+    }
+    publish(statSnapshot.backendHealth());
     publishHostnameMetrics(statSnapshot.sources(), "sources");
     publishHostnameMetrics(statSnapshot.backends(), "backends");
+    flush();
+
+    pruneTags(&d_vhostTags);
+    pruneTags(&d_sourceTags);
+    pruneTags(&d_backendTags);
+}
+
+const std::string &StatsDPublisher::cachedTags(TagCache          *cache,
+                                               const std::string &name,
+                                               const std::string &typeTag,
+                                               const std::string &nameTag,
+                                               const std::string &type)
+{
+    auto it = cache->find(name);
+    if (it == cache->end()) {
+        it = cache
+                 ->emplace(name,
+                           CachedTags{formatTags({{typeTag, type},
+                                                  {nameTag, name}}),
+                                      d_generation})
+                 .first;
+    }
+
+    it->second.d_generation = d_generation;
+    return it->second.d_tags;
+}
+
+void StatsDPublisher::pruneTags(TagCache *cache)
+{
+    for (auto it = cache->begin(); it != cache->end();) {
+        if (it->second.d_generation != d_generation) {
+            it = cache->erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
 }
 
 }
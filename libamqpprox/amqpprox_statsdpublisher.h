@@ -16,7 +16,12 @@
 #ifndef BLOOMBERG_AMQPPROX_STATSDPUBLISHER
 #define BLOOMBERG_AMQPPROX_STATSDPUBLISHER
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <boost/asio.hpp>
 
@@ -30,28 +35,101 @@ class ConnectionStats;
 /**
  * \brief Provides support to publish various statistics objects used by the
  * `StatCollector` to configured StatsD endpoint
+ *
+ * Metrics are packed, newline separated, into datagrams of at most the
+ * maximum datagram size, and a datagram is sent when the next metric would
+ * not fit or when `flush` is called. Publishing a whole `StatSnapshot`
+ * flushes at the end, the other `publish` overloads leave their metrics for a
+ * later `flush`. Each metric is formatted into the same buffer, and the tags
+ * for each vhost, source and backend are kept from one snapshot to the next
+ * for as long as it keeps being published.
  */
 class StatsDPublisher {
+  public:
+    // CONSTANTS
+    /**
+     * \brief Fits an Ethernet frame along with the IP and UDP headers
+     */
+    static constexpr std::size_t DEFAULT_MAX_DATAGRAM_SIZE = 1432;
+
+  private:
+    /**
+     * \brief The formatted tags of a vhost, source or backend, and the last
+     * snapshot they were used in
+     */
+    struct CachedTags {
+        std::string d_tags;
+        uint64_t    d_generation;
+    };
+
+    typedef std::unordered_map<std::string, CachedTags> TagCache;
+
     boost::asio::ip::udp::endpoint d_statsdEndpoint;
     boost::asio::ip::udp::socket   d_socket;
+    std::size_t                    d_maxDatagramSize;
+    std::string                    d_datagram;
+    std::string                    d_metric;
+    TagCache                       d_vhostTags;
+    TagCache                       d_sourceTags;
+    TagCache                       d_backendTags;
+    uint64_t                       d_generation;
 
+    /**
+     * \brief Add the `metric` to the datagram, sending the datagram first if
+     * the metric wouldn't fit into it
+     */
     void sendMetric(const std::string &metric);
 
+    /**
+     * \brief Publish `ConnectionStats` with tags already formatted as they
+     * appear in each metric
+     */
+    void publishStats(const ConnectionStats &stats, const std::string &tags);
+
+    /**
+     * \return the formatted tags for the named endpoint from the `cache`,
+     * formatting them if they aren't there already
+     */
+    const std::string &cachedTags(TagCache          *cache,
+                                  const std::string &name,
+                                  const std::string &typeTag,
+                                  const std::string &nameTag,
+                                  const std::string &type);
+
+    /**
+     * \brief Forget the tags which weren't used in the latest snapshot
+     */
+    void pruneTags(TagCache *cache);
+
     typedef std::vector<std::pair<std::string, std::string>> TagVector;
 
   public:
     // CREATORS
+    /**
+     * \brief Construct a publisher to the StatsD endpoint at `host:port`
+     * \param ioContext handle to the boost asio service
+     * \param host of the StatsD endpoint
+     * \param port of the StatsD endpoint
+     * \param maxDatagramSize the most bytes to send in one datagram, though
+     * a single metric longer than this is still sent on its own
+     */
     StatsDPublisher(boost::asio::io_context *ioContext,
                     const std::string       &host,
-                    int                      port);
+                    int                      port,
+                    std::size_t maxDatagramSize = DEFAULT_MAX_DATAGRAM_SIZE);
 
     // MANIPULATORS
     /**
-     * \brief Publish `StatSnapshot` to the StatsD endpoint
+     * \brief Publish `StatSnapshot` to the StatsD endpoint, and flush
      * \param statSnapshot const reference to `StatSnapshot`
      */
     void publish(const StatSnapshot &statSnapshot);
 
+    /**
+     * \brief Send the metrics not yet sent
+     */
+    void flush();
+
     /**
      * \brief Publish `ConnectionStats` with metric tags to the StatsD endpoint
      * \param stats const reference to `ConnectionStats`
@@ -80,6 +158,29 @@ class StatsDPublisher {
     void publish(const std::vector<StatSnapshot::PoolStats> &poolStats,
                  uint64_t                                    poolSpillover);
 
+    /**
+     * \brief Publish `StatSnapshot::ListenerStats` to the StatsD endpoint
+     * \param listenerStats const reference to the vector of
+     * `StatSnapshot::ListenerStats`
+     */
+    void
+    publish(const std::vector<StatSnapshot::ListenerStats> &listenerStats);
+
+    /**
+     * \brief Publish `StatSnapshot::MemoryStats` to the StatsD endpoint
+     * \param memoryStats const reference to `StatSnapshot::MemoryStats`
+     */
+    void publish(const StatSnapshot::MemoryStats &memoryStats);
+
+    /**
+     * \brief Publish `StatSnapshot::BackendHealthStats` to the StatsD
+     * endpoint
+     * \param backendHealth const reference to the vector of
+     * `StatSnapshot::BackendHealthStats`
+     */
+    void publish(
+        const std::vector<StatSnapshot::BackendHealthStats> &backendHealth);
+
     /**
      * \brief Publish hostname metric to the StatsD endpoint
      * \param stats const reference to `StatSnapshot::StatsMap`
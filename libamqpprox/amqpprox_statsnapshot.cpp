@@ -26,6 +26,11 @@ StatSnapshot::StatSnapshot()
 , d_process()
 , d_pool()
 , d_poolSpillover(0)
+, d_listeners()
+, d_memory()
+, d_topSourcesByBytes()
+, d_topSourcesByConnections()
+, d_backendHealth()
 {
 }
 
@@ -42,6 +47,11 @@ void StatSnapshot::swap(StatSnapshot &rhs)
     rhs.d_process                   = temp;
 
     std::swap(d_poolSpillover, rhs.d_poolSpillover);
+    d_listeners.swap(rhs.d_listeners);
+    std::swap(d_memory, rhs.d_memory);
+    d_topSourcesByBytes.swap(rhs.d_topSourcesByBytes);
+    d_topSourcesByConnections.swap(rhs.d_topSourcesByConnections);
+    d_backendHealth.swap(rhs.d_backendHealth);
 }
 
 bool operator==(const StatSnapshot::ProcessStats &lhs,
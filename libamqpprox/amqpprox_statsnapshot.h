@@ -54,23 +54,94 @@ class StatSnapshot {
         std::size_t d_bufferSize;
         uint64_t    d_highwaterMark;
         uint64_t    d_currentAllocation;
+        uint64_t    d_slabs;
+        uint64_t    d_slabBytesReleased;
 
         PoolStats()
         : d_bufferSize(0)
         , d_highwaterMark(0)
         , d_currentAllocation(0)
+        , d_slabs(0)
+        , d_slabBytesReleased(0)
+        {
+        }
+    };
+
+    struct ListenerStats {
+        int         d_port;
+        std::size_t d_shard;
+        uint64_t    d_accepts;
+
+        ListenerStats()
+        : d_port(0)
+        , d_shard(0)
+        , d_accepts(0)
+        {
+        }
+    };
+
+    struct MemoryStats {
+        uint64_t d_bytesInUse;
+        uint64_t d_highWatermark;
+        uint64_t d_lowWatermark;
+        uint64_t d_pausedSessions;
+        uint64_t d_pauses;
+        uint64_t d_resumes;
+
+        MemoryStats()
+        : d_bytesInUse(0)
+        , d_highWatermark(0)
+        , d_lowWatermark(0)
+        , d_pausedSessions(0)
+        , d_pauses(0)
+        , d_resumes(0)
+        {
+        }
+    };
+
+    struct TopSourceStats {
+        std::string d_vhost;
+        std::string d_source;
+        uint64_t    d_bytes;
+        uint64_t    d_connections;
+
+        TopSourceStats()
+        : d_vhost()
+        , d_source()
+        , d_bytes(0)
+        , d_connections(0)
+        {
+        }
+    };
+
+    struct BackendHealthStats {
+        std::string d_backend;
+        bool        d_healthy;
+        uint32_t    d_consecutiveFailures;
+        bool        d_ejected;
+
+        BackendHealthStats()
+        : d_backend()
+        , d_healthy(true)
+        , d_consecutiveFailures(0)
+        , d_ejected(false)
         {
         }
     };
 
   private:
-    StatsMap               d_vhosts;
-    StatsMap               d_sources;
-    StatsMap               d_backends;
-    ConnectionStats        d_overallConnectionStats;
-    ProcessStats           d_process;
-    std::vector<PoolStats> d_pool;
-    uint64_t               d_poolSpillover;
+    StatsMap                        d_vhosts;
+    StatsMap                        d_sources;
+    StatsMap                        d_backends;
+    ConnectionStats                 d_overallConnectionStats;
+    ProcessStats                    d_process;
+    std::vector<PoolStats>          d_pool;
+    uint64_t                        d_poolSpillover;
+    std::vector<ListenerStats>      d_listeners;
+    MemoryStats                     d_memory;
+    std::vector<TopSourceStats>     d_topSourcesByBytes;
+    std::vector<TopSourceStats>     d_topSourcesByConnections;
+    std::vector<BackendHealthStats> d_backendHealth;
 
   public:
     // CREATORS
@@ -140,6 +211,57 @@ class StatSnapshot {
      */
     inline const uint64_t &poolSpillover() const;
 
+    /**
+     * \return reference to vector of ListenerStats
+     */
+    inline std::vector<ListenerStats> &listeners();
+    /**
+     * \return const reference to vector of ListenerStats
+     */
+    inline const std::vector<ListenerStats> &listeners() const;
+
+    /**
+     * \return reference to the buffer memory budget statistics
+     */
+    inline MemoryStats &memory();
+    /**
+     * \return const reference to the buffer memory budget statistics
+     */
+    inline const MemoryStats &memory() const;
+
+    /**
+     * \return reference to the approximate top sources per vhost by bytes,
+     * highest first
+     */
+    inline std::vector<TopSourceStats> &topSourcesByBytes();
+    /**
+     * \return const reference to the approximate top sources per vhost by
+     * bytes, highest first
+     */
+    inline const std::vector<TopSourceStats> &topSourcesByBytes() const;
+
+    /**
+     * \return reference to the approximate top sources per vhost by new
+     * connections, highest first
+     */
+    inline std::vector<TopSourceStats> &topSourcesByConnections();
+    /**
+     * \return const reference to the approximate top sources per vhost by
+     * new connections, highest first
+     */
+    inline const std::vector<TopSourceStats> &topSourcesByConnections() const;
+
+    /**
+     * \return reference to the health of each checked backend, ordered by
+     * name
+     */
+    inline std::vector<BackendHealthStats> &backendHealth();
+    /**
+     * \return const reference to the health of each checked backend,
+     * ordered by name
+     */
+    inline const std::vector<BackendHealthStats> &backendHealth() const;
+
     // MANIPULATORS
     /**
      * \brief swap the current StatSnapshot with supplied StatSnapshot
@@ -219,6 +341,63 @@ inline const uint64_t &StatSnapshot::poolSpillover() const
     return d_poolSpillover;
 }
 
+inline std::vector<StatSnapshot::ListenerStats> &StatSnapshot::listeners()
+{
+    return d_listeners;
+}
+
+inline const std::vector<StatSnapshot::ListenerStats> &
+StatSnapshot::listeners() const
+{
+    return d_listeners;
+}
+
+inline StatSnapshot::MemoryStats &StatSnapshot::memory()
+{
+    return d_memory;
+}
+
+inline const StatSnapshot::MemoryStats &StatSnapshot::memory() const
+{
+    return d_memory;
+}
+
+inline std::vector<StatSnapshot::TopSourceStats> &
+StatSnapshot::topSourcesByBytes()
+{
+    return d_topSourcesByBytes;
+}
+
+inline const std::vector<StatSnapshot::TopSourceStats> &
+StatSnapshot::topSourcesByBytes() const
+{
+    return d_topSourcesByBytes;
+}
+
+inline std::vector<StatSnapshot::TopSourceStats> &
+StatSnapshot::topSourcesByConnections()
+{
+    return d_topSourcesByConnections;
+}
+
+inline const std::vector<StatSnapshot::TopSourceStats> &
+StatSnapshot::topSourcesByConnections() const
+{
+    return d_topSourcesByConnections;
+}
+
+inline std::vector<StatSnapshot::BackendHealthStats> &
+StatSnapshot::backendHealth()
+{
+    return d_backendHealth;
+}
+
+inline const std::vector<StatSnapshot::BackendHealthStats> &
+StatSnapshot::backendHealth() const
+{
+    return d_backendHealth;
+}
+
 bool operator==(const StatSnapshot::ProcessStats &lhs,
                 const StatSnapshot::ProcessStats &rhs);
 bool operator!=(const StatSnapshot::ProcessStats &lhs,
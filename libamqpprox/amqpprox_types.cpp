@@ -18,6 +18,7 @@
 #include <amqpprox_buffer.h>
 #include <amqpprox_constants.h>
 #include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldtableview.h>
 #include <amqpprox_fieldvalue.h>
 #include <amqpprox_logging.h>
 
@@ -388,6 +389,80 @@ bool Types::encodeFieldValue(Buffer &buffer, const FieldValue &fv)
     return true;
 }
 
+bool Types::skipFieldValue(Buffer &buffer)
+{
+    if (buffer.available() < sizeof(char)) {
+        return false;
+    }
+
+    char        type = buffer.copy<char>();
+    std::size_t size = 0;
+    switch (type) {
+    case 'V':  // No value
+        break;
+    case 't':  // boolean
+    case 'b':  // short-short-int
+    case 'B':  // short-short-uint
+        size = sizeof(big_uint8_t);
+        break;
+    case 'U':
+    case 's':  // short-int
+    case 'u':  // short-uint
+        size = sizeof(big_uint16_t);
+        break;
+    case 'I':  // long-int
+    case 'i':  // long-uint
+        size = sizeof(big_uint32_t);
+        break;
+    case 'l':  // long-long-int
+    case 'L':  // compatibility long-long-int
+    case 'T':  // timestamp
+        size = sizeof(big_uint64_t);
+        break;
+    case 'f':  // float
+        size = FLOAT_OCTETS;
+        break;
+    case 'd':  // double
+        size = DOUBLE_OCTETS;
+        break;
+    case 'D':  // decimal-value
+        size = DECIMAL_OCTETS;
+        break;
+    case 'S':  // long-string
+    case 'x':  // byte array
+    case 'A':  // field-array
+    {
+        if (buffer.available() < sizeof(big_uint32_t)) {
+            return false;
+        }
+        size = buffer.copy<big_uint32_t>();
+        if (type == 'A' && size <= buffer.available()) {
+            Buffer arrayBuffer = buffer.consume(size);
+            while (arrayBuffer.available() > 0) {
+                if (!skipFieldValue(arrayBuffer)) {
+                    return false;
+                }
+            }
+            size = 0;
+        }
+    } break;
+    case 'F':  // field-table
+    {
+        FieldTableView table;
+        return decodeFieldTable(&table, buffer);
+    }
+    default: {
+        return false;
+    }
+    }
+
+    if (size > buffer.available()) {
+        return false;
+    }
+    buffer.skip(size);
+    return true;
+}
+
 bool Types::decodeFieldArray(std::vector<FieldValue> *vector, Buffer &buffer)
 {
     assert(vector != nullptr);
@@ -463,11 +538,53 @@ bool Types::decodeFieldTable(FieldTable *table, Buffer &buffer)
     return true;
 }
 
+bool Types::decodeFieldTable(FieldTableView *table, Buffer &buffer)
+{
+    if (sizeof(big_uint32_t) > buffer.available()) {
+        return false;
+    }
+
+    auto fieldTableLength = buffer.copy<big_uint32_t>();
+    if (fieldTableLength > buffer.available()) {
+        return false;
+    }
+
+    Buffer tBuffer = buffer.consume(fieldTableLength);
+    while (tBuffer.available() > 0) {
+        if (sizeof(big_uint8_t) > tBuffer.available()) {
+            return false;
+        }
+
+        auto fieldNameLength = tBuffer.copy<big_uint8_t>();
+        if (fieldNameLength > tBuffer.available()) {
+            return false;
+        }
+        tBuffer.skip(fieldNameLength);
+
+        if (!skipFieldValue(tBuffer)) {
+            return false;
+        }
+    }
+
+    *table = FieldTableView(tBuffer.currentData());
+    return true;
+}
+
 bool Types::encodeFieldTable(Buffer &buffer, const FieldTable &table)
+{
+    return encodeFieldTable(buffer, FieldTableView(), table);
+}
+
+bool Types::encodeFieldTable(Buffer               &buffer,
+                             const FieldTableView &fields,
+                             const FieldTable     &table)
 {
     Buffer writeBuffer = buffer.remaining();
-    writeBuffer.skip(sizeof(big_uint32_t));
-    std::size_t originalOffset = writeBuffer.offset();
+    if (!writeBuffer.writeIn<big_uint32_t>(0) ||
+        !writeBuffer.writeIn(fields.fields())) {
+        return false;
+    }
+    std::size_t originalOffset = sizeof(big_uint32_t);
 
     for (auto i = 0u; i < table.numberFields(); ++i) {
         if (!encodeShortString(writeBuffer, table.fieldName(i))) {
@@ -26,6 +26,7 @@ namespace amqpprox {
 class Buffer;
 class FieldArray;
 class FieldTable;
+class FieldTableView;
 class FieldValue;
 
 /**
@@ -114,6 +115,14 @@ class Types {
      */
     static bool encodeFieldValue(Buffer &buffer, const FieldValue &value);
 
+    /**
+     * \brief Skip over an AMQP field type in the specified buffer, checking
+     * it is well formed without decoding it
+     * \param buffer raw data stored as `Buffer`
+     * \return true in case of success, otherwise false
+     */
+    static bool skipFieldValue(Buffer &buffer);
+
     /**
      * \brief Decode the specified buffer and convert the data into AMQP field
      * type array
@@ -144,6 +153,15 @@ class Types {
      */
     static bool decodeFieldTable(FieldTable *table, Buffer &buffer);
 
+    /**
+     * \brief Validate the AMQP field table in the specified buffer and view
+     * it in place, without decoding any of its fields
+     * \param table view set to the fields of the AMQP field table
+     * \param buffer raw data stored as `Buffer`, which must outlive the view
+     * \return true in case of success, otherwise false
+     */
+    static bool decodeFieldTable(FieldTableView *table, Buffer &buffer);
+
     /**
      * \brief Encode AMQP field table and write the data into the specified
      * buffer
@@ -152,6 +170,19 @@ class Types {
      * \return true in case of success, otherwise false
      */
     static bool encodeFieldTable(Buffer &buffer, const FieldTable &table);
+
+    /**
+     * \brief Encode AMQP field table made up of already encoded fields
+     * followed by further fields, and write the data into the specified
+     * buffer
+     * \param buffer raw data stored as `Buffer`
+     * \param fields encoded fields copied as they are
+     * \param table fields encoded after `fields`
+     * \return true in case of success, otherwise false
+     */
+    static bool encodeFieldTable(Buffer               &buffer,
+                                 const FieldTableView &fields,
+                                 const FieldTable     &table);
 };
 
 }
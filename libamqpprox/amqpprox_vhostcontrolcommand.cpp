@@ -40,6 +40,8 @@ std::string VhostControlCommand::helpText() const
 {
     return "PAUSE vhost | "
            "UNPAUSE vhost | "
+           "COUNT_ONLY vhost | "
+           "COUNT_FRAMES vhost | "
            "PRINT | "
            "BACKEND_DISCONNECT vhost | "
            "FORCE_DISCONNECT vhost";
@@ -87,6 +89,11 @@ void VhostControlCommand::handleCommand(const std::string & /* command */,
 
         serverHandle->visitSessions(visitor);
     }
+    else if (subcommand == "COUNT_ONLY" || subcommand == "COUNT_FRAMES") {
+        // Only applies to new connections: a session can't go back to
+        // parsing frames part way through passing them on unparsed
+        d_vhostState_p->setCountOnly(vhost, subcommand == "COUNT_ONLY");
+    }
     else if (subcommand == "FORCE_DISCONNECT") {
         auto visitor = [this, &vhost](std::shared_ptr<Session> session) {
             if (session->state().getVirtualHost() == vhost) {
@@ -30,8 +30,20 @@ EventSubscriptionHandle vhostEstablishedPauser(EventSource *eventSource,
 {
     return eventSource->connectionVhostEstablished().subscribe(
         [=](uint64_t id, const std::string &vhost) {
-            if (vhostState->isPaused(vhost)) {
-                auto session = server->getSession(id);
+            bool paused    = vhostState->isPaused(vhost);
+            bool countOnly = vhostState->isCountOnly(vhost);
+            if (!paused && !countOnly) {
+                return;
+            }
+
+            auto session = server->getSession(id);
+            if (!session) {
+                return;
+            }
+            if (countOnly) {
+                session->state().setCountOnly(true);
+            }
+            if (paused) {
                 session->pause();
             }
         });
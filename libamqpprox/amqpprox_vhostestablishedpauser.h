@@ -26,8 +26,9 @@ class Server;
 class VhostState;
 
 /**
- * \brief Subscribe to vhost connections to set new connections to be paused
- * once the vhost is established late in the connection phase
+ * \brief Subscribe to vhost connections to set new connections to be paused,
+ * or to count passthrough data only, once the vhost is established late in
+ * the connection phase
  * \param eventSource pointer to `EventSource`
  * \param server pointer to `Server`
  * \param vhostState pointer to `VhostState`
@@ -30,11 +30,13 @@ VhostState::VhostState()
 
 VhostState::State::State()
 : d_paused(false)
+, d_countOnly(false)
 {
 }
 
 VhostState::State::State(const State &rhs)
 : d_paused(rhs.d_paused)
+, d_countOnly(rhs.d_countOnly)
 {
 }
 
@@ -50,6 +52,19 @@ void VhostState::setPaused(const std::string &vhost, bool paused)
     d_vhosts[vhost].setPaused(paused);
 }
 
+bool VhostState::isCountOnly(const std::string &vhost)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    auto                        it = d_vhosts.find(vhost);
+    return it != d_vhosts.end() && it->second.isCountOnly();
+}
+
+void VhostState::setCountOnly(const std::string &vhost, bool countOnly)
+{
+    std::lock_guard<std::mutex> lg(d_mutex);
+    d_vhosts[vhost].setCountOnly(countOnly);
+}
+
 void VhostState::print(std::ostream &os)
 {
     std::map<std::string, State> sortedVhosts;
@@ -63,7 +78,8 @@ void VhostState::print(std::ostream &os)
 
     for (const auto &vhost : sortedVhosts) {
         auto paused = (vhost.second.isPaused() ? "PAUSED" : "UNPAUSED");
-        os << vhost.first << " = " << paused << "\n";
+        os << vhost.first << " = " << paused
+           << (vhost.second.isCountOnly() ? " COUNT_ONLY" : "") << "\n";
     }
 }
 
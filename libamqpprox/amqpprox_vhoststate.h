@@ -35,6 +35,7 @@ namespace amqpprox {
 class VhostState {
     class State {
         bool d_paused;
+        bool d_countOnly;
 
       public:
         State();
@@ -50,6 +51,19 @@ class VhostState {
          * \param paused flag to specify paused or unpaused virtual host
          */
         inline void setPaused(bool paused) { d_paused = paused; }
+
+        /**
+         * \return whether connections to the virtual host count passthrough
+         * data only
+         */
+        inline bool isCountOnly() const { return d_countOnly; }
+
+        /**
+         * \brief Set whether connections to the virtual host count
+         * passthrough data only
+         * \param countOnly flag to specify count-only passthrough
+         */
+        inline void setCountOnly(bool countOnly) { d_countOnly = countOnly; }
     };
 
     std::unordered_map<std::string, State> d_vhosts;
@@ -74,6 +88,24 @@ class VhostState {
      */
     void setPaused(const std::string &vhost, bool paused);
 
+    /**
+     * \brief Retrieve whether connections to a vhost pass data through
+     * without parsing frames once open, counting bytes only
+     *
+     * \param vhost The vhost name to retrieve the state for
+     * \return Whether connections to the vhost are count-only
+     */
+    bool isCountOnly(const std::string &vhost);
+
+    /**
+     * \brief Set whether connections to the specified vhost, established
+     * from now on, pass data through without parsing frames once open
+     *
+     * \param vhost The vhost to be manipulated
+     * \param countOnly Whether connections are to be count-only
+     */
+    void setCountOnly(const std::string &vhost, bool countOnly);
+
     /**
      * \brief Print the mappings currently held to the provide ostream
      *
@@ -0,0 +1,133 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendcounters.h>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::BackendCounters;
+
+namespace {
+
+BackendCounters::TimePoint at(std::chrono::milliseconds offset)
+{
+    return BackendCounters::TimePoint(std::chrono::hours(1) + offset);
+}
+
+}
+
+TEST(BackendCounters, Breathing)
+{
+    BackendCounters counters;
+
+    EXPECT_EQ(0, counters.connections());
+    EXPECT_EQ(0, counters.bytesPerSecond(at(std::chrono::milliseconds(0))));
+    EXPECT_EQ(0, counters.totalBytes());
+    EXPECT_EQ(0, counters.succeededConnections());
+    EXPECT_EQ(0, counters.failedConnections());
+}
+
+TEST(BackendCounters, Connections_Opened_And_Closed)
+{
+    BackendCounters counters;
+
+    counters.connectionOpened();
+    counters.connectionOpened();
+    EXPECT_EQ(2, counters.connections());
+
+    counters.connectionClosed();
+    EXPECT_EQ(1, counters.connections());
+
+    counters.connectionClosed();
+    EXPECT_EQ(0, counters.connections());
+}
+
+TEST(BackendCounters, Connection_Outcomes_Counted)
+{
+    BackendCounters counters;
+
+    counters.connectionSucceeded();
+    counters.connectionFailed();
+    counters.connectionFailed();
+    counters.connectionSnapped();
+    EXPECT_EQ(1, counters.succeededConnections());
+    EXPECT_EQ(2, counters.failedConnections());
+    EXPECT_EQ(1, counters.snappedConnections());
+
+    // Outcomes are independent of the sessions currently connected
+    EXPECT_EQ(0, counters.connections());
+}
+
+TEST(BackendCounters, Bytes_Reported_For_Last_Whole_Second)
+{
+    using std::chrono::milliseconds;
+
+    BackendCounters counters;
+
+    counters.addBytes(100, at(milliseconds(0)));
+    counters.addBytes(50, at(milliseconds(900)));
+
+    // The second being counted is not reported until it is over
+    EXPECT_EQ(0, counters.bytesPerSecond(at(milliseconds(950))));
+    EXPECT_EQ(150, counters.bytesPerSecond(at(milliseconds(1100))));
+
+    counters.addBytes(10, at(milliseconds(1200)));
+    EXPECT_EQ(150, counters.bytesPerSecond(at(milliseconds(1300))));
+    EXPECT_EQ(10, counters.bytesPerSecond(at(milliseconds(2000))));
+
+    // The total is kept regardless of the window
+    EXPECT_EQ(160, counters.totalBytes());
+}
+
+TEST(BackendCounters, Bytes_Expire_When_Idle)
+{
+    using std::chrono::milliseconds;
+
+    BackendCounters counters;
+
+    counters.addBytes(100, at(milliseconds(0)));
+    EXPECT_EQ(0, counters.bytesPerSecond(at(milliseconds(2500))));
+
+    // Skipping seconds does not carry stale bytes into the new window
+    counters.addBytes(20, at(milliseconds(3000)));
+    EXPECT_EQ(0, counters.bytesPerSecond(at(milliseconds(3100))));
+    EXPECT_EQ(20, counters.bytesPerSecond(at(milliseconds(4100))));
+}
+
+TEST(BackendCounters, Latency_Moving_Average)
+{
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+    using Phase = BackendCounters::Phase;
+
+    BackendCounters counters;
+    EXPECT_EQ(microseconds(0), counters.latency(Phase::CONNECT));
+
+    // The first sample is taken as is, later ones count for a quarter
+    counters.recordLatency(
+        Phase::CONNECT, microseconds(1000), at(milliseconds(0)));
+    EXPECT_EQ(microseconds(1000), counters.latency(Phase::CONNECT));
+
+    counters.recordLatency(
+        Phase::CONNECT, microseconds(2000), at(milliseconds(10)));
+    EXPECT_EQ(microseconds(1250), counters.latency(Phase::CONNECT));
+
+    counters.recordLatency(
+        Phase::BROKER_START, microseconds(400), at(milliseconds(20)));
+    EXPECT_EQ(microseconds(1650), counters.setupLatency());
+    EXPECT_EQ(at(milliseconds(20)), counters.lastLatencySample());
+}
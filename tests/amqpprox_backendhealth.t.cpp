@@ -0,0 +1,84 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendhealth.h>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::BackendHealth;
+
+TEST(BackendHealth, Breathing)
+{
+    BackendHealth health;
+
+    EXPECT_TRUE(health.isHealthy());
+    EXPECT_EQ(0, health.consecutiveFailures());
+    EXPECT_FALSE(health.isEjected(std::chrono::steady_clock::now()));
+}
+
+TEST(BackendHealth, Unhealthy_After_Consecutive_Failures)
+{
+    BackendHealth health;
+
+    EXPECT_FALSE(health.recordCheck(false, 3, 2));
+    EXPECT_FALSE(health.recordCheck(false, 3, 2));
+    EXPECT_TRUE(health.isHealthy());
+
+    // A pass in between starts the count again
+    EXPECT_FALSE(health.recordCheck(true, 3, 2));
+    EXPECT_EQ(0, health.consecutiveFailures());
+    EXPECT_FALSE(health.recordCheck(false, 3, 2));
+    EXPECT_FALSE(health.recordCheck(false, 3, 2));
+    EXPECT_TRUE(health.isHealthy());
+
+    EXPECT_TRUE(health.recordCheck(false, 3, 2));
+    EXPECT_FALSE(health.isHealthy());
+    EXPECT_EQ(3, health.consecutiveFailures());
+
+    EXPECT_FALSE(health.recordCheck(false, 3, 2));
+    EXPECT_FALSE(health.isHealthy());
+}
+
+TEST(BackendHealth, Healthy_Again_After_Consecutive_Passes)
+{
+    BackendHealth health;
+    EXPECT_TRUE(health.recordCheck(false, 1, 2));
+    EXPECT_FALSE(health.isHealthy());
+
+    EXPECT_FALSE(health.recordCheck(true, 1, 2));
+    EXPECT_FALSE(health.isHealthy());
+    EXPECT_FALSE(health.recordCheck(false, 1, 2));
+    EXPECT_FALSE(health.recordCheck(true, 1, 2));
+    EXPECT_FALSE(health.isHealthy());
+
+    EXPECT_TRUE(health.recordCheck(true, 1, 2));
+    EXPECT_TRUE(health.isHealthy());
+}
+
+TEST(BackendHealth, Ejected_Until_Time)
+{
+    BackendHealth health;
+    auto          now = std::chrono::steady_clock::now();
+
+    health.ejectUntil(now + std::chrono::seconds(30));
+    EXPECT_TRUE(health.isEjected(now));
+    EXPECT_TRUE(health.isEjected(now + std::chrono::seconds(29)));
+    EXPECT_FALSE(health.isEjected(now + std::chrono::seconds(30)));
+
+    // Ejection is independent of the active checks
+    EXPECT_TRUE(health.isHealthy());
+}
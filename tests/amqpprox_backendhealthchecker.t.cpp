@@ -0,0 +1,236 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendhealthchecker.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendstore.h>
+#include <amqpprox_buffer.h>
+#include <amqpprox_connectorutil.h>
+#include <amqpprox_constants.h>
+
+#include <boost/asio.hpp>
+
+#include <chrono>
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendHealthChecker;
+using Bloomberg::amqpprox::BackendStore;
+using Bloomberg::amqpprox::Buffer;
+using Bloomberg::amqpprox::Constants;
+using Bloomberg::amqpprox::ConnectorUtil;
+using boost::asio::ip::tcp;
+
+namespace {
+
+/**
+ * \brief A broker accepting one connection at a time, which reads the
+ * expected request and replies to it with the given bytes
+ */
+class FakeBroker {
+    tcp::acceptor d_acceptor;
+    std::string   d_expectedRequest;
+    std::string   d_reply;
+    std::string   d_request;
+
+  public:
+    FakeBroker(boost::asio::io_context &ioContext,
+               std::string              expectedRequest,
+               std::string              reply,
+               int                      port = 0)
+    : d_acceptor(ioContext, tcp::endpoint(tcp::v4(), port))
+    , d_expectedRequest(std::move(expectedRequest))
+    , d_reply(std::move(reply))
+    , d_request()
+    {
+        accept();
+    }
+
+    int port() const { return d_acceptor.local_endpoint().port(); }
+
+    const std::string &request() const { return d_request; }
+
+  private:
+    void accept()
+    {
+        d_acceptor.async_accept([this](boost::system::error_code ec,
+                                       tcp::socket               socket) {
+            if (ec) {
+                return;
+            }
+
+            auto peer = std::make_shared<tcp::socket>(std::move(socket));
+            d_request.assign(d_expectedRequest.size(), '\0');
+            boost::asio::async_read(
+                *peer,
+                boost::asio::buffer(d_request),
+                [this, peer](boost::system::error_code ec, std::size_t) {
+                    if (ec) {
+                        return;
+                    }
+                    boost::asio::async_write(
+                        *peer,
+                        boost::asio::buffer(d_reply),
+                        [peer](boost::system::error_code, std::size_t) {});
+                });
+            accept();
+        });
+    }
+};
+
+std::string protocolHeader()
+{
+    return std::string(Constants::protocolHeader(),
+                       Constants::protocolHeaderLength());
+}
+
+std::string startFrame()
+{
+    Buffer frame = ConnectorUtil::synthesizedStartFrame();
+    return std::string(static_cast<const char *>(frame.ptr()),
+                       frame.available());
+}
+
+void runChecks(boost::asio::io_context *ioContext,
+               BackendHealthChecker    *checker,
+               int                      rounds)
+{
+    for (int i = 0; i < rounds; ++i) {
+        checker->checkBackends();
+        ioContext->restart();
+        while (checker->checksInProgress() > 0 &&
+               ioContext->run_one_for(std::chrono::seconds(5))) {
+        }
+    }
+}
+
+}
+
+TEST(BackendHealthChecker, Passes_On_Connection_Start)
+{
+    boost::asio::io_context ioContext;
+    FakeBroker broker(ioContext, protocolHeader(), startFrame());
+
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "localhost", "127.0.0.1",
+                         broker.port()));
+    const Backend *backend = store.lookup("backend");
+
+    BackendHealthChecker checker(ioContext, &store);
+    checker.setThresholds(1, 1);
+    runChecks(&ioContext, &checker, 1);
+
+    EXPECT_EQ(protocolHeader(), broker.request());
+    EXPECT_TRUE(backend->health()->isHealthy());
+    EXPECT_EQ(0, backend->health()->consecutiveFailures());
+}
+
+TEST(BackendHealthChecker, Sends_Proxy_Protocol_Header)
+{
+    std::string expected = "PROXY UNKNOWN\r\n" + protocolHeader();
+
+    boost::asio::io_context ioContext;
+    FakeBroker broker(ioContext, expected, startFrame());
+
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "localhost", "127.0.0.1",
+                         broker.port(), true));
+    const Backend *backend = store.lookup("backend");
+
+    BackendHealthChecker checker(ioContext, &store);
+    checker.setThresholds(1, 1);
+    runChecks(&ioContext, &checker, 1);
+
+    EXPECT_EQ(expected, broker.request());
+    EXPECT_EQ(0, backend->health()->consecutiveFailures());
+}
+
+TEST(BackendHealthChecker, Fails_On_Other_Reply)
+{
+    boost::asio::io_context ioContext;
+
+    // A broker refusing the protocol version replies with the one it speaks
+    FakeBroker broker(ioContext,
+                      protocolHeader(),
+                      std::string("AMQP\x00\x00\x09\x01\x00\x00\x00", 11));
+
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "localhost", "127.0.0.1",
+                         broker.port()));
+    const Backend *backend = store.lookup("backend");
+
+    BackendHealthChecker checker(ioContext, &store);
+    checker.setThresholds(2, 1);
+    runChecks(&ioContext, &checker, 1);
+
+    EXPECT_TRUE(backend->health()->isHealthy());
+    EXPECT_EQ(1, backend->health()->consecutiveFailures());
+
+    runChecks(&ioContext, &checker, 1);
+    EXPECT_FALSE(backend->health()->isHealthy());
+}
+
+TEST(BackendHealthChecker, Fails_On_Timeout)
+{
+    boost::asio::io_context ioContext;
+
+    // Accepts the connection but never replies
+    FakeBroker broker(ioContext, protocolHeader() + "more", "");
+
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "localhost", "127.0.0.1",
+                         broker.port()));
+    const Backend *backend = store.lookup("backend");
+
+    BackendHealthChecker checker(ioContext, &store);
+    checker.setThresholds(1, 1);
+    checker.setTimeout(std::chrono::milliseconds(50));
+    runChecks(&ioContext, &checker, 1);
+
+    EXPECT_FALSE(backend->health()->isHealthy());
+}
+
+TEST(BackendHealthChecker, Fails_When_Refused_And_Recovers)
+{
+    boost::asio::io_context ioContext;
+
+    int port;
+    {
+        // Find a port nothing is listening on
+        tcp::acceptor acceptor(ioContext, tcp::endpoint(tcp::v4(), 0));
+        port = acceptor.local_endpoint().port();
+    }
+
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "localhost", "127.0.0.1", port));
+    const Backend *backend = store.lookup("backend");
+
+    BackendHealthChecker checker(ioContext, &store);
+    checker.setThresholds(2, 2);
+    runChecks(&ioContext, &checker, 2);
+    EXPECT_FALSE(backend->health()->isHealthy());
+
+    FakeBroker broker(ioContext, protocolHeader(), startFrame(), port);
+    runChecks(&ioContext, &checker, 1);
+    EXPECT_FALSE(backend->health()->isHealthy());
+
+    runChecks(&ioContext, &checker, 1);
+    EXPECT_TRUE(backend->health()->isHealthy());
+}
@@ -0,0 +1,216 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_backendoutlierdetector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendstore.h>
+
+#include <chrono>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendCounters;
+using Bloomberg::amqpprox::BackendOutlierDetector;
+using Bloomberg::amqpprox::BackendStore;
+
+namespace {
+
+using TimePoint = BackendOutlierDetector::TimePoint;
+
+// Ejections are kept to the microsecond
+const TimePoint START =
+    std::chrono::time_point_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now());
+
+TimePoint at(std::chrono::seconds offset)
+{
+    return START + offset;
+}
+
+void record(const Backend &backend, int succeeded, int failed)
+{
+    BackendCounters &counters = *backend.counters();
+    for (int i = 0; i < succeeded; ++i) {
+        counters.connectionSucceeded();
+    }
+    for (int i = 0; i < failed; ++i) {
+        counters.connectionFailed();
+    }
+}
+
+bool ejectedAt(const Backend &backend, std::chrono::seconds offset)
+{
+    return backend.health()->isEjected(at(offset));
+}
+
+}
+
+TEST(BackendOutlierDetector, Ejects_Failing_Backend)
+{
+    BackendStore store;
+    store.insert(Backend("backend1", "dc1", "host", "ip", 100));
+    store.insert(Backend("backend2", "dc1", "host", "ip", 100));
+    const Backend &backend1 = *store.lookup("backend1");
+    const Backend &backend2 = *store.lookup("backend2");
+
+    BackendOutlierDetector detector(&store);
+    detector.detect(at(std::chrono::seconds(0)));
+
+    record(backend1, 2, 3);
+    record(backend2, 4, 1);
+    detector.detect(at(std::chrono::seconds(1)));
+
+    EXPECT_TRUE(ejectedAt(backend1, std::chrono::seconds(1)));
+    EXPECT_TRUE(ejectedAt(backend1, std::chrono::seconds(30)));
+    EXPECT_FALSE(ejectedAt(backend1, std::chrono::seconds(31)));
+    EXPECT_FALSE(ejectedAt(backend2, std::chrono::seconds(1)));
+}
+
+TEST(BackendOutlierDetector, Ejects_Backend_Dropping_Sessions)
+{
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "host", "ip", 100));
+    const Backend &backend = *store.lookup("backend");
+
+    BackendOutlierDetector detector(&store);
+    detector.detect(at(std::chrono::seconds(0)));
+
+    // Every session gets as far as Connection.Start
+    record(backend, 5, 0);
+    detector.detect(at(std::chrono::seconds(1)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(1)));
+
+    // Only for the backend to drop them all
+    BackendCounters &counters = *backend.counters();
+    for (int i = 0; i < 5; ++i) {
+        counters.connectionSnapped();
+    }
+    detector.detect(at(std::chrono::seconds(2)));
+    EXPECT_TRUE(ejectedAt(backend, std::chrono::seconds(2)));
+}
+
+TEST(BackendOutlierDetector, Needs_Minimum_Connections)
+{
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "host", "ip", 100));
+    const Backend &backend = *store.lookup("backend");
+
+    BackendOutlierDetector detector(&store);
+    detector.setFailureThreshold(50, 10);
+    detector.detect(at(std::chrono::seconds(0)));
+
+    record(backend, 0, 9);
+    detector.detect(at(std::chrono::seconds(1)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(1)));
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(2)));
+    EXPECT_TRUE(ejectedAt(backend, std::chrono::seconds(2)));
+}
+
+TEST(BackendOutlierDetector, Outcomes_Before_Window_Forgotten)
+{
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "host", "ip", 100));
+    const Backend &backend = *store.lookup("backend");
+
+    BackendOutlierDetector detector(&store);
+    detector.setWindow(2);
+
+    // Failures before the first detection aren't counted at all
+    record(backend, 0, 10);
+    detector.detect(at(std::chrono::seconds(0)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(0)));
+
+    record(backend, 0, 4);
+    detector.detect(at(std::chrono::seconds(1)));
+    record(backend, 5, 0);
+    detector.detect(at(std::chrono::seconds(2)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(2)));
+
+    // The first four failures have left the window when the next four fail
+    record(backend, 0, 4);
+    detector.detect(at(std::chrono::seconds(3)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(3)));
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(4)));
+    EXPECT_TRUE(ejectedAt(backend, std::chrono::seconds(4)));
+}
+
+TEST(BackendOutlierDetector, Ejection_Grows_To_Maximum_And_Resets)
+{
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "host", "ip", 100));
+    const Backend &backend = *store.lookup("backend");
+
+    BackendOutlierDetector detector(&store);
+    detector.setFailureThreshold(50, 1);
+    detector.setEjectionTimes(std::chrono::seconds(10),
+                              std::chrono::seconds(25));
+    detector.detect(at(std::chrono::seconds(0)));
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(0)));
+    EXPECT_EQ(at(std::chrono::seconds(10)),
+              backend.health()->ejectedUntil());
+
+    // Failures while ejected are ignored
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(5)));
+    EXPECT_EQ(at(std::chrono::seconds(10)),
+              backend.health()->ejectedUntil());
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(10)));
+    EXPECT_EQ(at(std::chrono::seconds(30)),
+              backend.health()->ejectedUntil());
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(30)));
+    EXPECT_EQ(at(std::chrono::seconds(55)),
+              backend.health()->ejectedUntil());
+
+    // Once the backend has lasted the maximum since readmission, the next
+    // ejection is back to the base time
+    detector.detect(at(std::chrono::seconds(80)));
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(81)));
+    EXPECT_EQ(at(std::chrono::seconds(91)),
+              backend.health()->ejectedUntil());
+}
+
+TEST(BackendOutlierDetector, Replaced_Backend_Starts_Afresh)
+{
+    BackendStore store;
+    store.insert(Backend("backend", "dc1", "host", "ip", 100));
+
+    BackendOutlierDetector detector(&store);
+    detector.detect(at(std::chrono::seconds(0)));
+    record(*store.lookup("backend"), 0, 4);
+    detector.detect(at(std::chrono::seconds(1)));
+
+    store.remove("backend");
+    store.insert(Backend("backend", "dc1", "host", "ip", 200));
+    const Backend &backend = *store.lookup("backend");
+
+    record(backend, 0, 1);
+    detector.detect(at(std::chrono::seconds(2)));
+    EXPECT_FALSE(ejectedAt(backend, std::chrono::seconds(2)));
+}
@@ -135,3 +135,22 @@ TEST(BackendStore, Removals) {
     EXPECT_EQ(store.lookup("backend2"), nullptr);
 
 }
+
+TEST(BackendStore, Print_Shows_Unhealthy)
+{
+    BackendStore store;
+    Backend      backend1(
+        "backend1", "dc1", "backend1.bloomberg.com", "127.0.0.1", 5672);
+    EXPECT_EQ(store.insert(backend1), 0);
+
+    std::ostringstream healthy;
+    store.print(healthy);
+    EXPECT_EQ(healthy.str().find("UNHEALTHY"), std::string::npos);
+
+    // The stored copy shares its health with the inserted backend
+    backend1.health()->recordCheck(false, 1, 1);
+
+    std::ostringstream unhealthy;
+    store.print(unhealthy);
+    EXPECT_NE(unhealthy.str().find("UNHEALTHY"), std::string::npos);
+}
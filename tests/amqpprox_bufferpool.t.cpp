@@ -18,6 +18,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <thread>
+
 using namespace Bloomberg;
 using namespace amqpprox;
 
@@ -59,3 +61,85 @@ TEST(BufferPool, Different_Sizes_Different_Sources)
     EXPECT_EQ(pstats[0], std::make_tuple(1ull, 1ull, 1ull));
     EXPECT_EQ(pstats[1], std::make_tuple(2ull, 0ull, 1ull));
 }
+
+TEST(BufferPool, Smallest_Fitting_Source_Not_Power_Of_Two)
+{
+    BufferPool bp({100, 300, 200, 1000, 4096});
+
+    std::vector<std::pair<std::size_t, std::size_t>> expectations = {
+        {0, 100},
+        {1, 100},
+        {100, 100},
+        {101, 200},
+        {200, 200},
+        {201, 300},
+        {257, 300},
+        {301, 1000},
+        {1000, 1000},
+        {1001, 4096},
+        {4096, 4096}};
+
+    for (const auto &expectation : expectations) {
+        BufferHandle handle;
+        bp.acquireBuffer(&handle, expectation.first);
+        ASSERT_NE(handle.source(), nullptr) << expectation.first;
+        EXPECT_EQ(handle.source()->bufferSize(), expectation.second)
+            << expectation.first;
+    }
+
+    BufferHandle handle;
+    bp.acquireBuffer(&handle, 4097);
+    EXPECT_EQ(handle.source(), nullptr);
+}
+
+TEST(BufferPool, Release_On_Other_Thread)
+{
+    BufferPool bp({64});
+
+    const int                 numBuffers = 1000;
+    std::vector<BufferHandle> handles(numBuffers);
+    for (auto &handle : handles) {
+        bp.acquireBuffer(&handle, 64);
+    }
+
+    std::thread releaser([&handles] {
+        for (auto &handle : handles) {
+            handle.release();
+        }
+    });
+    releaser.join();
+
+    // Buffers released elsewhere are reused here through the shared depot
+    for (auto &handle : handles) {
+        bp.acquireBuffer(&handle, 64);
+    }
+
+    uint64_t                                      spillCount = 0;
+    std::vector<BufferPool::BufferAllocationStat> pstats;
+    bp.getPoolStatistics(&pstats, &spillCount);
+    EXPECT_EQ(spillCount, 0);
+    EXPECT_EQ(pstats[0], std::make_tuple(64ull, 1000ull, 1000ull));
+}
+
+TEST(BufferPool, Bytes_In_Use)
+{
+    BufferPool bp({32, 64});
+    EXPECT_EQ(bp.bytesInUse(), 0);
+
+    BufferHandle handle1;
+    bp.acquireBuffer(&handle1, 20);
+    BufferHandle handle2;
+    bp.acquireBuffer(&handle2, 64);
+    BufferHandle handle3;
+    bp.acquireBuffer(&handle3, 100);
+
+    // Pooled buffers count their whole size, spilt buffers what was asked for
+    EXPECT_EQ(bp.bytesInUse(), 32 + 64 + 100);
+
+    handle3.release();
+    EXPECT_EQ(bp.bytesInUse(), 32 + 64);
+
+    handle1.release();
+    handle2.release();
+    EXPECT_EQ(bp.bytesInUse(), 0);
+}
@@ -18,6 +18,11 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <cstring>
+#include <set>
+#include <thread>
+#include <vector>
+
 using namespace Bloomberg;
 using namespace amqpprox;
 
@@ -70,3 +75,166 @@ TEST(BufferSource, Use_Provided_Buffer)
     memset(buf2, 'F', 4096);
     EXPECT_EQ(memcmp(buf1, buf2, 4096), 0);
 }
+
+TEST(BufferSource, Concurrent_Acquire_And_Release)
+{
+    BufferSource bs(128);
+
+    const std::size_t numThreads    = 4;
+    const std::size_t numIterations = 10000;
+    const std::size_t numHeld       = BufferSource::MAGAZINE_SIZE * 3;
+
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < numThreads; ++t) {
+        threads.emplace_back([&bs, t] {
+            std::vector<void *> held;
+            for (std::size_t i = 0; i < numIterations; ++i) {
+                void *buf = bs.acquire();
+                memset(buf, static_cast<int>(t), 128);
+                held.push_back(buf);
+                if (held.size() == numHeld) {
+                    for (void *heldBuf : held) {
+                        // Nobody else wrote to the buffer while we held it
+                        EXPECT_EQ(static_cast<char *>(heldBuf)[127],
+                                  static_cast<char>(t));
+                        bs.release(heldBuf);
+                    }
+                    held.clear();
+                }
+            }
+            for (void *heldBuf : held) {
+                bs.release(heldBuf);
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    uint64_t allocationCount, deallocationCount, highwaterMark;
+    bs.allocationStats(&allocationCount, &deallocationCount, &highwaterMark);
+    EXPECT_EQ(allocationCount, numThreads * numIterations);
+    EXPECT_EQ(deallocationCount, numThreads * numIterations);
+    EXPECT_GE(highwaterMark, numHeld);
+    EXPECT_LE(highwaterMark, numThreads * numHeld);
+}
+
+TEST(BufferSource, Released_Buffers_Reused_Across_Threads)
+{
+    BufferSource bs(128);
+
+    std::set<void *> acquired;
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE * 2; ++i) {
+        acquired.insert(bs.acquire());
+    }
+
+    std::thread releaser([&bs, &acquired] {
+        for (void *buf : acquired) {
+            bs.release(buf);
+        }
+    });
+    releaser.join();
+
+    // A full magazine was handed to the depot by the releasing thread
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE; ++i) {
+        EXPECT_EQ(acquired.count(bs.acquire()), 1);
+    }
+}
+
+TEST(BufferSource, Outstanding_Summed_Across_Threads)
+{
+    BufferSource bs(128);
+
+    std::vector<void *> acquired;
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE * 2; ++i) {
+        acquired.push_back(bs.acquire());
+    }
+    EXPECT_EQ(bs.outstanding(), BufferSource::MAGAZINE_SIZE * 2);
+
+    // Released on a thread which never acquired any of them
+    std::thread releaser([&bs, &acquired] {
+        for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE; ++i) {
+            bs.release(acquired[i]);
+        }
+    });
+    releaser.join();
+    EXPECT_EQ(bs.outstanding(), BufferSource::MAGAZINE_SIZE);
+
+    for (std::size_t i = BufferSource::MAGAZINE_SIZE; i < acquired.size();
+         ++i) {
+        bs.release(acquired[i]);
+    }
+    EXPECT_EQ(bs.outstanding(), 0);
+
+    uint64_t allocationCount, deallocationCount, highwaterMark;
+    bs.allocationStats(&allocationCount, &deallocationCount, &highwaterMark);
+    EXPECT_EQ(highwaterMark, BufferSource::MAGAZINE_SIZE * 2);
+}
+
+TEST(BufferSource, Trim_Releases_Free_Slabs)
+{
+    // Sixteen buffers to a slab
+    BufferSource bs(SlabArena::SLAB_SIZE / 16);
+
+    std::vector<void *> buffers;
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE * 3; ++i) {
+        buffers.push_back(bs.acquire());
+    }
+
+    // Hold on to one buffer, keeping its slab in use
+    void *held = buffers.back();
+    buffers.pop_back();
+
+    // The first two magazines released go to the depot, the rest is kept by
+    // this thread, and both are taken by the trim
+    for (void *buf : buffers) {
+        bs.release(buf);
+    }
+
+    EXPECT_EQ(bs.trim(std::chrono::milliseconds(0)),
+              5 * SlabArena::SLAB_SIZE);
+
+    uint64_t residentSlabs, releasedBytes;
+    bs.slabStats(&residentSlabs, &releasedBytes);
+    EXPECT_EQ(residentSlabs, 1);
+    EXPECT_EQ(releasedBytes, 5 * SlabArena::SLAB_SIZE);
+    bs.release(held);
+
+    // Buffers can be acquired again after the slabs are released
+    for (auto &buf : buffers) {
+        buf = bs.acquire();
+        std::memset(buf, 0, bs.bufferSize());
+    }
+    for (void *buf : buffers) {
+        bs.release(buf);
+    }
+}
+
+TEST(BufferSource, Trim_Leaves_Caches_In_Use)
+{
+    // Sixteen buffers to a slab
+    BufferSource bs(SlabArena::SLAB_SIZE / 16);
+
+    std::set<void *> released;
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE * 3; ++i) {
+        released.insert(bs.acquire());
+    }
+    for (void *buf : released) {
+        bs.release(buf);
+    }
+
+    // Neither the depot's magazines nor this thread's have been idle long
+    // enough to be taken
+    EXPECT_EQ(bs.trim(std::chrono::hours(1)), 0);
+
+    uint64_t residentSlabs, releasedBytes;
+    bs.slabStats(&residentSlabs, &releasedBytes);
+    EXPECT_EQ(residentSlabs, 6);
+    EXPECT_EQ(releasedBytes, 0);
+
+    // So the released buffers are all still cached to be acquired again
+    for (std::size_t i = 0; i < BufferSource::MAGAZINE_SIZE * 3; ++i) {
+        EXPECT_EQ(released.count(bs.acquire()), 1);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_changedsessions.h>
+
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+TEST(ChangedSessions, Breathing)
+{
+    ChangedSessions       changed;
+    std::vector<uint64_t> ids{1, 2};
+    changed.take(&ids);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(ChangedSessions, Take_Empties_List)
+{
+    ChangedSessions changed;
+    changed.add(3);
+    changed.add(7);
+
+    std::vector<uint64_t> ids;
+    changed.take(&ids);
+    EXPECT_EQ(ids, (std::vector<uint64_t>{3, 7}));
+
+    changed.take(&ids);
+    EXPECT_TRUE(ids.empty());
+}
+
+TEST(ChangedSessions, Concurrent_Adds)
+{
+    ChangedSessions          changed;
+    std::vector<std::thread> threads;
+    for (uint64_t t = 0; t < 4; ++t) {
+        threads.emplace_back([&changed, t] {
+            for (uint64_t i = 0; i < 1000; ++i) {
+                changed.add(t * 1000 + i);
+            }
+        });
+    }
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::vector<uint64_t> ids;
+    changed.take(&ids);
+    EXPECT_EQ(ids.size(), 4000);
+}
@@ -0,0 +1,183 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_connectionmanager.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendset.h>
+#include <amqpprox_hashbackendselector.h>
+#include <amqpprox_robinbackendselector.h>
+
+#include <chrono>
+#include <memory>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendSet;
+using Bloomberg::amqpprox::ConnectionManager;
+using Bloomberg::amqpprox::HashBackendSelector;
+using Bloomberg::amqpprox::RobinBackendSelector;
+
+namespace {
+
+void markUnhealthy(const Backend &backend)
+{
+    backend.health()->recordCheck(false, 1, 1);
+}
+
+void eject(const Backend &backend, std::chrono::seconds duration)
+{
+    backend.health()->ejectUntil(std::chrono::steady_clock::now() + duration);
+}
+
+}
+
+TEST(ConnectionManager, Selections_Remembered_Per_Retry)
+{
+    RobinBackendSelector selector;
+    Backend              backend1("backend1", "dc1", "host", "ip", 100);
+    Backend              backend2("backend2", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    ConnectionManager manager(std::make_shared<BackendSet>(partitions),
+                              &selector);
+
+    EXPECT_EQ(&backend1, manager.getConnection(0));
+    EXPECT_EQ(&backend2, manager.getConnection(1));
+    EXPECT_EQ(&backend1, manager.getConnection(0));
+    EXPECT_EQ(nullptr, manager.getConnection(2));
+}
+
+TEST(ConnectionManager, Unhealthy_Backends_Tried_Last)
+{
+    RobinBackendSelector selector;
+    Backend              backend1("backend1", "dc1", "host", "ip", 100);
+    Backend              backend2("backend2", "dc1", "host", "ip", 100);
+    Backend              backend3("backend3", "dc2", "host", "ip", 100);
+    markUnhealthy(backend1);
+
+    std::vector<BackendSet::Partition> partitions(2);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[1].push_back(&backend3);
+
+    ConnectionManager manager(std::make_shared<BackendSet>(partitions),
+                              &selector);
+
+    // Unhealthy backends are passed over even for lower priority partitions
+    EXPECT_EQ(&backend2, manager.getConnection(0));
+    EXPECT_EQ(&backend3, manager.getConnection(1));
+    EXPECT_EQ(&backend1, manager.getConnection(2));
+    EXPECT_EQ(nullptr, manager.getConnection(3));
+}
+
+TEST(ConnectionManager, All_Unhealthy_Still_Tried)
+{
+    RobinBackendSelector selector;
+    Backend              backend1("backend1", "dc1", "host", "ip", 100);
+    Backend              backend2("backend2", "dc1", "host", "ip", 100);
+    markUnhealthy(backend1);
+    markUnhealthy(backend2);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    ConnectionManager manager(std::make_shared<BackendSet>(partitions),
+                              &selector);
+
+    EXPECT_EQ(&backend1, manager.getConnection(0));
+    EXPECT_EQ(&backend2, manager.getConnection(1));
+    EXPECT_EQ(nullptr, manager.getConnection(2));
+}
+
+TEST(ConnectionManager, Ejected_Backends_Tried_Last)
+{
+    RobinBackendSelector selector;
+    Backend              backend1("backend1", "dc1", "host", "ip", 100);
+    Backend              backend2("backend2", "dc1", "host", "ip", 100);
+    eject(backend1, std::chrono::seconds(60));
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    ConnectionManager manager(std::make_shared<BackendSet>(partitions),
+                              &selector);
+
+    EXPECT_EQ(&backend2, manager.getConnection(0));
+    EXPECT_EQ(&backend1, manager.getConnection(1));
+    EXPECT_EQ(nullptr, manager.getConnection(2));
+}
+
+TEST(ConnectionManager, Ejections_Capped_Per_Set)
+{
+    RobinBackendSelector selector;
+    Backend              backend1("backend1", "dc1", "host", "ip", 100);
+    Backend              backend2("backend2", "dc1", "host", "ip", 100);
+    Backend              backend3("backend3", "dc1", "host", "ip", 100);
+    Backend              backend4("backend4", "dc1", "host", "ip", 100);
+    eject(backend1, std::chrono::seconds(30));
+    eject(backend2, std::chrono::seconds(60));
+    eject(backend3, std::chrono::seconds(90));
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+    partitions[0].push_back(&backend4);
+
+    // Only half of the four may be ejected, so the backend due back first
+    // is selected as normal
+    ConnectionManager manager(
+        std::make_shared<BackendSet>(partitions), &selector, 50);
+
+    EXPECT_EQ(&backend1, manager.getConnection(0));
+    EXPECT_EQ(&backend4, manager.getConnection(1));
+    EXPECT_EQ(&backend2, manager.getConnection(2));
+    EXPECT_EQ(&backend3, manager.getConnection(3));
+    EXPECT_EQ(nullptr, manager.getConnection(4));
+}
+
+TEST(ConnectionManager, Affinity_Key_Passed_To_Selector)
+{
+    HashBackendSelector selector;
+    Backend             backend1("backend1", "dc1", "host", "ip", 100);
+    Backend             backend2("backend2", "dc1", "host", "ip", 100);
+    Backend             backend3("backend3", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+    auto backendSet = std::make_shared<BackendSet>(partitions);
+
+    for (const char *key : {"vhost1", "vhost2", "vhost3", "vhost4"}) {
+        BackendSet            expectedSet(partitions);
+        std::vector<uint64_t> markers(1, 0);
+
+        ConnectionManager manager(backendSet, &selector);
+        manager.setAffinityKey(key);
+        EXPECT_EQ(key, manager.affinityKey());
+        EXPECT_EQ(selector.selectWithAffinity(&expectedSet, markers, 0, key),
+                  manager.getConnection(0));
+    }
+}
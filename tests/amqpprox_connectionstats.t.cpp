@@ -39,3 +39,76 @@ TEST(ConnectionStats, BasicEquality)
     cs1.statsValue("pausedConnectionCount") += 1;
     EXPECT_NE(cs1, cs2);
 }
+
+TEST(ConnectionStats, Metric_Names_Match_Stats_Types)
+{
+    ASSERT_EQ(ConnectionStats::statsTypes().size(),
+              ConnectionStats::NUM_METRICS);
+    ASSERT_EQ(ConnectionStats::distributionMetrics().size(),
+              ConnectionStats::NUM_DISTRIBUTIONS);
+
+    EXPECT_EQ(ConnectionStats::metricName(
+                  ConnectionStats::Metric::PAUSED_CONNECTION_COUNT),
+              "pausedConnectionCount");
+    EXPECT_EQ(
+        ConnectionStats::metricName(ConnectionStats::FIRST_SESSION_METRIC),
+        ConnectionStats::sessionMetrics().front());
+    EXPECT_EQ(
+        ConnectionStats::metricName(ConnectionStats::Metric::BYTES_SENT),
+        "bytesSent");
+    EXPECT_EQ(ConnectionStats::distributionName(
+                  ConnectionStats::Distribution::RECEIVE_LATENCY),
+              "receiveLatency");
+
+    ConnectionStats cs;
+    cs.statsValue(ConnectionStats::Metric::FRAMES_SENT) = 3;
+    EXPECT_EQ(cs.statsValue("framesSent"), 3);
+}
+
+TEST(ConnectionStats, Subtract_Session_Metrics)
+{
+    ConnectionStats current({{"activeConnectionCount", 2},
+                             {"packetsReceived", 10},
+                             {"bytesSent", 300}},
+                            {{"sendLatency", {50, 5}}});
+    ConnectionStats previous({{"activeConnectionCount", 1},
+                              {"packetsReceived", 4},
+                              {"bytesSent", 100}},
+                             {{"sendLatency", {20, 2}}});
+
+    current.subtractSessionMetrics(previous);
+
+    // Connection counts are a snapshot, so only the session totals change
+    ConnectionStats expected({{"activeConnectionCount", 2},
+                              {"packetsReceived", 6},
+                              {"bytesSent", 200}},
+                             {{"sendLatency", {30, 3}}});
+    EXPECT_EQ(current, expected);
+    EXPECT_EQ(current.distributionValue(
+                  ConnectionStats::Distribution::SEND_LATENCY),
+              10);
+}
+
+TEST(ConnectionStats, Histograms_Follow_Session_Metrics)
+{
+    using Distribution = ConnectionStats::Distribution;
+
+    LatencyHistogram early, late;
+    early.record(10, 4);
+    late.record(900);
+
+    ConnectionStats stats;
+    stats.addHistogram(Distribution::RECEIVE_LATENCY, early);
+
+    ConnectionStats later = stats;
+    later.addHistogram(Distribution::RECEIVE_LATENCY, late);
+    later.subtractSessionMetrics(stats);
+    EXPECT_EQ(later.histogram(Distribution::RECEIVE_LATENCY), late);
+    EXPECT_EQ(later.histogram(Distribution::SEND_LATENCY), LatencyHistogram());
+
+    later.add(stats);
+    EXPECT_EQ(later.histogram(Distribution::RECEIVE_LATENCY).count(), 5);
+
+    later.clearSessionMetrics();
+    EXPECT_EQ(later.histogram(Distribution::RECEIVE_LATENCY).count(), 0);
+}
@@ -0,0 +1,82 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_connectorutil.h>
+
+#include <amqpprox_buffer.h>
+#include <amqpprox_frame.h>
+#include <amqpprox_method.h>
+#include <amqpprox_methods_start.h>
+#include <amqpprox_methods_tune.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using Bloomberg::amqpprox::Buffer;
+using Bloomberg::amqpprox::ConnectorUtil;
+using Bloomberg::amqpprox::Frame;
+using Bloomberg::amqpprox::Method;
+using namespace Bloomberg::amqpprox::methods;
+
+namespace {
+
+template <typename T>
+T decodeFrame(const Buffer &buffer)
+{
+    Frame       frame;
+    const void *endOfFrame = nullptr;
+    std::size_t remaining  = 0;
+    EXPECT_TRUE(Frame::decode(
+        &frame, &endOfFrame, &remaining, buffer.originalPtr(), buffer.size()));
+    EXPECT_EQ(remaining, 0);
+
+    Method method;
+    EXPECT_TRUE(Method::decode(&method, frame.payload, frame.length));
+    EXPECT_EQ(method.methodType, T::methodType());
+
+    T      decoded;
+    Buffer methodPayload(method.payload, method.length);
+    EXPECT_TRUE(T::decode(&decoded, methodPayload));
+    return decoded;
+}
+
+}
+
+TEST(ConnectorUtil, Synthesized_Start_Frame_Encoded_Once)
+{
+    Buffer frame = ConnectorUtil::synthesizedStartFrame();
+    EXPECT_EQ(frame.originalPtr(),
+              ConnectorUtil::synthesizedStartFrame().originalPtr());
+
+    // Nested tables are compared by pointer, so compare them as printed
+    std::ostringstream decoded, expected;
+    decoded << decodeFrame<Start>(frame);
+    expected << ConnectorUtil::synthesizedStart();
+    EXPECT_EQ(decoded.str(), expected.str());
+}
+
+TEST(ConnectorUtil, Synthesized_Tune_Frame_Encoded_Once)
+{
+    Buffer frame = ConnectorUtil::synthesizedTuneFrame();
+    EXPECT_EQ(frame.originalPtr(),
+              ConnectorUtil::synthesizedTuneFrame().originalPtr());
+
+    Tune decoded  = decodeFrame<Tune>(frame);
+    Tune expected = ConnectorUtil::synthesizedTune();
+    EXPECT_EQ(decoded.channelMax(), expected.channelMax());
+    EXPECT_EQ(decoded.frameMax(), expected.frameMax());
+    EXPECT_EQ(decoded.heartbeatInterval(), expected.heartbeatInterval());
+}
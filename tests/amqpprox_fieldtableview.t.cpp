@@ -0,0 +1,174 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_fieldtableview.h>
+
+#include <amqpprox_buffer.h>
+#include <amqpprox_fieldtable.h>
+#include <amqpprox_fieldvalue.h>
+#include <amqpprox_types.h>
+
+#include <boost/endian/arithmetic.hpp>
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+using Bloomberg::amqpprox::Buffer;
+using Bloomberg::amqpprox::FieldTable;
+using Bloomberg::amqpprox::FieldTableView;
+using Bloomberg::amqpprox::FieldValue;
+using Bloomberg::amqpprox::Types;
+
+namespace {
+
+FieldTable clientProperties()
+{
+    auto capabilities = std::make_shared<FieldTable>();
+    capabilities->pushField("publisher_confirms", FieldValue('t', true));
+    capabilities->pushField("authentication_failure_close",
+                            FieldValue('t', true));
+
+    FieldTable ft;
+    ft.pushField("product", FieldValue('S', std::string("Test Client")));
+    ft.pushField("channel_max", FieldValue('u', uint64_t(2047)));
+    ft.pushField("tags",
+                 FieldValue('A',
+                            std::vector<FieldValue>{
+                                FieldValue('S', std::string("a")),
+                                FieldValue('I', int64_t(-1))}));
+    ft.pushField("capabilities", FieldValue('F', capabilities));
+    ft.pushField("timestamp", FieldValue('T', uint64_t(1234567890)));
+    return ft;
+}
+
+std::vector<uint8_t> encode(const FieldTable &table)
+{
+    std::vector<uint8_t> data(4096);
+    Buffer               buffer(data.data(), data.size());
+    EXPECT_TRUE(Types::encodeFieldTable(buffer, table));
+    data.resize(buffer.offset());
+    return data;
+}
+
+}
+
+TEST(FieldTableView, Breathing)
+{
+    FieldTableView view;
+    FieldValue     value('V', false);
+    EXPECT_EQ(view.numberFields(), 0);
+    EXPECT_FALSE(view.findFieldValue(&value, "product"));
+}
+
+TEST(FieldTableView, Decode_Matches_Owning_Decode)
+{
+    std::vector<uint8_t> data = encode(clientProperties());
+
+    Buffer         buffer(data.data(), data.size());
+    FieldTableView view;
+    ASSERT_TRUE(Types::decodeFieldTable(&view, buffer));
+    EXPECT_EQ(buffer.available(), 0);
+    EXPECT_EQ(view.fields().originalPtr(), data.data() + 4);
+    EXPECT_EQ(view.numberFields(), 5);
+
+    // Nested tables are compared by pointer, so compare the encodings
+    FieldTable materialized;
+    EXPECT_TRUE(view.materialize(&materialized));
+    EXPECT_EQ(encode(materialized), data);
+}
+
+TEST(FieldTableView, Lookups_Decode_Only_The_Field)
+{
+    std::vector<uint8_t> data = encode(clientProperties());
+
+    Buffer         buffer(data.data(), data.size());
+    FieldTableView view;
+    ASSERT_TRUE(Types::decodeFieldTable(&view, buffer));
+
+    FieldValue value('V', false);
+    EXPECT_TRUE(view.findFieldValue(&value, "product"));
+    EXPECT_EQ(value, FieldValue('S', std::string("Test Client")));
+    EXPECT_TRUE(view.findFieldValue(&value, "timestamp"));
+    EXPECT_EQ(value, FieldValue('T', uint64_t(1234567890)));
+    EXPECT_FALSE(view.findFieldValue(&value, "missing"));
+    EXPECT_FALSE(view.findFieldValue(&value, "product_"));
+
+    FieldTableView capabilities;
+    EXPECT_FALSE(view.findFieldTable(&capabilities, "product"));
+    ASSERT_TRUE(view.findFieldTable(&capabilities, "capabilities"));
+    EXPECT_EQ(capabilities.numberFields(), 2);
+    EXPECT_TRUE(
+        capabilities.findFieldValue(&value, "authentication_failure_close"));
+    EXPECT_EQ(value, FieldValue('t', true));
+}
+
+TEST(FieldTableView, Decode_Rejects_Truncated_Fields)
+{
+    FieldTable           properties = clientProperties();
+    std::vector<uint8_t> data       = encode(properties);
+
+    // The lengths at which the table ends between two top-level fields
+    std::set<std::size_t> boundaries;
+    FieldTable            prefix;
+    boundaries.insert(encode(prefix).size() - 4);
+    for (std::size_t i = 0; i < properties.numberFields(); ++i) {
+        prefix.pushField(properties.fieldName(i), properties.fieldIndex(i));
+        boundaries.insert(encode(prefix).size() - 4);
+    }
+
+    // Shorten the table a byte at a time, so it mostly ends part way through
+    // a field, which has to reject the whole table
+    for (std::size_t length = 0; length + 4 <= data.size(); ++length) {
+        std::vector<uint8_t> truncated(data.begin(),
+                                       data.begin() + 4 + length);
+        boost::endian::big_uint32_t tableLength = length;
+        memcpy(truncated.data(), &tableLength, sizeof(tableLength));
+
+        Buffer         buffer(truncated.data(), truncated.size());
+        FieldTableView view;
+        EXPECT_EQ(Types::decodeFieldTable(&view, buffer),
+                  boundaries.count(length) == 1)
+            << length;
+    }
+}
+
+TEST(FieldTableView, Encode_Fields_Then_Table)
+{
+    std::vector<uint8_t> data = encode(clientProperties());
+
+    Buffer         buffer(data.data(), data.size());
+    FieldTableView view;
+    ASSERT_TRUE(Types::decodeFieldTable(&view, buffer));
+
+    FieldTable extra;
+    extra.pushField("amqpprox_client",
+                    FieldValue('S', std::string("host:1234")));
+
+    std::vector<uint8_t> encoded(4096);
+    Buffer               encodeBuffer(encoded.data(), encoded.size());
+    ASSERT_TRUE(Types::encodeFieldTable(encodeBuffer, view, extra));
+
+    encoded.resize(encodeBuffer.offset());
+
+    FieldTable expected = clientProperties();
+    expected.pushField("amqpprox_client",
+                       FieldValue('S', std::string("host:1234")));
+    EXPECT_EQ(encoded, encode(expected));
+}
@@ -18,6 +18,9 @@
 
 #include <cstddef>
 #include <gtest/gtest.h>
+#include <random>
+#include <stdexcept>
+#include <vector>
 
 using namespace Bloomberg;
 using namespace amqpprox;
@@ -225,3 +228,72 @@ TEST(Frame, BadFrameLength)
     EXPECT_EQ(remaining, 11111);
     EXPECT_EQ(endOfFrame, nullptr);
 }
+
+TEST(Frame, Scan_Matches_Decode_Randomized)
+{
+    std::mt19937 rng(20201016);
+
+    for (int iteration = 0; iteration < 2000; ++iteration) {
+        // A stream of frames of mostly small random sizes
+        std::vector<uint8_t> buffer;
+        int                  frames = rng() % 20;
+        for (int i = 0; i < frames; ++i) {
+            uint32_t length = rng() % 4 == 0 ? rng() % 2000 : rng() % 16;
+            buffer.push_back(rng() % 4);
+            buffer.push_back(0);
+            buffer.push_back(rng() % 3);
+            buffer.push_back(length >> 24);
+            buffer.push_back(length >> 16);
+            buffer.push_back(length >> 8);
+            buffer.push_back(length);
+            for (uint32_t j = 0; j < length; ++j) {
+                buffer.push_back(rng());
+            }
+            buffer.push_back(0xCE);
+        }
+
+        // Sometimes corrupt a byte, possibly a frame end or length, and
+        // sometimes end part way through a frame
+        if (!buffer.empty() && rng() % 3 == 0) {
+            buffer[rng() % buffer.size()] = rng();
+        }
+        if (!buffer.empty() && rng() % 2 == 0) {
+            buffer.resize(rng() % buffer.size());
+        }
+
+        std::size_t expectedFrames = 0;
+        std::size_t remaining      = buffer.size();
+        const void *next           = buffer.data();
+        bool        threw          = false;
+        try {
+            Frame frame;
+            while (Frame::decode(&frame, &next, &remaining, next, remaining)) {
+                ++expectedFrames;
+            }
+        }
+        catch (const std::runtime_error &) {
+            threw = true;
+        }
+
+        std::size_t frameCount = 3;
+        std::size_t scanned =
+            Frame::scan(&frameCount, buffer.data(), buffer.size());
+
+        ASSERT_EQ(frameCount, 3 + expectedFrames) << "iteration " << iteration;
+        ASSERT_EQ(scanned, buffer.size() - remaining)
+            << "iteration " << iteration;
+
+        // Decoding resumes where scanning stopped, throwing if it did before
+        if (threw) {
+            Frame       frame;
+            const void *end;
+            std::size_t left;
+            EXPECT_THROW(Frame::decode(&frame,
+                                       &end,
+                                       &left,
+                                       buffer.data() + scanned,
+                                       buffer.size() - scanned),
+                         std::runtime_error);
+        }
+    }
+}
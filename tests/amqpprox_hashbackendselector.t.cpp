@@ -0,0 +1,242 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_hashbackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendset.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendSet;
+using Bloomberg::amqpprox::HashBackendSelector;
+
+namespace {
+
+const int NUM_KEYS = 10000;
+
+std::vector<std::unique_ptr<Backend>> makeBackends(int count)
+{
+    std::vector<std::unique_ptr<Backend>> backends;
+    for (int i = 0; i < count; ++i) {
+        backends.push_back(std::make_unique<Backend>(
+            "backend" + std::to_string(i), "dc1", "host", "ip", 100));
+    }
+    return backends;
+}
+
+BackendSet::Partition
+toPartition(const std::vector<std::unique_ptr<Backend>> &backends)
+{
+    BackendSet::Partition partition;
+    for (const auto &backend : backends) {
+        partition.push_back(backend.get());
+    }
+    return partition;
+}
+
+const Backend *selectFor(const HashBackendSelector   &selector,
+                         const BackendSet::Partition &partition,
+                         const std::string           &key,
+                         uint64_t                     retryCount = 0)
+{
+    BackendSet            backendSet({partition});
+    std::vector<uint64_t> markers(1, 0);
+    return selector.selectWithAffinity(
+        &backendSet, markers, retryCount, key);
+}
+
+std::vector<std::string> placeKeys(const HashBackendSelector   &selector,
+                                   const BackendSet::Partition &partition)
+{
+    std::vector<std::string> placement;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        placement.push_back(
+            selectFor(selector, partition, "vhost" + std::to_string(i))
+                ->name());
+    }
+    return placement;
+}
+
+}
+
+TEST(HashBackendSelector, SelectorNamedCorrectly)
+{
+    HashBackendSelector selector;
+
+    EXPECT_EQ("consistent-hash", selector.selectorName());
+}
+
+TEST(HashBackendSelector, SelectNullValueWhenNoneAvailable)
+{
+    HashBackendSelector selector;
+
+    std::vector<BackendSet::Partition> partitions;
+    BackendSet                         backendSet(partitions);
+    std::vector<uint64_t>              markers;
+
+    EXPECT_EQ(nullptr,
+              selector.selectWithAffinity(&backendSet, markers, 0, "vhost"));
+}
+
+TEST(HashBackendSelector, SameKeySameBackend)
+{
+    HashBackendSelector selector;
+    HashBackendSelector otherSelector;
+    auto                backends  = makeBackends(5);
+    auto                partition = toPartition(backends);
+
+    std::set<const Backend *> used;
+    for (int i = 0; i < 100; ++i) {
+        std::string    key    = "vhost" + std::to_string(i);
+        const Backend *chosen = selectFor(selector, partition, key);
+        used.insert(chosen);
+
+        // Every proxy instance agrees, as do later sessions
+        EXPECT_EQ(chosen, selectFor(selector, partition, key));
+        EXPECT_EQ(chosen, selectFor(otherSelector, partition, key));
+    }
+    EXPECT_EQ(5, used.size());
+}
+
+TEST(HashBackendSelector, KeysSpreadEvenly)
+{
+    HashBackendSelector selector;
+    auto                backends = makeBackends(10);
+
+    std::map<std::string, int> counts;
+    for (const auto &name : placeKeys(selector, toPartition(backends))) {
+        ++counts[name];
+    }
+
+    ASSERT_EQ(10, counts.size());
+    for (const auto &count : counts) {
+        EXPECT_GT(count.second, NUM_KEYS / 10 * 8 / 10) << count.first;
+        EXPECT_LT(count.second, NUM_KEYS / 10 * 12 / 10) << count.first;
+    }
+}
+
+TEST(HashBackendSelector, MinimalDisruptionOnRemoval)
+{
+    HashBackendSelector selector;
+    auto                backends = makeBackends(10);
+    auto                before   = placeKeys(selector, toPartition(backends));
+
+    const std::string removed = backends[3]->name();
+    backends.erase(backends.begin() + 3);
+    auto after = placeKeys(selector, toPartition(backends));
+
+    // Only the removed backend's keys must move, and few others may
+    int needlesslyMoved = 0;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        if (before[i] != removed && before[i] != after[i]) {
+            ++needlesslyMoved;
+        }
+    }
+    EXPECT_LT(needlesslyMoved, NUM_KEYS / 50);
+}
+
+TEST(HashBackendSelector, MinimalDisruptionOnAddition)
+{
+    HashBackendSelector selector;
+    auto                backends = makeBackends(10);
+    auto                before   = placeKeys(selector, toPartition(backends));
+
+    backends.push_back(
+        std::make_unique<Backend>("backend10", "dc1", "host", "ip", 100));
+    auto after = placeKeys(selector, toPartition(backends));
+
+    // The new backend takes its share, and few keys move elsewhere
+    int movedToNew      = 0;
+    int needlesslyMoved = 0;
+    for (int i = 0; i < NUM_KEYS; ++i) {
+        if (after[i] == "backend10") {
+            ++movedToNew;
+        }
+        else if (before[i] != after[i]) {
+            ++needlesslyMoved;
+        }
+    }
+    EXPECT_GT(movedToNew, NUM_KEYS / 11 * 8 / 10);
+    EXPECT_LT(movedToNew, NUM_KEYS / 11 * 12 / 10);
+    EXPECT_LT(needlesslyMoved, NUM_KEYS / 50);
+}
+
+TEST(HashBackendSelector, RetriesTryEveryBackendInTableOrder)
+{
+    HashBackendSelector selector;
+    auto                backends  = makeBackends(4);
+    auto                partition = toPartition(backends);
+
+    // The first attempt is repeated by the first retry
+    const Backend *first = selectFor(selector, partition, "vhost");
+    EXPECT_EQ(first, selectFor(selector, partition, "vhost", 1));
+
+    std::set<const Backend *> tried;
+    for (uint64_t retry = 1; retry <= 4; ++retry) {
+        tried.insert(selectFor(selector, partition, "vhost", retry));
+    }
+    EXPECT_EQ(4, tried.size());
+    EXPECT_EQ(nullptr, selectFor(selector, partition, "vhost", 5));
+}
+
+TEST(HashBackendSelector, BusyBackendSpillsToNext)
+{
+    HashBackendSelector selector;
+    auto                backends  = makeBackends(4);
+    auto                partition = toPartition(backends);
+
+    const Backend *first = selectFor(selector, partition, "vhost");
+    const Backend *next  = selectFor(selector, partition, "vhost", 2);
+    ASSERT_NE(first, next);
+
+    for (const Backend *backend : partition) {
+        for (int i = 0; i < 4; ++i) {
+            backend->counters()->connectionOpened();
+        }
+    }
+
+    // A backend takes sessions while under 1.25 times the average, counting
+    // the new session, so 5 of 18 is within the bound and 6 of 19 isn't
+    first->counters()->connectionOpened();
+    EXPECT_EQ(first, selectFor(selector, partition, "vhost"));
+
+    first->counters()->connectionOpened();
+    EXPECT_EQ(next, selectFor(selector, partition, "vhost"));
+}
+
+TEST(HashBackendSelector, TablesOnlyRebuiltOnMembershipChange)
+{
+    HashBackendSelector selector;
+    auto                backends  = makeBackends(4);
+    auto                partition = toPartition(backends);
+
+    // A farm repartitioned without a membership change gets a new set
+    selectFor(selector, partition, "vhost1");
+    selectFor(selector, partition, "vhost2");
+    EXPECT_EQ(1, selector.tablesBuilt());
+
+    partition.pop_back();
+    selectFor(selector, partition, "vhost1");
+    EXPECT_EQ(2, selector.tablesBuilt());
+}
@@ -0,0 +1,129 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_heavyhitters.h>
+
+#include <gtest/gtest.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+TEST(HeavyHitters, Breathing)
+{
+    HeavyHitters heavyHitters(10);
+    EXPECT_EQ(heavyHitters.capacity(), 10);
+    EXPECT_EQ(heavyHitters.estimate("foo"), 0);
+
+    std::vector<HeavyHitters::Entry> top;
+    heavyHitters.top(&top);
+    EXPECT_TRUE(top.empty());
+}
+
+TEST(HeavyHitters, Few_Keys_Counted_Exactly)
+{
+    HeavyHitters heavyHitters(2);
+    EXPECT_EQ(heavyHitters.add("a", 5), 5);
+    EXPECT_EQ(heavyHitters.add("b", 1), 1);
+    EXPECT_EQ(heavyHitters.add("c", 3), 3);
+    EXPECT_EQ(heavyHitters.add("b", 1), 2);
+
+    EXPECT_EQ(heavyHitters.estimate("a"), 5);
+    EXPECT_EQ(heavyHitters.estimate("b"), 2);
+    EXPECT_EQ(heavyHitters.estimate("c"), 3);
+
+    // Only the highest two are kept, highest first
+    std::vector<HeavyHitters::Entry> top;
+    heavyHitters.top(&top);
+    ASSERT_EQ(top.size(), 2);
+    EXPECT_EQ(top[0].d_key, "a");
+    EXPECT_EQ(top[0].d_estimate, 5);
+    EXPECT_EQ(top[1].d_key, "c");
+    EXPECT_EQ(top[1].d_estimate, 3);
+
+    // A key outside the top replaces the lowest once it overtakes it
+    heavyHitters.add("b", 5);
+    heavyHitters.top(&top);
+    ASSERT_EQ(top.size(), 2);
+    EXPECT_EQ(top[0].d_key, "b");
+    EXPECT_EQ(top[0].d_estimate, 7);
+    EXPECT_EQ(top[1].d_key, "a");
+}
+
+TEST(HeavyHitters, Heavy_Keys_Found_Among_Many)
+{
+    const std::size_t width = 1024;
+    HeavyHitters      heavyHitters(10, width, 4);
+
+    std::map<std::string, uint64_t> totals;
+    uint64_t                        total = 0;
+    for (int round = 0; round < 10; ++round) {
+        for (int i = 0; i < 10; ++i) {
+            std::string key = "heavy" + std::to_string(i);
+            heavyHitters.add(key, 100 + i);
+            totals[key] += 100 + i;
+            total += 100 + i;
+        }
+        for (int i = 0; i < 10000; ++i) {
+            std::string key = "light" + std::to_string(round * 10000 + i);
+            heavyHitters.add(key, 1);
+            totals[key] += 1;
+            total += 1;
+        }
+    }
+
+    for (const auto &entry : totals) {
+        EXPECT_GE(heavyHitters.estimate(entry.first), entry.second);
+    }
+
+    std::vector<HeavyHitters::Entry> top;
+    heavyHitters.top(&top);
+    ASSERT_EQ(top.size(), 10);
+    for (const auto &entry : top) {
+        EXPECT_EQ(entry.d_key.rfind("heavy", 0), 0) << entry.d_key;
+
+        // Within the error bound of a sketch this wide
+        EXPECT_LE(entry.d_estimate, totals[entry.d_key] + 3 * total / width);
+    }
+    EXPECT_EQ(top[0].d_key, "heavy9");
+}
+
+TEST(HeavyHitters, Clear_Forgets_Everything)
+{
+    HeavyHitters heavyHitters(10);
+    heavyHitters.add("a", 5);
+    heavyHitters.clear();
+
+    EXPECT_EQ(heavyHitters.estimate("a"), 0);
+    std::vector<HeavyHitters::Entry> top;
+    heavyHitters.top(&top);
+    EXPECT_TRUE(top.empty());
+
+    EXPECT_EQ(heavyHitters.add("a", 1), 1);
+}
+
+TEST(HeavyHitters, Zero_Capacity_Only_Estimates)
+{
+    HeavyHitters heavyHitters(0);
+    heavyHitters.add("a", 5);
+    EXPECT_EQ(heavyHitters.estimate("a"), 5);
+
+    std::vector<HeavyHitters::Entry> top;
+    heavyHitters.top(&top);
+    EXPECT_TRUE(top.empty());
+}
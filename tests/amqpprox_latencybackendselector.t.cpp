@@ -0,0 +1,162 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_latencybackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendset.h>
+
+#include <chrono>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendCounters;
+using Bloomberg::amqpprox::BackendSet;
+using Bloomberg::amqpprox::LatencyBackendSelector;
+
+namespace {
+
+std::chrono::steady_clock::time_point sampleTime()
+{
+    // Samples are timed to the microsecond
+    return std::chrono::time_point_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now());
+}
+
+void recordConnect(const Backend                        &backend,
+                   std::chrono::microseconds             latency,
+                   std::chrono::steady_clock::time_point now)
+{
+    backend.counters()->recordLatency(
+        BackendCounters::Phase::CONNECT, latency, now);
+}
+
+}
+
+TEST(LatencyBackendSelector, SelectorNamedCorrectly)
+{
+    LatencyBackendSelector selector;
+
+    EXPECT_EQ("least-latency", selector.selectorName());
+}
+
+TEST(LatencyBackendSelector, SelectFastest)
+{
+    // GIVEN
+    LatencyBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    Backend backend3("backend3", "dc1", "host", "ip", 100);
+
+    auto now = std::chrono::steady_clock::now();
+    recordConnect(backend1, std::chrono::milliseconds(30), now);
+    recordConnect(backend2, std::chrono::milliseconds(5), now);
+    recordConnect(backend3, std::chrono::milliseconds(50), now);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, {0}, 0);
+
+    // THEN
+    EXPECT_EQ(&backend2, result);
+}
+
+TEST(LatencyBackendSelector, UnsampledBackendProbedFirst)
+{
+    // GIVEN
+    LatencyBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    recordConnect(backend1,
+                  std::chrono::microseconds(100),
+                  std::chrono::steady_clock::now());
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, {0}, 0);
+
+    // THEN
+    EXPECT_EQ(&backend2, result);
+}
+
+TEST(LatencyBackendSelector, CostScalesWithConnections)
+{
+    // GIVEN
+    Backend backend("backend", "dc1", "host", "ip", 100);
+
+    auto now = sampleTime();
+    recordConnect(backend, std::chrono::microseconds(1000), now);
+
+    // WHEN
+    double idle = LatencyBackendSelector::cost(backend, now);
+    backend.counters()->connectionOpened();
+    double busy = LatencyBackendSelector::cost(backend, now);
+
+    // THEN
+    EXPECT_DOUBLE_EQ(1000, idle);
+    EXPECT_DOUBLE_EQ(2000, busy);
+}
+
+TEST(LatencyBackendSelector, CostDecaysWithoutSamples)
+{
+    // GIVEN
+    Backend backend("backend", "dc1", "host", "ip", 100);
+
+    auto sampledAt = sampleTime();
+    recordConnect(backend, std::chrono::microseconds(1000), sampledAt);
+
+    // WHEN
+    double later = LatencyBackendSelector::cost(
+        backend, sampledAt + 2 * LatencyBackendSelector::DECAY_HALF_LIFE);
+
+    // THEN
+    EXPECT_DOUBLE_EQ(250, later);
+}
+
+TEST(LatencyBackendSelector, RetriesCoverWholePartition)
+{
+    // GIVEN
+    LatencyBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN/THEN
+    EXPECT_EQ(&backend1, selector.select(&backendSet, {0}, 1));
+    EXPECT_EQ(&backend2, selector.select(&backendSet, {0}, 2));
+    EXPECT_EQ(nullptr, selector.select(&backendSet, {0}, 3));
+}
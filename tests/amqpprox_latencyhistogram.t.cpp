@@ -0,0 +1,136 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_latencyhistogram.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+TEST(LatencyHistogram, Breathing)
+{
+    LatencyHistogram histogram;
+    EXPECT_EQ(histogram.count(), 0);
+    EXPECT_EQ(histogram.percentile(0.5), 0);
+}
+
+TEST(LatencyHistogram, Small_Values_Are_Exact)
+{
+    for (uint64_t value = 0; value < LatencyHistogram::SUB_BUCKETS * 2;
+         ++value) {
+        std::size_t bucket = LatencyHistogram::bucketIndex(value);
+        EXPECT_EQ(bucket, value);
+        EXPECT_EQ(LatencyHistogram::bucketUpperBound(bucket), value);
+    }
+}
+
+TEST(LatencyHistogram, Buckets_Bound_Their_Values)
+{
+    std::size_t previous = 0;
+    for (uint64_t value = 1; value < LatencyHistogram::MAX_VALUE;
+         value += value / 7 + 1) {
+        std::size_t bucket = LatencyHistogram::bucketIndex(value);
+        ASSERT_LT(bucket, LatencyHistogram::NUM_BUCKETS);
+        EXPECT_GE(bucket, previous);
+        previous = bucket;
+
+        uint64_t upper = LatencyHistogram::bucketUpperBound(bucket);
+        EXPECT_GE(upper, value);
+        EXPECT_LE(upper - value, value / LatencyHistogram::SUB_BUCKETS);
+        EXPECT_EQ(LatencyHistogram::bucketIndex(upper), bucket);
+        if (bucket + 1 < LatencyHistogram::NUM_BUCKETS) {
+            EXPECT_EQ(LatencyHistogram::bucketIndex(upper + 1), bucket + 1);
+        }
+    }
+}
+
+TEST(LatencyHistogram, Large_Values_Are_Clamped)
+{
+    EXPECT_EQ(LatencyHistogram::bucketIndex(LatencyHistogram::MAX_VALUE),
+              LatencyHistogram::NUM_BUCKETS - 1);
+    EXPECT_EQ(LatencyHistogram::bucketIndex(UINT64_MAX),
+              LatencyHistogram::NUM_BUCKETS - 1);
+    EXPECT_EQ(
+        LatencyHistogram::bucketUpperBound(LatencyHistogram::NUM_BUCKETS - 1),
+        LatencyHistogram::MAX_VALUE);
+}
+
+TEST(LatencyHistogram, Percentiles)
+{
+    LatencyHistogram histogram;
+    for (uint64_t value = 1; value <= 1000; ++value) {
+        histogram.record(value);
+    }
+
+    EXPECT_EQ(histogram.count(), 1000);
+
+    // Each percentile is within a bucket's width above the exact value
+    EXPECT_GE(histogram.percentile(0.5), 500);
+    EXPECT_LE(histogram.percentile(0.5), 500 + 500 / 8);
+    EXPECT_GE(histogram.percentile(0.9), 900);
+    EXPECT_LE(histogram.percentile(0.9), 900 + 900 / 8);
+    EXPECT_GE(histogram.percentile(0.99), 990);
+    EXPECT_LE(histogram.percentile(0.99), 990 + 990 / 8);
+    EXPECT_GE(histogram.percentile(1.0), 1000);
+    EXPECT_EQ(histogram.percentile(0.0), 1);
+}
+
+TEST(LatencyHistogram, Tail_Percentiles)
+{
+    LatencyHistogram histogram;
+    histogram.record(10, 999);
+    histogram.record(5000);
+
+    EXPECT_EQ(histogram.percentile(0.5), 10);
+    EXPECT_EQ(histogram.percentile(0.99), 10);
+    EXPECT_EQ(histogram.percentile(0.999), 10);
+    EXPECT_GE(histogram.percentile(0.9999), 5000);
+}
+
+TEST(LatencyHistogram, Add_Then_Subtract)
+{
+    LatencyHistogram first;
+    first.record(3);
+    first.record(200, 2);
+
+    LatencyHistogram second;
+    second.record(40000);
+
+    LatencyHistogram merged;
+    merged.add(first);
+    merged.add(second);
+    EXPECT_EQ(merged.count(), 4);
+    EXPECT_EQ(merged.bucketCount(LatencyHistogram::bucketIndex(200)), 2);
+
+    merged.subtract(second);
+    EXPECT_EQ(merged, first);
+    EXPECT_NE(merged, second);
+
+    merged.subtract(first);
+    EXPECT_EQ(merged, LatencyHistogram());
+    EXPECT_EQ(merged.count(), 0);
+}
+
+TEST(LatencyHistogram, Clear)
+{
+    LatencyHistogram histogram;
+    histogram.record(77);
+    histogram.clear();
+    EXPECT_EQ(histogram, LatencyHistogram());
+    EXPECT_EQ(histogram.bucketCount(LatencyHistogram::bucketIndex(77)), 0);
+}
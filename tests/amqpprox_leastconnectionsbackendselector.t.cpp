@@ -0,0 +1,176 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_leastconnectionsbackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendset.h>
+
+#include <chrono>
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendSet;
+using Bloomberg::amqpprox::LeastConnectionsBackendSelector;
+
+namespace {
+
+void openConnections(const Backend *backend, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        backend->counters()->connectionOpened();
+    }
+}
+
+}
+
+TEST(LeastConnectionsBackendSelector, SelectorNamedCorrectly)
+{
+    LeastConnectionsBackendSelector selector;
+
+    EXPECT_EQ("least-connections", selector.selectorName());
+}
+
+TEST(LeastConnectionsBackendSelector, SelectNullValueWhenNoneAvailable)
+{
+    // GIVEN
+    LeastConnectionsBackendSelector selector;
+
+    std::vector<BackendSet::Partition> partitions;
+    BackendSet                         backendSet(partitions);
+
+    std::vector<uint64_t> markers;
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, markers, 0);
+
+    // THEN
+    EXPECT_EQ(nullptr, result);
+}
+
+TEST(LeastConnectionsBackendSelector, SelectFewestConnections)
+{
+    // GIVEN
+    LeastConnectionsBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    Backend backend3("backend3", "dc1", "host", "ip", 100);
+    openConnections(&backend1, 3);
+    openConnections(&backend2, 1);
+    openConnections(&backend3, 2);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+
+    BackendSet backendSet(partitions);
+
+    std::vector<uint64_t> markers(1, 0);
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, markers, 0);
+
+    // THEN
+    EXPECT_EQ(&backend2, result);
+    EXPECT_EQ(1, backendSet.markers()[0]);
+}
+
+TEST(LeastConnectionsBackendSelector, TieBrokenByBytesPerSecond)
+{
+    // GIVEN
+    LeastConnectionsBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+
+    auto lastSecond =
+        std::chrono::steady_clock::now() - std::chrono::seconds(1);
+    backend1.counters()->addBytes(1000, lastSecond);
+    backend2.counters()->addBytes(10, lastSecond);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    BackendSet backendSet(partitions);
+
+    std::vector<uint64_t> markers(1, 0);
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, markers, 0);
+
+    // THEN
+    EXPECT_EQ(&backend2, result);
+}
+
+TEST(LeastConnectionsBackendSelector, EqualLoadTakesTurnsByMarker)
+{
+    // GIVEN
+    LeastConnectionsBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN/THEN
+    EXPECT_EQ(&backend1, selector.select(&backendSet, {0}, 0));
+    EXPECT_EQ(&backend2, selector.select(&backendSet, {1}, 0));
+}
+
+TEST(LeastConnectionsBackendSelector, RetriesCoverPartitionsInOrder)
+{
+    // GIVEN
+    LeastConnectionsBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    Backend backend3("backend3", "dc2", "host", "ip", 100);
+    openConnections(&backend1, 5);
+
+    std::vector<BackendSet::Partition> partitions(2);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[1].push_back(&backend3);
+
+    BackendSet backendSet(partitions);
+
+    std::vector<uint64_t> markers(2, 0);
+
+    // WHEN
+    std::vector<const Backend *> results;
+    for (uint64_t retry = 0; retry < 6; ++retry) {
+        results.push_back(selector.select(&backendSet, markers, retry));
+    }
+
+    // THEN
+    EXPECT_EQ(&backend2, results[0]);
+    EXPECT_EQ(std::set<const Backend *>({&backend1, &backend2}),
+              std::set<const Backend *>(results.begin() + 1,
+                                        results.begin() + 3));
+    EXPECT_EQ(&backend3, results[3]);
+    EXPECT_EQ(&backend3, results[4]);
+    EXPECT_EQ(nullptr, results[5]);
+}
@@ -206,6 +206,37 @@ TEST(MaybeSecureSocketAdaptorDataRateLimit, LimitEventuallyHit)
     }
 }
 
+TEST(MaybeSecureSocketAdaptorDataRateLimit, NoSpeculativeReadsOverLimit)
+{
+    DummyIoContext  ioContext  = 5;
+    DummyTlsContext tlsContext = 5;
+    MaybeSecureSocketAdaptor<MockSocket,
+                             MockTimer,
+                             DummyIoContext,
+                             DummyTlsContext>
+        socket(ioContext, tlsContext, false);
+
+    socket.setReadRateLimit(50);
+    EXPECT_TRUE(socket.canReadSpeculatively());
+
+    std::vector<uint8_t>           data(128);
+    boost::asio::mutable_buffers_1 buffer(data.data(), data.size());
+
+    EXPECT_CALL(*MockSocket::instance, read_some(_, _)).WillOnce(Return(55));
+    boost::system::error_code ec;
+    EXPECT_EQ(55, socket.read_some(buffer, ec));
+
+    // Over the limit reads must wait for the rate limiting in async_read_some
+    EXPECT_FALSE(socket.canReadSpeculatively());
+
+    MaybeSecureSocketAdaptor<MockSocket,
+                             MockTimer,
+                             DummyIoContext,
+                             DummyTlsContext>
+        secureSocket(ioContext, tlsContext, true);
+    EXPECT_FALSE(secureSocket.canReadSpeculatively());
+}
+
 TEST(MaybeSecureSocketAdaptorDataRateLimit, TimerHandlerLifetimes)
 {
     DummyIoContext  ioContext  = 5;
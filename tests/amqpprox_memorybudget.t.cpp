@@ -0,0 +1,206 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_memorybudget.h>
+
+#include <amqpprox_bufferhandle.h>
+#include <amqpprox_bufferpool.h>
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+
+#include <list>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+namespace {
+
+void fill(BufferPool *pool, std::list<BufferHandle> *handles, int count)
+{
+    handles->resize(count);
+    for (auto &handle : *handles) {
+        pool->acquireBuffer(&handle, 100);
+    }
+}
+
+}
+
+TEST(MemoryBudget, Breathing)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 500);
+
+    EXPECT_EQ(budget.highWatermark(), 1000);
+    EXPECT_EQ(budget.lowWatermark(), 500);
+    EXPECT_EQ(budget.bytesInUse(), 0);
+    EXPECT_FALSE(budget.exceeded());
+    EXPECT_FALSE(budget.shouldPause(1000000));
+}
+
+TEST(MemoryBudget, Low_Watermark_Clamped_To_High)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 2000);
+
+    EXPECT_EQ(budget.lowWatermark(), 1000);
+}
+
+TEST(MemoryBudget, Hysteresis)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 500);
+    budget.addReader();
+
+    std::list<BufferHandle> handles;
+    fill(&pool, &handles, 9);
+    budget.sample();
+    EXPECT_FALSE(budget.shouldPause(900));
+    EXPECT_FALSE(budget.exceeded());
+
+    handles.emplace_back();
+    pool.acquireBuffer(&handles.back(), 100);
+    budget.sample();
+    EXPECT_TRUE(budget.shouldPause(1000));
+    EXPECT_TRUE(budget.exceeded());
+
+    // Still exceeded until back down to the low watermark
+    handles.resize(6);
+    budget.sample();
+    EXPECT_TRUE(budget.shouldPause(600));
+
+    handles.resize(5);
+    budget.sample();
+    EXPECT_FALSE(budget.shouldPause(500));
+    EXPECT_FALSE(budget.exceeded());
+}
+
+TEST(MemoryBudget, Readers_See_Last_Sample)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 500);
+    budget.addReader();
+
+    // Reaching the high watermark only takes effect once sampled
+    std::list<BufferHandle> handles;
+    fill(&pool, &handles, 10);
+    EXPECT_FALSE(budget.shouldPause(1000));
+
+    budget.startSampling();
+    ioContext.run_for(
+        std::chrono::milliseconds(3 * MemoryBudget::SAMPLE_INTERVAL_MS));
+    EXPECT_TRUE(budget.shouldPause(1000));
+
+    handles.clear();
+    EXPECT_TRUE(budget.shouldPause(1000));
+    ioContext.restart();
+    ioContext.run_for(
+        std::chrono::milliseconds(3 * MemoryBudget::SAMPLE_INTERVAL_MS));
+    EXPECT_FALSE(budget.shouldPause(1000));
+    budget.stop();
+}
+
+TEST(MemoryBudget, Only_Heaviest_Readers_Pause)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 800);
+    for (int i = 0; i < 4; ++i) {
+        budget.addReader();
+    }
+
+    std::list<BufferHandle> handles;
+    fill(&pool, &handles, 10);
+    budget.sample();
+
+    // An equal share of the low watermark is 200 bytes per reader
+    EXPECT_FALSE(budget.shouldPause(0));
+    EXPECT_FALSE(budget.shouldPause(199));
+    EXPECT_TRUE(budget.shouldPause(200));
+    EXPECT_TRUE(budget.shouldPause(700));
+
+    budget.removeReader();
+    budget.removeReader();
+    EXPECT_TRUE(budget.shouldPause(400));
+    EXPECT_FALSE(budget.shouldPause(399));
+}
+
+TEST(MemoryBudget, Resume_Once_Drained)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 500);
+    budget.addReader();
+
+    std::list<BufferHandle> handles;
+    fill(&pool, &handles, 10);
+    budget.startSampling();
+    budget.sample();
+    ASSERT_TRUE(budget.shouldPause(1000));
+
+    int resumed = 0;
+    budget.waitForMemory([&resumed] { ++resumed; });
+    budget.waitForMemory([&resumed] { ++resumed; });
+
+    uint64_t paused, pauses, resumes;
+    budget.statistics(&paused, &pauses, &resumes);
+    EXPECT_EQ(paused, 2);
+    EXPECT_EQ(pauses, 2);
+    EXPECT_EQ(resumes, 0);
+
+    // Still over the low watermark, so readers stay paused across samples
+    handles.resize(8);
+    ioContext.run_for(
+        std::chrono::milliseconds(3 * MemoryBudget::SAMPLE_INTERVAL_MS));
+    EXPECT_EQ(resumed, 0);
+
+    handles.resize(5);
+    ioContext.restart();
+    ioContext.run_for(
+        std::chrono::milliseconds(3 * MemoryBudget::SAMPLE_INTERVAL_MS));
+    EXPECT_EQ(resumed, 2);
+    EXPECT_FALSE(budget.exceeded());
+
+    budget.statistics(&paused, &pauses, &resumes);
+    EXPECT_EQ(paused, 0);
+    EXPECT_EQ(pauses, 2);
+    EXPECT_EQ(resumes, 2);
+}
+
+TEST(MemoryBudget, Stop_Discards_Paused_Readers)
+{
+    boost::asio::io_context ioContext;
+    BufferPool              pool({100});
+    MemoryBudget            budget(ioContext, &pool, 1000, 500);
+
+    std::list<BufferHandle> handles;
+    fill(&pool, &handles, 10);
+    budget.startSampling();
+    budget.sample();
+    ASSERT_TRUE(budget.shouldPause(1000));
+
+    int resumed = 0;
+    budget.waitForMemory([&resumed] { ++resumed; });
+    budget.stop();
+
+    handles.clear();
+    ioContext.run();
+    EXPECT_EQ(resumed, 0);
+}
@@ -0,0 +1,169 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_metricsserver.h>
+
+#include <amqpprox_eventsource.h>
+#include <amqpprox_openmetricsrenderer.h>
+#include <amqpprox_statcollector.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+namespace http = boost::beast::http;
+
+namespace {
+
+/**
+ * \brief Runs a metrics server on its own thread, for a blocking client
+ */
+class MetricsServerTest : public ::testing::Test {
+  protected:
+    boost::asio::io_context      d_ioContext;
+    EventSource                  d_eventSource;
+    StatCollector                d_collector;
+    MetricsServer                d_server;
+    boost::asio::io_context      d_clientContext;
+    boost::asio::ip::tcp::socket d_client;
+    boost::beast::flat_buffer    d_buffer;
+
+    MetricsServerTest()
+    : d_ioContext()
+    , d_eventSource()
+    , d_collector()
+    , d_server(d_ioContext, &d_eventSource)
+    , d_clientContext()
+    , d_client(d_clientContext)
+    , d_buffer()
+    {
+    }
+
+    void connect()
+    {
+        d_client.connect(boost::asio::ip::tcp::endpoint(
+            boost::asio::ip::address_v4::loopback(), d_server.port()));
+    }
+
+    http::response<http::string_body> request(http::verb         method,
+                                              const std::string &target,
+                                              int version = 11)
+    {
+        http::request<http::empty_body> req(method, target, version);
+        req.set(http::field::host, "localhost");
+        http::write(d_client, req);
+
+        http::response<http::string_body> response;
+        if (method == http::verb::head) {
+            http::response_parser<http::string_body> parser;
+            parser.skip(true);
+            http::read(d_client, d_buffer, parser);
+            return parser.release();
+        }
+
+        http::read(d_client, d_buffer, response);
+        return response;
+    }
+
+    /**
+     * \brief Serve requests on another thread until `body` returns
+     */
+    template <typename Body>
+    void serve(Body body)
+    {
+        auto        work = boost::asio::make_work_guard(d_ioContext);
+        std::thread thread([this] { d_ioContext.run(); });
+        body();
+        d_ioContext.stop();
+        thread.join();
+    }
+};
+
+}
+
+TEST_F(MetricsServerTest, Serves_Latest_Statistics)
+{
+    boost::system::error_code ec;
+    d_server.listen(0, ec);
+    ASSERT_FALSE(ec);
+    ASSERT_NE(d_server.port(), 0);
+
+    d_collector.collectListener(5672, 0, 10);
+    d_eventSource.statisticsAvailable().emit(&d_collector);
+    ASSERT_EQ(d_server.snapshot()->listeners().size(), 1);
+
+    serve([this] {
+        connect();
+
+        auto response = request(http::verb::get, "/metrics");
+        EXPECT_EQ(response.result(), http::status::ok);
+        EXPECT_EQ(response[http::field::content_type],
+                  OpenMetricsRenderer::CONTENT_TYPE);
+        EXPECT_TRUE(response.chunked());
+        EXPECT_NE(response.body().find("\namqpprox_accepts{listenPort="
+                                       "\"5672\",listenShard=\"0\"} 10\n"),
+                  std::string::npos);
+        EXPECT_EQ(response.body().substr(response.body().size() - 6),
+                  "# EOF\n");
+
+        // The connection is kept alive for further requests
+        auto head = request(http::verb::head, "/metrics?format=text");
+        EXPECT_EQ(head.result(), http::status::ok);
+        EXPECT_TRUE(head.body().empty());
+
+        EXPECT_EQ(request(http::verb::get, "/other").result(),
+                  http::status::not_found);
+        EXPECT_EQ(request(http::verb::post, "/metrics").result(),
+                  http::status::method_not_allowed);
+    });
+}
+
+TEST_F(MetricsServerTest, Http_1_0_Body_Not_Chunked)
+{
+    boost::system::error_code ec;
+    d_server.listen(0, ec);
+    ASSERT_FALSE(ec);
+
+    serve([this] {
+        connect();
+
+        auto response = request(http::verb::get, "/metrics", 10);
+        EXPECT_EQ(response.result(), http::status::ok);
+        EXPECT_FALSE(response.chunked());
+        EXPECT_FALSE(response.keep_alive());
+        EXPECT_EQ(response.body().substr(response.body().size() - 6),
+                  "# EOF\n");
+    });
+}
+
+TEST_F(MetricsServerTest, Listen_Failure_Reported)
+{
+    boost::system::error_code ec;
+    d_server.listen(0, ec);
+    ASSERT_FALSE(ec);
+
+    MetricsServer             other(d_ioContext, &d_eventSource);
+    boost::system::error_code otherEc;
+    other.listen(d_server.port(), otherEc);
+    EXPECT_TRUE(otherEc);
+    EXPECT_EQ(other.port(), 0);
+}
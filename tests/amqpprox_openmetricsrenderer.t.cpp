@@ -0,0 +1,203 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_openmetricsrenderer.h>
+
+#include <amqpprox_connectionstats.h>
+#include <amqpprox_latencyhistogram.h>
+#include <amqpprox_statsnapshot.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+namespace {
+
+using Distribution = ConnectionStats::Distribution;
+
+std::shared_ptr<StatSnapshot> makeSnapshot()
+{
+    auto snapshot = std::make_shared<StatSnapshot>();
+    snapshot->overall() = ConnectionStats(
+        {{"activeConnectionCount", 3}, {"bytesSent", 42}},
+        {{"receiveLatency", {70, 3}}});
+
+    LatencyHistogram latency;
+    latency.record(10, 2);
+    latency.record(50);
+    snapshot->overall().addHistogram(Distribution::RECEIVE_LATENCY, latency);
+
+    snapshot->vhosts()["foo\"bar"] =
+        ConnectionStats({{"activeConnectionCount", 1}}, {});
+    snapshot->backends()["broker1"] =
+        ConnectionStats({{"activeConnectionCount", 2}}, {});
+
+    StatSnapshot::PoolStats small;
+    small.d_bufferSize        = 64;
+    small.d_currentAllocation = 5;
+    StatSnapshot::PoolStats large;
+    large.d_bufferSize        = 4096;
+    large.d_currentAllocation = 2;
+    snapshot->pool().push_back(large);
+    snapshot->pool().push_back(small);
+
+    return snapshot;
+}
+
+std::string renderAll(std::shared_ptr<const StatSnapshot> snapshot)
+{
+    OpenMetricsRenderer renderer(std::move(snapshot));
+    std::string         buffer;
+    EXPECT_TRUE(renderer.render(&buffer, std::string::npos));
+    return buffer;
+}
+
+bool contains(const std::string &text, const std::string &line)
+{
+    return text.find("\n" + line + "\n") != std::string::npos;
+}
+
+}
+
+TEST(OpenMetricsRenderer, Connection_Stats_As_Gauges)
+{
+    std::string text = renderAll(makeSnapshot());
+
+    EXPECT_EQ(text.rfind("# TYPE amqpprox_pausedConnectionCount gauge\n", 0),
+              0);
+    EXPECT_TRUE(contains(text, "# TYPE amqpprox_activeConnectionCount gauge"));
+    EXPECT_TRUE(contains(
+        text,
+        "amqpprox_activeConnectionCount{rmqEndpointType=\"overall\"} 3"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_activeConnectionCount{rmqEndpointType="
+                         "\"vhost\",rmqVhostName=\"foo\\\"bar\"} 1"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_activeConnectionCount{rmqEndpointType="
+                         "\"backends\",rmqEndpointHostname=\"broker1\"} 2"));
+    EXPECT_TRUE(
+        contains(text, "amqpprox_bytesSent{rmqEndpointType=\"overall\"} 42"));
+}
+
+TEST(OpenMetricsRenderer, Latency_Histograms)
+{
+    std::string text = renderAll(makeSnapshot());
+
+    EXPECT_TRUE(contains(text, "# TYPE amqpprox_receiveLatency histogram"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_receiveLatency_bucket{rmqEndpointType="
+                         "\"overall\",le=\"7\"} 0"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_receiveLatency_bucket{rmqEndpointType="
+                         "\"overall\",le=\"15\"} 2"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_receiveLatency_bucket{rmqEndpointType="
+                         "\"overall\",le=\"63\"} 3"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_receiveLatency_bucket{rmqEndpointType="
+                         "\"overall\",le=\"16777215\"} 3"));
+    EXPECT_TRUE(contains(text,
+                         "amqpprox_receiveLatency_bucket{rmqEndpointType="
+                         "\"overall\",le=\"+Inf\"} 3"));
+    EXPECT_TRUE(contains(
+        text, "amqpprox_receiveLatency_count{rmqEndpointType=\"overall\"} 3"));
+    EXPECT_TRUE(contains(
+        text, "amqpprox_receiveLatency_sum{rmqEndpointType=\"overall\"} 70"));
+    EXPECT_TRUE(contains(
+        text, "amqpprox_sendLatency_count{rmqEndpointType=\"overall\"} 0"));
+}
+
+TEST(OpenMetricsRenderer, Buffer_Pools_As_Gauge_Histogram)
+{
+    std::string text = renderAll(makeSnapshot());
+
+    EXPECT_TRUE(contains(text, "# TYPE amqpprox_pools gaugehistogram"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_bucket{le=\"64\"} 5"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_bucket{le=\"4096\"} 7"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_bucket{le=\"+Inf\"} 7"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_gcount 7"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_gsum 8512"));
+    EXPECT_TRUE(contains(text, "amqpprox_pools_slabs{bufferSize=\"64\"} 0"));
+
+    // Memory budget stats only appear when a budget is configured
+    EXPECT_EQ(text.find("amqpprox_buffer_memory_bytes"), std::string::npos);
+}
+
+TEST(OpenMetricsRenderer, Backend_Health_As_Gauges)
+{
+    auto snapshot = makeSnapshot();
+    EXPECT_EQ(renderAll(snapshot).find("amqpprox_backend_healthy"),
+              std::string::npos);
+
+    StatSnapshot::BackendHealthStats health;
+    health.d_backend             = "broker1";
+    health.d_healthy             = false;
+    health.d_consecutiveFailures = 4;
+    health.d_ejected             = true;
+    snapshot->backendHealth().push_back(health);
+
+    std::string text = renderAll(snapshot);
+    EXPECT_TRUE(contains(text, "# TYPE amqpprox_backend_healthy gauge"));
+    EXPECT_TRUE(
+        contains(text, "amqpprox_backend_healthy{backend=\"broker1\"} 0"));
+    EXPECT_TRUE(contains(
+        text,
+        "amqpprox_backend_consecutive_failed_checks{backend=\"broker1\"} 4"));
+    EXPECT_TRUE(
+        contains(text, "amqpprox_backend_ejected{backend=\"broker1\"} 1"));
+}
+
+TEST(OpenMetricsRenderer, Chunks_Match_Single_Render)
+{
+    auto snapshot = makeSnapshot();
+    for (int i = 0; i < 100; ++i) {
+        snapshot->sources()["source" + std::to_string(i)] = ConnectionStats();
+    }
+    std::string expected = renderAll(snapshot);
+
+    OpenMetricsRenderer renderer(snapshot);
+    std::string         text;
+    std::string         chunk;
+    int                 chunks = 0;
+    while (!renderer.finished()) {
+        chunk.clear();
+        renderer.render(&chunk, 1024);
+        ASSERT_FALSE(chunk.empty());
+        ASSERT_EQ(chunk.back(), '\n');
+        text += chunk;
+        ++chunks;
+    }
+
+    EXPECT_EQ(text, expected);
+    EXPECT_GT(chunks, 10);
+
+    const std::string eof = "# EOF\n";
+    ASSERT_GT(text.size(), eof.size());
+    EXPECT_EQ(text.substr(text.size() - eof.size()), eof);
+}
+
+TEST(OpenMetricsRenderer, Render_Appends_To_Buffer)
+{
+    OpenMetricsRenderer renderer(std::make_shared<StatSnapshot>());
+
+    std::string buffer = "existing\n";
+    EXPECT_FALSE(renderer.render(&buffer, buffer.size() + 1));
+    EXPECT_EQ(buffer.rfind("existing\n# TYPE", 0), 0);
+    EXPECT_FALSE(renderer.finished());
+}
@@ -0,0 +1,114 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_poweroftwobackendselector.h>
+
+#include <amqpprox_backend.h>
+#include <amqpprox_backendcounters.h>
+#include <amqpprox_backendset.h>
+
+#include <set>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+using Bloomberg::amqpprox::Backend;
+using Bloomberg::amqpprox::BackendSet;
+using Bloomberg::amqpprox::PowerOfTwoBackendSelector;
+
+TEST(PowerOfTwoBackendSelector, SelectorNamedCorrectly)
+{
+    PowerOfTwoBackendSelector selector;
+
+    EXPECT_EQ("power-of-two", selector.selectorName());
+}
+
+TEST(PowerOfTwoBackendSelector, SelectOnlyValueImmediately)
+{
+    // GIVEN
+    PowerOfTwoBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN
+    const Backend *result = selector.select(&backendSet, {0}, 0);
+
+    // THEN
+    EXPECT_EQ(&backend1, result);
+}
+
+TEST(PowerOfTwoBackendSelector, NeverSelectMostLoaded)
+{
+    // GIVEN
+    PowerOfTwoBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    Backend backend3("backend3", "dc1", "host", "ip", 100);
+    backend1.counters()->connectionOpened();
+    backend2.counters()->connectionOpened();
+    backend2.counters()->connectionOpened();
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN
+    std::set<const Backend *> results;
+    for (int i = 0; i < 100; ++i) {
+        results.insert(selector.select(&backendSet, {0}, 0));
+    }
+
+    // THEN
+    // Two distinct backends are always compared, so the most loaded of the
+    // three can never win, while the least loaded always wins when drawn
+    EXPECT_EQ(0, results.count(&backend2));
+    EXPECT_EQ(1, results.count(&backend3));
+}
+
+TEST(PowerOfTwoBackendSelector, RetriesCoverWholePartition)
+{
+    // GIVEN
+    PowerOfTwoBackendSelector selector;
+
+    Backend backend1("backend1", "dc1", "host", "ip", 100);
+    Backend backend2("backend2", "dc1", "host", "ip", 100);
+    Backend backend3("backend3", "dc1", "host", "ip", 100);
+
+    std::vector<BackendSet::Partition> partitions(1);
+    partitions[0].push_back(&backend1);
+    partitions[0].push_back(&backend2);
+    partitions[0].push_back(&backend3);
+
+    BackendSet backendSet(partitions);
+
+    // WHEN
+    std::set<const Backend *> results;
+    for (uint64_t retry = 1; retry < 4; ++retry) {
+        results.insert(selector.select(&backendSet, {7}, retry));
+    }
+
+    // THEN
+    EXPECT_EQ(3, results.size());
+    EXPECT_EQ(nullptr, selector.select(&backendSet, {7}, 4));
+}
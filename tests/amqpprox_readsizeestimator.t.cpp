@@ -0,0 +1,79 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_readsizeestimator.h>
+
+#include <gtest/gtest.h>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+TEST(ReadSizeEstimator, Breathing)
+{
+    ReadSizeEstimator estimator;
+    EXPECT_EQ(estimator.readSize(), ReadSizeEstimator::DEFAULT_FLOOR);
+}
+
+TEST(ReadSizeEstimator, Small_Reads_Stay_At_Floor)
+{
+    ReadSizeEstimator estimator(1024, 65536);
+    for (int i = 0; i < 100; ++i) {
+        estimator.recordRead(20, 1024);
+    }
+
+    EXPECT_LT(estimator.average(), 100);
+    EXPECT_EQ(estimator.readSize(), 1024);
+}
+
+TEST(ReadSizeEstimator, Full_Reads_Grow_To_Ceiling)
+{
+    ReadSizeEstimator estimator(1024, 65536);
+
+    std::size_t previous = estimator.readSize();
+    for (int i = 0; i < 100; ++i) {
+        std::size_t size = estimator.readSize();
+        EXPECT_GE(size, previous);
+        estimator.recordRead(size, size);
+        previous = size;
+    }
+
+    EXPECT_EQ(estimator.readSize(), 65536);
+}
+
+TEST(ReadSizeEstimator, Rounded_Up_To_Power_Of_Two)
+{
+    ReadSizeEstimator estimator(1024, 65536);
+    for (int i = 0; i < 100; ++i) {
+        estimator.recordRead(5000, 16384);
+    }
+
+    EXPECT_GE(estimator.average(), 4900);
+    EXPECT_LE(estimator.average(), 5000);
+    EXPECT_EQ(estimator.readSize(), 8192);
+}
+
+TEST(ReadSizeEstimator, Decays_After_Burst)
+{
+    ReadSizeEstimator estimator(1024, 65536);
+    for (int i = 0; i < 100; ++i) {
+        estimator.recordRead(65536, 65536);
+    }
+    ASSERT_EQ(estimator.readSize(), 65536);
+
+    for (int i = 0; i < 100; ++i) {
+        estimator.recordRead(100, 65536);
+    }
+    EXPECT_EQ(estimator.readSize(), 1024);
+}
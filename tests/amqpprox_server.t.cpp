@@ -0,0 +1,246 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_server.h>
+
+#include <amqpprox_bufferpool.h>
+#include <amqpprox_connectionselectorinterface.h>
+#include <amqpprox_constants.h>
+#include <amqpprox_dataratelimitmanager.h>
+#include <amqpprox_eventsource.h>
+#include <amqpprox_frame.h>
+#include <amqpprox_methods_close.h>
+#include <amqpprox_methods_start.h>
+#include <amqpprox_session.h>
+
+#include <boost/asio.hpp>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+namespace {
+
+using tcp = boost::asio::ip::tcp;
+
+struct SelectorMock : public ConnectionSelectorInterface {
+    virtual ~SelectorMock() {}
+
+    MOCK_METHOD2(
+        acquireConnection,
+        SessionState::ConnectionStatus(std::shared_ptr<ConnectionManager> *,
+                                       const SessionState &));
+};
+
+/**
+ * \brief Runs a server on its own threads, for blocking clients which never
+ * get as far as connecting to a broker
+ */
+class ServerTest : public ::testing::Test {
+  protected:
+    BufferPool                                d_pool;
+    SelectorMock                              d_selector;
+    EventSource                               d_eventSource;
+    DataRateLimitManager                      d_limitManager;
+    Server                                    d_server;
+    std::thread                               d_thread;
+    boost::asio::io_context                   d_clientContext;
+    std::vector<std::unique_ptr<tcp::socket>> d_clients;
+    int                                       d_port;
+
+    ServerTest();
+
+    ~ServerTest();
+
+    void run();
+
+    void connect(std::size_t count);
+
+    std::size_t sessionCount();
+
+    bool waitFor(const std::function<bool()> &condition);
+};
+
+ServerTest::ServerTest()
+: d_pool({32, 64, 128, 256, 512, 1024, 4096, 16384, Frame::getMaxFrameSize()})
+, d_selector()
+, d_eventSource()
+, d_limitManager()
+, d_server(&d_selector, &d_eventSource, &d_pool, &d_limitManager)
+, d_thread()
+, d_clientContext()
+, d_clients()
+, d_port(0)
+{
+    // Borrow a free port from the kernel for the server to listen on
+    tcp::acceptor acceptor(
+        d_clientContext,
+        tcp::endpoint(boost::asio::ip::address_v4::loopback(), 0));
+    d_port = acceptor.local_endpoint().port();
+}
+
+ServerTest::~ServerTest()
+{
+    for (auto &client : d_clients) {
+        boost::system::error_code ec;
+        client->close(ec);
+    }
+
+    if (d_thread.joinable()) {
+        d_server.stop();
+        d_thread.join();
+    }
+}
+
+void ServerTest::run()
+{
+    d_server.startListening(d_port, false);
+    d_thread = std::thread([this] { d_server.run(); });
+
+    ASSERT_TRUE(waitFor([this] {
+        std::vector<Server::ListenerStatistic> stats;
+        d_server.getListenerStatistics(&stats);
+        return !stats.empty();
+    }));
+}
+
+void ServerTest::connect(std::size_t count)
+{
+    for (std::size_t i = 0; i < count; ++i) {
+        auto client = std::make_unique<tcp::socket>(d_clientContext);
+        client->connect(
+            tcp::endpoint(boost::asio::ip::address_v4::loopback(), d_port));
+        d_clients.push_back(std::move(client));
+    }
+
+    ASSERT_TRUE(
+        waitFor([this] { return sessionCount() == d_clients.size(); }));
+}
+
+std::size_t ServerTest::sessionCount()
+{
+    std::size_t count = 0;
+    d_server.visitSessions([&count](const auto &) { ++count; });
+    return count;
+}
+
+bool ServerTest::waitFor(const std::function<bool()> &condition)
+{
+    auto deadline =
+        std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!condition()) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    return true;
+}
+
+/**
+ * \return the class and method id of the next method frame on the `client`
+ */
+std::pair<int, int> readMethod(tcp::socket &client)
+{
+    std::vector<uint8_t> frame(Frame::frameHeaderSize());
+    boost::asio::read(client, boost::asio::buffer(frame));
+    EXPECT_EQ(frame[0], 1);  // Method frame
+
+    std::size_t length = 0;
+    for (std::size_t i = 3; i < Frame::frameHeaderSize(); ++i) {
+        length = (length << 8) | frame[i];
+    }
+
+    frame.resize(length + Frame::frameOverhead());
+    boost::asio::read(
+        client,
+        boost::asio::buffer(frame.data() + Frame::frameHeaderSize(),
+                            frame.size() - Frame::frameHeaderSize()));
+
+    const uint8_t *payload = frame.data() + Frame::frameHeaderSize();
+    return {(payload[0] << 8) | payload[1], (payload[2] << 8) | payload[3]};
+}
+
+}
+
+TEST_F(ServerTest, Graceful_Disconnect_Runs_On_Each_Sessions_Worker)
+{
+    // Sessions are spread over both workers, while the graceful disconnect
+    // is requested from this thread, as the control commands do
+    d_server.addWorker();
+    ASSERT_EQ(d_server.workerCount(), 2);
+    run();
+    connect(4);
+
+    for (auto &client : d_clients) {
+        boost::asio::write(
+            *client,
+            boost::asio::buffer(Constants::protocolHeader(),
+                                Constants::protocolHeaderLength()));
+        EXPECT_EQ(readMethod(*client),
+                  std::make_pair(methods::Start::classType(),
+                                 methods::Start::methodType()));
+    }
+
+    d_server.visitSessions(
+        [](const auto &session) { session->disconnect(false); });
+
+    for (auto &client : d_clients) {
+        EXPECT_EQ(readMethod(*client),
+                  std::make_pair(methods::Close::classType(),
+                                 methods::Close::methodType()));
+    }
+}
+
+#ifdef __linux__
+// Only Linux balances connections over the sockets sharing a port
+TEST_F(ServerTest, Reuse_Port_Accepts_On_Each_Workers_Shard)
+{
+    d_server.addWorker();
+    d_server.setReusePort(true);
+    run();
+    connect(32);
+
+    std::vector<Server::ListenerStatistic> stats;
+    d_server.getListenerStatistics(&stats);
+    ASSERT_EQ(stats.size(), 2);
+
+    uint64_t    accepts         = 0;
+    std::size_t shardsAccepting = 0;
+    for (std::size_t i = 0; i < stats.size(); ++i) {
+        EXPECT_EQ(std::get<0>(stats[i]), d_port);
+        EXPECT_EQ(std::get<1>(stats[i]), i);
+        accepts += std::get<2>(stats[i]);
+        shardsAccepting += std::get<2>(stats[i]) > 0;
+    }
+
+    // The kernel hashes each connection onto a shard, so the chance that 32
+    // connections all land on the same one is negligible
+    EXPECT_EQ(accepts, 32);
+    EXPECT_GT(shardsAccepting, 1);
+}
+#endif
@@ -27,6 +27,9 @@
  * [x] End-to-end connection establishment: handshaking with both the 'client'
  *     and a simulated 'broker'
  * [x] TLS handshake failure with the newly connected 'client'
+ * [x] TLS handshake failure with the 'broker' counts against its backend
+ * [x] Write failure to the 'client' does not count against the backend
+ * [x] A 'broker' connection counts as one success, even if it drops later
  * [x] Proxy protocol header is inserted before the AMQP header
  * [X] Handshaking fails due to no broker to connect to
  * [X] Handshaking succeeds after first broker connection fails and needs to be
@@ -39,7 +42,9 @@
 #define SOCKET_TESTING 1
 
 #include <amqpprox_authinterceptinterface.h>
+#include <amqpprox_backendcounters.h>
 #include <amqpprox_backendset.h>
+#include <amqpprox_bufferhandle.h>
 #include <amqpprox_bufferpool.h>
 #include <amqpprox_connectionmanager.h>
 #include <amqpprox_connectionselectorinterface.h>
@@ -50,6 +55,7 @@
 #include <amqpprox_dnsresolver.h>
 #include <amqpprox_eventsource.h>
 #include <amqpprox_hostnamemapper.h>
+#include <amqpprox_memorybudget.h>
 #include <amqpprox_methods_close.h>
 #include <amqpprox_methods_closeok.h>
 #include <amqpprox_methods_startok.h>
@@ -73,6 +79,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
 #include <stdexcept>
 
@@ -184,6 +192,9 @@ class SessionTest : public ::testing::Test {
     void runBrokerHandshake(TestSocketState::State *clientBase, int step);
     void runStandardConnect(TestSocketState::State *clientBase);
     void runStandardConnectWithDisconnect(TestSocketState::State *clientBase);
+    void runGracefulDisconnect(Session *session, int step);
+
+    std::shared_ptr<Session> makeConnectedSession();
 
     void testSetupServerHandshake(int idx);
     void testSetupClientSendsProtocolHeader(int idx);
@@ -249,6 +260,12 @@ std::vector<TYPE> filterVariant(const std::vector<Item> &items);
 
 Data coalesce(std::initializer_list<Data> input);
 
+void frameAndByteTotals(uint64_t           *ingressFrames,
+                        uint64_t           *ingressBytes,
+                        uint64_t           *egressFrames,
+                        uint64_t           *egressBytes,
+                        const SessionState &state);
+
 void SessionTest::testSetupHostnameMapperForServerClientBase(
     TestSocketState::State &base,
     TestSocketState::State &clientBase)
@@ -638,6 +655,58 @@ void SessionTest::runStandardConnectWithDisconnect(
     testSetupHandlersCleanedUp(15);
 }
 
+void SessionTest::runGracefulDisconnect(Session *session, int step)
+{
+    // session->disconnect(false) called
+    // Client  <-----Close--------  Proxy                        Broker
+    d_serverState.pushItem(step,
+                           Func([session] { session->disconnect(false); }));
+    testSetupProxySendsCloseToClient(step);
+
+    // Client  ------CloseOk----->  Proxy                        Broker
+    // Client                       Proxy  --------Close------>  Broker
+    testSetupClientSendsCloseOk(step + 1);
+
+    // Client                       Proxy  <-------CloseOk-----  Broker
+    testSetupBrokerRespondsCloseOk(step + 2);
+
+    // After closing sockets any outstanding handlers will get aborted
+    testSetupHandlersCleanedUp(step + 3);
+
+    // Lastly, check it's elligible to be deleted
+    d_serverState.pushItem(
+        step + 4, Func([session] {
+            EXPECT_TRUE(session->finished());
+            EXPECT_EQ(session->state().getDisconnectType(),
+                      SessionState::DisconnectType::DISCONNECTED_CLEANLY);
+        }));
+}
+
+std::shared_ptr<Session> SessionTest::makeConnectedSession()
+{
+    EXPECT_CALL(d_selector, acquireConnection(_, _))
+        .WillOnce(DoAll(SetArgPointee<0>(d_cm),
+                        Return(SessionState::ConnectionStatus::SUCCESS)));
+
+    TestSocketState::State base, clientBase;
+    testSetupHostnameMapperForServerClientBase(base, clientBase);
+
+    // Initialise the state
+    d_serverState.pushItem(0, base);
+    driveTo(0);
+
+    // The connection is open once step 9 has been driven
+    runStandardConnect(&clientBase);
+
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_client, false);
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> serverSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_server, false);
+    return makeSession(clientSocket, serverSocket);
+}
+
 TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect)
 {
     EXPECT_CALL(d_selector, acquireConnection(_, _))
@@ -679,6 +748,382 @@ TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect)
     driveTo(17);
 }
 
+TEST_F(SessionTest, Connection_Then_Ping_Counts_Backend_Bytes)
+{
+    EXPECT_CALL(d_selector, acquireConnection(_, _))
+        .WillOnce(DoAll(SetArgPointee<0>(d_cm),
+                        Return(SessionState::ConnectionStatus::SUCCESS)));
+
+    TestSocketState::State base, clientBase;
+    testSetupHostnameMapperForServerClientBase(base, clientBase);
+
+    // Initialise the state
+    d_serverState.pushItem(0, base);
+    driveTo(0);
+
+    runStandardConnectWithDisconnect(&clientBase);
+
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_client, false);
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> serverSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_server, false);
+    auto session = makeSession(clientSocket, serverSocket);
+
+    session->start();
+
+    // Only the OpenOk completing the handshake and the two heartbeats were
+    // passed through, however large the read buffers were
+    d_serverState.pushItem(12, Func([this] {
+                               EXPECT_EQ(d_backend1.counters()->totalBytes(),
+                                         encode(serverOpenOk()).size() +
+                                             2 * encodeHeartbeat().size());
+                           }));
+
+    // Graceful disconnect after the heartbeats
+    d_serverState.pushItem(12,
+                           Func([&session] { session->disconnect(false); }));
+
+    // Run the tests through to completion
+    driveTo(17);
+}
+
+TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect_Pipelined)
+{
+    auto session = makeConnectedSession();
+
+    // Room for exactly two heartbeats in flight towards the client, the
+    // handshake is unaffected
+    session->setInFlightWriteLimit(2 * encodeHeartbeat().size());
+    session->start();
+
+    // Client  <-----Heartbeat----  Proxy  <-------Heartbeat---  Broker
+    // The write to the client is left outstanding, but the broker is read
+    // from again regardless. The client's items are driven first, so writes
+    // are held from there, before the heartbeat is read.
+    d_clientState.pushItem(10,
+                           Func([this] { d_serverState.holdWrites(true); }));
+    d_clientState.pushItem(10, Data(encodeHeartbeat()));
+    d_serverState.expect(10, [this](const auto &items) {
+        auto data = filterVariant<Data>(items);
+        ASSERT_EQ(data.size(), 1);
+        EXPECT_EQ(data[0], Data(encodeHeartbeat()));
+    });
+    d_clientState.expect(10, [](const auto &items) {
+        EXPECT_THAT(items,
+                    Contains(VariantWith<Call>(Call("async_read_some"))));
+    });
+
+    // Client                       Proxy  <-------Heartbeat---  Broker
+    // Queued behind the outstanding write, reaching the in-flight limit, so
+    // the broker isn't read from again
+    d_clientState.pushItem(11, Data(encodeHeartbeat()));
+    d_serverState.expect(11, [](const auto &items) {
+        EXPECT_TRUE(filterVariant<Data>(items).empty());
+    });
+    d_clientState.expect(11, [](const auto &items) {
+        EXPECT_THAT(
+            items,
+            Not(Contains(VariantWith<Call>(Call("async_read_some")))));
+    });
+
+    // Client  <-----Heartbeat----  Proxy                        Broker
+    // Completing the first write starts the queued one and resumes reading
+    d_serverState.pushItem(12, WriteComplete());
+    d_serverState.expect(12, [this](const auto &items) {
+        auto data = filterVariant<Data>(items);
+        ASSERT_EQ(data.size(), 1);
+        EXPECT_EQ(data[0], Data(encodeHeartbeat()));
+    });
+    d_clientState.expect(12, [](const auto &items) {
+        EXPECT_THAT(items,
+                    Contains(VariantWith<Call>(Call("async_read_some"))));
+    });
+
+    d_serverState.pushItem(13, WriteComplete());
+    d_serverState.pushItem(13,
+                           Func([this] { d_serverState.holdWrites(false); }));
+
+    // Graceful disconnect after the heartbeats
+    runGracefulDisconnect(session.get(), 14);
+
+    // Run the tests through to completion
+    driveTo(18);
+}
+
+TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect_Memory_Paused)
+{
+    auto session = makeConnectedSession();
+
+    // A budget with no room at all, exceeded while anything is held from
+    // its own pool, and sampled only when the test says so
+    BufferPool   budgetPool({100});
+    BufferHandle held;
+    auto         budget =
+        std::make_shared<MemoryBudget>(d_ioContext, &budgetPool, 100, 0);
+    session->setMemoryBudget(budget);
+    session->start();
+
+    // Client  ------Heartbeat--->  Proxy  --------Heartbeat-->  Broker
+    // Once over budget the heartbeat is still passed on, but the client
+    // isn't read from again
+    d_serverState.pushItem(10, Func([&budgetPool, &held, &budget] {
+                               budgetPool.acquireBuffer(&held, 100);
+                               budget->sample();
+                           }));
+    testSetupClientSendsHeartbeat(10);
+    d_serverState.expect(10, [&budget](const auto &items) {
+        EXPECT_THAT(
+            items,
+            Not(Contains(VariantWith<Call>(Call("async_read_some")))));
+
+        uint64_t paused, pauses, resumes;
+        budget->statistics(&paused, &pauses, &resumes);
+        EXPECT_EQ(paused, 1);
+        EXPECT_EQ(pauses, 1);
+    });
+
+    // Releasing the memory resumes reading from the client
+    d_serverState.pushItem(11, Func([&held, &budget] {
+                               held.release();
+                               budget->sample();
+                           }));
+    d_serverState.expect(11, [&budget](const auto &items) {
+        EXPECT_THAT(items,
+                    Contains(VariantWith<Call>(Call("async_read_some"))));
+
+        uint64_t paused, pauses, resumes;
+        budget->statistics(&paused, &pauses, &resumes);
+        EXPECT_EQ(paused, 0);
+        EXPECT_EQ(resumes, 1);
+    });
+
+    // Graceful disconnect after the heartbeat
+    runGracefulDisconnect(session.get(), 12);
+
+    // Run the tests through to completion
+    driveTo(16);
+}
+
+TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect_Speculative)
+{
+    auto session = makeConnectedSession();
+    session->setSpeculativeReads(true);
+    session->start();
+
+    auto countCalls = [](const auto &items, const char *name) {
+        auto calls = filterVariant<Call>(items);
+        return std::count(calls.begin(), calls.end(), Call(name));
+    };
+
+    // Client  ------Heartbeat--->  Proxy  --------Heartbeat-->  Broker
+    //         ------Heartbeat--->
+    // The first heartbeat wakes the waiting read. Nothing is read again
+    // until its write to the broker completes, so the second is left on the
+    // socket.
+    d_clientState.pushItem(10, Func([this] {
+                               d_clientState.holdWrites(true);
+                               d_serverState.allowSpeculativeReads(true);
+                           }));
+    d_serverState.pushItem(10, Data(encodeHeartbeat()));
+    d_serverState.pushItem(10, Data(encodeHeartbeat()));
+    d_clientState.expect(10, [this](const auto &items) {
+        auto data = filterVariant<Data>(items);
+        ASSERT_EQ(data.size(), 1);
+        EXPECT_EQ(data[0], Data(encodeHeartbeat()));
+    });
+    d_serverState.expect(10, [&countCalls](const auto &items) {
+        EXPECT_EQ(countCalls(items, "read_some"), 1);
+        EXPECT_EQ(countCalls(items, "async_read_some"), 0);
+    });
+
+    // Client                       Proxy  --------Heartbeat-->  Broker
+    // Once the write completes the second heartbeat is read straight away,
+    // without waiting for the socket, and delivered from the posted handler
+    std::size_t heldBytes = 0;
+    d_clientState.pushItem(11, WriteComplete());
+    d_clientState.expect(11, [this](const auto &items) {
+        auto data = filterVariant<Data>(items);
+        ASSERT_EQ(data.size(), 1);
+        EXPECT_EQ(data[0], Data(encodeHeartbeat()));
+    });
+    d_serverState.expect(11, [this, &countCalls, &heldBytes](
+                                 const auto &items) {
+        EXPECT_EQ(countCalls(items, "read_some"), 1);
+        EXPECT_EQ(countCalls(items, "async_read_some"), 0);
+        heldBytes = d_pool.bytesInUse();
+    });
+
+    // The next read finds nothing, so gives its buffer back and waits for
+    // the socket once more
+    d_clientState.pushItem(12, WriteComplete());
+    d_clientState.pushItem(12,
+                           Func([this] { d_clientState.holdWrites(false); }));
+    d_serverState.expect(12, [this, &countCalls, &heldBytes](
+                                 const auto &items) {
+        EXPECT_EQ(countCalls(items, "read_some"), 1);
+        EXPECT_EQ(countCalls(items, "async_read_some"), 1);
+        auto calls = filterVariant<Call>(items);
+        ASSERT_FALSE(calls.empty());
+        EXPECT_EQ(calls.back(), Call("async_read_some"));
+        EXPECT_LT(d_pool.bytesInUse(), heldBytes);
+    });
+
+    // Graceful disconnect after the heartbeats
+    runGracefulDisconnect(session.get(), 13);
+
+    // Run the tests through to completion
+    driveTo(17);
+}
+
+TEST_F(SessionTest, Speculative_Read_Failure_Disconnects_Client)
+{
+    auto session = makeConnectedSession();
+    session->setSpeculativeReads(true);
+    session->start();
+
+    // Client  ------Heartbeat--->  Proxy  --------Heartbeat-->  Broker
+    //         --RESET----------->
+    // The reset is left on the socket while the heartbeat is written
+    d_clientState.pushItem(10, Func([this] {
+                               d_clientState.holdWrites(true);
+                               d_serverState.allowSpeculativeReads(true);
+                           }));
+    d_serverState.pushItem(10, Data(encodeHeartbeat()));
+    d_serverState.pushItem(
+        10,
+        Data(std::vector<uint8_t>(), boost::asio::error::connection_reset));
+    d_clientState.expect(10, [this](const auto &items) {
+        auto data = filterVariant<Data>(items);
+        ASSERT_EQ(data.size(), 1);
+        EXPECT_EQ(data[0], Data(encodeHeartbeat()));
+    });
+
+    // The speculative read after the write completes fails, closing the
+    // session without waiting for the socket again
+    d_clientState.pushItem(11, WriteComplete());
+    d_clientState.pushItem(11,
+                           Func([this] { d_clientState.holdWrites(false); }));
+    d_serverState.expect(11, [](const auto &items) {
+        EXPECT_THAT(items, Contains(VariantWith<Call>(Call("read_some"))));
+        EXPECT_THAT(
+            items,
+            Not(Contains(VariantWith<Call>(Call("async_read_some")))));
+    });
+
+    driveTo(11);
+
+    EXPECT_TRUE(session->finished());
+    EXPECT_EQ(session->state().getDisconnectType(),
+              SessionState::DisconnectType::DISCONNECTED_CLIENT);
+}
+
+TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect_Count_Only)
+{
+    auto session = makeConnectedSession();
+
+    // The handshake is parsed as usual, the heartbeats after it are passed
+    // through unparsed
+    session->state().setCountOnly(true);
+    session->start();
+
+    // Client  <-----Heartbeat----  Proxy  <-------Heartbeat---  Broker
+    testSetupBrokerSendsHeartbeat(10);
+
+    // Client  ------Heartbeat--->  Proxy  --------Heartbeat-->  Broker
+    testSetupClientSendsHeartbeat(11);
+
+    // Graceful disconnect after the heartbeats
+    runGracefulDisconnect(session.get(), 12);
+
+    d_serverState.pushItem(16, Func([this, &session] {
+                               uint64_t ingressFrames, ingressBytes,
+                                   egressFrames, egressBytes;
+                               frameAndByteTotals(&ingressFrames,
+                                                  &ingressBytes,
+                                                  &egressFrames,
+                                                  &egressBytes,
+                                                  session->state());
+
+                               // Only the OpenOk completing the handshake is
+                               // counted, not the heartbeats passed through
+                               // after it
+                               EXPECT_EQ(ingressFrames, 0);
+                               EXPECT_EQ(ingressBytes,
+                                         encodeHeartbeat().size());
+                               EXPECT_EQ(egressFrames, 1);
+                               EXPECT_EQ(egressBytes,
+                                         encode(serverOpenOk()).size() +
+                                             encodeHeartbeat().size());
+                           }));
+
+    // Run the tests through to completion
+    driveTo(16);
+}
+
+TEST_F(SessionTest, Connection_Then_Ping_Then_Disconnect_Coalesced)
+{
+    auto session = makeConnectedSession();
+
+    // Heartbeats are small enough to be held back before being written, and
+    // the in-flight limit leaves room for all of them
+    session->setInFlightWriteLimit(1024);
+    session->setWriteCoalesceDelay(std::chrono::microseconds(100));
+    session->start();
+
+    auto expectOneWrite = [this](int step, std::size_t heartbeats) {
+        d_serverState.expect(step, [this, heartbeats](const auto &items) {
+            auto calls = filterVariant<Call>(items);
+            EXPECT_EQ(std::count(calls.begin(),
+                                 calls.end(),
+                                 Call("async_write_some")),
+                      1);
+            EXPECT_EQ(filterVariant<Data>(items),
+                      std::vector<Data>(heartbeats, Data(encodeHeartbeat())));
+        });
+    };
+
+    // Client  <-----Heartbeat x2-  Proxy  <-------Heartbeat---  Broker
+    //                                     <-------Heartbeat---
+    // The first heartbeat is held back long enough for the second to be
+    // written along with it
+    d_clientState.pushItem(10, Data(encodeHeartbeat()));
+    d_clientState.pushItem(10, Data(encodeHeartbeat()));
+    expectOneWrite(10, 2);
+
+    // Client  <-----Heartbeat----  Proxy  <-------Heartbeat---  Broker
+    // This write is left outstanding
+    d_serverState.pushItem(11,
+                           Func([this] { d_serverState.holdWrites(true); }));
+    d_clientState.pushItem(11, Data(encodeHeartbeat()));
+    expectOneWrite(11, 1);
+
+    // Client                       Proxy  <-------Heartbeat---  Broker
+    //                                     <-------Heartbeat---
+    // Both are queued behind the outstanding write
+    d_clientState.pushItem(12, Data(encodeHeartbeat()));
+    d_clientState.pushItem(12, Data(encodeHeartbeat()));
+    d_serverState.expect(12, [](const auto &items) {
+        EXPECT_TRUE(filterVariant<Data>(items).empty());
+    });
+
+    // Client  <-----Heartbeat x2-  Proxy                        Broker
+    // Once it completes, everything queued goes in a single gathered write
+    d_serverState.pushItem(13, WriteComplete());
+    expectOneWrite(13, 2);
+
+    d_serverState.pushItem(14, WriteComplete());
+    d_serverState.pushItem(14,
+                           Func([this] { d_serverState.holdWrites(false); }));
+
+    // Graceful disconnect after the heartbeats
+    runGracefulDisconnect(session.get(), 15);
+
+    // Run the tests through to completion
+    driveTo(19);
+}
+
 TEST_F(SessionTest, BadClientHandshake)
 {
     EXPECT_CALL(*d_mapper, prime(_, _)).Times(AtLeast(1));
@@ -837,6 +1282,148 @@ TEST_F(SessionTest, New_Client_Handshake_Failure)
     EXPECT_TRUE(session->finished());
 }
 
+TEST_F(SessionTest, Broker_Handshake_Failure_Counts_Backend_Failure)
+{
+    EXPECT_CALL(d_selector, acquireConnection(_, _))
+        .WillOnce(DoAll(SetArgPointee<0>(d_cm),
+                        Return(SessionState::ConnectionStatus::SUCCESS)));
+
+    TestSocketState::State base, clientBase;
+    testSetupHostnameMapperForServerClientBase(base, clientBase);
+
+    // Initialise the state
+    d_serverState.pushItem(0, base);
+    driveTo(0);
+
+    runConnectToClientOpen(&clientBase);
+
+    // Client                       Proxy  <----TCP CONNECT---->  Broker
+    testSetupProxyConnect(5, &clientBase);
+
+    // Client                       Proxy  <--HANDSHAKE FAILS-->  Broker
+    d_clientState.pushItem(
+        6, HandshakeComplete(boost::asio::error::access_denied));
+    d_serverState.expect(6, [this](const auto &items) {
+        EXPECT_THAT(items, Contains(VariantWith<Call>(Call("close"))));
+    });
+    d_clientState.expect(6, [this](const auto &items) {
+        EXPECT_THAT(items, Contains(VariantWith<Call>(Call("close"))));
+    });
+
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_client, false);
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> serverSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_server, false);
+    auto session = makeSession(clientSocket, serverSocket);
+
+    session->start();
+
+    // Run the tests through to completion
+    driveTo(6);
+
+    EXPECT_TRUE(session->finished());
+    EXPECT_EQ(session->state().getDisconnectType(),
+              SessionState::DisconnectType::DISCONNECTED_SERVER);
+    EXPECT_EQ(d_backend1.counters()->failedConnections(), 1);
+    EXPECT_EQ(d_backend1.counters()->succeededConnections(), 0);
+    EXPECT_EQ(d_backend1.counters()->connections(), 0);
+}
+
+TEST_F(SessionTest, Client_Write_Failure_Does_Not_Count_Against_Backend)
+{
+    EXPECT_CALL(d_selector, acquireConnection(_, _))
+        .WillOnce(DoAll(SetArgPointee<0>(d_cm),
+                        Return(SessionState::ConnectionStatus::SUCCESS)));
+
+    TestSocketState::State base, clientBase;
+    testSetupHostnameMapperForServerClientBase(base, clientBase);
+
+    // Initialise the state
+    d_serverState.pushItem(0, base);
+    driveTo(0);
+
+    runStandardConnect(&clientBase);
+
+    // Client  <--WRITE FAILS-----  Proxy  <-------Heartbeat---  Broker
+    d_clientState.pushItem(10, Func([this] {
+                               d_serverState.failWrites(
+                                   boost::asio::error::broken_pipe);
+                           }));
+    d_clientState.pushItem(10, Data(encodeHeartbeat()));
+    d_serverState.expect(10, [this](const auto &items) {
+        EXPECT_THAT(items, Contains(VariantWith<Call>(Call("close"))));
+    });
+    d_clientState.expect(10, [this](const auto &items) {
+        EXPECT_THAT(items, Contains(VariantWith<Call>(Call("close"))));
+    });
+
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_client, false);
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> serverSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_server, false);
+    auto session = makeSession(clientSocket, serverSocket);
+
+    session->start();
+
+    // Run the tests through to completion
+    driveTo(10);
+
+    EXPECT_TRUE(session->finished());
+    EXPECT_EQ(session->state().getDisconnectType(),
+              SessionState::DisconnectType::DISCONNECTED_CLIENT);
+    EXPECT_EQ(d_backend1.counters()->failedConnections(), 0);
+    EXPECT_EQ(d_backend1.counters()->succeededConnections(), 1);
+    EXPECT_EQ(d_backend1.counters()->connections(), 0);
+}
+
+TEST_F(SessionTest, Broker_Drop_After_Start_Counts_Backend_Snapped)
+{
+    EXPECT_CALL(d_selector, acquireConnection(_, _))
+        .WillOnce(DoAll(SetArgPointee<0>(d_cm),
+                        Return(SessionState::ConnectionStatus::SUCCESS)));
+
+    TestSocketState::State base, clientBase;
+    testSetupHostnameMapperForServerClientBase(base, clientBase);
+
+    // Initialise the state
+    d_serverState.pushItem(0, base);
+    driveTo(0);
+
+    runStandardConnect(&clientBase);
+
+    // Client                       Proxy  <--READ FAILS-------  Broker
+    d_clientState.pushItem(
+        10,
+        Data(std::vector<uint8_t>(), boost::asio::error::connection_reset));
+
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> clientSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_client, false);
+    std::shared_ptr<MaybeSecureSocketAdaptor<>> serverSocket =
+        std::make_shared<MaybeSecureSocketAdaptor<>>(
+            d_ioContext, d_server, false);
+    auto session = makeSession(clientSocket, serverSocket);
+
+    session->start();
+
+    // Run the tests through to completion
+    driveTo(10);
+
+    // The broker is blamed for the disconnect. The connection it accepted
+    // has already been counted as a success, so dropping it is counted as
+    // snapped rather than failed.
+    EXPECT_TRUE(session->finished());
+    EXPECT_EQ(session->state().getDisconnectType(),
+              SessionState::DisconnectType::DISCONNECTED_SERVER);
+    EXPECT_EQ(d_backend1.counters()->failedConnections(), 0);
+    EXPECT_EQ(d_backend1.counters()->succeededConnections(), 1);
+    EXPECT_EQ(d_backend1.counters()->snappedConnections(), 1);
+}
+
 TEST_F(SessionTest, Connection_To_Proxy_Protocol)
 {
     Backend backendPP("backend1", "dc1", "localhost", "127.0.0.1", 5672, true);
@@ -1311,8 +1898,8 @@ TEST_F(SessionTest, Authorized_Client_Test)
     methods::StartOk overriddenStartOk = clientStartOk();
     overriddenStartOk.setAuthMechanism(modifiedMechanism);
     overriddenStartOk.setCredentials(modifiedCredentials);
-    overriddenStartOk.properties().pushField("amqpprox_auth",
-                                             FieldValue('S', reason));
+    overriddenStartOk.pushClientProperty("amqpprox_auth",
+                                         FieldValue('S', reason));
     testSetupProxySendsStartOk(
         7, "host1", 2345, LOCAL_HOSTNAME, 1234, 32000, overriddenStartOk);
     testSetupProxyOpen(8);
@@ -1820,6 +2407,26 @@ Data coalesce(std::initializer_list<Data> input)
     return Data(buffer, ec);
 }
 
+void frameAndByteTotals(uint64_t           *ingressFrames,
+                        uint64_t           *ingressBytes,
+                        uint64_t           *egressFrames,
+                        uint64_t           *egressBytes,
+                        const SessionState &state)
+{
+    uint64_t ingressPackets, ingressLatencyTotal, ingressLatencyCount,
+        egressPackets, egressLatencyTotal, egressLatencyCount;
+    state.getTotals(&ingressPackets,
+                    ingressFrames,
+                    ingressBytes,
+                    &ingressLatencyTotal,
+                    &ingressLatencyCount,
+                    &egressPackets,
+                    egressFrames,
+                    egressBytes,
+                    &egressLatencyTotal,
+                    &egressLatencyCount);
+}
+
 SessionTest::SessionTest()
 : d_ioContext()
 , d_pool({32,
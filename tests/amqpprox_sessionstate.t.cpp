@@ -22,6 +22,8 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <sstream>
+
 using namespace Bloomberg::amqpprox;
 using namespace boost::asio;
 using namespace ::testing;
@@ -86,3 +88,83 @@ TEST(SessionState, hostnameMapper)
     EXPECT_EQ(ip1, s.hostname(egress.first));
     EXPECT_EQ(ip2, s.hostname(egress.second));
 }
+
+TEST(SessionState, readTotals)
+{
+    SessionState state;
+    state.recordIngressRead(100);
+    state.recordIngressRead(300);
+    state.recordEgressRead(65536);
+
+    uint64_t ingressReads, ingressReadBytes, egressReads, egressReadBytes;
+    state.getReadTotals(
+        &ingressReads, &ingressReadBytes, &egressReads, &egressReadBytes);
+    EXPECT_EQ(ingressReads, 2);
+    EXPECT_EQ(ingressReadBytes, 400);
+    EXPECT_EQ(egressReads, 1);
+    EXPECT_EQ(egressReadBytes, 65536);
+
+    std::ostringstream oss;
+    oss << state;
+    EXPECT_NE(oss.str().find("Avg. Read: 200B 5243 reads/MB"),
+              std::string::npos);
+    EXPECT_NE(oss.str().find("Avg. Read: 65536B 16 reads/MB"),
+              std::string::npos);
+}
+
+TEST(SessionState, changedSessions)
+{
+    ChangedSessions       changed;
+    std::vector<uint64_t> ids;
+
+    SessionState state;
+    state.incrementIngressTotals(1, 10);
+
+    // Added once it has a list, so that it's collected at least once
+    state.setChangedSessions(&changed);
+    changed.take(&ids);
+    EXPECT_EQ(ids, std::vector<uint64_t>{state.id()});
+
+    // Not added again until the changed flag is cleared
+    state.incrementIngressTotals(1, 10);
+    state.setPaused(true);
+    changed.take(&ids);
+    EXPECT_TRUE(ids.empty());
+
+    state.clearChanged();
+    state.recordIngressRead(10);
+    changed.take(&ids);
+    EXPECT_TRUE(ids.empty());
+
+    state.addEgressLatency(5);
+    state.setDisconnected(SessionState::DisconnectType::DISCONNECTED_CLIENT);
+    changed.take(&ids);
+    EXPECT_EQ(ids, std::vector<uint64_t>{state.id()});
+}
+
+TEST(SessionState, latencyHistograms)
+{
+    SessionState state;
+    state.addIngressLatency(3);
+    state.addIngressLatency(3);
+    state.addIngressLatency(250);
+    state.addEgressLatency(90);
+
+    LatencyHistogram ingress, egress;
+    state.takeLatencyHistograms(&ingress, &egress);
+
+    LatencyHistogram expectedIngress, expectedEgress;
+    expectedIngress.record(3, 2);
+    expectedIngress.record(250);
+    expectedEgress.record(90);
+    EXPECT_EQ(ingress, expectedIngress);
+    EXPECT_EQ(egress, expectedEgress);
+
+    // Taken samples aren't counted again, later ones are added on
+    state.addEgressLatency(7);
+    state.takeLatencyHistograms(&ingress, &egress);
+
+    expectedEgress.record(7);
+    EXPECT_EQ(ingress, expectedIngress);
+    EXPECT_EQ(egress, expectedEgress);
+}
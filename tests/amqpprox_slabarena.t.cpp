@@ -0,0 +1,143 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_slabarena.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+#include <set>
+#include <vector>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+TEST(SlabArena, Breathing)
+{
+    SlabArena arena(100);
+    EXPECT_EQ(arena.bufferSize(), 100);
+    EXPECT_EQ(arena.slabSize(), SlabArena::SLAB_SIZE);
+    EXPECT_EQ(arena.residentSlabs(), 0);
+    EXPECT_EQ(arena.releasedBytes(), 0);
+}
+
+TEST(SlabArena, Buffers_Are_Distinct_And_Writable)
+{
+    SlabArena arena(1);
+
+    std::set<void *> buffers;
+    for (int i = 0; i < 1000; ++i) {
+        void *buf = arena.allocate();
+        ASSERT_NE(buf, nullptr);
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(buf) % alignof(std::max_align_t),
+                  0);
+        *static_cast<char *>(buf) = 'x';
+        EXPECT_TRUE(buffers.insert(buf).second);
+    }
+
+    EXPECT_EQ(arena.residentSlabs(), 1);
+}
+
+TEST(SlabArena, Released_Buffer_Reused)
+{
+    SlabArena arena(64);
+
+    void *buf1 = arena.allocate();
+    void *buf2 = arena.allocate();
+    arena.deallocate(buf1);
+
+    EXPECT_EQ(arena.allocate(), buf1);
+    EXPECT_NE(arena.allocate(), buf2);
+}
+
+TEST(SlabArena, Grows_By_Slab)
+{
+    SlabArena   arena(SlabArena::SLAB_SIZE / 4);
+    std::size_t perSlab = 4;
+
+    std::vector<void *> buffers;
+    for (std::size_t i = 0; i < perSlab * 2 + 1; ++i) {
+        buffers.push_back(arena.allocate());
+        std::memset(buffers.back(), 0xab, arena.bufferSize());
+    }
+
+    EXPECT_EQ(arena.residentSlabs(), 3);
+}
+
+TEST(SlabArena, Buffers_Larger_Than_A_Slab)
+{
+    SlabArena arena(SlabArena::SLAB_SIZE + 1);
+    EXPECT_EQ(arena.slabSize(), SlabArena::SLAB_SIZE * 2);
+
+    void *buf1 = arena.allocate();
+    void *buf2 = arena.allocate();
+    std::memset(buf1, 1, arena.bufferSize());
+    std::memset(buf2, 2, arena.bufferSize());
+    EXPECT_EQ(arena.residentSlabs(), 2);
+
+    arena.deallocate(buf1);
+    arena.deallocate(buf2);
+}
+
+TEST(SlabArena, Trim_Only_Idle_Empty_Slabs)
+{
+    SlabArena                    arena(SlabArena::SLAB_SIZE / 2);
+    SlabArena::Clock::time_point start = SlabArena::Clock::now();
+    std::chrono::seconds         idle(10);
+
+    std::vector<void *> buffers;
+    for (int i = 0; i < 4; ++i) {
+        buffers.push_back(arena.allocate());
+    }
+    ASSERT_EQ(arena.residentSlabs(), 2);
+
+    // Empty the second slab, leaving one buffer in use in the first
+    arena.deallocate(buffers[1], start);
+    arena.deallocate(buffers[2], start);
+    arena.deallocate(buffers[3], start);
+
+    EXPECT_EQ(arena.trim(idle, start + idle / 2), 0);
+    EXPECT_EQ(arena.residentSlabs(), 2);
+
+    EXPECT_EQ(arena.trim(idle, start + idle), arena.slabSize());
+    EXPECT_EQ(arena.residentSlabs(), 1);
+    EXPECT_EQ(arena.releasedBytes(), arena.slabSize());
+
+    // Already released slabs aren't counted again
+    EXPECT_EQ(arena.trim(idle, start + idle * 2), 0);
+}
+
+TEST(SlabArena, Released_Slab_Reused)
+{
+    SlabArena                    arena(SlabArena::SLAB_SIZE / 2);
+    SlabArena::Clock::time_point start = SlabArena::Clock::now();
+
+    void *buf1 = arena.allocate();
+    void *buf2 = arena.allocate();
+    arena.deallocate(buf1, start);
+    arena.deallocate(buf2, start);
+    ASSERT_EQ(arena.trim(std::chrono::seconds(0), start), arena.slabSize());
+    EXPECT_EQ(arena.residentSlabs(), 0);
+
+    // Buffers are carved again from the start of the released slab
+    void *buf3 = arena.allocate();
+    void *buf4 = arena.allocate();
+    EXPECT_EQ(buf3, buf1);
+    EXPECT_EQ(buf4, buf2);
+    std::memset(buf3, 3, arena.bufferSize());
+    EXPECT_EQ(arena.residentSlabs(), 1);
+    EXPECT_EQ(arena.releasedBytes(), 0);
+}
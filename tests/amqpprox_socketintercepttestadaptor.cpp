@@ -78,6 +78,11 @@ SocketInterceptTestAdaptor::available(boost::system::error_code &ec)
     throw std::runtime_error("No item available");
 }
 
+bool SocketInterceptTestAdaptor::canReadSpeculatively()
+{
+    return d_state.speculativeReadsAllowed();
+}
+
 void SocketInterceptTestAdaptor::async_shutdown(AsyncShutdownHandler handler)
 {
     d_state.recordCall("async_shutdown");
@@ -112,6 +117,20 @@ void SocketInterceptTestAdaptor::async_write_some(
     for (auto &buf : buffers) {
         sz += d_state.recordData(buf.first, buf.second, ec);
     }
+
+    if (d_state.writesHeld()) {
+        d_heldWrites.emplace_back(
+            [handler, ec, sz](boost::system::error_code completionEc) {
+                if (completionEc) {
+                    handler(completionEc, 0);
+                }
+                else {
+                    handler(ec, sz);
+                }
+            });
+        return;
+    }
+
     handler(ec, sz);
 }
 
@@ -122,9 +141,18 @@ std::size_t SocketInterceptTestAdaptor::read_some(
     d_state.recordCall("read_some");
 
     if (!d_currentData) {
+        if (d_state.speculativeReadsAllowed()) {
+            ec = boost::asio::error::would_block;
+            return 0;
+        }
+
         throw std::runtime_error("No data for read_some when expected");
     }
 
+    if (d_currentData->d_ec) {
+        ec = d_currentData->d_ec;
+    }
+
     std::size_t sz  = 0;
     auto &      src = d_currentData->d_value;
 
@@ -179,6 +207,16 @@ void SocketInterceptTestAdaptor::drive(TestSocketState::Item *item)
                 "No connection handler, connection not expected");
         }
     }
+    else if (auto write = std::get_if<TestSocketState::WriteComplete>(item)) {
+        if (d_heldWrites.empty()) {
+            throw std::runtime_error(
+                "No write outstanding, write completion not expected");
+        }
+
+        auto completion = d_heldWrites.front();
+        d_heldWrites.pop_front();
+        completion(write->d_ec);
+    }
     else if (auto data = std::get_if<TestSocketState::Data>(item)) {
         if (d_readHandler) {
             auto handler  = d_readHandler;
@@ -186,6 +224,11 @@ void SocketInterceptTestAdaptor::drive(TestSocketState::Item *item)
             d_currentData = data;
             handler(data->d_ec, data->d_value.size());
         }
+        else if (d_state.speculativeReadsAllowed()) {
+            // Nobody is waiting on the socket, so the data is left for the
+            // next speculative read_some
+            d_currentData = data;
+        }
     }
     else {
         throw std::runtime_error("No read handler, data not expected");
@@ -21,6 +21,9 @@
 
 #include <amqpprox_testsocketstate.h>
 
+#include <deque>
+#include <functional>
+
 namespace Bloomberg {
 namespace amqpprox {
 
@@ -36,11 +39,14 @@ namespace amqpprox {
  * documentation for that will not be duplicated here.
  */
 class SocketInterceptTestAdaptor : public SocketInterceptInterface {
+    using HeldWrite = std::function<void(boost::system::error_code)>;
+
     TestSocketState &      d_state;
     AsyncReadHandler       d_readHandler;
     AsyncConnectHandler    d_connectionHandler;
     AsyncHandshakeHandler  d_handshakeHandler;
     TestSocketState::Data *d_currentData;
+    std::deque<HeldWrite>  d_heldWrites;  // completions of held writes
 
     /**
      * \brief Private function that receives asynchronous events
@@ -91,6 +97,8 @@ class SocketInterceptTestAdaptor : public SocketInterceptInterface {
 
     virtual std::size_t available(boost::system::error_code &ec) override;
 
+    virtual bool canReadSpeculatively() override;
+
     virtual void async_shutdown(AsyncShutdownHandler handler) override;
 
     virtual void async_connect(const endpoint &    peer_endpoint,
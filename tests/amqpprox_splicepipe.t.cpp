@@ -0,0 +1,161 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_splicepipe.h>
+
+#include <boost/asio.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace Bloomberg::amqpprox;
+
+namespace {
+
+class SplicePipeTest : public ::testing::Test {
+  protected:
+    int d_source[2];
+    int d_destination[2];
+
+    void SetUp() override
+    {
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, d_source));
+        ASSERT_EQ(0, socketpair(AF_UNIX, SOCK_STREAM, 0, d_destination));
+        for (int fd : {d_source[1], d_destination[0]}) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    void TearDown() override
+    {
+        for (int fd :
+             {d_source[0], d_source[1], d_destination[0], d_destination[1]}) {
+            if (fd >= 0) {
+                ::close(fd);
+            }
+        }
+    }
+};
+
+}
+
+TEST_F(SplicePipeTest, Breathing)
+{
+    SplicePipe pipe;
+    EXPECT_FALSE(pipe.isOpen());
+    EXPECT_EQ(pipe.pending(), 0);
+}
+
+#ifdef __linux__
+
+TEST_F(SplicePipeTest, Fill_Then_Drain)
+{
+    SplicePipe                pipe;
+    boost::system::error_code ec;
+    pipe.open(ec);
+    ASSERT_FALSE(ec);
+    ASSERT_TRUE(pipe.isOpen());
+
+    const std::string data("AMQP\x00\x00\x09\x01", 8);
+    ASSERT_EQ(data.size(), ::write(d_source[0], data.data(), data.size()));
+
+    EXPECT_EQ(data.size(), pipe.fill(d_source[1], 65536, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(data.size(), pipe.pending());
+
+    EXPECT_EQ(data.size(), pipe.drain(d_destination[0], ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(0, pipe.pending());
+
+    std::string received(data.size(), '\0');
+    ASSERT_EQ(data.size(),
+              ::read(d_destination[1], &received[0], received.size()));
+    EXPECT_EQ(data, received);
+}
+
+TEST_F(SplicePipeTest, Fill_Respects_Max_Bytes)
+{
+    SplicePipe                pipe;
+    boost::system::error_code ec;
+    pipe.open(ec);
+    ASSERT_FALSE(ec);
+
+    const std::string data(100, 'x');
+    ASSERT_EQ(data.size(), ::write(d_source[0], data.data(), data.size()));
+
+    EXPECT_EQ(60, pipe.fill(d_source[1], 60, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(40, pipe.fill(d_source[1], 60, ec));
+    EXPECT_FALSE(ec);
+    EXPECT_EQ(100, pipe.pending());
+}
+
+TEST_F(SplicePipeTest, Fill_Would_Block_Without_Data)
+{
+    SplicePipe                pipe;
+    boost::system::error_code ec;
+    pipe.open(ec);
+    ASSERT_FALSE(ec);
+
+    EXPECT_EQ(0, pipe.fill(d_source[1], 65536, ec));
+    EXPECT_EQ(boost::asio::error::would_block, ec);
+}
+
+TEST_F(SplicePipeTest, Fill_Eof_On_Shutdown)
+{
+    SplicePipe                pipe;
+    boost::system::error_code ec;
+    pipe.open(ec);
+    ASSERT_FALSE(ec);
+
+    ::close(d_source[0]);
+    d_source[0] = -1;
+
+    EXPECT_EQ(0, pipe.fill(d_source[1], 65536, ec));
+    EXPECT_EQ(boost::asio::error::eof, ec);
+}
+
+TEST_F(SplicePipeTest, Drain_Would_Block_Keeps_Pending)
+{
+    SplicePipe                pipe;
+    boost::system::error_code ec;
+    pipe.open(ec);
+    ASSERT_FALSE(ec);
+
+    // Fill the destination until it can't take any more
+    const std::string chunk(4096, 'y');
+    while (::write(d_destination[0], chunk.data(), chunk.size()) > 0) {
+    }
+
+    ASSERT_EQ(chunk.size(),
+              ::write(d_source[0], chunk.data(), chunk.size()));
+    EXPECT_EQ(chunk.size(), pipe.fill(d_source[1], 65536, ec));
+    EXPECT_FALSE(ec);
+
+    pipe.drain(d_destination[0], ec);
+    EXPECT_EQ(boost::asio::error::would_block, ec);
+    EXPECT_GT(pipe.pending(), 0);
+
+    pipe.close();
+    EXPECT_FALSE(pipe.isOpen());
+    EXPECT_EQ(0, pipe.pending());
+}
+
+#endif
@@ -15,11 +15,16 @@
 */
 #include <amqpprox_statcollector.h>
 
+#include <amqpprox_backend.h>
+#include <amqpprox_backendhealth.h>
+#include <amqpprox_backendstore.h>
 #include <amqpprox_bufferpool.h>
 #include <amqpprox_cpumonitor.h>
 #include <amqpprox_sessionstate.h>
 
 #include <map>
+#include <memory>
+#include <vector>
 
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
@@ -105,6 +110,40 @@ TEST(StatCollector, Simple_Single_Session)
     EXPECT_EQ(snapshot.overall(), zeroStats);
 }
 
+TEST(StatCollector, Count_Only_Session_Left_Out_Of_Frames)
+{
+    StatSnapshot snapshot;
+
+    SessionState state1(nullptr);
+    SessionState state2(nullptr);
+    state1.setVirtualHost("foo");
+    state1.incrementEgressTotals(2, 3);
+    state1.incrementIngressTotals(4, 5);
+    state2.setVirtualHost("foo");
+    state2.setCountOnly(true);
+    state2.incrementEgressTotals(1, 30);
+    state2.incrementIngressTotals(1, 50);
+
+    StatCollector sc;
+    sc.collect(state1);
+    sc.collect(state2);
+
+    ConnectionStats expectedStats(
+        {{"activeConnectionCount", 2},
+         {"countOnlyConnectionCount", 1},
+         {"packetsReceived", 2},
+         {"packetsSent", 2},
+         {"framesReceived", 4},
+         {"framesSent", 2},
+         {"bytesReceived", 55},
+         {"bytesSent", 33}},
+        {});
+
+    sc.populateStats(&snapshot);
+    EXPECT_EQ(snapshot.overall(), expectedStats);
+    EXPECT_EQ(snapshot.vhosts()["foo"], expectedStats);
+}
+
 TEST(StatCollector, Multiple_Session)
 {
     ConnectionStats zeroStats;
@@ -372,3 +411,409 @@ TEST(StatCollector, Pool_Two_Stats)
     EXPECT_EQ(statMap[200].d_highwaterMark, 1);
     EXPECT_EQ(statMap[200].d_currentAllocation, 0);
 }
+
+TEST(StatCollector, Pool_Multiple_Pools_Summed)
+{
+    BufferPool    bp1({100, 200});
+    BufferPool    bp2({100, 300});
+    StatCollector sc;
+    sc.setBufferPool(&bp1);
+    sc.addBufferPool(&bp2);
+
+    BufferHandle handle1;
+    BufferHandle handle2;
+    BufferHandle handle3;
+    BufferHandle handle4;
+    bp1.acquireBuffer(&handle1, 99);
+    bp2.acquireBuffer(&handle2, 99);
+    bp2.acquireBuffer(&handle3, 250);
+    bp1.acquireBuffer(&handle4, 1000);
+    handle4.release();
+    bp2.acquireBuffer(&handle4, 1000);
+
+    StatSnapshot stats;
+    sc.populateStats(&stats);
+
+    EXPECT_EQ(stats.pool().size(), 3);
+    EXPECT_EQ(stats.poolSpillover(), 2);
+
+    std::map<std::size_t, StatSnapshot::PoolStats> statMap;
+    for (const auto &pool : stats.pool()) {
+        statMap[pool.d_bufferSize] = pool;
+    }
+
+    EXPECT_EQ(statMap[100].d_highwaterMark, 2);
+    EXPECT_EQ(statMap[100].d_currentAllocation, 2);
+    EXPECT_EQ(statMap[200].d_currentAllocation, 0);
+    EXPECT_EQ(statMap[300].d_currentAllocation, 1);
+}
+
+TEST(StatCollector, Listeners_Accepts_Per_Interval)
+{
+    StatCollector sc;
+    sc.collectListener(5672, 0, 10);
+    sc.collectListener(5672, 1, 4);
+
+    StatSnapshot stats;
+    sc.populateStats(&stats);
+
+    ASSERT_EQ(stats.listeners().size(), 2);
+    EXPECT_EQ(stats.listeners()[0].d_port, 5672);
+    EXPECT_EQ(stats.listeners()[0].d_shard, 0);
+    EXPECT_EQ(stats.listeners()[0].d_accepts, 10);
+    EXPECT_EQ(stats.listeners()[1].d_shard, 1);
+    EXPECT_EQ(stats.listeners()[1].d_accepts, 4);
+
+    sc.reset();
+    sc.collectListener(5672, 0, 15);
+    sc.collectListener(5672, 1, 2);
+    sc.collectListener(5673, 0, 3);
+
+    StatSnapshot stats2;
+    sc.populateStats(&stats2);
+
+    ASSERT_EQ(stats2.listeners().size(), 3);
+    EXPECT_EQ(stats2.listeners()[0].d_accepts, 5);
+    // Shard 1 was reopened, so its whole total is attributed to this interval
+    EXPECT_EQ(stats2.listeners()[1].d_accepts, 2);
+    EXPECT_EQ(stats2.listeners()[2].d_port, 5673);
+    EXPECT_EQ(stats2.listeners()[2].d_accepts, 3);
+}
+
+TEST(StatCollector, Memory_Pauses_Per_Interval)
+{
+    StatCollector sc;
+
+    StatSnapshot::MemoryStats memoryStats;
+    memoryStats.d_bytesInUse     = 2000;
+    memoryStats.d_highWatermark  = 1500;
+    memoryStats.d_lowWatermark   = 1000;
+    memoryStats.d_pausedSessions = 3;
+    memoryStats.d_pauses         = 5;
+    memoryStats.d_resumes        = 2;
+    sc.collectMemory(memoryStats);
+
+    StatSnapshot stats;
+    sc.populateStats(&stats);
+
+    EXPECT_EQ(stats.memory().d_bytesInUse, 2000);
+    EXPECT_EQ(stats.memory().d_highWatermark, 1500);
+    EXPECT_EQ(stats.memory().d_lowWatermark, 1000);
+    EXPECT_EQ(stats.memory().d_pausedSessions, 3);
+    EXPECT_EQ(stats.memory().d_pauses, 5);
+    EXPECT_EQ(stats.memory().d_resumes, 2);
+
+    sc.reset();
+    memoryStats.d_bytesInUse     = 900;
+    memoryStats.d_pausedSessions = 0;
+    memoryStats.d_pauses         = 6;
+    memoryStats.d_resumes        = 6;
+    sc.collectMemory(memoryStats);
+
+    StatSnapshot stats2;
+    sc.populateStats(&stats2);
+
+    EXPECT_EQ(stats2.memory().d_bytesInUse, 900);
+    EXPECT_EQ(stats2.memory().d_pausedSessions, 0);
+    EXPECT_EQ(stats2.memory().d_pauses, 1);
+    EXPECT_EQ(stats2.memory().d_resumes, 4);
+}
+
+TEST(StatCollector, Unchanged_Sessions_Stay_Counted)
+{
+    SessionState state1(nullptr);
+    SessionState state2(nullptr);
+    state1.setVirtualHost("foo");
+    state1.incrementIngressTotals(4, 5);
+    state2.setVirtualHost("foo");
+    state2.setPaused(true);
+
+    StatCollector sc;
+    sc.collect(state1);
+    sc.collect(state2);
+    sc.reset();
+
+    // Only state1 changed, state2 is still counted without being collected
+    state1.incrementIngressTotals(6, 7);
+    sc.collect(state1);
+
+    ConnectionStats expectedStats({{"pausedConnectionCount", 1},
+                                   {"activeConnectionCount", 2},
+                                   {"packetsReceived", 1},
+                                   {"framesReceived", 6},
+                                   {"bytesReceived", 7}},
+                                  {});
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+    EXPECT_EQ(snapshot.overall(), expectedStats);
+    EXPECT_EQ(snapshot.vhosts()["foo"], expectedStats);
+
+    sc.deletedSession(state1);
+    sc.deletedSession(state2);
+    sc.reset();
+
+    StatSnapshot snapshot2;
+    sc.populateStats(&snapshot2);
+    EXPECT_EQ(snapshot2.overall(), ConnectionStats());
+    EXPECT_TRUE(snapshot2.vhosts().empty());
+    EXPECT_TRUE(snapshot2.backends().empty());
+    EXPECT_TRUE(snapshot2.sources().empty());
+}
+
+TEST(StatCollector, Vhost_Change_Moves_Session)
+{
+    SessionState state(nullptr);
+    state.incrementIngressTotals(4, 5);
+
+    StatCollector sc;
+    sc.collect(state);
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+    EXPECT_EQ(
+        snapshot.vhosts()[""].statsValue(
+            ConnectionStats::Metric::ACTIVE_CONNECTION_COUNT),
+        1);
+    sc.reset();
+
+    state.setVirtualHost("foo");
+    state.setDisconnected(SessionState::DisconnectType::DISCONNECTED_CLEANLY);
+    sc.collect(state);
+
+    ConnectionStats expectedStats({{"removedConnectionGraceful", 1}}, {});
+
+    StatSnapshot snapshot2;
+    sc.populateStats(&snapshot2);
+    EXPECT_EQ(snapshot2.vhosts()["foo"], expectedStats);
+    EXPECT_EQ(snapshot2.vhosts()[""], ConnectionStats());
+    EXPECT_EQ(snapshot2.overall(), expectedStats);
+
+    // The empty vhost is gone once the interval is over
+    sc.deletedSession(state);
+    sc.reset();
+
+    StatSnapshot snapshot3;
+    sc.populateStats(&snapshot3);
+    EXPECT_TRUE(snapshot3.vhosts().empty());
+}
+
+TEST(StatCollector, Per_Source_Disabled)
+{
+    SessionState state(nullptr);
+    state.incrementIngressTotals(4, 5);
+
+    StatCollector sc;
+    sc.collect(state);
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+    EXPECT_EQ(snapshot.sources().size(), 1);
+    sc.reset();
+
+    sc.collectPerSourceStats(false);
+    state.incrementIngressTotals(4, 5);
+    sc.collect(state);
+
+    StatSnapshot snapshot2;
+    sc.populateStats(&snapshot2);
+    EXPECT_TRUE(snapshot2.sources().empty());
+    EXPECT_EQ(snapshot2.overall().statsValue(
+                  ConnectionStats::Metric::BYTES_RECEIVED),
+              5);
+}
+
+TEST(StatCollector, Latency_Histograms_Merged_Per_Interval)
+{
+    using Distribution = ConnectionStats::Distribution;
+
+    SessionState state1(nullptr);
+    SessionState state2(nullptr);
+    state1.setVirtualHost("foo");
+    state2.setVirtualHost("bar");
+    for (int i = 0; i < 99; ++i) {
+        state1.addIngressLatency(7);
+    }
+    state2.addIngressLatency(5000);
+    state2.addEgressLatency(7);
+
+    StatCollector sc;
+    sc.collect(state1);
+    sc.collect(state2);
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+
+    const LatencyHistogram &overall =
+        snapshot.overall().histogram(Distribution::RECEIVE_LATENCY);
+    EXPECT_EQ(overall.count(), 100);
+    EXPECT_EQ(overall.percentile(0.5), 7);
+    EXPECT_EQ(overall.percentile(0.99), 7);
+    EXPECT_GE(overall.percentile(0.999), 5000);
+
+    EXPECT_EQ(snapshot.vhosts()["foo"]
+                  .histogram(Distribution::RECEIVE_LATENCY)
+                  .percentile(0.999),
+              7);
+    EXPECT_EQ(
+        snapshot.vhosts()["bar"].histogram(Distribution::SEND_LATENCY).count(),
+        1);
+    sc.reset();
+
+    // Only the samples added since the last interval are in the next one
+    state2.addIngressLatency(10);
+    sc.collect(state2);
+
+    StatSnapshot snapshot2;
+    sc.populateStats(&snapshot2);
+    const LatencyHistogram &next =
+        snapshot2.overall().histogram(Distribution::RECEIVE_LATENCY);
+    EXPECT_EQ(next.count(), 1);
+    EXPECT_EQ(next.percentile(0.999), 10);
+    EXPECT_EQ(
+        snapshot2.overall().histogram(Distribution::SEND_LATENCY).count(), 0);
+}
+
+TEST(StatCollector, Top_Sources_Per_Vhost)
+{
+    using boost::asio::ip::address_v4;
+    using boost::asio::ip::tcp;
+
+    boost::asio::io_context ioContext;
+    tcp::endpoint           local(address_v4::loopback(), 5672);
+
+    SessionState heavy(nullptr);
+    heavy.setIngress(
+        ioContext, local, tcp::endpoint(address_v4(0x0a000001), 40000));
+    heavy.setVirtualHost("foo");
+    heavy.incrementIngressTotals(1, 1000);
+
+    SessionState light(nullptr);
+    light.setIngress(
+        ioContext, local, tcp::endpoint(address_v4(0x0a000002), 40000));
+    light.setVirtualHost("foo");
+    light.incrementIngressTotals(1, 10);
+
+    SessionState noVhost(nullptr);
+    noVhost.setIngress(
+        ioContext, local, tcp::endpoint(address_v4(0x0a000003), 40000));
+    noVhost.incrementIngressTotals(1, 5000);
+
+    StatCollector sc;
+    sc.collect(heavy);
+
+    // Disabled by default
+    StatSnapshot disabled;
+    sc.populateStats(&disabled);
+    EXPECT_TRUE(disabled.topSourcesByBytes().empty());
+    sc.reset();
+
+    sc.collectTopSources(true);
+    heavy.incrementEgressTotals(1, 500);
+    sc.collect(heavy);
+    sc.collect(light);
+    sc.collect(noVhost);
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+
+    const auto &byBytes = snapshot.topSourcesByBytes();
+    ASSERT_EQ(byBytes.size(), 2);
+    EXPECT_EQ(byBytes[0].d_vhost, "foo");
+    EXPECT_EQ(byBytes[0].d_source, "10.0.0.1");
+    EXPECT_EQ(byBytes[0].d_bytes, 500);
+    EXPECT_EQ(byBytes[0].d_connections, 1);
+    EXPECT_EQ(byBytes[1].d_source, "10.0.0.2");
+    EXPECT_EQ(byBytes[1].d_bytes, 10);
+    EXPECT_EQ(snapshot.topSourcesByConnections().size(), 2);
+    sc.reset();
+
+    // Each interval only counts what happened in it
+    light.incrementIngressTotals(1, 20);
+    sc.collect(light);
+
+    StatSnapshot snapshot2;
+    sc.populateStats(&snapshot2);
+    ASSERT_EQ(snapshot2.topSourcesByBytes().size(), 1);
+    EXPECT_EQ(snapshot2.topSourcesByBytes()[0].d_source, "10.0.0.2");
+    EXPECT_EQ(snapshot2.topSourcesByBytes()[0].d_bytes, 20);
+    EXPECT_EQ(snapshot2.topSourcesByBytes()[0].d_connections, 0);
+    EXPECT_TRUE(snapshot2.topSourcesByConnections().empty());
+}
+
+TEST(StatCollector, Top_Sources_Bounded_For_Each_Vhost)
+{
+    using boost::asio::ip::address_v4;
+    using boost::asio::ip::tcp;
+
+    boost::asio::io_context ioContext;
+    tcp::endpoint           local(address_v4::loopback(), 5672);
+
+    StatCollector sc;
+    sc.collectTopSources(true);
+
+    // A busy vhost with more sources than are reported, each sending more
+    // than the only source of a quiet one
+    std::vector<std::unique_ptr<SessionState>> sessions;
+    for (uint32_t i = 0; i <= StatCollector::TOP_SOURCES; ++i) {
+        sessions.push_back(std::make_unique<SessionState>(nullptr));
+        sessions.back()->setIngress(
+            ioContext, local, tcp::endpoint(address_v4(0x0a000001 + i), 1));
+        sessions.back()->setVirtualHost("busy");
+        sessions.back()->incrementIngressTotals(1, 1000 + i);
+        sc.collect(*sessions.back());
+    }
+
+    SessionState quiet(nullptr);
+    quiet.setIngress(
+        ioContext, local, tcp::endpoint(address_v4(0x0b000001), 1));
+    quiet.setVirtualHost("quiet");
+    quiet.incrementIngressTotals(1, 1);
+    sc.collect(quiet);
+
+    StatSnapshot snapshot;
+    sc.populateStats(&snapshot);
+
+    const auto &byBytes = snapshot.topSourcesByBytes();
+    ASSERT_EQ(byBytes.size(), StatCollector::TOP_SOURCES + 1);
+    for (std::size_t i = 0; i < StatCollector::TOP_SOURCES; ++i) {
+        EXPECT_EQ(byBytes[i].d_vhost, "busy");
+    }
+    EXPECT_EQ(byBytes[0].d_source, "10.0.0.11");
+    EXPECT_EQ(byBytes[0].d_bytes, 1010);
+    EXPECT_EQ(byBytes.back().d_vhost, "quiet");
+    EXPECT_EQ(byBytes.back().d_source, "11.0.0.1");
+    EXPECT_EQ(byBytes.back().d_bytes, 1);
+    EXPECT_EQ(byBytes.back().d_connections, 1);
+
+    const auto &byConnections = snapshot.topSourcesByConnections();
+    ASSERT_EQ(byConnections.size(), StatCollector::TOP_SOURCES + 1);
+    EXPECT_EQ(byConnections.back().d_vhost, "quiet");
+}
+
+TEST(StatCollector, Backend_Health_From_Store)
+{
+    StatCollector sc;
+
+    BackendStore store;
+    Backend backend1("backend1", "dc1", "host1", "127.0.0.1", 5672);
+    Backend backend2("backend2", "dc1", "host2", "127.0.0.2", 5672);
+    store.insert(backend2);
+    store.insert(backend1);
+    backend2.health()->recordCheck(false, 1, 1);
+
+    StatSnapshot unchecked;
+    sc.populateStats(&unchecked);
+    EXPECT_TRUE(unchecked.backendHealth().empty());
+
+    sc.setBackendStore(&store);
+    StatSnapshot stats;
+    sc.populateStats(&stats);
+
+    ASSERT_EQ(stats.backendHealth().size(), 2);
+    EXPECT_EQ(stats.backendHealth()[0].d_backend, "backend1");
+    EXPECT_TRUE(stats.backendHealth()[0].d_healthy);
+    EXPECT_EQ(stats.backendHealth()[1].d_backend, "backend2");
+    EXPECT_FALSE(stats.backendHealth()[1].d_healthy);
+    EXPECT_EQ(stats.backendHealth()[1].d_consecutiveFailures, 1);
+}
@@ -0,0 +1,169 @@
+/*
+** Copyright 2020 Bloomberg Finance L.P.
+**
+** Licensed under the Apache License, Version 2.0 (the "License");
+** you may not use this file except in compliance with the License.
+** You may obtain a copy of the License at
+**
+**     http://www.apache.org/licenses/LICENSE-2.0
+**
+** Unless required by applicable law or agreed to in writing, software
+** distributed under the License is distributed on an "AS IS" BASIS,
+** WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+** See the License for the specific language governing permissions and
+** limitations under the License.
+*/
+#include <amqpprox_statsdpublisher.h>
+
+#include <amqpprox_connectionstats.h>
+#include <amqpprox_statsnapshot.h>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/asio.hpp>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace Bloomberg;
+using namespace amqpprox;
+
+namespace {
+
+/**
+ * \brief Receives the datagrams sent to a local UDP port
+ */
+class StatsDPublisherTest : public ::testing::Test {
+  protected:
+    boost::asio::io_context      d_ioContext;
+    boost::asio::ip::udp::socket d_sink;
+
+    StatsDPublisherTest()
+    : d_ioContext()
+    , d_sink(d_ioContext,
+             boost::asio::ip::udp::endpoint(
+                 boost::asio::ip::address_v4::loopback(), 0))
+    {
+    }
+
+    int port() const { return d_sink.local_endpoint().port(); }
+
+    /**
+     * \brief Run the sends, then take every datagram received
+     */
+    std::vector<std::string> receive()
+    {
+        d_ioContext.restart();
+        d_ioContext.run();
+
+        std::vector<std::string> datagrams;
+        std::vector<char>        buffer(65536);
+        while (d_sink.available() > 0) {
+            std::size_t size =
+                d_sink.receive(boost::asio::buffer(buffer.data(), 65536));
+            datagrams.emplace_back(buffer.data(), size);
+        }
+        return datagrams;
+    }
+
+    static std::vector<std::string>
+    lines(const std::vector<std::string> &datagrams)
+    {
+        std::vector<std::string> result;
+        for (const auto &datagram : datagrams) {
+            std::vector<std::string> split;
+            boost::split(split, datagram, boost::is_any_of("\n"));
+            result.insert(result.end(), split.begin(), split.end());
+        }
+        return result;
+    }
+};
+
+}
+
+TEST_F(StatsDPublisherTest, Connection_Stats_In_One_Datagram)
+{
+    StatsDPublisher publisher(&d_ioContext, "127.0.0.1", port());
+
+    ConnectionStats stats({{"activeConnectionCount", 3}, {"bytesSent", 42}},
+                          {});
+    publisher.publish(stats, {{"rmqEndpointType", "overall"}});
+    publisher.flush();
+
+    auto datagrams = receive();
+    ASSERT_EQ(datagrams.size(), 1);
+
+    auto metrics = lines(datagrams);
+    ASSERT_EQ(metrics.size(), ConnectionStats::NUM_METRICS);
+    EXPECT_EQ(metrics[0],
+              "amqpprox.pausedConnectionCount,rmqEndpointType=overall:0|g");
+    EXPECT_EQ(metrics[1],
+              "amqpprox.activeConnectionCount,rmqEndpointType=overall:3|g");
+    EXPECT_EQ(metrics[13], "amqpprox.bytesSent,rmqEndpointType=overall:42|c");
+}
+
+TEST_F(StatsDPublisherTest, Nothing_Sent_Until_Flushed)
+{
+    StatsDPublisher publisher(&d_ioContext, "127.0.0.1", port());
+
+    StatSnapshot::ProcessStats process;
+    publisher.publish(process);
+    EXPECT_TRUE(receive().empty());
+
+    publisher.flush();
+    auto datagrams = receive();
+    ASSERT_EQ(datagrams.size(), 1);
+    EXPECT_EQ(lines(datagrams).size(), 4);
+
+    publisher.flush();
+    EXPECT_TRUE(receive().empty());
+}
+
+TEST_F(StatsDPublisherTest, Datagrams_Fit_Max_Size)
+{
+    StatSnapshot snapshot;
+    snapshot.overall().statsValue(ConnectionStats::Metric::BYTES_SENT) = 99;
+    for (int i = 0; i < 20; ++i) {
+        snapshot.vhosts()["vhost" + std::to_string(i)] = ConnectionStats();
+        snapshot.backends()["backend" + std::to_string(i)] =
+            ConnectionStats();
+    }
+
+    StatsDPublisher unlimited(&d_ioContext, "127.0.0.1", port(), 65000);
+    unlimited.publish(snapshot);
+    auto expected = lines(receive());
+
+    const std::size_t maxSize = 512;
+    StatsDPublisher   publisher(&d_ioContext, "127.0.0.1", port(), maxSize);
+    publisher.publish(snapshot);
+    auto datagrams = receive();
+
+    // (1 overall + 20 vhosts + 20 backends) * 14 metrics, plus 4 process
+    // metrics and the heap spillover
+    EXPECT_EQ(expected.size(), 41 * ConnectionStats::NUM_METRICS + 5);
+    EXPECT_EQ(lines(datagrams), expected);
+
+    std::size_t bytes = 0;
+    for (const auto &datagram : datagrams) {
+        EXPECT_LE(datagram.size(), maxSize);
+        bytes += datagram.size() + 1;
+    }
+
+    // Datagrams are filled up rather than sent a few metrics at a time
+    EXPECT_LT(datagrams.size(), bytes / (maxSize - 100) + 1);
+    EXPECT_GT(datagrams.size(), 1);
+}
+
+TEST_F(StatsDPublisherTest, Oversized_Metric_Sent_Alone)
+{
+    StatsDPublisher publisher(&d_ioContext, "127.0.0.1", port(), 10);
+
+    StatSnapshot::MemoryStats memory;
+    publisher.publish(memory);
+    publisher.flush();
+
+    auto datagrams = receive();
+    ASSERT_EQ(datagrams.size(), 4);
+    EXPECT_EQ(datagrams[0], "amqpprox.buffer_memory_bytes:0|g");
+}
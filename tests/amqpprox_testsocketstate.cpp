@@ -39,11 +39,40 @@ TestSocketState::State &TestSocketState::currentState()
 std::size_t
 TestSocketState::recordData(const void *data, std::size_t len, ErrorCode &ec)
 {
+    if (d_writeError) {
+        ec = d_writeError;
+    }
+
     auto dataptr = static_cast<const uint8_t *>(data);
     Data toRecord(std::vector<uint8_t>(dataptr, dataptr + len), ec);
     d_stateMachine[d_currentStep].d_record.push_back(toRecord);
     // TODO Enhancement: this might want to indicate a partial write
-    return len;
+    return ec ? 0 : len;
+}
+
+void TestSocketState::failWrites(ErrorCode ec)
+{
+    d_writeError = ec;
+}
+
+void TestSocketState::holdWrites(bool hold)
+{
+    d_holdWrites = hold;
+}
+
+bool TestSocketState::writesHeld() const
+{
+    return d_holdWrites;
+}
+
+void TestSocketState::allowSpeculativeReads(bool allow)
+{
+    d_speculativeReads = allow;
+}
+
+bool TestSocketState::speculativeReadsAllowed() const
+{
+    return d_speculativeReads;
 }
 
 void TestSocketState::handleTransition(std::function<void(Item *)> handler)
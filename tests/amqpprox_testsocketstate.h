@@ -133,6 +133,9 @@ class TestSocketState {
     int                           d_currentStep;
     State                         d_currentState;
     std::function<void(Item *)>   d_handler;
+    ErrorCode                     d_writeError;
+    bool                          d_holdWrites{false};
+    bool                          d_speculativeReads{false};
 
   public:
     /**
@@ -195,6 +198,43 @@ class TestSocketState {
      */
     std::size_t recordData(const void *data, std::size_t len, ErrorCode &ec);
 
+    /**
+     * \brief Make every write recorded from now on fail
+     * \param ec The error code the writes fail with
+     */
+    void failWrites(ErrorCode ec);
+
+    /**
+     * \brief Set whether writes recorded from now on are left outstanding
+     *
+     * The data of a held write is recorded as usual, but its completion is
+     * only delivered once a `WriteComplete` item is driven, oldest first.
+     *
+     * \param hold true to hold the completion of writes
+     */
+    void holdWrites(bool hold);
+
+    /**
+     * \return true if the completion of writes is being held
+     */
+    bool writesHeld() const;
+
+    /**
+     * \brief Set whether `read_some` may be called without first waiting
+     * for the socket to become readable
+     *
+     * When allowed, data driven while no read is waiting is left for the
+     * next `read_some`, which sets `would_block` if there is none.
+     *
+     * \param allow true to allow speculative reads
+     */
+    void allowSpeculativeReads(bool allow);
+
+    /**
+     * \return true if speculative reads are allowed
+     */
+    bool speculativeReadsAllowed() const;
+
     /**
      * \brief Stage an `Item` for a particular step
      * \param step The state step the item is for
@@ -63,3 +63,20 @@ TEST(VhostState, Print_Two) {
 
     EXPECT_EQ(oss.str(), "bar = UNPAUSED\nfoo = PAUSED\n");
 }
+
+TEST(VhostState, Count_Only) {
+    VhostState state;
+    EXPECT_FALSE(state.isCountOnly("/"));
+
+    state.setCountOnly("/", true);
+    EXPECT_TRUE(state.isCountOnly("/"));
+    EXPECT_FALSE(state.isPaused("/"));
+    EXPECT_FALSE(state.isCountOnly("unrelated"));
+
+    std::ostringstream oss;
+    state.print(oss);
+    EXPECT_EQ(oss.str(), "/ = UNPAUSED COUNT_ONLY\n");
+
+    state.setCountOnly("/", false);
+    EXPECT_FALSE(state.isCountOnly("/"));
+}
@@ -0,0 +1,199 @@
+#
+# Copyright 2022 Bloomberg Finance L.P.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+
+# Runs the same data throughput test through amqpprox with readiness-driven
+# reads and with --speculativeReads, reporting for each the system calls made
+# per GB passed through and the worst per-interval p99 send and receive
+# latencies published by STAT.
+#
+# Needs `perf` with access to the raw_syscalls tracepoints, and amqpprox and
+# amqpprox_ctl on the PATH or in AMQPPROX_BIN_DIR.
+
+import argparse
+import json
+import os
+import signal
+import socket
+import subprocess
+import tempfile
+from contextlib import closing
+from time import sleep
+
+AMQPPROX_PORT = 30672
+PERF_TEST_PORT = 30671
+
+STRATEGIES = [("readiness", []), ("speculative", ["--speculativeReads"])]
+
+
+def check_socket(host, port):
+    with closing(socket.socket(socket.AF_INET, socket.SOCK_STREAM)) as sock:
+        return sock.connect_ex((host, port)) == 0
+
+
+def binary(name):
+    bin_dir = os.environ.get("AMQPPROX_BIN_DIR")
+    return os.path.join(bin_dir, name) if bin_dir else name
+
+
+def run_perf_test(args):
+    env = os.environ.copy()
+    env["RUST_LOG"] = "warn"
+
+    subprocess.run(
+        [
+            env.get("CARGO_PATH", "cargo"),
+            "run",
+            "--release",
+            "--manifest-path",
+            os.path.join(os.path.dirname(__file__), "Cargo.toml"),
+            "--",
+            "--address",
+            f"amqp://localhost:{AMQPPROX_PORT}",
+            "--listen-address",
+            f"0.0.0.0:{PERF_TEST_PORT}",
+            "--clients",
+            str(args.clients),
+            "--max-threads",
+            str(args.clients),
+            "--message-size",
+            str(args.message_size),
+            "--num-messages",
+            str(args.num_messages),
+        ],
+        env=env,
+        check=True,
+    )
+
+
+def read_syscalls(path):
+    # perf stat -x, writes "<count>,<unit>,<event>,..." per event
+    with open(path) as f:
+        for line in f:
+            fields = line.split(",")
+            if len(fields) > 2 and fields[2].startswith("raw_syscalls"):
+                return int(fields[0])
+    raise RuntimeError(f"No system call count in {path}")
+
+
+def read_stats(path):
+    total_bytes = 0
+    p99 = {"sendLatency": 0, "receiveLatency": 0}
+    with open(path) as f:
+        for line in f:
+            try:
+                stats = json.loads(line)
+            except ValueError:
+                continue
+
+            total_bytes += stats["bytesSent"] + stats["bytesReceived"]
+            for name in p99:
+                if stats[name]["count"] > 0:
+                    p99[name] = max(p99[name], stats[name]["p99"])
+    return total_bytes, p99
+
+
+def run_strategy(args, flags, workdir):
+    control = os.path.join(workdir, "control")
+    amqpprox = subprocess.Popen(
+        [
+            binary("amqpprox"),
+            "--listenPort",
+            str(AMQPPROX_PORT),
+            "--destinationPort",
+            str(PERF_TEST_PORT),
+            "--destinationDNS",
+            "localhost",
+            "--controlSocket",
+            control,
+            "--logDirectory",
+            os.path.join(workdir, "logs"),
+        ]
+        + flags
+    )
+
+    while not check_socket("localhost", AMQPPROX_PORT):
+        sleep(0.5)
+
+    stats_path = os.path.join(workdir, "stats.json")
+    syscalls_path = os.path.join(workdir, "syscalls.csv")
+    with open(stats_path, "w") as stats_file:
+        stat = subprocess.Popen(
+            [
+                binary("amqpprox_ctl"),
+                control,
+                "STAT",
+                "LISTEN",
+                "json",
+                "overall",
+            ],
+            stdout=stats_file,
+        )
+        perf = subprocess.Popen(
+            [
+                "perf",
+                "stat",
+                "-x,",
+                "-e",
+                "raw_syscalls:sys_enter",
+                "-p",
+                str(amqpprox.pid),
+                "-o",
+                syscalls_path,
+            ]
+        )
+
+        try:
+            run_perf_test(args)
+
+            # Let the last interval's statistics be published
+            sleep(2)
+        finally:
+            perf.send_signal(signal.SIGINT)
+            perf.wait()
+            stat.kill()
+            amqpprox.kill()
+            amqpprox.wait()
+
+    total_bytes, p99 = read_stats(stats_path)
+    return read_syscalls(syscalls_path), total_bytes, p99
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Compare readiness-driven and speculative reads"
+    )
+    parser.add_argument("--clients", type=int, default=10)
+    parser.add_argument("--message-size", type=int, default=10000000)
+    parser.add_argument("--num-messages", type=int, default=50)
+    args = parser.parse_args()
+
+    print(
+        f"{'strategy':<12} {'syscalls/GB':>12} {'send p99 us':>12} "
+        f"{'receive p99 us':>15}"
+    )
+    for name, flags in STRATEGIES:
+        with tempfile.TemporaryDirectory() as workdir:
+            syscalls, total_bytes, p99 = run_strategy(args, flags, workdir)
+
+        per_gb = syscalls / (total_bytes / 1e9) if total_bytes else 0
+        print(
+            f"{name:<12} {per_gb:>12.0f} {p99['sendLatency']:>12} "
+            f"{p99['receiveLatency']:>15}"
+        )
+
+
+if __name__ == "__main__":
+    main()